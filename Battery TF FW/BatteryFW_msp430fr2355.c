@@ -1,23 +1,81 @@
-/* Battery Test Fixure MSP430FR2355 Firmware 
+/* Battery Test Fixure MSP430FR2355 Firmware
 // Author: N. Ramirez
 // __________________________________________________________________________________
 //
 //  Mainloop:
-//  Monitor ADC (n12vFlt)
-//  if ADC is High
-//      Disable VBat1 and VBat2
-//      Enable ChrgEn1 and ChrgEn2
-//  else
-//      Enable VBat1 and VBat2
-//      Disable ChrgEn1 and ChrgEn2
-//
-//  This works on Single-Channel Single-Conversion Mode.
-//  Software sets ADCSC to start sample and conversion - ADCSC automatically
-//  cleared at EOC. ADC internal oscillator times sample (16x) and conversion.
-//  In Mainloop MSP430 waits in LPM0 to save power until ADC conversion complete,
-//  ADC_ISR will force exit from LPM0 in Mainloop on reti.
-//  
-//  ACLK = default REFO ~32768Hz, MCLK = SMCLK = default DCODIV ~1MHz.
+//  Sleep in LPM3 (LPM0 while a module needs SMCLK) until an ISR posts an event
+//  On a supervisor or trip event:
+//  Step the battery 1 and battery 2 state machines (battery_sm.h), which
+//  drive ChrgEnx, DisChgx and VBATx_OFF per channel from the 12 V rail
+//  state and nBatxFlt, switched in make-before-break order with timed
+//  dead time and overlap (power_seq.h)
+//  if the 12 V rail is tripped (n12VFlt Low)
+//      Enable First 3 LEDs
+//  LED 4 and LED 5 show the state of battery 1 and battery 2
+//
+//  The LEDs are driven by the LED engine (led.h) from a Timer2_B ISR with
+//  PWM dimming and patterns; the main loop only picks the pattern.
+//
+//  The status inputs on port 6 and P2.4 are sampled and debounced by the
+//  supervisor from a Timer0_B tick (see supervisor.h for rate and
+//  worst-case latency). The CPU only runs when one of them changes. The
+//  12 V fault itself does not wait for the tick: power_trip.c switches to
+//  the batteries from the TB3.3 capture ISR and the main loop only follows up.
+//
+//  IOUT1/IOUT2 are sampled continuously (iout_sampler.h) while a battery is
+//  charging, discharging or backing the load; the CPU then sleeps in LPM0
+//  and wakes once per half ring instead of LPM3.
+//
+//  TH1/TH2 are read once a second (therm.h); a battery over temperature
+//  stops charging. They and IOUT share the ADC through the ADC service
+//  (adc.h), which chains queued conversions from its ISR; the ADC scheduler
+//  (adc_sched.h) releases them, and DVCC and the die temperature every
+//  10 s, from the supervisor tick, and measures their sample time jitter.
+//
+//  Once a second the charge termination (charge.h) checks each charging
+//  battery for current taper, -dV, temperature rise and the safety timer,
+//  with its ACOK input gating the charge, and ends the charge when done.
+//
+//  A test discharge is plain on/off, or regulated to a constant current or
+//  a constant power (discharge.h): DisChgx is then PWM from Timer3_B, the
+//  duty set by a PI loop in the ADC ISR.
+//
+//  On request, the internal resistance of an idle battery is measured with
+//  a DisChgx load pulse (ir_test.h): the edge is timed by Timer3_B against
+//  the IOUT trigger, the current read in bursts just before and after it,
+//  the voltage from the gauge.
+//
+//  The Raspberry Pi talks to the fixture over eUSCI_A1 (host_link.h):
+//  periodic telemetry out, commands in. The link holds SMCLK (LPM0) only
+//  while it sends or has heard from the host in the last second; idle, it
+//  lets the CPU sleep in LPM3 and the start bit of the next character
+//  (UCSTTIE) wakes it.
+//
+//  The smart battery gauges are polled on their own I2C buses (sbs.h),
+//  battery 1 on UCB0 and battery 2 on UCB1, both at the same time from
+//  their ISRs; the main loop only queues the reads that are due.
+//
+//  nPWR_OFF_Int (P2.4) shuts the fixture down from the port 2 ISR within
+//  SHUTDOWN_LATENCY_US (shutdown.h): outputs safe, coulomb counts in FRAM,
+//  then nSWTurnOFFPower (P2.3) low.
+//
+//  Every status input edge, 12 V rail change and battery state change seen
+//  here, and each boot and shutdown, is appended to the FRAM event log
+//  (event_log.h) with its RTC time; the Pi reads it back over the link.
+//
+//  The time spent awake, in LPM0 and in LPM3, the interrupts per source and
+//  an energy estimate are kept by energy.h for the host.
+//
+//  While the transient capture is armed (capture.h), IOUT runs all the
+//  time into a RAM ring; a 12 V or battery fault freezes the pairs around
+//  it, which the main loop copies to FRAM for the Pi.
+//
+//  Before anything else is set up, a timed power-on self test (post.h)
+//  checks the FRAM image CRC, the ADC reference and rails, the clocks and
+//  the die temperature, with the ADC calibration from the TLV (cal.h);
+//  failures go to the event log and the host.
+//
+//  ACLK = default REFO ~32768Hz, MCLK = SMCLK = DCOCLKDIV = 16MHz.
 //
 //               MSP430FR2355
 //            -----------------
@@ -33,101 +91,288 @@
 //
 //
 //  __________________________________________________________________________________*/
-#include <msp430.h>
-
-// Port 1 definitions
-#define IOUT1   (BIT0)                      // P1.0 IOUT1 input
-#define IOUT2   (BIT1)                      // P1.1 IOUT2 input
-#define i2cData1  (BIT2)                      // P1.2 I2C Data 1 
-#define i2cClk1   (BIT3)                      // P1.3 I2C Clock 1 
-
-// Port 2 definitions
-#define DM_12V_En   (BIT0)                      // P2.0 DM 12V Enable output
-#define DM_VBat2_En (BIT1)                      // P2.1 DM Battery Voltage 2 Enable output
-#define DM_VBat1_En (BIT2)                      // P2.2 DM Battery Voltage 1 output
-#define nSWTurnOFFPower  (BIT3)                      // P2.3 SW Turn off power - active low output
-#define nPWR_OFF_Int (BIT4)                      // P2.4 Power off intterrupt - active low input
-
-// Port 3 definitions
-#define LED_1   (BIT0)                      // P3.0 LED output
-#define LED_2   (BIT1)                      // P3.1 LED output
-#define LED_3   (BIT2)                      // P3.2 LED output
-#define LED_4   (BIT3)                      // P3.3 LED output
-#define LED_5   (BIT4)                      // P3.4 LED output
-#define LED_6   (BIT5)                      // P3.5 LED output
-
-// Port 4 definitions
-#define VBAT1_OFF   (BIT4)                      // 4.4 Battery Voltage 1 Off output
-#define VBAT2_OFF   (BIT5)                      // 4.5 Battery Voltage 2 Off output
-#define i2cData2    (BIT6)                      // 4.6 I2C Data 2 
-#define i2cClk2     (BIT7)                      // 4.7 I2C Clock 2 
-
-// Port 5 definitions
-#define ChrgEn1 (BIT0)                      // P5.0 Enable Battery 1 Charging output
-#define ChrgEn2 (BIT1)                      // P5.1 Enable Battery 1 Charging output
-#define TH1     (BIT2)                      // P5.2 TH1 intput
-#define TH2     (BIT3)                      // P5.3 TH2 intput
-
-// Port 6 definitions
-#define DisChg1 (BIT0)                      // P6.0 LED output
-#define DisChg2 (BIT1)                      // P6.1 LED output
-#define n12VFlt (BIT2)                      // P6.2 12V Fault - active low input
-#define nBat1Flt (BIT3)                      // P6.3 Battery 1 Fault - active low input
-#define nBat2Flt (BIT4)                      // P6.4 Battery 2 Fault - active low input
-#define ACOK2 (BIT5)                      // P6.5 ACOK2 input
-#define ACOK1 (BIT6)                      // P6.6 ACOK1 input
-
-
-// unsigned int ADC_Result;
+#include "BatteryFW_msp430fr2355.h"
+#include "supervisor.h"
+#include "power_trip.h"
+#include "power_seq.h"
+#include "battery_sm.h"
+#include "charge.h"
+#include "discharge.h"
+#include "ir_test.h"
+#include "adc.h"
+#include "adc_sched.h"
+#include "iout_sampler.h"
+#include "capture.h"
+#include "coulomb.h"
+#include "therm.h"
+#include "host_link.h"
+#include "sbs.h"
+#include "shutdown.h"
+#include "led.h"
+#include "rtc.h"
+#include "event_log.h"
+#include "energy.h"
+#include "post.h"
+#include "cal.h"
 
+volatile unsigned int Pending_Events = 0;
+volatile unsigned int SMCLK_Requests = 0;
 
-int main(void)
+void Init_Clock(void);
+void Software_Trim();                       // Software Trim to get the best DCOFTRIM value
+void Power_Select(void);
+
+static unsigned char Power_LastState[BATT_CHANNELS] = { 0xFF, 0xFF };   // Logged states
+static unsigned char Power_LastRail = 0xFF;
+
+// LED pattern per battery state
+static const unsigned char Batt_Led[BATT_STATES] =
 {
-    WDTCTL = WDTPW | WDTHOLD;                      // Stop WDT
+    LED_OFF,            // IDLE
+    LED_BREATHE,        // CHARGE
+    LED_BLINK,          // DISCHARGE
+    LED_BLINK_FAST,     // FAULT
+    LED_DIM,            // COOLDOWN
+    LED_BLINK_FAST      // HOT
+};
 
-    // Configure GPIO
-    P3DIR |= LED_1 + LED_2 + LED_3 + LED_4 + LED_5 + LED_6       // Set P3.0 - P3.5 LEDs as outputs
-    // P3OUT &= ~(LED_1 + LED_2 + LED_3 + LED_4 + LED_5 + LED_6);  // Set all LEDs off at start up
+int main(void)
+{
+    unsigned int events;
 
-    P6DIR &= ~n12VFlt;      // Set P6.2 (n12VFlt) as Input
-    P6REN = n12VFlt;        // Enable Pullup/down resistor for P6.2 (n12VFlt)
-    P6OUT = n12VFlt;        // Select Pullup
+    WDTCTL = WDTPW | WDTHOLD;                      // Stop WDT
 
-    P4DIR |= VBAT1_OFF + VBAT2_OFF;     // Set P4.4(VBAT1_OFF) and P4.5(VBAT2_OFF) as outputs
-    // P4OUT |= VBAT1_OFF + VBAT2_OFF;     //drive output HIGH initially
+    Init_Clock();                   // MCLK = SMCLK = 16MHz, ACLK = REFO
+    Cal_Init();                     // ADC calibration from the TLV
+    Post_Run();                     // Image CRC, ADC reference, clock, die temperature, timed
 
-    P5DIR |= ChrgEn1 + ChrgEn2;     // Set P5.0(ChrgEn1) and P5.1(ChrgEn2) as outputs
-    // P5OUT |= ChrgEn1 + ChrgEn2;     //drive output HIGH initially
+    Led_Init();                     // P3.0 - P3.5 LEDs off, PWM on Timer2_B
 
     // Disable the GPIO power-on default high-impedance mode to activate
     // previously configured port settings
-    // PM5CTL0 &= ~LOCKLPM5;
+    PM5CTL0 &= ~LOCKLPM5;
+
+    Rtc_Init();                     // Seconds count, ACLK / 1024
+    Log_Init();                     // Event log head from FRAM, boot record
+    Post_Log();                     // Failed self test stages
+    Supervisor_Init();              // Port 6 status inputs, Timer0_B tick
+    Energy_Init();                  // Sleep mode residency on TB0R
+    Seq_Init();                     // Power path sequencer, steps on TB3CCR5
+    Dischg_Init();                  // Regulated discharge, PWM on TB3CCR1/TB3CCR2
+    Ir_Init();                      // Internal resistance test, edge on TB3CCR1/TB3CCR2
+    Trip_Init();                    // n12VFlt capture on TB3.3, TB3 on ACLK while idle
+    Batt_Init(Supervisor_Inputs(), Trip_RailGood());   // Per battery state machines, outputs
+    Charge_Init();                  // Charge termination, once a second
+    Adc_Init();                     // ADC service, request queue and stream
+    Sched_Init();                   // Slow ADC channels on the supervisor tick, DVCC, die temperature
+    Iout_Init();                    // IOUT1/IOUT2 ADC pins
+    Capture_Init();                 // Transient capture, armed from the window in FRAM
+    Coulomb_Init();                 // Restore charge counts from FRAM
+    Shutdown_Init();                // nPWR_OFF_Int on P2.4, nSWTurnOFFPower on P2.3
+    Therm_Init();                   // TH1/TH2 ADC pins, scheduled once a second
+    Host_Init();                    // Pi link on eUSCI_A1, telemetry on TB0CCR1
+    Sbs_Init();                     // Gauges on eUSCI_B0/eUSCI_B1, schedule on TB0CCR2
+
+    Power_Select();                 // Apply the power-on state before the first tick
 
     while(1)
     {
-        // ADCCTL0 |= ADCENC | ADCSC;                            // Sampling and conversion start
-        // __bis_SR_register(LPM0_bits | GIE);                   // LPM0, ADC_ISR will force exit
-
-        // Power Selection
-        if( !(P6IN & n12VFlt) ) //Evaluates to True for a 'LOW' on P6.2(n12VFlt)
+        __disable_interrupt();
+        if(Pending_Events == 0)
         {
-            // Enable VBat
-            P4OUT |= VBAT1_OFF + VBAT2_OFF;       // Set P4.4(VBAT1_OFF) and P4.5(VBAT2_OFF) HIGH
-            // Disable Battery Charge
-            P5OUT &= ~(ChrgEn1 + ChrgEn2);        // Set P5.0(ChrgEn1) and P5.1(ChrgEn2) LOW
+            Energy_Sleep(SMCLK_Requests);
+            if(SMCLK_Requests)
+                __bis_SR_register(LPM0_bits | GIE); // LPM0, an ISR will force exit
+            else
+                __bis_SR_register(LPM3_bits | GIE); // LPM3, an ISR will force exit
+            Energy_Wake();
+        }
+        __disable_interrupt();
+        events = Pending_Events;
+        Pending_Events = 0;
+        __enable_interrupt();
 
-            // Enable First 3 LEDs
-            P4OUT |= LED_1 + LED_2 + LED_3;
+        if(events & (EVT_SUPERVISOR + EVT_TRIP))
+            Power_Select();
+        if(events & EVT_IOUT_BLOCK)
+            Iout_Process();
+        if(events & EVT_CAPTURE)
+        {
+            Capture_Save();         // Window to FRAM, sampling goes on
+            Power_Select();         // IOUT may stop with the record held
+        }
+        if(events & EVT_ADC_AUX)
+        {
+            Therm_Process();        // May stop charging on over temperature
+            Power_Select();
+        }
+        if(events & EVT_HOST_RX)
+        {
+            Host_Process();         // Commands may change a battery state
+            Power_Select();
+        }
+        if(events & EVT_HOST_TX)
+            Host_TxReady();
+        if(events & EVT_TELEMETRY)
+            Host_Telemetry();
+        if(events & EVT_SBS_TICK)
+        {
+            Sbs_Tick();
+            Ir_Tick();              // Gauge voltages for the internal resistance test
+        }
+        if(events & EVT_LED)
+            Led_Tick();
+        if(events & EVT_SECOND)
+        {
+            Charge_Second();        // May end a charge with BEV_DONE
+            Dischg_Second();        // Loop rate, constant power targets
+            Batt_Second();
+            Coulomb_Second();       // Batched FRAM commit
+            Host_Second();
+            Power_Select();         // A timeout may have changed a battery state
         }
-        else                    //P6.2(n12VFlt) is HIGH
+    }
+}
+
+// Power Selection
+void Power_Select(void)
+{
+    unsigned char ch;
+    unsigned char active = !Trip_RailGood();    // Batteries back the load
+    unsigned int fell;
+    unsigned int rose;
+
+    // Per battery charge / discharge / VBat outputs, from the debounced status edges
+    Supervisor_Edges(&fell, &rose);
+    Batt_Update(Supervisor_Inputs(), (unsigned char)fell, (unsigned char)rose, Trip_RailGood());
+
+    // Event log: input edges, source change, battery state changes
+    Log_Inputs(fell, rose, Supervisor_State());
+    if(Trip_RailGood() != Power_LastRail)
+    {
+        Power_LastRail = Trip_RailGood();
+        Log_Append(LOG_RAIL, Power_LastRail);
+    }
+
+    // Sample battery current only while some battery current can flow, or
+    // the transient capture needs its history
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        if(Batt_State(ch) != Power_LastState[ch])
         {
-            // Disable VBat
-            P4OUT &= ~(VBAT1_OFF + VBAT2_OFF);       // Set P4.4(VBAT1_OFF) and P4.5(VBAT2_OFF) LOW
-            // Enable Battery Charge
-            P5OUT |= ChrgEn1 + ChrgEn2;        // Set P5.0(ChrgEn1) and P5.1(ChrgEn2) HIGH
-            // Disable First 3 LEDs
-            P4OUT &= ~(LED_1 + LED_2 + LED_3);
+            Power_LastState[ch] = Batt_State(ch);
+            Log_Append(LOG_BATT, (ch << 4) | Power_LastState[ch]);
         }
+        if(Batt_State(ch) == BATT_CHARGE || Batt_State(ch) == BATT_DISCHARGE)
+            active = 1;
+        if(Batt_State(ch) == BATT_CHARGE && Trip_RailGood())
+            Coulomb_SetDirection(ch, COULOMB_IN);
+        else
+            Coulomb_SetDirection(ch, COULOMB_OUT);
+        Led_Set(3 + ch, Batt_Led[Batt_State(ch)]);  // LED 4, LED 5
+    }
+    if(active || Ir_Busy() || Capture_Armed())
+        Iout_Start(IOUT_RATE_HZ);
+    else
+        Iout_Stop();
 
+    if( !Trip_RailGood() ) //True from the n12VFlt falling edge until the restore hysteresis expires
+    {
+        // Enable First 3 LEDs
+        for(ch = 0; ch < 3; ch++)
+            Led_Set(ch, LED_ON);
     }
-}
\ No newline at end of file
+    else                    //P6.2(n12VFlt) is HIGH and stayed HIGH
+    {
+        // Disable First 3 LEDs
+        for(ch = 0; ch < 3; ch++)
+            Led_Set(ch, LED_OFF);
+    }
+}
+
+void Init_Clock(void)
+{
+    // Configure one FRAM waitstate as required by the device datasheet for MCLK
+    // operation beyond 8MHz _before_ configuring the clock system.
+    FRCTL0 = FRCTLPW | NWAITS_1;
+
+    __bis_SR_register(SCG0);                           // disable FLL
+    CSCTL3 |= SELREF__REFOCLK;                         // Set REFO as FLL reference source
+    CSCTL1 = DCOFTRIMEN_1 | DCOFTRIM0 | DCOFTRIM1 | DCORSEL_5;// DCOFTRIM=5, DCO Range = 16MHz
+    CSCTL2 = FLLD_0 + 487;                             // DCOCLKDIV = 16MHz
+    __delay_cycles(3);
+    __bic_SR_register(SCG0);                           // enable FLL
+    Software_Trim();                                   // Software Trim to get the best DCOFTRIM value
+
+    CSCTL4 = SELMS__DCOCLKDIV | SELA__REFOCLK;         // set default REFO(~32768Hz) as ACLK source, ACLK = 32768Hz
+                                                       // default DCOCLKDIV as MCLK and SMCLK source
+}
+
+void Software_Trim()
+{
+    unsigned int oldDcoTap = 0xffff;
+    unsigned int newDcoTap = 0xffff;
+    unsigned int newDcoDelta = 0xffff;
+    unsigned int bestDcoDelta = 0xffff;
+    unsigned int csCtl0Copy = 0;
+    unsigned int csCtl1Copy = 0;
+    unsigned int csCtl0Read = 0;
+    unsigned int csCtl1Read = 0;
+    unsigned int dcoFreqTrim = 3;
+    unsigned char endLoop = 0;
+
+    do
+    {
+        CSCTL0 = 0x100;                         // DCO Tap = 256
+        do
+        {
+            CSCTL7 &= ~DCOFFG;                  // Clear DCO fault flag
+        }while (CSCTL7 & DCOFFG);               // Test DCO fault flag
+
+        __delay_cycles((unsigned int)3000 * MCLK_FREQ_MHZ);// Wait FLL lock status (FLLUNLOCK) to be stable
+                                                           // Suggest to wait 24 cycles of divided FLL reference clock
+        while((CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1)) && ((CSCTL7 & DCOFFG) == 0));
+
+        csCtl0Read = CSCTL0;                   // Read CSCTL0
+        csCtl1Read = CSCTL1;                   // Read CSCTL1
+
+        oldDcoTap = newDcoTap;                 // Record DCOTAP value of last time
+        newDcoTap = csCtl0Read & 0x01ff;       // Get DCOTAP value of this time
+        dcoFreqTrim = (csCtl1Read & 0x0070)>>4;// Get DCOFTRIM value
+
+        if(newDcoTap < 256)                    // DCOTAP < 256
+        {
+            newDcoDelta = 256 - newDcoTap;     // Delta value between DCPTAP and 256
+            if((oldDcoTap != 0xffff) && (oldDcoTap >= 256)) // DCOTAP cross 256
+                endLoop = 1;                   // Stop while loop
+            else
+            {
+                dcoFreqTrim--;
+                CSCTL1 = (csCtl1Read & (~DCOFTRIM)) | (dcoFreqTrim<<4);
+            }
+        }
+        else                                   // DCOTAP >= 256
+        {
+            newDcoDelta = newDcoTap - 256;     // Delta value between DCPTAP and 256
+            if(oldDcoTap < 256)                // DCOTAP cross 256
+                endLoop = 1;                   // Stop while loop
+            else
+            {
+                dcoFreqTrim++;
+                CSCTL1 = (csCtl1Read & (~DCOFTRIM)) | (dcoFreqTrim<<4);
+            }
+        }
+
+        if(newDcoDelta < bestDcoDelta)         // Record DCOTAP closest to 256
+        {
+            csCtl0Copy = csCtl0Read;
+            csCtl1Copy = csCtl1Read;
+            bestDcoDelta = newDcoDelta;
+        }
+
+    }while(endLoop == 0);                      // Poll until endLoop == 1
+
+    CSCTL0 = csCtl0Copy;                       // Reload locked DCOTAP
+    CSCTL1 = csCtl1Copy;                       // Reload locked DCOFTRIM
+    while(CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1)); // Poll until FLL is locked
+}
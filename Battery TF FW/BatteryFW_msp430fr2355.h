@@ -0,0 +1,87 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// Author: N. Ramirez
+// __________________________________________________________________________________
+//
+//  Board pin map and the main loop event flags shared by every firmware module.
+//
+//  ISRs never do the main loop's work themselves: they set a bit in
+//  Pending_Events and clear the LPM bits on exit. The main loop collects
+//  the bits with interrupts disabled and goes back to sleep when none are left.
+//  __________________________________________________________________________________*/
+#ifndef BATTERYFW_MSP430FR2355_H_
+#define BATTERYFW_MSP430FR2355_H_
+
+#include <msp430.h>
+
+// Port 1 definitions
+#define IOUT1   (BIT0)                      // P1.0 IOUT1 input
+#define IOUT2   (BIT1)                      // P1.1 IOUT2 input
+#define i2cData1  (BIT2)                      // P1.2 I2C Data 1
+#define i2cClk1   (BIT3)                      // P1.3 I2C Clock 1
+
+// Port 2 definitions
+#define DM_12V_En   (BIT0)                      // P2.0 DM 12V Enable output
+#define DM_VBat2_En (BIT1)                      // P2.1 DM Battery Voltage 2 Enable output
+#define DM_VBat1_En (BIT2)                      // P2.2 DM Battery Voltage 1 output
+#define nSWTurnOFFPower  (BIT3)                      // P2.3 SW Turn off power - active low output
+#define nPWR_OFF_Int (BIT4)                      // P2.4 Power off intterrupt - active low input
+
+// Port 3 definitions
+#define LED_1   (BIT0)                      // P3.0 LED output
+#define LED_2   (BIT1)                      // P3.1 LED output
+#define LED_3   (BIT2)                      // P3.2 LED output
+#define LED_4   (BIT3)                      // P3.3 LED output
+#define LED_5   (BIT4)                      // P3.4 LED output
+#define LED_6   (BIT5)                      // P3.5 LED output
+
+// Port 4 definitions
+#define uartRxd     (BIT2)                      // 4.2 UCA1RXD from Pi TXD0
+#define uartTxd     (BIT3)                      // 4.3 UCA1TXD to Pi RXD0
+#define VBAT1_OFF   (BIT4)                      // 4.4 Battery Voltage 1 Off output
+#define VBAT2_OFF   (BIT5)                      // 4.5 Battery Voltage 2 Off output
+#define i2cData2    (BIT6)                      // 4.6 I2C Data 2
+#define i2cClk2     (BIT7)                      // 4.7 I2C Clock 2
+
+// Port 5 definitions
+#define ChrgEn1 (BIT0)                      // P5.0 Enable Battery 1 Charging output
+#define ChrgEn2 (BIT1)                      // P5.1 Enable Battery 1 Charging output
+#define TH1     (BIT2)                      // P5.2 TH1 intput
+#define TH2     (BIT3)                      // P5.3 TH2 intput
+
+// Port 6 definitions
+#define DisChg1 (BIT0)                      // P6.0 LED output
+#define DisChg2 (BIT1)                      // P6.1 LED output
+#define n12VFlt (BIT2)                      // P6.2 12V Fault - active low input
+#define nBat1Flt (BIT3)                      // P6.3 Battery 1 Fault - active low input
+#define nBat2Flt (BIT4)                      // P6.4 Battery 2 Fault - active low input
+#define ACOK2 (BIT5)                      // P6.5 ACOK2 input
+#define ACOK1 (BIT6)                      // P6.6 ACOK1 input
+
+// Clocks
+#define MCLK_FREQ_MHZ 16                    // MCLK = 16MHz, FRAM needs one wait state
+#define ACLK_HZ     32768UL                 // ACLK = REFO
+#define SMCLK_HZ    16000000UL              // SMCLK = MCLK = DCOCLKDIV
+
+// Main loop events, set from ISRs
+#define EVT_SUPERVISOR  (BIT0)              // Supervisor saw a change on the status inputs
+#define EVT_TRIP        (BIT1)              // 12 V rail tripped or restored
+#define EVT_SECOND      (BIT2)              // One second housekeeping tick
+#define EVT_IOUT_BLOCK  (BIT3)              // Half of the IOUT ring is ready
+#define EVT_ADC_AUX     (BIT4)              // Queued auxiliary ADC conversions are done
+#define EVT_HOST_RX     (BIT5)              // Host link frame received
+#define EVT_HOST_TX     (BIT6)              // Host link TX ring half empty or empty
+#define EVT_TELEMETRY   (BIT7)              // Telemetry period elapsed
+#define EVT_SBS_TICK    (BIT8)              // Smart battery poll schedule tick
+#define EVT_LED         (BIT9)              // LED pattern tick
+#define EVT_CAPTURE     (BITA)              // Transient capture window frozen, copy to FRAM
+
+// Modules that need SMCLK while the CPU sleeps; main loop uses LPM0 instead of LPM3
+#define CLKREQ_TRIP     (BIT0)              // TB3 edges pending or trip measurement, TB3 on SMCLK
+#define CLKREQ_IOUT     (BIT1)              // IOUT sampling, TB1 trigger on SMCLK
+#define CLKREQ_HOST     (BIT2)              // Host link UART on SMCLK
+#define CLKREQ_SBS      (BIT3)              // Smart battery I2C buses on SMCLK
+
+extern volatile unsigned int Pending_Events;
+extern volatile unsigned int SMCLK_Requests;
+
+#endif /* BATTERYFW_MSP430FR2355_H_ */
@@ -0,0 +1,234 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC service: request queue, stream, and the ADC ISR that chains them.
+//  See adc.h for the request format and how requests share the stream.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "adc.h"
+#include "energy.h"
+
+static Adc_Request *Adc_Head;                   // Queue, oldest first
+static Adc_Request *Adc_Tail;
+static Adc_Request *Adc_Active;                 // Converting, the stream or a one-shot
+static Adc_Request *Adc_Stream;                 // Running stream, 0 when none
+
+// Write a request's settings, ADCENC clear. On the stream's trigger when
+// the stream runs and the request has none of its own.
+static void Adc_Config(const Adc_Request *req)
+{
+    unsigned int ctl1 = req->ctl1;
+
+    if(Adc_Stream && req != Adc_Stream && (ctl1 & ADCSHS) == ADCSHS_0)
+        ctl1 |= Adc_Stream->ctl1 & ADCSHS;
+    ADCCTL0 &= ~ADCENC;
+    ADCCTL0 = req->ctl0 | ADCON;
+    ADCCTL1 = ctl1 | ADCSHP;
+    ADCCTL2 = req->ctl2;
+    ADCMCTL0 = req->mctl0;
+}
+
+// Take the queue head and start it. Interrupts off or from the ADC ISR.
+static void Adc_Next(void)
+{
+    Adc_Request *req = Adc_Head;
+
+    Adc_Head = req->next;
+    Adc_Active = req;
+    req->n = 0;
+    req->state = ADC_RUNNING;
+    Adc_Config(req);
+    if((ADCCTL1 & ADCSHS) == ADCSHS_0)
+        ADCCTL0 |= ADCENC | ADCSC;              // Sampling and conversion start
+    else
+        ADCCTL0 |= ADCENC;                      // On the next trigger
+}
+
+// After the last result of a one-shot: the next request, the stream, or off
+static void Adc_Chain(void)
+{
+    if(Adc_Head)
+        Adc_Next();
+    else if(Adc_Stream)
+    {
+        Adc_Active = Adc_Stream;
+        Adc_Config(Adc_Stream);                 // Back to the stream on the next trigger
+        ADCCTL0 |= ADCENC;
+    }
+    else
+    {
+        Adc_Active = 0;
+        ADCCTL0 &= ~ADCENC;
+        ADCIE = 0;
+        ADCCTL0 &= ~ADCON;
+    }
+}
+
+// Stop the one-shot in progress and put it back at the head of the
+// queue, to be redone from its first result. Interrupts off.
+static void Adc_Requeue(void)
+{
+    Adc_Request *req = Adc_Active;
+
+    if(req == 0 || req == Adc_Stream)
+        return;
+    req->state = ADC_QUEUED;
+    req->next = Adc_Head;
+    if(Adc_Head == 0)
+        Adc_Tail = req;
+    Adc_Head = req;
+    Adc_Active = 0;
+}
+
+void Adc_Init(void)
+{
+    Adc_Head = 0;
+    Adc_Tail = 0;
+    Adc_Active = 0;
+    Adc_Stream = 0;
+}
+
+// Queue a one-shot request, started right away when the ADC is free.
+// Returns 0 when the request is still queued or running, or a repeat
+// request has no count.
+unsigned char Adc_Queue(Adc_Request *req)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(req->state != ADC_IDLE)
+        return 0;
+    switch(req->ctl1 & ADCCONSEQ)
+    {
+        case ADCCONSEQ_0: req->count = 1; break;
+        case ADCCONSEQ_1: req->count = (req->mctl0 & ADCINCH) + 1; break;
+        default: break;                         // Repeat, the client's count
+    }
+    if(req->count == 0)
+        return 0;
+
+    __disable_interrupt();
+    req->state = ADC_QUEUED;
+    req->next = 0;
+    if(Adc_Head)
+        Adc_Tail->next = req;
+    else
+        Adc_Head = req;
+    Adc_Tail = req;
+    if(Adc_Active == 0)
+    {
+        ADCIFG = 0;
+        ADCIE = ADCIE0;
+        Adc_Next();
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+    return 1;
+}
+
+unsigned char Adc_Busy(const Adc_Request *req)
+{
+    return req->state != ADC_IDLE;
+}
+
+// Run req as the stream, its trigger already set up by the caller or right
+// after. A one-shot running on the software trigger is redone later.
+void Adc_StreamStart(Adc_Request *req)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    ADCIE = 0;                                  // Stop a software triggered one-shot
+    Adc_Requeue();
+    req->state = ADC_RUNNING;
+    Adc_Stream = req;
+    Adc_Active = req;
+    Adc_Config(req);
+    ADCCTL0 |= ADCENC;                          // ADC Enable
+    ADCIFG = 0;
+    ADCIE = ADCIE0;                             // Enable ADC conv complete interrupt
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// After the stream's trigger was stopped: finish what is queued on the
+// software trigger
+void Adc_StreamStop(void)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(Adc_Stream == 0)
+        return;
+    __disable_interrupt();
+    ADCCTL1 &= ~ADCCONSEQ;                      // Stop after the current conversion
+    ADCCTL0 &= ~ADCENC;
+    while(ADCCTL1 & ADCBUSY);
+    ADCIE = 0;
+    ADCCTL0 &= ~ADCON;
+    Adc_Stream->state = ADC_IDLE;
+    Adc_Requeue();                              // A one-shot on the stream's trigger
+    Adc_Stream = 0;
+    Adc_Active = 0;
+    if(Adc_Head)
+    {
+        ADCIFG = 0;
+        ADCIE = ADCIE0;
+        Adc_Next();
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// ADC interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=ADC_VECTOR
+__interrupt void ADC_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(ADC_VECTOR))) ADC_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    Adc_Request *req;
+    unsigned int sample;
+    unsigned int events = 0;
+
+    ENERGY_IRQ(ENERGY_IRQ_ADC);
+    switch(__even_in_range(ADCIV,ADCIV_ADCIFG))
+    {
+        case ADCIV_ADCIFG:
+            sample = ADCMEM0;                           // Clears ADCIFG0
+            req = Adc_Active;
+            if(req == 0)
+                break;
+            if(req == Adc_Stream)
+            {
+                events = req->sample(sample);
+                if((events & ADC_SLOT) && Adc_Head)     // Pair done, a one-shot goes next
+                    Adc_Next();
+                events &= ~ADC_SLOT;
+            }
+            else
+            {
+                req->result[req->n] = sample;
+                if(++req->n < req->count)
+                    break;
+                if(req->ctl1 & ADCCONSEQ_2)             // Repeat: stop it at once
+                {
+                    ADCCTL1 &= ~ADCCONSEQ;
+                    ADCCTL0 &= ~ADCENC;
+                }
+                req->state = ADC_IDLE;
+                if(req->done)
+                    events = req->done(req);
+                Adc_Chain();
+            }
+            if(events)
+            {
+                Pending_Events |= events;
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,74 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC service: owns the ADC and its ISR, and runs conversion requests for
+//  the other modules without blocking.
+//
+//  A request (Adc_Request) carries its own register settings: ADCCTL0
+//  sample time (ADCSHT_x, ADCMSC), ADCCTL1 trigger, mode and clock
+//  (ADCSHS_x, ADCCONSEQ_x, ADCSSEL_x, ADCDIV_x), ADCCTL2 resolution and
+//  ADCMCTL0 channel and reference (ADCINCH_x, ADCSREF_x). The mode is the
+//  ADC's own:
+//      ADCCONSEQ_0     single channel, one result
+//      ADCCONSEQ_1     sequence from ADCINCH down to A0, ADCINCH + 1 results
+//      ADCCONSEQ_2     repeat single channel, count results
+//      ADCCONSEQ_3     repeat sequence, count results
+//  ADCON and ADCSHP are added here. Results go to result[] in conversion
+//  order; done() is called from the ADC ISR after the last one and returns
+//  EVT_* bits to post, 0 to post none (the ISR wakes the main loop for
+//  them, a callee can not).
+//
+//  One-shot requests are queued (Adc_Queue()) and run in order. The ISR
+//  starts the next one as soon as the last conversion of a request is in,
+//  before done() returns to the main loop, so requests from different
+//  clients follow back to back: on the software trigger (ADCSHS_0) the
+//  next ADCSC is set in the same ISR pass, one conversion time apart.
+//  The periodic ones are queued by the ADC scheduler (adc_sched.h), from
+//  the supervisor tick ISR.
+//
+//  The stream (Adc_StreamStart()) is one repeat request with no end and a
+//  sample() callback per conversion instead of a result buffer, run on a
+//  timer trigger: the IOUT sampler (iout_sampler.h). sample() returns EVT_*
+//  bits as done() does, | ADC_SLOT where a queued request may go in, the
+//  end of a pair. The request is then switched in for the next trigger:
+//  a software triggered request takes the stream's trigger instead, so
+//  the trigger grid is kept and each of its conversions delays the stream
+//  by one trigger period. After the last the stream's settings are put
+//  back for the next trigger. Stopping the stream runs what is still
+//  queued on the software trigger.
+//
+//  A request is the client's storage and must stay put until it is idle
+//  again (Adc_Busy()). While queued or running it is not to be touched.
+//  __________________________________________________________________________________*/
+#ifndef ADC_H_
+#define ADC_H_
+
+#define ADC_SLOT            (BITF)          // sample() return, not an EVT_* bit
+
+// Adc_Request.state
+#define ADC_IDLE            0
+#define ADC_QUEUED          1
+#define ADC_RUNNING         2
+
+typedef struct Adc_Request
+{
+    unsigned int ctl0;                      // ADCSHT_x | ADCMSC
+    unsigned int ctl1;                      // ADCSHS_x | ADCCONSEQ_x | ADCSSEL_x | ADCDIV_x
+    unsigned int ctl2;                      // ADCRES_x
+    unsigned int mctl0;                     // ADCINCH_x | ADCSREF_x
+    unsigned int count;                     // Results of a repeat request
+    unsigned int *result;
+    unsigned int (*done)(struct Adc_Request *req);  // ADC ISR, returns EVT_* bits, may be 0
+    unsigned int (*sample)(unsigned int code);      // Stream only, EVT_* bits | ADC_SLOT
+    struct Adc_Request *next;               // Queue, the service's
+    unsigned int n;                         // Results so far
+    volatile unsigned char state;           // ADC_IDLE/QUEUED/RUNNING
+} Adc_Request;
+
+void Adc_Init(void);
+unsigned char Adc_Queue(Adc_Request *req);
+unsigned char Adc_Busy(const Adc_Request *req);
+void Adc_StreamStart(Adc_Request *req);
+void Adc_StreamStop(void);
+
+#endif /* ADC_H_ */
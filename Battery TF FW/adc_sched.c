@@ -0,0 +1,182 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC scheduler: tick releases, reference, latency, the DVCC and die
+//  temperature channels. See adc_sched.h for the rate classes and the
+//  latency bound.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "adc.h"
+#include "adc_sched.h"
+#include "supervisor.h"
+#include "cal.h"
+
+#define SCHED_LATE_MAX_ACLK ((unsigned int)(SCHED_LATE_MAX_US * ACLK_HZ / 1000000UL))
+
+static Sched_Channel *Sched_Table[SCHED_CHANNELS];
+static unsigned char Sched_Channels;
+static unsigned char Sched_RefUsers;            // SCHED_REF channels between reference on and their result
+static unsigned int Sched_Code[2];              // DVCC, die
+static unsigned int Sched_Done(Adc_Request *req);
+
+// A13, the 1.5 V reference against AVCC, for DVCC
+static Sched_Channel Sched_Dvcc =
+{
+    { ADCSHT_2, ADCSHS_0 | ADCCONSEQ_0 | ADCSSEL_0, ADCRES_2, ADCINCH_13 | ADCSREF_0,
+      1, &Sched_Code[0], 0, 0 },
+    0, SCHED_REF
+};
+
+// A12, the temperature sensor against the 1.5 V reference, 256ADCclks
+static Sched_Channel Sched_Die =
+{
+    { ADCSHT_8, ADCSHS_0 | ADCCONSEQ_0 | ADCSSEL_0, ADCRES_2, ADCINCH_12 | ADCSREF_1,
+      1, &Sched_Code[1], 0, 0 },
+    0, SCHED_REF
+};
+
+static void Sched_Ref(unsigned int on)
+{
+    PMMCTL0_H = PMMPW_H;                        // Unlock the PMM registers
+    PMMCTL2 = on ? INTREFEN | TSENSOREN | REFVSEL_0 : 0;
+    PMMCTL0_H = 0;                              // Lock the PMM registers
+}
+
+// A SCHED_REF channel is done with the reference, interrupts off
+static void Sched_RefRelease(void)
+{
+    if(Sched_RefUsers && --Sched_RefUsers == 0)
+        Sched_Ref(0);
+}
+
+// After Adc_Init(), before the clients' Sched_Add(); DVCC and the die
+// temperature are the scheduler's own
+void Sched_Init(void)
+{
+    Sched_Channels = 0;
+    Sched_RefUsers = 0;
+    Sched_Code[0] = 0;
+    Sched_Code[1] = 0;
+    Sched_Add(&Sched_Dvcc, SCHED_SUPPLY_MS, SCHED_PHASE_DVCC);
+    Sched_Add(&Sched_Die, SCHED_SUPPLY_MS, SCHED_PHASE_DIE);
+}
+
+// Register a channel, released every periodMs from tick phase on. The
+// request is a single conversion. Returns 0 when the table is full.
+unsigned char Sched_Add(Sched_Channel *ch, unsigned int periodMs, unsigned int phase)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned int ticks = (unsigned int)((unsigned long)periodMs * SUPERVISOR_TICK_HZ / 1000);
+
+    if(Sched_Channels == SCHED_CHANNELS)
+        return 0;
+    if(ticks < 2)
+        ticks = 2;                              // A tick for the reference to settle
+    ch->req.ctl1 = (ch->req.ctl1 & ~ADCCONSEQ) | ADCCONSEQ_0;
+    ch->req.done = Sched_Done;
+    ch->period = ticks;
+    ch->left = phase ? phase : 1;
+
+    __disable_interrupt();
+    Sched_Table[Sched_Channels++] = ch;
+    if(sr & GIE)
+        __enable_interrupt();
+    Sched_Clear();
+    return 1;
+}
+
+// Supervisor tick ISR, tick = the TB0CCR0 time it was due at
+void Sched_Tick(unsigned int tick)
+{
+    Sched_Channel *ch;
+    unsigned char i;
+
+    for(i = 0; i < Sched_Channels; i++)
+    {
+        ch = Sched_Table[i];
+        if(--ch->left == 1 && (ch->flags & SCHED_REF))
+        {
+            if(Sched_RefUsers++ == 0)
+                Sched_Ref(1);                   // Settles over the tick
+        }
+        if(ch->left)
+            continue;
+        ch->left = ch->period;
+        ch->release = tick;
+        if(!Adc_Queue(&ch->req))
+        {
+            ch->misses++;                       // Still waiting from the last release
+            if(ch->flags & SCHED_REF)
+                Sched_RefRelease();
+        }
+    }
+}
+
+// ADC ISR, the conversion of a channel is in
+static unsigned int Sched_Done(Adc_Request *req)
+{
+    Sched_Channel *ch = (Sched_Channel *)req;   // req is the first member
+    unsigned int lat = Supervisor_Now() - ch->release;
+
+    ch->conversions++;
+    if(lat < ch->minLat)
+        ch->minLat = lat;
+    if(lat > ch->maxLat)
+        ch->maxLat = lat;
+    if(lat > SCHED_LATE_MAX_ACLK)
+        ch->late++;
+    if(ch->flags & SCHED_REF)
+        Sched_RefRelease();
+    return ch->done ? ch->done(ch) : 0;
+}
+
+unsigned char Sched_Count(void)
+{
+    return Sched_Channels;
+}
+
+const Sched_Channel *Sched_Get(unsigned char i)
+{
+    return Sched_Table[i < Sched_Channels ? i : 0];
+}
+
+// Counts and latencies from now on
+void Sched_Clear(void)
+{
+    unsigned int sr = __get_SR_register();
+    Sched_Channel *ch;
+    unsigned char i;
+
+    __disable_interrupt();
+    for(i = 0; i < Sched_Channels; i++)
+    {
+        ch = Sched_Table[i];
+        ch->conversions = 0;
+        ch->misses = 0;
+        ch->late = 0;
+        ch->minLat = 0xFFFF;
+        ch->maxLat = 0;
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// ACLK counts to us, saturated
+unsigned int Sched_Us(unsigned int aclk)
+{
+    unsigned long us = ((unsigned long)aclk * 15625UL) >> 9;   // 1000000 / 32768
+
+    return us > 0xFFFF ? 0xFFFF : (unsigned int)us;
+}
+
+// Last DVCC in mV, 0 before the first conversion
+unsigned int Sched_DvccMv(void)
+{
+    return Sched_Code[0] ? Cal_DvccMv(Sched_Code[0]) : 0;
+}
+
+// Last die temperature in 0.1 degC, 0 before the first conversion
+int Sched_DieC10(void)
+{
+    return Sched_Code[1] ? Cal_TempC10(Sched_Code[1]) : 0;
+}
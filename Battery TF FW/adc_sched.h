@@ -0,0 +1,89 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC scheduler: the slow ADC channels interleaved with the IOUT stream on
+//  the one converter, by rate class, with their sample time latency
+//  measured.
+//
+//  Rate classes:
+//      IOUT1/IOUT2     kHz         the ADC service's stream (iout_sampler.h),
+//                                  every TB1.1 edge but the slots below
+//      TH1/TH2         ~1 Hz       SCHED_THERM_MS (therm.h)
+//      DVCC, die       ~0.1 Hz     SCHED_SUPPLY_MS, here: A13 against AVCC
+//                                  and A12 against the 1.5 V reference,
+//                                  converted with the TLV calibration (cal.h)
+//
+//  Release: a channel (Sched_Channel, the client's storage like an
+//  Adc_Request) is released every period on the supervisor tick
+//  (supervisor.h, TB0CCR0, ACLK, runs in LPM3), from the tick ISR, as a
+//  one-shot request of the ADC service (adc.h). Periods and phases are in
+//  ticks, 10 ms at SUPERVISOR_TICK_HZ; the phase plan below gives every
+//  channel a tick of its own, so no two are ever released together.
+//
+//  Conversion: each channel has its own ADCCTL0..ADCMCTL0 settings, which
+//  the service writes before its conversion and puts back for the stream
+//  after it. While IOUT runs the released channel takes the TB1.1 edge
+//  after the current pair (ADC_SLOT), so all conversions stay on the one
+//  trigger grid; with IOUT stopped it starts at once on the software
+//  trigger. The die temperature's 256 ADC clock sample (over the sensor's
+//  30 us) spans two trigger periods at 10 kHz; the edge it covers is not
+//  converted and the pairs go on one period later.
+//
+//  Reference: a channel flagged SCHED_REF gets the internal 1.5 V
+//  reference and the temperature sensor switched on one tick before its
+//  release, for them to settle, and off again after the last such
+//  conversion: ~20 ms of reference every SCHED_SUPPLY_MS.
+//
+//  Latency, release tick to result, measured per conversion on TB0R (ACLK,
+//  30.5 us resolution) in the ADC ISR; min and max are the channel's
+//  sample time jitter. Bounded by the design: one release per tick and
+//  nothing else queued, so a conversion waits for the end of the pair and
+//  the next edge, two trigger periods, or for an internal resistance burst
+//  to end (ir_test.h), 2 * IR_BURST_PAIRS + IR_SETTLE_PAIRS + 1 pairs,
+//  3.5 ms at 10 kHz. A conversion over SCHED_LATE_MAX_US is counted late; a
+//  channel still waiting at its next release is not released again and
+//  counted missed. HOST_CMD_SCHED reports them (host_link.h).
+//  __________________________________________________________________________________*/
+#ifndef ADC_SCHED_H_
+#define ADC_SCHED_H_
+
+#define SCHED_THERM_MS      1000            // TH1/TH2
+#define SCHED_SUPPLY_MS     10000           // DVCC, die temperature
+#define SCHED_LATE_MAX_US   5000            // Latency bound, see above
+#define SCHED_CHANNELS      4               // Registered channels at most
+
+// Phase plan, tick of the first release after the start
+#define SCHED_PHASE_TH1     1
+#define SCHED_PHASE_TH2     2
+#define SCHED_PHASE_DVCC    3
+#define SCHED_PHASE_DIE     4
+
+// Sched_Channel.flags
+#define SCHED_REF           0x01            // Needs the 1.5 V reference and the temperature sensor
+
+typedef struct Sched_Channel
+{
+    Adc_Request req;                        // One conversion, the client's settings; first
+    unsigned int (*done)(struct Sched_Channel *ch); // ADC ISR, returns EVT_* bits, may be 0
+    unsigned char flags;                    // SCHED_REF
+    unsigned int period;                    // Ticks
+    unsigned int left;                      // Ticks to the next release
+    unsigned int release;                   // TB0 time of the last release, ACLK counts
+    unsigned int conversions;               // Counts, wrapping
+    unsigned int misses;
+    unsigned int late;
+    unsigned int minLat;                    // Latency, ACLK counts
+    unsigned int maxLat;
+} Sched_Channel;
+
+void Sched_Init(void);
+unsigned char Sched_Add(Sched_Channel *ch, unsigned int periodMs, unsigned int phase);
+void Sched_Tick(unsigned int tick);
+unsigned char Sched_Count(void);
+const Sched_Channel *Sched_Get(unsigned char i);
+void Sched_Clear(void);
+unsigned int Sched_Us(unsigned int aclk);
+unsigned int Sched_DvccMv(void);
+int Sched_DieC10(void);
+
+#endif /* ADC_SCHED_H_ */
@@ -0,0 +1,207 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Battery state machine: table driven, one instance per channel.
+//  See battery_sm.h for the states, events and output mapping.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "battery_sm.h"
+#include "power_trip.h"
+#include "power_seq.h"
+
+typedef struct
+{
+    unsigned char chrg;                     // P5 ChrgEn pin
+    unsigned char dischg;                   // P6 DisChg pin
+    unsigned char vbat;                     // P4 VBAT_OFF pin
+    unsigned char fault;                    // P6 nBatFlt pin
+} Batt_Pins;
+
+static const Batt_Pins Batt_PinMap[BATT_CHANNELS] =
+{
+    { ChrgEn1, DisChg1, VBAT1_OFF, nBat1Flt },
+    { ChrgEn2, DisChg2, VBAT2_OFF, nBat2Flt }
+};
+
+// Next state, indexed [state][event]
+static const unsigned char Batt_Transition[BATT_STATES][BEV_EVENTS] =
+{
+    //              RAIL_LOST       RAIL_GOOD       FAULT       FAULT_CLEAR     CHARGE          DISCHARGE       STOP            TIMEOUT         DONE            OVERTEMP    TEMP_OK
+    /* IDLE */      { BATT_IDLE,      BATT_IDLE,      BATT_FAULT, BATT_IDLE,      BATT_CHARGE,    BATT_DISCHARGE, BATT_IDLE,      BATT_IDLE,      BATT_IDLE,      BATT_HOT,   BATT_IDLE      },
+    /* CHARGE */    { BATT_CHARGE,    BATT_CHARGE,    BATT_FAULT, BATT_CHARGE,    BATT_CHARGE,    BATT_DISCHARGE, BATT_COOLDOWN,  BATT_CHARGE,    BATT_COOLDOWN,  BATT_HOT,   BATT_CHARGE    },
+    /* DISCHARGE */ { BATT_COOLDOWN,  BATT_DISCHARGE, BATT_FAULT, BATT_DISCHARGE, BATT_CHARGE,    BATT_DISCHARGE, BATT_COOLDOWN,  BATT_DISCHARGE, BATT_COOLDOWN,  BATT_HOT,   BATT_DISCHARGE },
+    /* FAULT */     { BATT_FAULT,     BATT_FAULT,     BATT_FAULT, BATT_COOLDOWN,  BATT_FAULT,     BATT_FAULT,     BATT_FAULT,     BATT_FAULT,     BATT_FAULT,     BATT_FAULT, BATT_FAULT     },
+    /* COOLDOWN */  { BATT_COOLDOWN,  BATT_COOLDOWN,  BATT_FAULT, BATT_COOLDOWN,  BATT_COOLDOWN,  BATT_COOLDOWN,  BATT_COOLDOWN,  BATT_IDLE,      BATT_COOLDOWN,  BATT_HOT,   BATT_COOLDOWN  },
+    /* HOT */       { BATT_HOT,       BATT_HOT,       BATT_FAULT, BATT_HOT,       BATT_HOT,       BATT_HOT,       BATT_HOT,       BATT_HOT,       BATT_HOT,       BATT_HOT,   BATT_IDLE      }
+};
+
+// Output code, indexed [state][railGood]
+static const unsigned char Batt_Outputs[BATT_STATES][2] =
+{
+    //              rail lost       rail good
+    /* IDLE */      { BOUT_VBAT,      0           },
+    /* CHARGE */    { BOUT_VBAT,      BOUT_CHRG   },
+    /* DISCHARGE */ { BOUT_VBAT,      BOUT_DISCHG },
+    /* FAULT */     { 0,              0           },
+    /* COOLDOWN */  { BOUT_VBAT,      0           },
+    /* HOT */       { BOUT_VBAT,      0           }
+};
+
+// Seconds spent in a state before BEV_TIMEOUT, 0 = no timeout
+static const unsigned int Batt_Timeout[BATT_STATES] =
+{
+    0, 0, 0, 0, BATT_COOLDOWN_S, 0
+};
+
+static unsigned char Batt_Current[BATT_CHANNELS];   // Current state
+static unsigned int Batt_Timer[BATT_CHANNELS];      // Seconds left before BEV_TIMEOUT
+static unsigned char Batt_Auto[BATT_CHANNELS];      // Go back to CHARGE when IDLE is reached
+static unsigned char Batt_Hot[BATT_CHANNELS];       // Over temperature, hold in HOT instead of IDLE
+static unsigned char Batt_RailGood;                 // Rail state last seen
+
+// Publish what each channel must do if the rail trips before the main loop runs again
+static void Batt_PublishTrip(void)
+{
+    unsigned char ch;
+    unsigned char p4 = 0;
+    unsigned char p5 = 0;
+    unsigned char p6 = 0;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        if(Batt_Outputs[Batt_Current[ch]][0] & BOUT_VBAT)
+            p4 |= Batt_PinMap[ch].vbat;
+        p5 |= Batt_PinMap[ch].chrg;
+        p6 |= Batt_PinMap[ch].dischg;
+    }
+    Seq_SetTrip(p4, p5, p6);
+}
+
+// Drive both channels through the sequencer. Runs with interrupts off and
+// takes the rail state from the trip module, so a trip ISR can not land
+// between reading the rail and starting the transition and have its
+// VBAT/ChrgEn bits undone by a stale rail state.
+static void Batt_ApplyAll(void)
+{
+    unsigned int sr = __get_SR_register();
+    const Batt_Pins *pins;
+    unsigned char railGood;
+    unsigned char out;
+    unsigned char ch;
+    unsigned char p4 = 0;
+    unsigned char p5 = 0;
+    unsigned char p6 = 0;
+
+    __disable_interrupt();
+    railGood = Trip_RailGood();
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        pins = &Batt_PinMap[ch];
+        out = Batt_Outputs[Batt_Current[ch]][railGood];
+        if(out & BOUT_VBAT)
+            p4 |= pins->vbat;
+        if(out & BOUT_CHRG)
+            p5 |= pins->chrg;
+        if(out & BOUT_DISCHG)
+            p6 |= pins->dischg;
+    }
+    Batt_PublishTrip();
+    Seq_Apply(p4, p5, p6);
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+static void Batt_Step(unsigned char ch, unsigned char event)
+{
+    unsigned char next = Batt_Transition[Batt_Current[ch]][event];
+
+    if(event == BEV_STOP || (event == BEV_DONE && Batt_Current[ch] == BATT_CHARGE))
+        Batt_Auto[ch] = 0;                  // Stay idle until asked to charge again
+    else if(event == BEV_CHARGE)
+        Batt_Auto[ch] = 1;
+    if(event == BEV_OVERTEMP)
+        Batt_Hot[ch] = 1;
+    else if(event == BEV_TEMP_OK)
+        Batt_Hot[ch] = 0;
+    if(next == BATT_IDLE && Batt_Hot[ch])
+        next = Batt_Transition[BATT_IDLE][BEV_OVERTEMP];
+    else if(next == BATT_IDLE && Batt_Auto[ch])
+        next = Batt_Transition[BATT_IDLE][BEV_CHARGE];
+
+    if(next != Batt_Current[ch])
+    {
+        Batt_Current[ch] = next;
+        Batt_Timer[ch] = Batt_Timeout[next];
+    }
+}
+
+void Batt_Init(unsigned char inputs, unsigned char railGood)
+{
+    unsigned char ch;
+
+    P5OUT &= ~(ChrgEn1 + ChrgEn2);          // Everything off until the tables say otherwise
+    P6OUT &= ~(DisChg1 + DisChg2);
+    P5DIR |= ChrgEn1 + ChrgEn2;             // Set P5.0(ChrgEn1) and P5.1(ChrgEn2) as outputs
+    P6DIR |= DisChg1 + DisChg2;             // Set P6.0(DisChg1) and P6.1(DisChg2) as outputs
+    P4DIR |= VBAT1_OFF + VBAT2_OFF;         // Set P4.4(VBAT1_OFF) and P4.5(VBAT2_OFF) as outputs
+
+    Batt_RailGood = railGood ? 1 : 0;
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        Batt_Current[ch] = BATT_IDLE;
+        Batt_Timer[ch] = 0;
+        Batt_Hot[ch] = 0;
+        Batt_Step(ch, BEV_CHARGE);          // Charge whenever the rail allows it, like before
+        if(!(inputs & Batt_PinMap[ch].fault))
+            Batt_Step(ch, BEV_FAULT);
+    }
+    Batt_ApplyAll();
+}
+
+// inputs: debounced port 6 status inputs, fell/rose: their edges since the
+// last update. A fault that came and went in between gives both events, in
+// the order that ends at the current level.
+void Batt_Update(unsigned char inputs, unsigned char fell, unsigned char rose, unsigned char railGood)
+{
+    unsigned char ch;
+    unsigned char fault;
+
+    railGood = railGood ? 1 : 0;
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        fault = Batt_PinMap[ch].fault;
+        if(fell & rose & fault)
+            Batt_Step(ch, (inputs & fault) ? BEV_FAULT : BEV_FAULT_CLEAR);
+        if((fell | rose) & fault)
+            Batt_Step(ch, (inputs & fault) ? BEV_FAULT_CLEAR : BEV_FAULT);
+        if(railGood != Batt_RailGood)
+            Batt_Step(ch, railGood ? BEV_RAIL_GOOD : BEV_RAIL_LOST);
+    }
+    Batt_RailGood = railGood;
+
+    Batt_ApplyAll();
+}
+
+void Batt_Request(unsigned char ch, unsigned char event)
+{
+    if(ch >= BATT_CHANNELS || event >= BEV_EVENTS)
+        return;
+    Batt_Step(ch, event);
+    Batt_ApplyAll();
+}
+
+void Batt_Second(void)
+{
+    unsigned char ch;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        if(Batt_Timer[ch] != 0 && --Batt_Timer[ch] == 0)
+            Batt_Request(ch, BEV_TIMEOUT);
+    }
+}
+
+unsigned char Batt_State(unsigned char ch)
+{
+    return Batt_Current[ch];
+}
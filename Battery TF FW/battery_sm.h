@@ -0,0 +1,79 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Battery state machine: one independent instance per battery channel.
+//
+//  States:  IDLE, CHARGE, DISCHARGE, FAULT, COOLDOWN, HOT
+//  Events:  rail lost/good, nBatxFlt asserted/cleared, charge/discharge/stop
+//           requests, cooldown timeout, charge/discharge done,
+//           over-temperature / temperature ok (therm.h)
+//
+//  Both the transitions and the outputs are const tables (placed in FRAM
+//  with the rest of .const):
+//      next    = Batt_Transition[state][event]
+//      outputs = Batt_Outputs[state][railGood]
+//  so one step is two indexed loads and the two channels never share state.
+//  The output code is channel neutral (BOUT_*) and is mapped to the
+//  ChrgEn/DisChg/VBAT_OFF pins of the channel through Batt_Pins. The pins
+//  of both channels are then switched together by the power path
+//  sequencer (power_seq.h), in make-before-break order.
+//
+//  The rail is an input to the output table rather than an event: a channel
+//  in CHARGE stops charging and backs the load while the 12 V rail is gone,
+//  and resumes charging when it returns, without leaving CHARGE. A test
+//  discharge is aborted on rail loss.
+//
+//  A channel that reaches IDLE goes straight on to CHARGE unless the last
+//  request it got was BEV_STOP, which keeps the old "always charge on 12 V"
+//  behaviour as the default. A charge that ended with BEV_DONE (charge.h
+//  terminates on taper, -dV, dT/dt or the safety timer) also stays in IDLE
+//  after its cooldown, the battery is full; BEV_CHARGE starts a new one. A
+//  channel that is over temperature goes to HOT instead, and only leaves it
+//  on BEV_TEMP_OK, so neither the auto charge nor a request can restart
+//  charging while it is hot.
+//
+//  The rail-lost outputs of every channel are also published as the
+//  sequencer's trip transition, so the TB3.3 ISR applies exactly what the
+//  table says.
+//  __________________________________________________________________________________*/
+#ifndef BATTERY_SM_H_
+#define BATTERY_SM_H_
+
+#define BATT_CHANNELS       2
+#define BATT_COOLDOWN_S     30              // Rest time after charge, discharge or fault
+
+// States
+#define BATT_IDLE           0
+#define BATT_CHARGE         1
+#define BATT_DISCHARGE      2
+#define BATT_FAULT          3
+#define BATT_COOLDOWN       4
+#define BATT_HOT            5
+#define BATT_STATES         6
+
+// Events
+#define BEV_RAIL_LOST       0
+#define BEV_RAIL_GOOD       1
+#define BEV_FAULT           2
+#define BEV_FAULT_CLEAR     3
+#define BEV_CHARGE          4
+#define BEV_DISCHARGE       5
+#define BEV_STOP            6
+#define BEV_TIMEOUT         7
+#define BEV_DONE            8
+#define BEV_OVERTEMP        9
+#define BEV_TEMP_OK         10
+#define BEV_EVENTS          11
+
+// Channel neutral output code
+#define BOUT_CHRG           (BIT0)          // ChrgEn high
+#define BOUT_DISCHG         (BIT1)          // DisChg high
+#define BOUT_VBAT           (BIT2)          // VBAT_OFF high, battery backs the load
+
+void Batt_Init(unsigned char inputs, unsigned char railGood);
+void Batt_Update(unsigned char inputs, unsigned char fell, unsigned char rose, unsigned char railGood);
+void Batt_Request(unsigned char ch, unsigned char event);
+void Batt_Second(void);
+unsigned char Batt_State(unsigned char ch);
+
+#endif /* BATTERY_SM_H_ */
@@ -0,0 +1,125 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC calibration: TLV coefficients and the fixed point conversions.
+//  See cal.h for the TLV words, the checks and the formulas.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "cal.h"
+
+static Cal_Coeffs Cal;
+static unsigned char Cal_Flags;
+
+// Q15 factor within CAL_MIN_FACTOR..CAL_MAX_FACTOR
+static unsigned char Cal_FactorOk(unsigned int f)
+{
+    return f >= CAL_MIN_FACTOR && f <= CAL_MAX_FACTOR;
+}
+
+// Once, before Post_Run(): the TLV read and checked, the constants worked
+// out, so the conversions need no divide
+void Cal_Init(void)
+{
+    unsigned int gain = TLV_WORD(CAL_TLV_GAIN);
+    int offset = (int)TLV_WORD(CAL_TLV_OFFSET);
+    unsigned int ref15 = TLV_WORD(CAL_TLV_REF15);
+    unsigned int t30 = TLV_WORD(CAL_TLV_T30);
+    unsigned int tHot = TLV_WORD(CAL_TLV_THOT);
+
+    Cal_Flags = 0;
+    if(!Cal_FactorOk(gain) || offset <= -CAL_MAX_OFFSET || offset >= CAL_MAX_OFFSET)
+    {
+        gain = CAL_NOM_GAIN;
+        offset = 0;
+        Cal_Flags |= CAL_NOM_ADC;
+    }
+    if(!Cal_FactorOk(ref15))
+    {
+        ref15 = CAL_NOM_REF15;
+        Cal_Flags |= CAL_NOM_REF;
+    }
+    if(t30 == 0 || t30 > 4094 - CAL_MIN_TSPAN || tHot > 4094 || tHot < t30 + CAL_MIN_TSPAN)
+    {
+        t30 = CAL_NOM_T30;
+        tHot = CAL_NOM_THOT;
+        Cal_Flags |= CAL_NOM_TEMP;
+    }
+
+    Cal.gain = gain;
+    Cal.offset = offset;
+    Cal.ref15 = ref15;
+    Cal.t30 = t30;
+    Cal.tHot = tHot;
+    Cal.dvcc = (1500UL * ref15 + 4) >> 3;           // 1500 * 4096 * ref15 >> 15, 6144000 at 1
+    Cal.tempK = ((unsigned long)(CAL_HOT_C - 30) * 10 * 65536UL + (unsigned int)(tHot - t30) / 2)
+              / (unsigned int)(tHot - t30);
+}
+
+// CAL_NOM_* bits, 0 when the whole TLV was used
+unsigned char Cal_Status(void)
+{
+    return Cal_Flags;
+}
+
+const Cal_Coeffs *Cal_Get(void)
+{
+    return &Cal;
+}
+
+// Gain and offset corrected code, 0..4095
+unsigned int Cal_Code(unsigned int raw)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long prod;
+    int code;
+
+    __disable_interrupt();                          // MPY32 is the ADC ISR's too
+    MPY = raw;
+    OP2 = Cal.gain;                                 // Starts the 16 x 16 multiply
+    prod = ((unsigned long)RESHI << 16) | RESLO;
+    if(sr & GIE)
+        __enable_interrupt();
+
+    code = (int)((prod + 0x4000) >> 15) + Cal.offset;
+    if(code < 0)
+        return 0;
+    if(code > 4095)
+        return 4095;
+    return (unsigned int)code;
+}
+
+// DVCC in mV from the A13 code against AVCC, 0 for a code of 0
+unsigned int Cal_DvccMv(unsigned int refCode)
+{
+    unsigned int code = Cal_Code(refCode);
+
+    if(code == 0)
+        return 0;
+    return (unsigned int)((Cal.dvcc + code / 2) / code);
+}
+
+// Die temperature in 0.1 degC from the A12 code against the 1.5 V
+// reference. Not gain corrected: the TLV points were taken the same way.
+int Cal_TempC10(unsigned int raw)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned int d;
+    unsigned int r0, r1;
+    unsigned char below = raw < Cal.t30;
+
+    d = below ? Cal.t30 - raw : raw - Cal.t30;
+    __disable_interrupt();
+    MPY32L = d;
+    MPY32H = 0;
+    OP2L = (unsigned int)Cal.tempK;
+    OP2H = (unsigned int)(Cal.tempK >> 16);         // Starts the 32 x 32 multiply
+    r0 = RES0;
+    r1 = RES1;                                      // |d| * k < 2^32, RES2/3 are 0
+    if(sr & GIE)
+        __enable_interrupt();
+
+    r1 += r0 >> 15;                                 // Rounded
+    if(r1 > CAL_MAX_DC)
+        r1 = CAL_MAX_DC;                            // A code off the line, not a temperature
+    return below ? 300 - (int)r1 : 300 + (int)r1;
+}
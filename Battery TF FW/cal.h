@@ -0,0 +1,87 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  ADC calibration: the factory calibration in the TLV (TLVMEM, 0x1A00 in
+//  lnk_msp430fr2355.cmd) read once at startup, turned into fixed point
+//  coefficients, and the conversions that use them.
+//
+//  TLV words read by Cal_Init():
+//      CAL_TLV_GAIN    ADC gain factor, Q15 (0x8000 = 1)
+//      CAL_TLV_OFFSET  ADC offset, signed codes
+//      CAL_TLV_T30     temperature sensor code at 30 degC, 1.5 V reference
+//      CAL_TLV_THOT    the same at CAL_HOT_C
+//      CAL_TLV_REF15   1.5 V reference factor, Q15
+//  Each group is checked against a plausible range (a blank or erased TLV
+//  reads 0xFFFF); a group that fails is replaced by its nominal values and
+//  flagged in Cal_Status(), so the conversions always have coefficients.
+//
+//  Conversions, one multiply and a shift on MPY32 each, no divide (the
+//  DVCC reading is an inverse, so it keeps one):
+//      Cal_Code()      code against AVCC, gain and offset corrected
+//                          c = (raw * gain) >> 15 + offset
+//      Cal_DvccMv()    DVCC from the A13 (1.5 V reference) code against
+//                      AVCC, the reference at its calibrated voltage
+//                          DVCC = (1500 * ref15 * 4096 >> 15) / c   mV
+//      Cal_TempC10()   die temperature from the A12 code against the
+//                      1.5 V reference, two point line through the TLV
+//                      codes, the slope a Q16 constant
+//                          T = 300 + ((raw - T30) * k) >> 16        0.1 degC
+//  The TI examples do these in float (msp430fr235x_adc12_16.c, _05.c), on
+//  the software float library; make bench, case_adc12_16 against case_cal.
+//
+//  MPY32 is shared with the coulomb counter in the ADC ISR, which does not
+//  save it, so the conversions run it with interrupts off, ~10 MCLK cycles.
+//  __________________________________________________________________________________*/
+#ifndef CAL_H_
+#define CAL_H_
+
+// TLV words, device datasheet TLV table. TLV_WORD() is the simulator's
+// accessor there.
+#ifndef TLV_WORD
+#define TLV_WORD(addr)      (*(const volatile unsigned int *)(addr))
+#endif
+#define CAL_TLV_GAIN        0x1A16
+#define CAL_TLV_OFFSET      0x1A18
+#define CAL_TLV_T30         0x1A1A
+#define CAL_TLV_THOT        0x1A1C
+#define CAL_TLV_REF15       0x1A20
+
+#define CAL_HOT_C           105             // High calibration point, 85 on parts rated to 85 degC
+
+// Nominal values, for a group the TLV does not have
+#define CAL_NOM_GAIN        0x8000
+#define CAL_NOM_REF15       0x8000
+#define CAL_NOM_T30         2185            // ~0.8 V at 30 degC
+#define CAL_NOM_THOT        2715            // ~2.6 mV/degC
+
+// Plausible TLV values
+#define CAL_MIN_FACTOR      0x7000          // Gain and reference within 1/8 of 1
+#define CAL_MAX_FACTOR      0x9000
+#define CAL_MAX_OFFSET      128             // Codes either way
+#define CAL_MIN_TSPAN       64              // THOT - T30, codes
+#define CAL_MAX_DC          2000            // Cal_TempC10() within 30 degC +-200 degC
+
+// Cal_Status(), a bit per TLV group replaced by nominal values
+#define CAL_NOM_ADC         0x01
+#define CAL_NOM_REF         0x02
+#define CAL_NOM_TEMP        0x04
+
+typedef struct
+{
+    unsigned int gain;                      // Q15
+    int offset;                             // Codes
+    unsigned int ref15;                     // Q15
+    unsigned int t30;                       // Codes
+    unsigned int tHot;
+    unsigned long dvcc;                     // DVCC numerator, mV * codes
+    unsigned long tempK;                    // Q16, 0.1 degC per code
+} Cal_Coeffs;
+
+void Cal_Init(void);
+unsigned char Cal_Status(void);
+const Cal_Coeffs *Cal_Get(void);
+unsigned int Cal_Code(unsigned int raw);
+unsigned int Cal_DvccMv(unsigned int refCode);
+int Cal_TempC10(unsigned int raw);
+
+#endif /* CAL_H_ */
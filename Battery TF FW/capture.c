@@ -0,0 +1,196 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Transient capture: IOUT pair ring, fault trigger, FRAM record.
+//  See capture.h for the window, the copy timing and the arming rules.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "capture.h"
+#include "iout_sampler.h"
+#include "event_log.h"
+#include "rtc.h"
+
+typedef struct
+{
+    unsigned int pre;                       // 0 and 0 = off
+    unsigned int post;
+} Capture_Config;
+
+// Statically-initialized variable
+#ifdef __TI_COMPILER_VERSION__
+#pragma PERSISTENT(Capture_Saved)
+Capture_Record Capture_Saved = {0};
+#pragma PERSISTENT(Capture_Setup)
+Capture_Config Capture_Setup = {0};
+#elif __IAR_SYSTEMS_ICC__
+__persistent Capture_Record Capture_Saved = {0};
+__persistent Capture_Config Capture_Setup = {0};
+#elif defined(__GNUC__)
+Capture_Record Capture_Saved __attribute__((persistent)) = {0};
+Capture_Config Capture_Setup __attribute__((persistent)) = {0};
+#else
+// Port the following variable to an equivalent persistent functionality for the specific compiler being used
+Capture_Record Capture_Saved = {0};
+Capture_Config Capture_Setup = {0};
+#endif
+
+static unsigned long Capture_Ring[CAPTURE_PAIRS];
+static volatile unsigned int Capture_Head;      // Free running write count, ADC ISR only
+static volatile unsigned int Capture_Fill;      // Pairs of history, up to CAPTURE_PAIRS
+static unsigned int Capture_Start;              // Capture_Head of the window's first entry
+static unsigned int Capture_Pre;                // Window of the pending record
+static unsigned int Capture_Left;               // Post-trigger pairs still to take
+static unsigned char Capture_Source;
+static unsigned long Capture_Time;
+static volatile unsigned char Capture_Mode;     // CAPTURE_OFF..CAPTURE_HELD
+
+// A block of entries to the record
+static void Capture_Write(unsigned long *dst, const unsigned long *src, unsigned int n)
+{
+    while(n--)
+        *dst++ = *src++;                            // Long-word writes
+}
+
+// Armed again from the window in FRAM, unless a record is held
+void Capture_Init(void)
+{
+    Capture_Head = 0;
+    Capture_Fill = 0;
+    if(Capture_Saved.source != CAPTURE_SRC_NONE)
+        Capture_Mode = CAPTURE_HELD;
+    else if(Capture_Setup.post != 0 && Capture_Setup.pre + Capture_Setup.post <= CAPTURE_WINDOW)
+        Capture_Mode = CAPTURE_ARMED;
+    else
+        Capture_Mode = CAPTURE_OFF;
+}
+
+// Set the window and arm, dropping a held record; 0 and 0 disarm.
+// Returns 0 when pre + post is over CAPTURE_WINDOW, or post is 0 (the
+// trigger's own pair is the first post-trigger entry).
+unsigned char Capture_Arm(unsigned int pre, unsigned int post)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(pre > CAPTURE_WINDOW || post > CAPTURE_WINDOW - pre || (post == 0 && pre != 0))
+        return 0;
+    __disable_interrupt();
+    Capture_Mode = CAPTURE_OFF;                     // No trigger while the setup changes
+    if(sr & GIE)
+        __enable_interrupt();
+
+    Capture_Saved.source = CAPTURE_SRC_NONE;
+    Capture_Setup.pre = pre;
+    Capture_Setup.post = post;
+
+    __disable_interrupt();
+    if(post != 0)
+        Capture_Mode = CAPTURE_ARMED;
+    if(sr & GIE)
+        __enable_interrupt();
+    return 1;
+}
+
+// IOUT has to run: armed, taking the post-trigger pairs or copying
+unsigned char Capture_Armed(void)
+{
+    unsigned char mode = Capture_Mode;
+
+    return mode != CAPTURE_OFF && mode != CAPTURE_HELD;
+}
+
+unsigned char Capture_State(void)
+{
+    return Capture_Mode;
+}
+
+void Capture_Window(unsigned int *pre, unsigned int *post)
+{
+    *pre = Capture_Setup.pre;
+    *post = Capture_Setup.post;
+}
+
+// From the fault ISRs, interrupts off. Only the first trigger of an armed
+// capture counts.
+void Capture_Trigger(unsigned char source)
+{
+    unsigned int pre;
+
+    if(Capture_Mode != CAPTURE_ARMED)
+        return;
+    pre = Capture_Setup.pre;
+    if(Capture_Fill < pre)
+        pre = Capture_Fill;                         // IOUT has not run that long
+    Capture_Pre = pre;
+    Capture_Start = Capture_Head - pre;
+    Capture_Left = Capture_Setup.post;
+    Capture_Source = source;
+    Capture_Time = Rtc_Now();
+    Capture_Mode = CAPTURE_POST_TRIG;
+}
+
+// From Iout_Start(), before the stream runs: the ring holds pairs from
+// before the gap, which are not history of the next trigger
+void Capture_Restart(void)
+{
+    Capture_Fill = 0;
+}
+
+// ADC ISR, after every IOUT pair (iout_sampler.c). Returns EVT_CAPTURE once
+// the post-trigger pairs are in.
+unsigned int Capture_Pair(unsigned int iout1, unsigned int iout2)
+{
+    unsigned int head = Capture_Head;
+
+    Capture_Ring[head & (CAPTURE_PAIRS - 1)] = ((unsigned long)iout2 << 16) | iout1;
+    Capture_Head = head + 1;
+    if(Capture_Fill < CAPTURE_PAIRS)
+        Capture_Fill++;
+    if(Capture_Mode != CAPTURE_POST_TRIG || --Capture_Left != 0)
+        return 0;
+    Capture_Mode = CAPTURE_COPY;                    // Window frozen, the ring goes on
+    return EVT_CAPTURE;
+}
+
+// EVT_CAPTURE: the frozen window to FRAM, a chunk between overrun checks,
+// oldest first, while the ADC ISR goes on writing the slack of the ring
+void Capture_Save(void)
+{
+    unsigned int total;
+    unsigned int done;
+    unsigned int pos;
+    unsigned int n;
+    unsigned char flags = 0;
+
+    if(Capture_Mode != CAPTURE_COPY)
+        return;
+    total = Capture_Pre + Capture_Setup.post;
+    Capture_Saved.source = CAPTURE_SRC_NONE;        // Invalid until the last write
+    for(done = 0; done < total; done += n)
+    {
+        pos = (Capture_Start + done) & (CAPTURE_PAIRS - 1);
+        n = total - done;
+        if(n > CAPTURE_CHUNK)
+            n = CAPTURE_CHUNK;
+        if(n > CAPTURE_PAIRS - pos)
+            n = CAPTURE_PAIRS - pos;                // Up to the end of the ring
+        Capture_Write(&Capture_Saved.pairs[done], &Capture_Ring[pos], n);
+        if((unsigned int)(Capture_Head - (Capture_Start + done)) > CAPTURE_PAIRS)
+            flags = CAPTURE_OVERRUN;                // The ISR got there first
+    }
+
+    Capture_Saved.flags = flags;
+    Capture_Saved.pre = Capture_Pre;
+    Capture_Saved.post = Capture_Setup.post;
+    Capture_Saved.rate = Iout_Rate();
+    Capture_Saved.time = Capture_Time;
+    Capture_Saved.source = Capture_Source;
+
+    Capture_Mode = CAPTURE_HELD;
+    Log_Append(LOG_CAPTURE, Capture_Source);
+}
+
+// The record in FRAM, source CAPTURE_SRC_NONE when there is none
+const Capture_Record *Capture_Get(void)
+{
+    return &Capture_Saved;
+}
@@ -0,0 +1,101 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Transient capture: the IOUT1/IOUT2 waveform around a 12 V rail or a
+//  battery fault, with pre- and post-trigger history, kept in FRAM for the
+//  host.
+//
+//  Source: the ADC inputs of this board are the two load currents (and the
+//  thermistors); there is no rail or battery voltage on the ADC (ir_test.h).
+//  The capture taps the IOUT stream (iout_sampler.h) rather than running a
+//  sampling of its own: one IOUT pair per entry, at the pair rate,
+//  IOUT_RATE_HZ (100 us), the fastest the ADC runs without taking the
+//  trigger grid from the coulomb counter and the discharge loop. While the
+//  capture is armed IOUT runs even with every battery idle, so the CPU
+//  sleeps in LPM0 instead of LPM3.
+//
+//  Ring: CAPTURE_PAIRS entries of RAM, u32 each, IOUT1 in the low word and
+//  IOUT2 in the high word, written by the ADC ISR after every pair (~25
+//  MCLK cycles) and never stopped.
+//
+//  Trigger, from the ISRs that see the fault first:
+//      CAPTURE_SRC_RAIL    n12VFlt falling edge, Timer3_B1 capture ISR
+//                          (power_trip.h), ~3 us after the edge
+//      CAPTURE_SRC_BATT1/2 first raw sample of nBatxFlt low on the
+//                          supervisor tick (supervisor.h), before the
+//                          debounce: up to one tick, 10 ms, after the edge;
+//                          a glitch the debounce rejects still triggers
+//  The pre-trigger part is the last pre pairs before the trigger (fewer
+//  when IOUT had not run that long, the record says how many), the
+//  post-trigger part the next post pairs. pre + post is at most
+//  CAPTURE_WINDOW, less than the ring: the rest is slack for the copy.
+//
+//  Freeze and copy: after the last post-trigger pair the ADC ISR posts
+//  EVT_CAPTURE and the main loop copies the window to FRAM (Capture_Save())
+//  with long-word writes, CAPTURE_CHUNK entries between overrun checks,
+//  interrupts on. The ISR keeps writing the ring meanwhile, into the slack
+//  after the window: the copy has CAPTURE_PAIRS - pre - post pair periods
+//  (6.4 ms with a full window) before the oldest entry is overwritten. A
+//  copy that falls behind is finished anyway and flagged CAPTURE_OVERRUN.
+//  ~12 MCLK cycles per entry, ~150 us for a full window.
+//
+//  Record, PERSISTENT: the window, the trigger source, the RTC time and the
+//  pair rate; the source is cleared first and written last, so a record cut
+//  short by a reset reads as none. PERSISTENT is outside PFWP
+//  (lnk_msp430fr2355.cmd). A LOG_CAPTURE record goes to the event log
+//  (event_log.h). The record is held: no new capture is taken until the
+//  host arms again, so the first fault of a cascade is the one kept,
+//  across resets too.
+//
+//  Arming: HOST_CMD_CAPTURE sets pre and post, post at least 1 (the pair
+//  the trigger falls in), and arms; 0, 0 disarms. The window is
+//  PERSISTENT, so after a reset the capture arms itself again unless a
+//  record is held. Off until first set. The host reads the record with
+//  HOST_CMD_CAPTURE_READ (host_link.h).
+//  __________________________________________________________________________________*/
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#define CAPTURE_PAIRS       256             // RAM ring entries, power of 2, 1 KB
+#define CAPTURE_WINDOW      192             // pre + post at most, 19.2 ms at 10 kHz
+#define CAPTURE_CHUNK       16              // Entries copied between overrun checks
+
+// Capture_State()
+#define CAPTURE_OFF         0               // Not armed
+#define CAPTURE_ARMED       1               // Filling the ring, waiting for a trigger
+#define CAPTURE_POST_TRIG   2               // Triggered, taking the post-trigger pairs
+#define CAPTURE_COPY        3               // Window frozen, for Capture_Save()
+#define CAPTURE_HELD        4               // Record in FRAM, waiting for the host
+
+// Trigger sources, Capture_Record.source
+#define CAPTURE_SRC_NONE    0               // No record
+#define CAPTURE_SRC_RAIL    1
+#define CAPTURE_SRC_BATT1   2
+#define CAPTURE_SRC_BATT2   3
+
+// Capture_Record.flags
+#define CAPTURE_OVERRUN     0x01            // The copy fell behind the ring, the oldest entries are newer pairs
+
+typedef struct
+{
+    unsigned char source;                   // CAPTURE_SRC_*, written last
+    unsigned char flags;                    // CAPTURE_OVERRUN
+    unsigned int pre;                       // Entries before the trigger
+    unsigned int post;                      // Entries from the trigger on
+    unsigned int rate;                      // Pair rate, Hz
+    unsigned long time;                     // RTC seconds of the trigger
+    unsigned long pairs[CAPTURE_WINDOW];    // IOUT1 | IOUT2 << 16, oldest first
+} Capture_Record;
+
+void Capture_Init(void);
+unsigned char Capture_Arm(unsigned int pre, unsigned int post);
+unsigned char Capture_Armed(void);
+unsigned char Capture_State(void);
+void Capture_Window(unsigned int *pre, unsigned int *post);
+void Capture_Trigger(unsigned char source);
+void Capture_Restart(void);
+unsigned int Capture_Pair(unsigned int iout1, unsigned int iout2);
+void Capture_Save(void);
+const Capture_Record *Capture_Get(void);
+
+#endif /* CAPTURE_H_ */
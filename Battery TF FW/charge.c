@@ -0,0 +1,168 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Charge termination: taper, -dV, dT/dt, safety timer, ACOK gating.
+//  See charge.h for the criteria and the fixed point formats.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "charge.h"
+#include "battery_sm.h"
+#include "iout_sampler.h"
+#include "coulomb.h"
+#include "therm.h"
+#include "sbs.h"
+#include "supervisor.h"
+#include "power_trip.h"
+#include "event_log.h"
+
+#define CHARGE_FLOOR_CODES  ((unsigned int)(CHARGE_FLOOR_MA * 1000UL / COULOMB_UA_PER_CODE))
+
+typedef struct
+{
+    unsigned char active;                   // Charge in progress
+    unsigned char reason;                   // CHARGE_END_* of the last charge
+    unsigned int seconds;                   // Charging time, pauses excluded
+    unsigned int current;                   // Filtered IOUT, 1/16 codes
+    unsigned int peak;                      // Peak of current
+    unsigned char taper;                    // Seconds in taper
+    unsigned char ndv;                      // Fresh readings under the peak voltage
+    unsigned int vPeak;                     // mV
+    int temp[CHARGE_DT_SLOTS];              // 0.1 degC, every CHARGE_DT_STEP_S
+    unsigned char tNext;                    // Next ring slot
+    unsigned char tCount;                   // Ring entries, up to CHARGE_DT_SLOTS
+    unsigned char tStep;                    // Seconds to the next entry
+} Charge_Channel;
+
+static const unsigned char Charge_Acok[BATT_CHANNELS] = { ACOK1, ACOK2 };
+
+static Charge_Channel Charge_Ch[BATT_CHANNELS];
+
+static void Charge_Start(Charge_Channel *c)
+{
+    c->active = 1;
+    c->reason = CHARGE_END_NONE;
+    c->seconds = 0;
+    c->current = 0;
+    c->peak = 0;
+    c->taper = 0;
+    c->ndv = 0;
+    c->vPeak = 0;
+    c->tNext = 0;
+    c->tCount = 0;
+    c->tStep = 1;                           // First entry on the first second
+}
+
+void Charge_Init(void)
+{
+    unsigned char ch;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        Charge_Ch[ch].active = 0;
+        Charge_Ch[ch].reason = CHARGE_END_NONE;
+        Charge_Ch[ch].seconds = 0;
+    }
+}
+
+// One second of one charging channel, CHARGE_END_NONE while it goes on
+static unsigned char Charge_Step(unsigned char ch, Charge_Channel *c)
+{
+    unsigned int v;
+    int t;
+
+    c->seconds++;
+
+    // Exponential average, 1/4 of the new second: f = f - f / 4 + 16 x / 4,
+    // in 1/16 codes, taken off first so the sum never passes 16 bits
+    c->current = c->current - (c->current >> 2) + (Iout_Mean(ch) << 2);
+    if(c->current > c->peak)
+        c->peak = c->current;
+
+    if(--c->tStep == 0)
+    {
+        c->tStep = CHARGE_DT_STEP_S;
+        t = Therm_Temp(ch);
+        c->temp[c->tNext] = t;
+        c->tNext = (c->tNext + 1) & (CHARGE_DT_SLOTS - 1);
+        if(c->tCount < CHARGE_DT_SLOTS)
+            c->tCount++;
+        else if(t - c->temp[c->tNext] >= CHARGE_DT_RISE_DC)   // tNext is now the oldest
+            return CHARGE_END_DTDT;
+    }
+
+    if(Sbs_Fresh(ch, SBS_VOLTAGE))
+    {
+        v = Sbs_Value(ch, SBS_VOLTAGE);
+        if(v > c->vPeak)
+            c->vPeak = v;
+        if(c->vPeak - v >= CHARGE_NDV_MV)
+            c->ndv++;
+        else
+            c->ndv = 0;
+    }
+
+    if(c->current <= (c->peak >> CHARGE_TAPER_SHIFT) || c->current <= CHARGE_FLOOR_CODES * 16)
+    {
+        if(c->taper < CHARGE_TAPER_S)
+            c->taper++;
+    }
+    else
+        c->taper = 0;
+
+    if(c->seconds >= CHARGE_MAX_S)
+        return CHARGE_END_TIMER;
+    if(c->seconds < CHARGE_HOLDOFF_S)
+        return CHARGE_END_NONE;
+    if(c->taper >= CHARGE_TAPER_S)
+        return CHARGE_END_TAPER;
+    if(c->ndv >= CHARGE_NDV_READS)
+        return CHARGE_END_NDV;
+    return CHARGE_END_NONE;
+}
+
+// EVT_SECOND, before Batt_Second()
+void Charge_Second(void)
+{
+    Charge_Channel *c;
+    unsigned char inputs = Supervisor_Inputs();
+    unsigned char railGood = Trip_RailGood();
+    unsigned char reason;
+    unsigned char ch;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        c = &Charge_Ch[ch];
+        if(Batt_State(ch) != BATT_CHARGE)
+        {
+            c->active = 0;                  // Ended elsewhere: request, fault, heat
+            continue;
+        }
+        if(!c->active)
+            Charge_Start(c);
+        if(!railGood || !(inputs & Charge_Acok[ch]))
+        {
+            c->taper = 0;                   // Paused, no current is no taper
+            c->ndv = 0;
+            continue;
+        }
+        reason = Charge_Step(ch, c);
+        if(reason != CHARGE_END_NONE)
+        {
+            c->active = 0;
+            c->reason = reason;
+            Log_Append(LOG_CHARGE_END, (ch << 4) | reason);
+            Batt_Request(ch, BEV_DONE);
+        }
+    }
+}
+
+// Why the last charge of a channel ended, CHARGE_END_NONE while charging
+unsigned char Charge_Reason(unsigned char ch)
+{
+    return Charge_Ch[ch & 1].reason;
+}
+
+unsigned int Charge_Seconds(unsigned char ch)
+{
+    return Charge_Ch[ch & 1].seconds;
+}
@@ -0,0 +1,65 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Charge termination: decides when a channel in BATT_CHARGE is done, and
+//  ends the charge with BEV_DONE (battery_sm.h).
+//
+//  Runs once a second from EVT_SECOND, for both channels, on what the
+//  other modules already measured:
+//      current      Iout_Mean() (iout_sampler.h), IOUT codes
+//      voltage      SBS_VOLTAGE from the gauge (sbs.h), mV, when fresh
+//      temperature  Therm_Temp() (therm.h), 0.1 degC
+//      charger      ACOK1 (battery 1) and ACOK2 (battery 2) on port 6
+//  A channel only counts as charging with the 12 V rail good and its ACOK
+//  high; otherwise the charge is paused: the timers hold and the taper and
+//  -dV counts start over, so a charger that loses its input is not taken
+//  for a taper.
+//
+//  Terminations, the first one that holds ends the charge:
+//      CHARGE_END_TIMER  safety timer, CHARGE_MAX_S of charging
+//      CHARGE_END_DTDT   temperature up CHARGE_DT_RISE_DC or more over the
+//                        last CHARGE_DT_WINDOW_S
+//      CHARGE_END_TAPER  CV taper: the filtered current at or below 1/16
+//                        of its peak in this charge, or below
+//                        CHARGE_FLOOR_MA, for CHARGE_TAPER_S seconds
+//      CHARGE_END_NDV    -dV: the voltage CHARGE_NDV_MV or more under its
+//                        peak on CHARGE_NDV_READS fresh readings in a row
+//  Taper and -dV only count after CHARGE_HOLDOFF_S, past the inrush and the
+//  first voltage swing. The end is logged (LOG_CHARGE_END, event_log.h)
+//  with the reason.
+//
+//  Fixed point only: the current is an exponential average in 1/16 codes
+//  (a shift and an add), the taper test a shift against the peak, the
+//  temperature slope the difference across a ring of CHARGE_DT_SLOTS
+//  readings taken every CHARGE_DT_STEP_S. No loop depends on the data, so
+//  a pass costs the same every second, a few hundred MCLK cycles for both
+//  channels (make bench, case_charge), in the main loop and not in any ISR.
+//  __________________________________________________________________________________*/
+#ifndef CHARGE_H_
+#define CHARGE_H_
+
+#define CHARGE_MAX_S        18000           // Safety timer, 5 h of charging
+#define CHARGE_HOLDOFF_S    120             // No taper or -dV before this
+#define CHARGE_FLOOR_MA     50              // Current at or below is taper, whatever the peak
+#define CHARGE_TAPER_SHIFT  4               // Taper at 1/16 of the peak current
+#define CHARGE_TAPER_S      30              // Seconds the taper has to hold
+#define CHARGE_NDV_MV       30              // -dV under the peak voltage, whole pack
+#define CHARGE_NDV_READS    3               // Fresh gauge readings in a row
+#define CHARGE_DT_SLOTS     8               // Temperature ring, power of 2
+#define CHARGE_DT_STEP_S    8               // Seconds between ring entries
+#define CHARGE_DT_WINDOW_S  ((CHARGE_DT_SLOTS - 1) * CHARGE_DT_STEP_S)  // 56 s
+#define CHARGE_DT_RISE_DC   10              // 1.0 degC over the window
+
+// Reasons, LOG_CHARGE_END arg low nibble
+#define CHARGE_END_NONE     0
+#define CHARGE_END_TAPER    1
+#define CHARGE_END_NDV      2
+#define CHARGE_END_DTDT     3
+#define CHARGE_END_TIMER    4
+
+void Charge_Init(void);
+void Charge_Second(void);
+unsigned char Charge_Reason(unsigned char ch);
+unsigned int Charge_Seconds(unsigned char ch);
+
+#endif /* CHARGE_H_ */
@@ -0,0 +1,243 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Coulomb counter: MPY32 integration of the IOUT block sums, batched
+//  commits to two alternating PERSISTENT FRAM slots.
+//  See coulomb.h for the fixed point format and the commit scheme.
+//  __________________________________________________________________________________*/
+#include <stddef.h>
+#include "BatteryFW_msp430fr2355.h"
+#include "coulomb.h"
+
+typedef struct
+{
+    unsigned long long charge[2][2];        // [ch][dir], 2^-32 uAh
+    unsigned long long energy[2][2];        // [ch][dir], 2^-32 uWh
+} Coulomb_Counts;
+
+typedef struct
+{
+    unsigned long seq;                      // Commit number, highest valid slot wins
+    Coulomb_Counts counts;
+    unsigned int crc;                       // CRC16 of seq and counts
+} Coulomb_Slot;
+
+// Statically-initialized variable
+#ifdef __TI_COMPILER_VERSION__
+#pragma PERSISTENT(Coulomb_Saved)
+Coulomb_Slot Coulomb_Saved[2] = {0};
+#elif __IAR_SYSTEMS_ICC__
+__persistent Coulomb_Slot Coulomb_Saved[2] = {0};
+#elif defined(__GNUC__)
+Coulomb_Slot Coulomb_Saved[2] __attribute__((persistent)) = {0};
+#else
+// Port the following variable to an equivalent persistent functionality for the specific compiler being used
+Coulomb_Slot Coulomb_Saved[2] = {0};
+#endif
+
+static volatile Coulomb_Counts Coulomb_Live;
+static unsigned long Coulomb_Seq;               // Sequence of the last committed slot
+static unsigned long Coulomb_KQ;                // 2^-32 uAh per ADC code at the current rate
+static unsigned long Coulomb_KE[2];             // 2^-32 uWh per ADC code, per channel
+static unsigned int Coulomb_mV[2];
+static volatile unsigned char Coulomb_Dir[2];
+static unsigned int Coulomb_Rate;
+static unsigned int Coulomb_Timer;
+
+// 32x32 unsigned multiply on MPY32. The compiler's own MPY32 sequences
+// (--use_hw_mpy=F5) run with interrupts disabled, so the ADC ISR can use
+// the multiplier without saving it. RES0..RES3 are read in order, each
+// read lands after the word it reads is ready.
+static inline unsigned long long Coulomb_Mpy(unsigned long a, unsigned long b)
+{
+    unsigned int r0, r1, r2, r3;
+
+    MPY32L = (unsigned int)a;
+    MPY32H = (unsigned int)(a >> 16);
+    OP2L = (unsigned int)b;
+    OP2H = (unsigned int)(b >> 16);             // Starts the multiply
+    r0 = RES0;
+    r1 = RES1;
+    r2 = RES2;
+    r3 = RES3;
+    return ((unsigned long long)(((unsigned long)r3 << 16) | r2) << 32) | (((unsigned long)r1 << 16) | r0);
+}
+
+// CRC16 (CRC-CCITT) of a slot on the CRC module, main loop only
+static unsigned int Coulomb_Crc(const Coulomb_Slot *slot)
+{
+    const unsigned int *p = (const unsigned int *)slot;
+    unsigned int n = offsetof(Coulomb_Slot, crc) / 2;
+
+    CRCINIRES = 0xFFFF;                         // Init CRC with 0xFFFF
+    while(n--)
+        CRCDIRB = *p++;                         // Input data in CRC
+    return CRCINIRES;
+}
+
+static void Coulomb_UpdateK(void)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long long kq;
+    unsigned long ke0, ke1;
+
+    if(Coulomb_Rate == 0)
+        return;
+    kq = ((unsigned long long)COULOMB_UA_PER_CODE << 32) / (3600UL * Coulomb_Rate);
+    ke0 = (unsigned long)((kq * Coulomb_mV[0]) / 1000);
+    ke1 = (unsigned long)((kq * Coulomb_mV[1]) / 1000);
+    __disable_interrupt();
+    Coulomb_KQ = (unsigned long)kq;
+    Coulomb_KE[0] = ke0;
+    Coulomb_KE[1] = ke1;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+void Coulomb_Init(void)
+{
+    const Coulomb_Slot *best = 0;
+    unsigned char i;
+    unsigned char ch;
+
+    for(i = 0; i < 2; i++)
+    {
+        if(Coulomb_Saved[i].crc != Coulomb_Crc(&Coulomb_Saved[i]))
+            continue;                           // Torn or never written
+        if(best == 0 || (long)(Coulomb_Saved[i].seq - best->seq) > 0)
+            best = &Coulomb_Saved[i];
+    }
+
+    if(best != 0)
+    {
+        Coulomb_Seq = best->seq;
+        for(ch = 0; ch < 2; ch++)
+        {
+            for(i = 0; i < 2; i++)
+            {
+                Coulomb_Live.charge[ch][i] = best->counts.charge[ch][i];
+                Coulomb_Live.energy[ch][i] = best->counts.energy[ch][i];
+            }
+        }
+    }
+    else
+    {
+        Coulomb_Seq = 0;
+        for(ch = 0; ch < 2; ch++)
+            Coulomb_Clear(ch);
+    }
+
+    for(ch = 0; ch < 2; ch++)
+    {
+        Coulomb_mV[ch] = COULOMB_NOMINAL_MV;
+        Coulomb_Dir[ch] = COULOMB_OUT;
+    }
+    Coulomb_Rate = 0;
+    Coulomb_Timer = COULOMB_COMMIT_S;
+}
+
+void Coulomb_SetRate(unsigned int pairRateHz)
+{
+    Coulomb_Rate = pairRateHz;
+    Coulomb_UpdateK();
+}
+
+void Coulomb_SetVoltage(unsigned char ch, unsigned int mV)
+{
+    Coulomb_mV[ch & 1] = mV;
+    Coulomb_UpdateK();
+}
+
+void Coulomb_SetDirection(unsigned char ch, unsigned char dir)
+{
+    Coulomb_Dir[ch & 1] = dir;
+}
+
+// Called from the ADC ISR once per IOUT block with the code sum of each channel
+void Coulomb_Integrate(unsigned long sum0, unsigned long sum1)
+{
+    unsigned char dir;
+
+    dir = Coulomb_Dir[0];
+    Coulomb_Live.charge[0][dir] += Coulomb_Mpy(sum0, Coulomb_KQ);
+    Coulomb_Live.energy[0][dir] += Coulomb_Mpy(sum0, Coulomb_KE[0]);
+
+    dir = Coulomb_Dir[1];
+    Coulomb_Live.charge[1][dir] += Coulomb_Mpy(sum1, Coulomb_KQ);
+    Coulomb_Live.energy[1][dir] += Coulomb_Mpy(sum1, Coulomb_KE[1]);
+}
+
+void Coulomb_Second(void)
+{
+    if(--Coulomb_Timer == 0)
+    {
+        Coulomb_Timer = COULOMB_COMMIT_S;
+        Coulomb_Commit();
+    }
+}
+
+// Copy the live counts into the older FRAM slot. Only the copy runs with
+// interrupts off (~10 us at 16 MHz); the CRC is computed afterwards from
+// FRAM and written last, so a torn slot never validates.
+void Coulomb_Commit(void)
+{
+    unsigned int sr = __get_SR_register();
+    Coulomb_Slot *slot = &Coulomb_Saved[(unsigned int)(Coulomb_Seq + 1) & 1];
+    unsigned char ch;
+    unsigned char dir;
+
+    slot->crc = ~slot->crc;                     // Invalidate before touching the counts
+    slot->seq = Coulomb_Seq + 1;
+    __disable_interrupt();
+    for(ch = 0; ch < 2; ch++)
+    {
+        for(dir = 0; dir < 2; dir++)
+        {
+            slot->counts.charge[ch][dir] = Coulomb_Live.charge[ch][dir];
+            slot->counts.energy[ch][dir] = Coulomb_Live.energy[ch][dir];
+        }
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+    slot->crc = Coulomb_Crc(slot);
+    Coulomb_Seq++;
+}
+
+void Coulomb_Clear(unsigned char ch)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned char dir;
+
+    __disable_interrupt();
+    for(dir = 0; dir < 2; dir++)
+    {
+        Coulomb_Live.charge[ch & 1][dir] = 0;
+        Coulomb_Live.energy[ch & 1][dir] = 0;
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+unsigned long Coulomb_uAh(unsigned char ch, unsigned char dir)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long v;
+
+    __disable_interrupt();
+    v = (unsigned long)(Coulomb_Live.charge[ch & 1][dir & 1] >> 32);
+    if(sr & GIE)
+        __enable_interrupt();
+    return v;
+}
+
+unsigned long Coulomb_uWh(unsigned char ch, unsigned char dir)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long v;
+
+    __disable_interrupt();
+    v = (unsigned long)(Coulomb_Live.energy[ch & 1][dir & 1] >> 32);
+    if(sr & GIE)
+        __enable_interrupt();
+    return v;
+}
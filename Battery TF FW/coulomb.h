@@ -0,0 +1,48 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Coulomb counter: charge (uAh) and energy (uWh) per battery channel and
+//  direction, integrated from the IOUT1/IOUT2 samples.
+//
+//  The ADC ISR adds every sample to a per-channel code sum and, every
+//  IOUT_BLOCK_PAIRS pairs, calls Coulomb_Integrate() with the two sums.
+//  That runs two 32x32 MPY32 multiplies per channel:
+//      charge += sum * Coulomb_KQ      (2^-32 uAh per ADC code)
+//      energy += sum * Coulomb_KE      (2^-32 uWh per ADC code)
+//  into 64-bit accumulators whose upper 32 bits are uAh / uWh. K is
+//  precomputed from the IOUT scale, the pair rate and the battery voltage,
+//  so the ISR never divides. Cost is ~120 MCLK cycles once per block
+//  (6.4 ms at 10 kHz), well inside the sampling ISR budget.
+//
+//  Direction comes from the battery state: a channel in CHARGE with the rail
+//  present counts into COULOMB_IN, anything else into COULOMB_OUT.
+//
+//  The accumulators live in RAM and are committed to #pragma PERSISTENT
+//  FRAM every COULOMB_COMMIT_S seconds and on demand (Coulomb_Commit()).
+//  Two FRAM slots are written alternately with a sequence number and a
+//  hardware CRC16, so a reset in the middle of a commit falls back to the
+//  previous slot. At one commit a minute FRAM endurance is not a concern;
+//  batching keeps FRAM writes out of the ISR and off the sampling path.
+//  __________________________________________________________________________________*/
+#ifndef COULOMB_H_
+#define COULOMB_H_
+
+#define COULOMB_IN              0           // Charging
+#define COULOMB_OUT             1           // Discharging or backing the load
+
+#define COULOMB_UA_PER_CODE     1221        // IOUT sense: 5 A full scale over 4095 codes
+#define COULOMB_NOMINAL_MV      11100       // Used for energy until a measured voltage is set
+#define COULOMB_COMMIT_S        60          // FRAM commit interval
+
+void Coulomb_Init(void);
+void Coulomb_SetRate(unsigned int pairRateHz);
+void Coulomb_SetVoltage(unsigned char ch, unsigned int mV);
+void Coulomb_SetDirection(unsigned char ch, unsigned char dir);
+void Coulomb_Integrate(unsigned long sum0, unsigned long sum1);
+void Coulomb_Second(void);
+void Coulomb_Commit(void);
+void Coulomb_Clear(unsigned char ch);
+unsigned long Coulomb_uAh(unsigned char ch, unsigned char dir);
+unsigned long Coulomb_uWh(unsigned char ch, unsigned char dir);
+
+#endif /* COULOMB_H_ */
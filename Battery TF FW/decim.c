@@ -0,0 +1,35 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Oversampling decimator: accumulate and dump. See decim.h for the ratios,
+//  the output widths and the cost.
+//  __________________________________________________________________________________*/
+#include "decim.h"
+
+// shift out of range is clamped to DECIM_MIN_SHIFT..DECIM_MAX_SHIFT
+void Decim_Init(Decim_Filter *f, unsigned char shift)
+{
+    if(shift < DECIM_MIN_SHIFT)
+        shift = DECIM_MIN_SHIFT;
+    if(shift > DECIM_MAX_SHIFT)
+        shift = DECIM_MAX_SHIFT;
+    f->sum = 0;
+    f->ratio = 1U << shift;
+    f->left = f->ratio;
+    f->scale = shift - shift / 2;
+    f->out = 0;
+    f->outputs = 0;
+}
+
+// One code in; returns 1 when it completed an output (f->out)
+unsigned char Decim_Add(Decim_Filter *f, unsigned int code)
+{
+    f->sum += code;
+    if(--f->left)
+        return 0;
+    f->out = (unsigned int)(f->sum >> f->scale);
+    f->outputs++;
+    f->sum = 0;
+    f->left = f->ratio;
+    return 1;
+}
@@ -0,0 +1,54 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Oversampling decimator: accumulate and dump, a first order CIC, for
+//  more resolution from a stream of 12 bit ADC codes.
+//
+//  R = 1 << shift codes, shift DECIM_MIN_SHIFT..DECIM_MAX_SHIFT (4x to
+//  256x), are summed into 32 bits; every R-th code the sum is dumped as one
+//  output of 12 + shift / 2 bits:
+//      out = sum >> (shift - shift / 2)
+//      4x  13 bits     16x 14 bits     64x 15 bits     256x 16 bits
+//  (8x, 32x and 128x give 13, 14 and 15 bits with a quarter more
+//  averaging). The extra bits are real when the input carries about half
+//  an LSB or more of noise, which the IOUT sense amplifiers do; a noiseless
+//  input only gets its code scaled. Outputs are at the input rate / R;
+//  the response is a sinc with nulls at multiples of the output rate, so
+//  ripple at the output rate and its harmonics is rejected.
+//
+//  Cost, from the ADC ISR: one 32-bit add and a count per code, plus the
+//  dump every R codes. No multiply, no divide. The cycles are measured per
+//  ratio by make bench (Simulator/bench, case_decim4 .. case_decim256):
+//  cycles per input code, per output and the MCLK share of both IOUT
+//  channels at IOUT_RATE_HZ, kept in Simulator/bench/baseline.txt by make
+//  bench-update. Until that has run on a machine with msp430-elf-gcc and
+//  mspdebug there are no figures; the per code cost is the design's, not
+//  a measurement.
+//
+//  The IOUT sampler runs one per channel on every pair (Iout_SetOversample(),
+//  iout_sampler.h). A Decim_Filter is plain data, so the same filter can be
+//  run on the results of any ADC service request (adc.h). The board has no
+//  battery voltage on the ADC (ir_test.h), so the currents are the
+//  channels it runs on here.
+//  __________________________________________________________________________________*/
+#ifndef DECIM_H_
+#define DECIM_H_
+
+#define DECIM_MIN_SHIFT     2               // 4x, 13 bits
+#define DECIM_MAX_SHIFT     8               // 256x, 16 bits
+#define DECIM_BITS(shift)   (12 + (shift) / 2)
+
+typedef struct
+{
+    unsigned long sum;                      // Codes since the last dump
+    unsigned int left;                      // Codes to the next dump
+    unsigned int ratio;                     // R
+    unsigned char scale;                    // shift - shift / 2
+    unsigned int out;                       // Last output, DECIM_BITS(shift) bits
+    unsigned int outputs;                   // Outputs since Decim_Init(), wrapping
+} Decim_Filter;
+
+void Decim_Init(Decim_Filter *f, unsigned char shift);
+unsigned char Decim_Add(Decim_Filter *f, unsigned int code);
+
+#endif /* DECIM_H_ */
@@ -0,0 +1,375 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Regulated discharge: TB3.1/TB3.2 PWM on DisChg1/DisChg2, PI from the ADC ISR.
+//  See discharge.h for the pin handover, the loop timing and the formats.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "discharge.h"
+#include "battery_sm.h"
+#include "power_seq.h"
+#include "power_trip.h"
+#include "iout_sampler.h"
+#include "coulomb.h"
+#include "sbs.h"
+
+#define DISCHG_DUTY_FULL    32768U          // Q15 1.0
+#define DISCHG_INTEG_FULL   ((long)DISCHG_DUTY_FULL << 8)
+
+typedef struct
+{
+    unsigned char mode;                     // DISCHG_MODE_*
+    unsigned char engaged;                  // Pin on its TB3 output, loop running
+    unsigned char end;                      // Next compare ends the on time
+    unsigned char kp;                       // Q8
+    unsigned char ki;                       // Q8
+    unsigned int setpoint;                  // mA or mW, as set
+    unsigned int target;                    // IOUT, 1/16 codes
+    unsigned int sum;                       // IOUT codes of the window so far
+    unsigned int window[DISCHG_SETTLE_LOOPS];   // Last windows, 1/16 codes
+    unsigned long windows;                  // Their sum
+    unsigned char slot;                     // Oldest window
+    unsigned int on;                        // On time of the next period, TB3 counts
+    unsigned int next;                      // On time of the period being started
+    unsigned int rest;                      // Counts from the end of the on time to the next period
+    long integ;                             // Q15 duty << 8
+    unsigned int duty;                      // Q15
+    unsigned int loops;                     // Since the setpoint step
+    unsigned int settle;                    // Loops to settle, DISCHG_UNSETTLED until then
+} Dischg_Channel;
+
+static const unsigned char Dischg_Pin[BATT_CHANNELS] = { DisChg1, DisChg2 };
+static volatile unsigned int * const Dischg_Cctl[BATT_CHANNELS] = { &TB3CCTL1, &TB3CCTL2 };
+static volatile unsigned int * const Dischg_Ccr[BATT_CHANNELS] = { &TB3CCR1, &TB3CCR2 };
+
+volatile unsigned char Dischg_Running;
+
+static Dischg_Channel Dischg_Ch[BATT_CHANNELS];
+static unsigned int Dischg_CountsPerUs;         // TB3 counts per us (power_trip.h)
+static unsigned int Dischg_Period;              // PWM period, TB3 counts, 0 until first engaged
+static unsigned int Dischg_MinCounts;           // DISCHG_MIN_US in TB3 counts
+static unsigned char Dischg_Pairs;              // IOUT pairs in the current window
+static volatile unsigned int Dischg_Loops;      // Loops run, free running
+static unsigned int Dischg_LastLoops;           // Dischg_Loops at the last second
+static unsigned int Dischg_Hz;                  // Loops in the last second
+
+// Restart the settling measurement
+static void Dischg_Step(Dischg_Channel *d)
+{
+    d->loops = 0;
+    d->settle = DISCHG_UNSETTLED;
+}
+
+// Give the pin back to P6OUT, interrupts off
+static void Dischg_Release(unsigned char ch)
+{
+    P6SEL0 &= ~Dischg_Pin[ch];
+    *Dischg_Cctl[ch] = OUTMOD_0;
+    Dischg_Ch[ch].engaged = 0;
+    Trip_ClockRelease(TRIP_HOLD_DISCHG << ch);
+}
+
+void Dischg_Init(void)
+{
+    unsigned char ch;
+    unsigned char i;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        Dischg_Ch[ch].mode = DISCHG_MODE_FULL;
+        Dischg_Ch[ch].engaged = 0;
+        Dischg_Ch[ch].kp = DISCHG_KP;
+        Dischg_Ch[ch].ki = DISCHG_KI;
+        Dischg_Ch[ch].setpoint = 0;
+        Dischg_Ch[ch].target = 0;
+        Dischg_Ch[ch].sum = 0;
+        Dischg_Ch[ch].windows = 0;
+        Dischg_Ch[ch].slot = 0;
+        for(i = 0; i < DISCHG_SETTLE_LOOPS; i++)
+            Dischg_Ch[ch].window[i] = 0;
+        Dischg_Step(&Dischg_Ch[ch]);
+        *Dischg_Cctl[ch] = OUTMOD_0;
+    }
+    Dischg_Running = 0;
+    Dischg_Period = 0;
+    Dischg_Pairs = 0;
+    Dischg_CountsPerUs = 1;
+    Dischg_MinCounts = DISCHG_MIN_US;
+}
+
+// From Trip_SetMeasure(), interrupts off, TB3 on a new clock: the
+// scheduled edges are off their times, so the pins go back to P6OUT (fully
+// on) until the next loop takes them over on the new clock.
+void Dischg_SetClock(unsigned int countsPerUs)
+{
+    unsigned char ch;
+
+    Dischg_CountsPerUs = countsPerUs;
+    Dischg_MinCounts = DISCHG_MIN_US * countsPerUs;
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        if(Dischg_Ch[ch].engaged)
+            Dischg_Release(ch);
+    }
+    Dischg_Period = 0;
+}
+
+// IOUT target in 1/16 codes from mA
+static unsigned int Dischg_Codes(unsigned long ma)
+{
+    unsigned long codes = ma * 1000UL * 16 / COULOMB_UA_PER_CODE;
+
+    return codes > 0xFFFF ? 0xFFFF : (unsigned int)codes;
+}
+
+// Constant power: I = P / V on the gauge voltage, 0 without one
+static unsigned int Dischg_PowerTarget(unsigned char ch, unsigned int mw)
+{
+    unsigned int mv = Sbs_Value(ch, SBS_VOLTAGE);
+
+    if(!(Sbs_Valid(ch) & (1 << SBS_VOLTAGE)) || mv == 0)
+        return 0;
+    return Dischg_Codes((unsigned long)mw * 1000UL / mv);
+}
+
+// Returns 0 on a bad argument. kp and ki are Q8, ki may not be 0.
+unsigned char Dischg_Set(unsigned char ch, unsigned char mode, unsigned int setpoint,
+                         unsigned char kp, unsigned char ki)
+{
+    unsigned int sr = __get_SR_register();
+    Dischg_Channel *d;
+    unsigned int target;
+
+    if(ch >= BATT_CHANNELS || mode > DISCHG_MODE_CP || ki == 0)
+        return 0;
+    d = &Dischg_Ch[ch];
+    if(mode == DISCHG_MODE_CC)
+        target = Dischg_Codes(setpoint);
+    else if(mode == DISCHG_MODE_CP)
+        target = Dischg_PowerTarget(ch, setpoint);
+    else
+        target = 0;
+
+    __disable_interrupt();
+    d->mode = mode;
+    d->setpoint = setpoint;
+    d->target = target;
+    d->kp = kp;
+    d->ki = ki;
+    Dischg_Step(d);
+    if(mode == DISCHG_MODE_FULL && d->engaged)
+        Dischg_Release(ch);
+    Dischg_Running = Dischg_Ch[0].mode != DISCHG_MODE_FULL || Dischg_Ch[1].mode != DISCHG_MODE_FULL;
+    if(sr & GIE)
+        __enable_interrupt();
+    return 1;
+}
+
+// EVT_SECOND: loop rate, constant power targets
+void Dischg_Second(void)
+{
+    unsigned int loops = Dischg_Loops;
+    unsigned int target;
+    unsigned char ch;
+
+    Dischg_Hz = loops - Dischg_LastLoops;
+    Dischg_LastLoops = loops;
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        if(Dischg_Ch[ch].mode != DISCHG_MODE_CP)
+            continue;
+        target = Dischg_PowerTarget(ch, Dischg_Ch[ch].setpoint);
+        Dischg_Ch[ch].target = target;          // One word, the ISR sees old or new
+    }
+}
+
+// PWM period in TB3 counts for the current IOUT rate: DISCHG_LOOP_PAIRS
+// pairs of two TB1 trigger periods (iout_sampler.c), plus the slip.
+// Shared by both channels, so only set while neither is engaged.
+static unsigned char Dischg_Timing(void)
+{
+    unsigned int rate = Iout_Rate();
+    unsigned long period;
+
+    if(Dischg_Ch[0].engaged || Dischg_Ch[1].engaged)
+        return Dischg_Period != 0;
+    if(rate == 0)
+        return 0;
+    period = (SMCLK_HZ / (2UL * rate)) * 2UL * DISCHG_LOOP_PAIRS * Dischg_CountsPerUs
+             / (SMCLK_HZ / 1000000UL);
+    period += period / (DISCHG_LOOP_PAIRS * DISCHG_SETTLE_LOOPS);     // Slip, see discharge.h
+    if(period > 0xFFFF || period < 4UL * Dischg_MinCounts)
+        return 0;
+    Dischg_Period = (unsigned int)period;
+    return 1;
+}
+
+// Take the pin over from P6OUT, which has it high: the timer output is
+// set high first, then selected, then the first period starts fully on.
+static void Dischg_Engage(unsigned char ch, Dischg_Channel *d)
+{
+    *Dischg_Cctl[ch] = OUTMOD_0 | OUT;
+    P6SEL0 |= Dischg_Pin[ch];
+    d->on = Dischg_Period;
+    d->next = Dischg_Period;
+    d->end = 0;
+    d->integ = DISCHG_INTEG_FULL;
+    d->duty = DISCHG_DUTY_FULL;
+    Dischg_Step(d);
+    Trip_ClockHold(TRIP_HOLD_DISCHG << ch);     // TB3 in us before it is read
+    *Dischg_Ccr[ch] = TB3R + Dischg_MinCounts;
+    *Dischg_Cctl[ch] = OUTMOD_1 | CCIE;
+    d->engaged = 1;
+}
+
+// One PI step on the window just completed
+static void Dischg_Loop(unsigned char ch, Dischg_Channel *d)
+{
+    unsigned int measured = d->sum;
+    unsigned int band;
+    unsigned long on;
+    long e;
+    long u;
+
+    d->sum = 0;
+    d->windows = d->windows + measured - d->window[d->slot];
+    d->window[d->slot] = measured;
+    d->slot = (d->slot + 1) & (DISCHG_SETTLE_LOOPS - 1);
+    if(!d->engaged)
+    {
+        // Only a path the sequencer has switched on and finished with
+        if(d->mode != DISCHG_MODE_FULL && (P6OUT & Dischg_Pin[ch]) && !Seq_Busy() && Dischg_Timing())
+            Dischg_Engage(ch, d);
+        return;
+    }
+
+    e = (long)d->target - (long)measured;
+    if(e > 32767)
+        e = 32767;
+    else if(e < -32767)
+        e = -32767;
+
+    d->integ += d->ki * e;                      // Clamped: no windup at 0 or full duty
+    if(d->integ < 0)
+        d->integ = 0;
+    else if(d->integ > DISCHG_INTEG_FULL)
+        d->integ = DISCHG_INTEG_FULL;
+    u = (d->integ + d->kp * e) >> 8;
+    if(u < 0)
+        u = 0;
+    else if(u > (long)DISCHG_DUTY_FULL)
+        u = DISCHG_DUTY_FULL;
+    d->duty = (unsigned int)u;
+
+    on = ((unsigned long)u * Dischg_Period) >> 15;
+    if(on < Dischg_MinCounts)
+        on = 0;
+    else if(on > (unsigned int)(Dischg_Period - Dischg_MinCounts))
+        on = Dischg_Period;
+    d->on = (unsigned int)on;                   // Picked up at the end of the current on time
+
+    if(d->loops != 0xFFFF)
+        d->loops++;
+    if(d->settle == DISCHG_UNSETTLED && d->loops >= DISCHG_SETTLE_LOOPS)
+    {
+        band = d->target >> DISCHG_BAND_SHIFT;
+        if(band < DISCHG_BAND_MIN)
+            band = DISCHG_BAND_MIN;
+        e = (long)d->target - (long)(d->windows / DISCHG_SETTLE_LOOPS);
+        if(e <= (long)band && e >= -(long)band)
+            d->settle = d->loops - DISCHG_SETTLE_LOOPS;
+    }
+}
+
+// ADC ISR, once per IOUT pair while Dischg_Running
+void Dischg_Pair(unsigned int iout1, unsigned int iout2)
+{
+    Dischg_Ch[0].sum += iout1;
+    Dischg_Ch[1].sum += iout2;
+    if(++Dischg_Pairs < DISCHG_LOOP_PAIRS)
+        return;
+    Dischg_Pairs = 0;
+    Dischg_Loops++;
+    Dischg_Loop(0, &Dischg_Ch[0]);
+    Dischg_Loop(1, &Dischg_Ch[1]);
+}
+
+// Timer3_B1 ISR, TB3CCR1 (ch 0) or TB3CCR2 (ch 1): the edge the hardware
+// just made is past, schedule the next one
+void Dischg_Edge(unsigned char ch)
+{
+    Dischg_Channel *d = &Dischg_Ch[ch];
+    unsigned int span;
+
+    if(!(P6SEL0 & Dischg_Pin[ch]))              // Taken back by the sequencer or the shutdown
+    {
+        *Dischg_Cctl[ch] = OUTMOD_0;
+        d->engaged = 0;
+        Trip_ClockRelease(TRIP_HOLD_DISCHG << ch);
+        return;
+    }
+    if(d->end)                                  // On time over, next compare starts a period
+    {
+        d->next = d->on;
+        *Dischg_Ccr[ch] += d->rest;
+        *Dischg_Cctl[ch] = (d->next ? OUTMOD_1 : OUTMOD_5) | CCIE;
+        d->end = 0;
+    }
+    else                                        // Period started, next compare ends the on time
+    {
+        span = d->next;
+        if(span == 0 || span >= Dischg_Period)
+            span = Dischg_Period >> 1;          // No edge in this period, any point will do
+        *Dischg_Ccr[ch] += span;
+        d->rest = Dischg_Period - span;
+        *Dischg_Cctl[ch] = (d->next >= Dischg_Period ? OUTMOD_1 : OUTMOD_5) | CCIE;
+        d->end = 1;
+    }
+}
+
+unsigned char Dischg_Mode(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].mode;
+}
+
+unsigned char Dischg_Engaged(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].engaged;
+}
+
+unsigned int Dischg_Setpoint(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].setpoint;
+}
+
+unsigned int Dischg_Target(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].target;
+}
+
+// Mean of the last DISCHG_SETTLE_LOOPS windows
+unsigned int Dischg_Measured(unsigned char ch)
+{
+    return (unsigned int)(Dischg_Ch[ch & 1].windows / DISCHG_SETTLE_LOOPS);
+}
+
+unsigned int Dischg_Duty(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].duty;
+}
+
+unsigned int Dischg_SettleLoops(unsigned char ch)
+{
+    return Dischg_Ch[ch & 1].settle;
+}
+
+unsigned int Dischg_LoopHz(void)
+{
+    return Dischg_Hz;
+}
+
+// PWM and loop period, 0 before the first engagement on this clock
+unsigned int Dischg_PeriodUs(void)
+{
+    return Dischg_Period / Dischg_CountsPerUs;
+}
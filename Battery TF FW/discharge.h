@@ -0,0 +1,109 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Regulated discharge: constant current or constant power test discharge
+//  on DisChg1 (P6.0) and DisChg2 (P6.1).
+//
+//  The battery state machine and the power path sequencer still decide
+//  whether a discharge path is on (battery_sm.h, power_seq.h); this module
+//  only sets how hard. With a channel in DISCHG_MODE_CC or DISCHG_MODE_CP
+//  and its DisChg pin switched on by the sequencer, the pin is handed to
+//  its Timer3_B output (P6.0 TB3.1, P6.1 TB3.2) and pulse width modulated;
+//  the sequencer takes it back by clearing P6SEL0 together with P6OUT, so a
+//  break step, the trip and the shutdown cut the path as before.
+//  DISCHG_MODE_FULL is the plain on/off discharge.
+//
+//  The load setpoint is the PWM duty. The SAC DAC would give a true analog
+//  setpoint, but of the four SAC outputs only OA1O (P1.5) is free on this
+//  board (OA0O is IOUT2, OA2O and OA3O are LEDs), and the DisChg pins are
+//  the TB3 pins already.
+//
+//  PWM: Timer3_B keeps running continuous mode for the trip capture and
+//  the sequencer, so each channel schedules its own edges: TB3CCR1/CCR2 in
+//  set mode (OUTMOD_1) for the start of a period and in reset mode
+//  (OUTMOD_5) for the end of the on time, the compare ISR adding the next
+//  span. The hardware makes the edges, the ISR only needs to run before
+//  the next one, so on times under DISCHG_MIN_US are rounded to 0 or to
+//  the full period.
+//
+//  Loop: the PI runs from the ADC ISR (iout_sampler.h) every
+//  DISCHG_LOOP_PAIRS IOUT pairs, on the sum of those pairs, a window; the
+//  sum of 16 pairs is the mean in 1/16 codes, the charge termination's
+//  current format (charge.h). The PWM period is one window (both timers
+//  count SMCLK) plus a slip of 1/DISCHG_SETTLE_LOOPS of a pair: a window
+//  holds the whole switching ripple once, and over DISCHG_SETTLE_LOOPS
+//  windows the samples move through the PWM period in steps of that slip.
+//  A window alone only sees a switched current at 16 points, 1/16 of full
+//  load apart; the slip lets the integrator, and the mean of the last
+//  DISCHG_SETTLE_LOOPS windows, resolve 1/128. At the default 10 kHz pair
+//  rate the period is 1.612 ms and the loop runs at 625 Hz. An auxiliary
+//  conversion stretches one window by a trigger period, once a second.
+//
+//  PI, fixed point, per loop:
+//      e     = target - measured           1/16 codes, clamped to 16 bits
+//      integ = integ + ki * e              clamped to 0..full duty
+//      duty  = (integ + kp * e) >> 8       Q15, clamped to 0..1.0
+//  kp and ki are Q8 (DISCHG_KP, DISCHG_KI by default, set with
+//  Dischg_Set()). kp is 0 by default: on a switched load a proportional
+//  term makes the duty follow the sampling noise of each window, which
+//  correlates it with the sampling phase and moves the mean current a few
+//  percent off the target; integral only, the mean holds within 1%. A
+//  filtered IOUT can take some kp. The integrator starts at full duty,
+//  where the pin was, so taking the pin over is bumpless and the first
+//  response is a step down from full load.
+//
+//  Constant power is constant current at P / V, the target recomputed
+//  once a second from the gauge voltage (SBS_VOLTAGE, sbs.h); with no valid
+//  voltage the target is 0.
+//
+//  Measured, for the host (HOST_CMD_DISCHG_READ, host_link.h):
+//      loop rate      loops run in the last second
+//      measured       mean of the last DISCHG_SETTLE_LOOPS windows
+//      settling time  loops from a setpoint change (or from taking the pin
+//                     over) to the first DISCHG_SETTLE_LOOPS windows whose
+//                     mean is within 1/32 of the target (DISCHG_BAND_SHIFT)
+//  A setpoint change restarts the settling measurement; the once a second
+//  constant power update does not. In the simulator, with the load an
+//  ideal switch (sim.h, load), a 1 A step on a 3.1 A load settles in about
+//  20 loops, 35 ms.
+//
+//  Cost: the loop pass for both channels is in the ADC ISR every
+//  DISCHG_LOOP_PAIRS pairs (make bench, case_dischg), the other pairs only
+//  add; the PWM takes two Timer3_B1 interrupts per period and channel.
+//  __________________________________________________________________________________*/
+#ifndef DISCHARGE_H_
+#define DISCHARGE_H_
+
+#define DISCHG_MODE_FULL    0               // DisChg plain on/off
+#define DISCHG_MODE_CC      1               // Constant current, setpoint in mA
+#define DISCHG_MODE_CP      2               // Constant power, setpoint in mW
+
+#define DISCHG_LOOP_PAIRS   16              // IOUT pairs per loop and per PWM period
+#define DISCHG_MIN_US       25              // Shortest on or off time, ISR latency margin
+#define DISCHG_KP           0               // Q8
+#define DISCHG_KI           32              // Q8, 0.125
+#define DISCHG_BAND_SHIFT   5               // Settled within 1/32 of the target
+#define DISCHG_BAND_MIN     16              // or 1 code, whichever is larger
+#define DISCHG_SETTLE_LOOPS 8               // Windows in the settling mean and the slip, power of 2
+#define DISCHG_UNSETTLED    0xFFFF
+
+extern volatile unsigned char Dischg_Running;   // A channel is in CC or CP mode
+
+void Dischg_Init(void);
+void Dischg_SetClock(unsigned int countsPerUs);
+unsigned char Dischg_Set(unsigned char ch, unsigned char mode, unsigned int setpoint,
+                         unsigned char kp, unsigned char ki);
+void Dischg_Second(void);
+void Dischg_Pair(unsigned int iout1, unsigned int iout2);
+void Dischg_Edge(unsigned char ch);
+unsigned char Dischg_Mode(unsigned char ch);
+unsigned char Dischg_Engaged(unsigned char ch);
+unsigned int Dischg_Setpoint(unsigned char ch);
+unsigned int Dischg_Target(unsigned char ch);
+unsigned int Dischg_Measured(unsigned char ch);
+unsigned int Dischg_Duty(unsigned char ch);
+unsigned int Dischg_SettleLoops(unsigned char ch);
+unsigned int Dischg_LoopHz(void);
+unsigned int Dischg_PeriodUs(void);
+
+#endif /* DISCHARGE_H_ */
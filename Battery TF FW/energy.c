@@ -0,0 +1,127 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Energy: sleep mode residency on TB0R, interrupt counts, energy estimate.
+//  See energy.h for what is measured and the current figures.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "energy.h"
+#include "supervisor.h"
+
+volatile unsigned long Energy_Irqs[ENERGY_IRQS];
+volatile unsigned long Energy_Lpm3Wakes;
+volatile unsigned char Energy_InLpm3;           // Main loop is asleep in LPM3
+
+static unsigned long long Energy_Ticks[ENERGY_MODES];   // ACLK counts per mode
+static unsigned long long Energy_Held[ENERGY_HOLDERS];  // LPM0 ACLK counts per CLKREQ_* bit
+static unsigned long Energy_WakeCount;          // Main loop wakes
+static unsigned int Energy_Mark;                // TB0R at the last sleep or wake
+static unsigned int Energy_Requests;            // SMCLK_Requests of the current sleep
+
+// After Supervisor_Init(), TB0 counting
+void Energy_Init(void)
+{
+    Energy_Clear();
+    Energy_Mark = Supervisor_Now();
+}
+
+// Interrupts off, right before the main loop sleeps
+void Energy_Sleep(unsigned int requests)
+{
+    unsigned int t = Supervisor_Now();
+
+    Energy_Ticks[ENERGY_ACTIVE] += (unsigned int)(t - Energy_Mark);
+    Energy_Mark = t;
+    Energy_Requests = requests;
+    Energy_InLpm3 = (requests == 0);
+}
+
+// First thing after the main loop wakes
+void Energy_Wake(void)
+{
+    unsigned int t = Supervisor_Now();
+    unsigned int span = t - Energy_Mark;
+    unsigned char b;
+
+    Energy_InLpm3 = 0;
+    Energy_Mark = t;
+    Energy_WakeCount++;
+    if(Energy_Requests == 0)
+    {
+        Energy_Ticks[ENERGY_LPM3] += span;
+        return;
+    }
+    Energy_Ticks[ENERGY_LPM0] += span;
+    for(b = 0; b < ENERGY_HOLDERS; b++)
+    {
+        if(Energy_Requests & (1 << b))
+            Energy_Held[b] += span;
+    }
+}
+
+void Energy_Clear(void)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned char i;
+
+    __disable_interrupt();
+    for(i = 0; i < ENERGY_IRQS; i++)
+        Energy_Irqs[i] = 0;
+    Energy_Lpm3Wakes = 0;
+    for(i = 0; i < ENERGY_MODES; i++)
+        Energy_Ticks[i] = 0;
+    for(i = 0; i < ENERGY_HOLDERS; i++)
+        Energy_Held[i] = 0;
+    Energy_WakeCount = 0;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// 1000 / 32768 = 125 / 4096
+static unsigned long Energy_TicksToMs(unsigned long long ticks)
+{
+    return (unsigned long)((ticks * 125) >> 12);
+}
+
+unsigned long Energy_Ms(unsigned char mode)
+{
+    return Energy_TicksToMs(Energy_Ticks[mode]);
+}
+
+unsigned long Energy_HeldMs(unsigned char holder)
+{
+    return Energy_TicksToMs(Energy_Held[holder]);
+}
+
+// uA * mV is nW; ACLK counts to s, then s to h and nWh to uWh
+unsigned long Energy_uWh(unsigned char mode)
+{
+    static const unsigned int ua[ENERGY_MODES] = { ENERGY_UA_ACTIVE, ENERGY_UA_LPM0, ENERGY_UA_LPM3 };
+
+    return (unsigned long)(Energy_Ticks[mode] * ((unsigned long)ua[mode] * ENERGY_MV)
+                           / (ACLK_HZ * 3600ULL * 1000));
+}
+
+unsigned long Energy_WakeuWh(void)
+{
+    return (unsigned long)(Energy_IrqCount(ENERGY_IRQ_LPM3) * ((unsigned long long)ENERGY_WAKE_US * ENERGY_UA_ACTIVE * ENERGY_MV)
+                           / (1000000ULL * 3600 * 1000));
+}
+
+unsigned long Energy_Wakes(void)
+{
+    return Energy_WakeCount;
+}
+
+// Entries of one source, or ENERGY_IRQ_LPM3
+unsigned long Energy_IrqCount(unsigned char src)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long n;
+
+    __disable_interrupt();
+    n = src < ENERGY_IRQS ? Energy_Irqs[src] : Energy_Lpm3Wakes;
+    if(sr & GIE)
+        __enable_interrupt();
+    return n;
+}
@@ -0,0 +1,89 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Energy: time spent active, in LPM0 and in LPM3, interrupt counts per
+//  source, and an energy estimate from datasheet currents.
+//
+//  Residency is measured on TB0R, the supervisor's free running ACLK
+//  count (supervisor.h), which keeps counting in LPM0 and LPM3. The main
+//  loop calls Energy_Sleep() right before it sleeps, with interrupts off,
+//  and Energy_Wake() when it runs again: the span in between goes to the
+//  sleep mode, the span from the wake to the next sleep is active time.
+//  ISRs that run while the main loop sleeps are counted as sleep; their
+//  cost is in the wake-up term below. At 30.5 us per count a single active
+//  pass is below the resolution, but the main loop wakes at a random ACLK
+//  phase, so the sums are right on average. EVT_SECOND wakes the main loop
+//  at least once a second, so a span always fits the 16-bit count.
+//
+//  LPM0 time is also split by the CLKREQ_* bits that held SMCLK on
+//  (BatteryFW_msp430fr2355.h), a span counting for every holder: that is
+//  the LPM0 time each module would save by letting go.
+//
+//  Every ISR counts its entries with ENERGY_IRQ(), one 32-bit increment,
+//  and the entries taken while the main loop sleeps in LPM3 are counted
+//  once more as LPM3 wakes: each one restarts the DCO and runs the ISR at
+//  active current for about ENERGY_WAKE_US.
+//
+//  The firmware has no LPM4 or LPMx.5 idle state, the supervisor tick, the
+//  RTC and the LED engine all need ACLK; LPM4 is only entered at shutdown,
+//  waiting for the supply to drop (shutdown.h).
+//
+//  Estimate, in uWh at ENERGY_MV:
+//      active  ticks * ENERGY_UA_ACTIVE      LPM0  ticks * ENERGY_UA_LPM0
+//      LPM3    ticks * ENERGY_UA_LPM3        wakes LPM3 wakes * ENERGY_WAKE_US * ENERGY_UA_ACTIVE
+//  Currents are typical MSP430FR2355 datasheet figures at 3 V, 25 C, with
+//  the clocks this firmware runs (MCLK = SMCLK = 16 MHz, ACLK = REFO); the
+//  board's own loads are not included.
+//
+//  The host reads the counters with HOST_CMD_ENERGY (host_link.h), and may
+//  clear them at the same time. Times go out in ms and wrap after 49 days.
+//  __________________________________________________________________________________*/
+#ifndef ENERGY_H_
+#define ENERGY_H_
+
+// Interrupt sources, ENERGY_IRQ() in each ISR
+#define ENERGY_IRQ_TICK     0               // Timer0_B0, supervisor tick
+#define ENERGY_IRQ_TIMERS   1               // Timer0_B1, module timers
+#define ENERGY_IRQ_LED      2               // Timer2_B0, LED engine
+#define ENERGY_IRQ_TRIP     3               // Timer3_B1, trip capture and sequencer
+#define ENERGY_IRQ_RTC      4
+#define ENERGY_IRQ_ADC      5
+#define ENERGY_IRQ_HOST     6               // USCI_A1
+#define ENERGY_IRQ_SBS0     7               // USCI_B0
+#define ENERGY_IRQ_SBS1     8               // USCI_B1
+#define ENERGY_IRQS         9               // Port 2 is the shutdown, never counted
+#define ENERGY_IRQ_LPM3     ENERGY_IRQS     // Energy_IrqCount(): entries from LPM3, all sources
+
+// Residency modes
+#define ENERGY_ACTIVE       0
+#define ENERGY_LPM0         1
+#define ENERGY_LPM3         2
+#define ENERGY_MODES        3
+
+#define ENERGY_HOLDERS      4               // CLKREQ_* bits
+
+// Datasheet figures, typical
+#define ENERGY_MV           3300            // DVCC
+#define ENERGY_UA_ACTIVE    2300            // AM, 16 MHz, FRAM 1 wait state, ~142 uA/MHz
+#define ENERGY_UA_LPM0      700             // LPM0, 16 MHz DCO and FLL running
+#define ENERGY_UA_LPM3      16              // LPM3, REFO as ACLK, RTC and Timer_B counting
+#define ENERGY_WAKE_US      15              // LPM3 wake-up, ~10 us, plus a short ISR
+
+#define ENERGY_IRQ(src)     (Energy_Irqs[src]++, Energy_Lpm3Wakes += Energy_InLpm3)
+
+extern volatile unsigned long Energy_Irqs[ENERGY_IRQS];
+extern volatile unsigned long Energy_Lpm3Wakes;
+extern volatile unsigned char Energy_InLpm3;
+
+void Energy_Init(void);
+void Energy_Sleep(unsigned int requests);
+void Energy_Wake(void);
+void Energy_Clear(void);
+unsigned long Energy_Ms(unsigned char mode);
+unsigned long Energy_HeldMs(unsigned char holder);
+unsigned long Energy_uWh(unsigned char mode);
+unsigned long Energy_WakeuWh(void);
+unsigned long Energy_Wakes(void);
+unsigned long Energy_IrqCount(unsigned char src);
+
+#endif /* ENERGY_H_ */
@@ -0,0 +1,142 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Event log: PERSISTENT FRAM ring of timestamped power events.
+//  See event_log.h for the record format and the wear and write rules.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "event_log.h"
+#include "rtc.h"
+
+// Statically-initialized variable
+#ifdef __TI_COMPILER_VERSION__
+#pragma PERSISTENT(Log_Ring)
+Log_Record Log_Ring[LOG_SIZE] = {0};
+#elif __IAR_SYSTEMS_ICC__
+__persistent Log_Record Log_Ring[LOG_SIZE] = {0};
+#elif defined(__GNUC__)
+Log_Record Log_Ring[LOG_SIZE] __attribute__((persistent)) = {0};
+#else
+// Port the following variable to an equivalent persistent functionality for the specific compiler being used
+Log_Record Log_Ring[LOG_SIZE] = {0};
+#endif
+
+static unsigned int Log_Head;                   // Next slot to write
+static unsigned int Log_Seq;                    // seq of the newest record
+static unsigned int Log_Count;                  // Records in the ring
+
+void Log_Init(void)
+{
+    unsigned int newest = LOG_SIZE;
+    unsigned int i;
+    unsigned int k;
+
+    for(i = 0; i < LOG_SIZE; i++)
+    {
+        if(Log_Ring[i].type == 0)
+            continue;                           // Never written, or cut short
+        if(newest == LOG_SIZE || (int)(Log_Ring[i].seq - Log_Ring[newest].seq) > 0)
+            newest = i;
+    }
+
+    Log_Head = 0;
+    Log_Seq = 0xFFFF;                           // First record is seq 0
+    Log_Count = 0;
+    if(newest != LOG_SIZE)
+    {
+        Log_Seq = Log_Ring[newest].seq;
+        for(k = 1; k < LOG_SIZE; k++)           // The run of records before the newest
+        {
+            i = (newest - k) & (LOG_SIZE - 1);
+            if(Log_Ring[i].type == 0 || Log_Ring[i].seq != (unsigned int)(Log_Seq - k))
+                break;
+        }
+        Log_Head = (newest + 1) & (LOG_SIZE - 1);
+        Log_Count = k;
+    }
+
+    Log_Append(LOG_BOOT, (unsigned char)SYSRSTIV);
+}
+
+// Interrupts off for the slot and the writes, under ~50 MCLK cycles
+void Log_Append(unsigned char type, unsigned char arg)
+{
+    unsigned int sr = __get_SR_register();
+    Log_Record *r;
+    unsigned long time;
+    unsigned int seq;
+
+    __disable_interrupt();
+    time = Rtc_Now();
+    seq = Log_Seq + 1;
+    r = &Log_Ring[Log_Head];
+
+    r->type = 0;                                    // Invalid until the last write
+    r->seq = seq;
+    r->arg = arg;
+    r->time = time;
+    r->type = type;
+
+    Log_Seq = seq;
+    Log_Head = (Log_Head + 1) & (LOG_SIZE - 1);
+    if(Log_Count < LOG_SIZE)
+        Log_Count++;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// One LOG_INPUT record per supervisor edge. An input with both edges went
+// and came back; its current level gives the order.
+void Log_Inputs(unsigned int fell, unsigned int rose, unsigned int state)
+{
+    unsigned int bit;
+    unsigned char b;
+
+    for(b = 0, bit = 1; bit != 0; b++, bit <<= 1)
+    {
+        if(!((fell | rose) & bit))
+            continue;
+        if((fell & rose & bit) && (state & bit))
+            Log_Append(LOG_INPUT, b);
+        if(rose & bit)
+            Log_Append(LOG_INPUT, b | LOG_ROSE);
+        if((fell & bit) && !((rose & bit) && (state & bit)))
+            Log_Append(LOG_INPUT, b);
+    }
+}
+
+// Copy up to max records from *seq on, oldest first, and move *seq past
+// them. A seq that is not in the log starts at the oldest record; returns
+// 0 once *seq is the one after the newest.
+unsigned char Log_Read(unsigned int *seq, Log_Record *buf, unsigned char max)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned int back;
+    unsigned char n = 0;
+
+    __disable_interrupt();                          // An ISR may append meanwhile
+    back = Log_Seq - *seq;                          // Records after *seq up to the newest
+    if(Log_Count != 0 && back != 0xFFFF)
+    {
+        if(back >= Log_Count)
+        {
+            back = Log_Count - 1;                   // Overwritten or never written, start at the oldest
+            *seq = Log_Seq - back;
+        }
+        while(n < max)
+        {
+            buf[n++] = Log_Ring[(Log_Head - 1 - back) & (LOG_SIZE - 1)];
+            (*seq)++;
+            if(back-- == 0)
+                break;
+        }
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+    return n;
+}
+
+unsigned int Log_Newest(void)
+{
+    return Log_Seq;
+}
@@ -0,0 +1,80 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Event log: power events in a PERSISTENT FRAM ring, kept across resets
+//  and power cycles.
+//
+//  Record, LOG_RECORD_BYTES as sent to the host (little endian), the same
+//  as stored with the MSP430 compilers:
+//      u16 seq, u8 LOG_* type, u8 arg, u32 time (RTC seconds, rtc.h)
+//  seq counts up by one per record, wrapping at 16 bits. Type 0 marks a
+//  slot that was never written. LOG_SIZE records fit, the oldest is
+//  overwritten.
+//
+//  Wear: the ring is written strictly in order, so every slot takes one
+//  write per LOG_SIZE records, and there is no head index or counter in
+//  FRAM that every append would have to rewrite. Log_Init() finds the
+//  newest record by its seq and the run of records before it, so the head
+//  is rebuilt from the records themselves. A record cut short by a reset
+//  has type 0 (it is cleared first and set last) and simply ends the run.
+//
+//  Log_Append() takes the time and the slot with interrupts off and writes
+//  the fields, type last: ~3 us at MCLK 16 MHz. It may be called from an
+//  ISR. The ring is PERSISTENT, outside PFWP (lnk_msp430fr2355.cmd).
+//
+//  Events, logged by Power_Select(), the charge termination and the
+//  shutdown ISR:
+//      LOG_BOOT        arg = SYSRSTIV, the reset cause
+//      LOG_INPUT       arg = supervisor input bit (0..15, supervisor.h),
+//                      | LOG_ROSE on a rising edge: source changes (ACOKn),
+//                      fault assertions (nBatnFlt, n12VFlt)
+//      LOG_RAIL        arg = 1 12 V rail good again, 0 lost (power_trip.h)
+//      LOG_BATT        arg = channel << 4 | new BATT_* state: charge start
+//                      and stop, discharge, faults
+//      LOG_SHUTDOWN    arg = 0, nPWR_OFF_Int shutdown
+//      LOG_RTC_SET     arg = 0, time = the new RTC time, the records after
+//                      it are on the host's clock
+//      LOG_CHARGE_END  arg = channel << 4 | CHARGE_END_* reason, charge
+//                      terminated (charge.h)
+//      LOG_POST        arg = a bit per failed power-on self test stage,
+//                      | POST_OVER_BUDGET (post.h), only when not 0
+//      LOG_CAPTURE     arg = CAPTURE_SRC_* trigger, a transient capture
+//                      record was saved (capture.h)
+//
+//  The host reads the log with HOST_CMD_LOG_READ, HOST_LOG_RECORDS records
+//  per frame (host_link.h).
+//  __________________________________________________________________________________*/
+#ifndef EVENT_LOG_H_
+#define EVENT_LOG_H_
+
+#define LOG_SIZE            128             // Records, power of 2, 1 KB of FRAM
+#define LOG_RECORD_BYTES    8               // On the wire
+
+// Record types
+#define LOG_BOOT            0x01
+#define LOG_INPUT           0x02
+#define LOG_RAIL            0x03
+#define LOG_BATT            0x04
+#define LOG_SHUTDOWN        0x05
+#define LOG_RTC_SET         0x06
+#define LOG_CHARGE_END      0x07
+#define LOG_POST            0x08
+#define LOG_CAPTURE         0x09
+
+#define LOG_ROSE            0x80            // LOG_INPUT arg, rising edge
+
+typedef struct
+{
+    unsigned int seq;
+    unsigned char type;                     // 0 = empty slot
+    unsigned char arg;
+    unsigned long time;                     // RTC seconds
+} Log_Record;
+
+void Log_Init(void);
+void Log_Append(unsigned char type, unsigned char arg);
+void Log_Inputs(unsigned int fell, unsigned int rose, unsigned int state);
+unsigned char Log_Read(unsigned int *seq, Log_Record *buf, unsigned char max);
+unsigned int Log_Newest(void);
+
+#endif /* EVENT_LOG_H_ */
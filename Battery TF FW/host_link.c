@@ -0,0 +1,968 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Host link: eUSCI_A1 UART, framed TX ring, single slot RX, telemetry.
+//  See host_link.h for the frame format and the throughput figures.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "host_link.h"
+#include "supervisor.h"
+#include "power_trip.h"
+#include "power_seq.h"
+#include "battery_sm.h"
+#include "discharge.h"
+#include "ir_test.h"
+#include "iout_sampler.h"
+#include "decim.h"
+#include "capture.h"
+#include "coulomb.h"
+#include "therm.h"
+#include "adc.h"
+#include "adc_sched.h"
+#include "sbs.h"
+#include "shutdown.h"
+#include "event_log.h"
+#include "rtc.h"
+#include "energy.h"
+#include "post.h"
+
+#define HOST_TELEM_LEN      62
+#define HOST_OVERHEAD       5               // Sync, type, len, CRC
+#define HOST_SBS_LEN        (7 + 2 * SBS_REGS)
+#define HOST_SHUTDOWN_LEN   10
+#define HOST_LOG_LEN        (3 + HOST_LOG_RECORDS * LOG_RECORD_BYTES)
+#define HOST_ENERGY_LEN     (4 * (ENERGY_MODES + ENERGY_HOLDERS + 1 + ENERGY_MODES + 1))
+#define HOST_IRQS_LEN       (4 * (1 + ENERGY_IRQS))
+#define HOST_DISCHG_LEN     21
+#define HOST_IR_LEN         20
+#define HOST_POST_LEN       (5 + 5 * POST_STAGES)
+#define HOST_OVERSAMPLE_LEN 12
+#define HOST_CAPTURE_LEN    17
+#define HOST_CAPTURE_DATA_LEN (3 + 4 * HOST_CAPTURE_PAIRS)
+#define HOST_SCHED_LEN(n)   (7 + 13 * (n))
+#define HOST_TRIP_LEN(n)    (11 + 7 * (n))
+
+// RX frame assembly
+#define HOST_RX_SYNC        0
+#define HOST_RX_TYPE        1
+#define HOST_RX_LEN         2
+#define HOST_RX_PAYLOAD     3
+#define HOST_RX_CRC_LO      4
+#define HOST_RX_CRC_HI      5
+
+typedef struct
+{
+    unsigned char type;
+    unsigned char len;
+    unsigned char payload[HOST_MAX_PAYLOAD];
+    unsigned int crc;
+} Host_Frame;
+
+typedef struct
+{
+    unsigned char type;
+    unsigned char len;                      // Exact payload length
+    unsigned char (*run)(const unsigned char *arg);
+} Host_Command;
+
+typedef struct
+{
+    unsigned int brw;                       // UCA1BRW
+    unsigned int mctlw;                     // UCA1MCTLW
+} Host_Baud;
+
+// SMCLK = 16 MHz, oversampling, User's Guide Table 22-5
+static const Host_Baud Host_BaudTable[2] =
+{
+    { 8, 0xF700 | UCOS16 | UCBRF_10 },      // 115200: N = 138.89, UCBRSx = 0xF7
+    { 1, 0x0000 | UCOS16 | UCBRF_0 }        // 1 Mbaud: N = 16
+};
+
+static unsigned char Host_TxRing[HOST_TX_SIZE];
+static volatile unsigned int Host_TxHead;       // Free running, end of the last whole frame, main loop only
+static volatile unsigned int Host_TxTail;       // Free running, TX ISR only
+static unsigned int Host_TxPos;                 // Write position of the frame being built
+static unsigned char Host_TxLeft;               // Payload bytes still expected by Host_End()
+static unsigned char Host_TxOpen;
+static unsigned int Host_TxDrops;               // Frames that did not fit in the ring
+static unsigned long Host_TxQueued;             // Bytes queued since start
+static unsigned long Host_TxSent;               // Bytes sent at the last Host_Second()
+static unsigned long Host_TxRate;               // Bytes sent in the last second
+
+static Host_Frame Host_Rx;
+static volatile unsigned char Host_RxFull;      // Host_Rx holds a frame for the main loop
+static volatile unsigned char Host_RxSeen;      // Bytes received since the last Host_Second()
+static unsigned char Host_RxState;
+static unsigned char Host_RxCount;
+static unsigned int Host_RxDrops;               // Frames lost while the slot was full
+static unsigned int Host_RxErrors;              // CRC errors
+
+static volatile unsigned char Host_Stream;      // Keep the ring full of telemetry
+static unsigned char Host_BaudPending;          // HOST_BAUD_* + 1 once the TX ring is empty
+static unsigned int Host_TelemSeq;
+static volatile unsigned char Host_LogDump;     // Send log records until the newest
+static unsigned int Host_LogSeq;                // Next record to send
+static volatile unsigned char Host_CaptureDump; // Send capture entries until the last
+static unsigned int Host_CapturePos;            // Next entry to send
+
+static unsigned char Host_CmdPing(const unsigned char *arg);
+static unsigned char Host_CmdBatt(const unsigned char *arg);
+static unsigned char Host_CmdTelem(const unsigned char *arg);
+static unsigned char Host_CmdBaud(const unsigned char *arg);
+static unsigned char Host_CmdClear(const unsigned char *arg);
+static unsigned char Host_CmdStream(const unsigned char *arg);
+static unsigned char Host_CmdSbsPeriod(const unsigned char *arg);
+static unsigned char Host_CmdSbsRead(const unsigned char *arg);
+static unsigned char Host_CmdShutdown(const unsigned char *arg);
+static unsigned char Host_CmdSeq(const unsigned char *arg);
+static unsigned char Host_CmdLogRead(const unsigned char *arg);
+static unsigned char Host_CmdRtcSet(const unsigned char *arg);
+static unsigned char Host_CmdEnergy(const unsigned char *arg);
+static unsigned char Host_CmdDischg(const unsigned char *arg);
+static unsigned char Host_CmdDischgRead(const unsigned char *arg);
+static unsigned char Host_CmdIr(const unsigned char *arg);
+static unsigned char Host_CmdIrRead(const unsigned char *arg);
+static unsigned char Host_CmdPost(const unsigned char *arg);
+static unsigned char Host_CmdOversample(const unsigned char *arg);
+static unsigned char Host_CmdCapture(const unsigned char *arg);
+static unsigned char Host_CmdCaptureRead(const unsigned char *arg);
+static unsigned char Host_CmdSched(const unsigned char *arg);
+static unsigned char Host_CmdTripHyst(const unsigned char *arg);
+static unsigned char Host_CmdTripMeasure(const unsigned char *arg);
+static unsigned char Host_CmdTripRead(const unsigned char *arg);
+
+static const Host_Command Host_Commands[] =
+{
+    { HOST_CMD_PING,        0, Host_CmdPing      },
+    { HOST_CMD_BATT,        2, Host_CmdBatt      },
+    { HOST_CMD_TELEM,       2, Host_CmdTelem     },
+    { HOST_CMD_BAUD,        1, Host_CmdBaud      },
+    { HOST_CMD_CLEAR,       1, Host_CmdClear     },
+    { HOST_CMD_STREAM,      1, Host_CmdStream    },
+    { HOST_CMD_SBS_PERIOD,  4, Host_CmdSbsPeriod },
+    { HOST_CMD_SBS_READ,    1, Host_CmdSbsRead   },
+    { HOST_CMD_SHUTDOWN,    0, Host_CmdShutdown  },
+    { HOST_CMD_SEQ,         4, Host_CmdSeq       },
+    { HOST_CMD_LOG_READ,    2, Host_CmdLogRead   },
+    { HOST_CMD_RTC_SET,     4, Host_CmdRtcSet    },
+    { HOST_CMD_ENERGY,      1, Host_CmdEnergy    },
+    { HOST_CMD_DISCHG,      6, Host_CmdDischg    },
+    { HOST_CMD_DISCHG_READ, 1, Host_CmdDischgRead },
+    { HOST_CMD_IR,          3, Host_CmdIr        },
+    { HOST_CMD_IR_READ,     1, Host_CmdIrRead    },
+    { HOST_CMD_POST,        0, Host_CmdPost      },
+    { HOST_CMD_OVERSAMPLE,  1, Host_CmdOversample },
+    { HOST_CMD_CAPTURE,     4, Host_CmdCapture   },
+    { HOST_CMD_CAPTURE_READ, 0, Host_CmdCaptureRead },
+    { HOST_CMD_SCHED,       1, Host_CmdSched     },
+    { HOST_CMD_TRIP_HYST,   2, Host_CmdTripHyst  },
+    { HOST_CMD_TRIP_MEASURE, 1, Host_CmdTripMeasure },
+    { HOST_CMD_TRIP_READ,   2, Host_CmdTripRead  }
+};
+
+#define HOST_COMMANDS       (sizeof(Host_Commands) / sizeof(Host_Commands[0]))
+
+static unsigned int Host_Room(void)
+{
+    return HOST_TX_SIZE - (unsigned int)(Host_TxHead - Host_TxTail);
+}
+
+static void Host_Raw(unsigned char value)
+{
+    Host_TxRing[Host_TxPos++ & (HOST_TX_SIZE - 1)] = value;
+}
+
+static void Host_Byte(unsigned char value)
+{
+    CRCDIRB_L = value;                              // CRC as the byte goes in
+    Host_Raw(value);
+}
+
+// Take SMCLK for a frame in flight, interrupts off: no start bit wake-up
+// needed until the link is idle again
+static void Host_Hold(void)
+{
+    SMCLK_Requests |= CLKREQ_HOST;
+    UCA1IE &= ~UCSTTIE;
+}
+
+// Let SMCLK go once nothing is in flight or queued and no byte came in
+// since the last Host_Second(), LPM3 from then on; the next start bit
+// wakes the link
+static void Host_Idle(void)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    if(Host_TxHead == Host_TxTail && !Host_RxSeen && !Host_RxFull && !Host_TxOpen
+       && !Host_Stream && !Host_BaudPending && !Host_LogDump && !Host_CaptureDump)
+    {
+        SMCLK_Requests &= ~CLKREQ_HOST;
+        UCA1IE |= UCSTTIE;
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+static void Host_SetTelemetry(unsigned int ms)
+{
+    if(ms != 0 && ms < HOST_TELEM_MIN_MS)
+        ms = HOST_TELEM_MIN_MS;
+    else if(ms > SUPERVISOR_TIMER_MAX_MS)
+        ms = SUPERVISOR_TIMER_MAX_MS;
+    Supervisor_SetTimer(SUPERVISOR_TIMER_TELEM, ms, EVT_TELEMETRY);
+}
+
+void Host_Init(void)
+{
+    // Configure UART pins
+    P4SEL0 |= uartRxd + uartTxd;                    // set 2-UART pin as second function
+
+    Host_TxHead = 0;
+    Host_TxTail = 0;
+    Host_TxOpen = 0;
+    Host_RxFull = 0;
+    Host_RxSeen = 0;
+    Host_RxState = HOST_RX_SYNC;
+    Host_Stream = 0;
+    Host_BaudPending = 0;
+    Host_LogDump = 0;
+    Host_CaptureDump = 0;
+
+    Host_SetBaud(HOST_BAUD_115200);                 // Idle, no CLKREQ_HOST until a start bit
+    Host_SetTelemetry(HOST_TELEM_MS);
+}
+
+void Host_SetBaud(unsigned char baud)
+{
+    const Host_Baud *cfg = &Host_BaudTable[baud & 1];
+
+    UCA1CTLW0 = UCSWRST;                            // Put eUSCI in reset
+    UCA1CTLW0 |= UCSSEL__SMCLK;
+    UCA1BRW = cfg->brw;
+    UCA1MCTLW = cfg->mctlw;
+    UCA1CTLW0 &= ~UCSWRST;                          // Initialize eUSCI
+    UCA1IE |= UCRXIE;                               // Enable USCI_A1 RX interrupt
+    if(!(SMCLK_Requests & CLKREQ_HOST))
+        UCA1IE |= UCSTTIE;                          // Idle, wake on the next start bit
+    if(Host_TxHead != Host_TxTail)
+        UCA1IE |= UCTXIE;
+}
+
+// Start a frame, 0 when it does not fit (counted). The Put calls must add
+// exactly len payload bytes before Host_End().
+unsigned char Host_Begin(unsigned char type, unsigned char len)
+{
+    if(Host_TxOpen || len > HOST_MAX_PAYLOAD)
+        return 0;
+    if(Host_Room() < (unsigned int)len + HOST_OVERHEAD)
+    {
+        Host_TxDrops++;
+        return 0;
+    }
+    Host_TxPos = Host_TxHead;
+    Host_TxLeft = len;
+    Host_TxOpen = 1;
+
+    Host_Raw(HOST_SYNC);
+    CRCINIRES = 0xFFFF;                             // Init CRC with 0xFFFF
+    Host_Byte(type);
+    Host_Byte(len);
+    return 1;
+}
+
+void Host_Put8(unsigned char value)
+{
+    if(!Host_TxOpen || Host_TxLeft == 0)
+        return;
+    Host_TxLeft--;
+    Host_Byte(value);
+}
+
+void Host_Put16(unsigned int value)
+{
+    Host_Put8((unsigned char)value);
+    Host_Put8((unsigned char)(value >> 8));
+}
+
+void Host_Put32(unsigned long value)
+{
+    Host_Put16((unsigned int)value);
+    Host_Put16((unsigned int)(value >> 16));
+}
+
+// Close the frame and hand it to the TX ISR
+void Host_End(void)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned int crc;
+
+    if(!Host_TxOpen)
+        return;
+    while(Host_TxLeft)
+        Host_Put8(0);
+    crc = CRCINIRES;
+    Host_Raw((unsigned char)crc);
+    Host_Raw((unsigned char)(crc >> 8));
+
+    Host_TxQueued += (unsigned int)(Host_TxPos - Host_TxHead);
+    Host_TxHead = Host_TxPos;                       // Publish the whole frame at once
+    Host_TxOpen = 0;
+    __disable_interrupt();
+    Host_Hold();                                    // Until the ring is empty
+    UCA1IE |= UCTXIE;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+static void Host_Ack(unsigned char type, unsigned char status)
+{
+    if(Host_Begin(HOST_RSP_ACK, 2))
+    {
+        Host_Put8(type);
+        Host_Put8(status);
+        Host_End();
+    }
+}
+
+// Check and run the frame the RX ISR assembled
+void Host_Process(void)
+{
+    const Host_Command *cmd = 0;
+    unsigned char status;
+    unsigned char i;
+
+    if(!Host_RxFull)
+        return;
+
+    CRCINIRES = 0xFFFF;
+    CRCDIRB_L = Host_Rx.type;
+    CRCDIRB_L = Host_Rx.len;
+    for(i = 0; i < Host_Rx.len; i++)
+        CRCDIRB_L = Host_Rx.payload[i];
+
+    if(CRCINIRES != Host_Rx.crc)
+    {
+        Host_RxErrors++;                            // No ACK, the host retries
+    }
+    else
+    {
+        for(i = 0; i < HOST_COMMANDS; i++)
+        {
+            if(Host_Commands[i].type == Host_Rx.type)
+                cmd = &Host_Commands[i];
+        }
+        if(cmd == 0)
+            status = HOST_ERR_CMD;
+        else if(cmd->len != Host_Rx.len)
+            status = HOST_ERR_LEN;
+        else
+            status = cmd->run(Host_Rx.payload);
+        Host_Ack(Host_Rx.type, status);
+    }
+    Host_RxFull = 0;                                // Slot back to the ISR
+    Host_TxReady();                                 // Start a stream or a baud change
+}
+
+// One HOST_LOG frame from Host_LogSeq on; the dump ends with a frame of
+// no records
+static void Host_LogFrame(void)
+{
+    Log_Record rec[HOST_LOG_RECORDS];
+    unsigned int seq = Host_LogSeq;
+    unsigned char n;
+    unsigned char i;
+
+    n = Log_Read(&seq, rec, HOST_LOG_RECORDS);
+    if(!Host_Begin(HOST_LOG, 3 + n * LOG_RECORD_BYTES))
+        return;
+    Host_Put16(Log_Newest());
+    Host_Put8(n);
+    for(i = 0; i < n; i++)                          // Field by field, not the struct layout
+    {
+        Host_Put16(rec[i].seq);
+        Host_Put8(rec[i].type);
+        Host_Put8(rec[i].arg);
+        Host_Put32(rec[i].time);
+    }
+    Host_End();
+    Host_LogSeq = seq;
+    if(n == 0)
+        Host_LogDump = 0;
+}
+
+// One HOST_CAPTURE_DATA frame from Host_CapturePos on; the upload ends
+// with a frame of no entries
+static void Host_CaptureFrame(void)
+{
+    const Capture_Record *rec = Capture_Get();
+    unsigned int total = rec->pre + rec->post;
+    unsigned long pair;
+    unsigned char n = 0;
+    unsigned char i;
+
+    if(rec->source != CAPTURE_SRC_NONE && Host_CapturePos < total)
+    {
+        n = HOST_CAPTURE_PAIRS;
+        if(total - Host_CapturePos < n)
+            n = total - Host_CapturePos;
+    }
+    if(!Host_Begin(HOST_CAPTURE_DATA, 3 + 4 * n))
+        return;
+    Host_Put16(Host_CapturePos);
+    Host_Put8(n);
+    for(i = 0; i < n; i++)
+    {
+        pair = rec->pairs[Host_CapturePos + i];
+        Host_Put16((unsigned int)pair);             // IOUT1
+        Host_Put16((unsigned int)(pair >> 16));     // IOUT2
+    }
+    Host_End();
+    Host_CapturePos += n;
+    if(n == 0)
+        Host_CaptureDump = 0;
+}
+
+// EVT_HOST_TX: the TX ring is half empty or empty, or the RX side went
+// back to sync without a frame
+void Host_TxReady(void)
+{
+    if(Host_BaudPending && Host_TxHead == Host_TxTail)
+    {
+        while(UCA1STATW & UCBUSY);                  // Last stop bit, 87 us at most
+        Host_SetBaud(Host_BaudPending - 1);
+        Host_BaudPending = 0;
+    }
+    while(Host_LogDump && Host_Room() >= HOST_LOG_LEN + HOST_OVERHEAD)
+        Host_LogFrame();
+    while(Host_CaptureDump && Host_Room() >= HOST_CAPTURE_DATA_LEN + HOST_OVERHEAD)
+        Host_CaptureFrame();
+    while(Host_Stream && Host_Room() >= HOST_TELEM_LEN + HOST_OVERHEAD)
+        Host_Telemetry();
+    Host_Idle();
+}
+
+// One frame with every channel reading
+void Host_Telemetry(void)
+{
+    unsigned char ch;
+
+    if(!Host_Begin(HOST_TELEM, HOST_TELEM_LEN))
+        return;
+    Host_Put16(Host_TelemSeq++);
+    Host_Put8(Supervisor_Inputs());
+    Host_Put8(Trip_RailGood());
+    Host_Put16(Trip_Count());
+    Host_Put16(Iout_Dropped());
+    Host_Put16(Host_TxDrops);
+    Host_Put16(Host_RxDrops);
+    Host_Put16(Host_RxErrors);
+    Host_Put32(Host_TxRate);
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        Host_Put8(Batt_State(ch));
+        Host_Put8(Therm_Hot(ch));
+        Host_Put16(Iout_Mean(ch));
+        Host_Put16((unsigned int)Therm_Temp(ch));
+        Host_Put32(Coulomb_uAh(ch, COULOMB_IN));
+        Host_Put32(Coulomb_uAh(ch, COULOMB_OUT));
+        Host_Put32(Coulomb_uWh(ch, COULOMB_IN));
+        Host_Put32(Coulomb_uWh(ch, COULOMB_OUT));
+    }
+    Host_End();
+}
+
+// Measure the TX rate over the last second
+void Host_Second(void)
+{
+    unsigned long sent = Host_TxQueued - (unsigned int)(Host_TxHead - Host_TxTail);
+
+    Host_TxRate = sent - Host_TxSent;
+    Host_TxSent = sent;
+    __disable_interrupt();
+    Host_Idle();                                    // A second without a byte in
+    Host_RxSeen = 0;
+    __enable_interrupt();
+}
+
+static unsigned char Host_CmdPing(const unsigned char *arg)
+{
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdBatt(const unsigned char *arg)
+{
+    if(arg[0] >= BATT_CHANNELS)
+        return HOST_ERR_ARG;
+    if(arg[1] != BEV_CHARGE && arg[1] != BEV_DISCHARGE && arg[1] != BEV_STOP && arg[1] != BEV_DONE)
+        return HOST_ERR_ARG;
+    Batt_Request(arg[0], arg[1]);
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdTelem(const unsigned char *arg)
+{
+    Host_SetTelemetry(arg[0] | ((unsigned int)arg[1] << 8));
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdBaud(const unsigned char *arg)
+{
+    if(arg[0] > HOST_BAUD_1M)
+        return HOST_ERR_ARG;
+    Host_BaudPending = arg[0] + 1;                  // After the ACK has gone out
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdClear(const unsigned char *arg)
+{
+    if(arg[0] >= BATT_CHANNELS)
+        return HOST_ERR_ARG;
+    Coulomb_Clear(arg[0]);
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdStream(const unsigned char *arg)
+{
+    Host_Stream = arg[0] ? 1 : 0;
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdSbsPeriod(const unsigned char *arg)
+{
+    unsigned int ms = arg[2] | ((unsigned int)arg[3] << 8);
+
+    if(arg[0] >= SBS_BUSES || arg[1] >= SBS_REGS)
+        return HOST_ERR_ARG;
+    if(ms != 0 && ms < SBS_TICK_MS)
+        ms = SBS_TICK_MS;
+    Sbs_SetPeriod(arg[0], arg[1], ms / SBS_TICK_MS);
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdSbsRead(const unsigned char *arg)
+{
+    unsigned char reg;
+
+    if(arg[0] >= SBS_BUSES)
+        return HOST_ERR_ARG;
+    if(Host_Begin(HOST_SBS, HOST_SBS_LEN))
+    {
+        Host_Put8(arg[0]);
+        Host_Put16(Sbs_Valid(arg[0]));
+        Host_Put16(Sbs_Errors(arg[0]));
+        Host_Put16(Sbs_Skipped(arg[0]));
+        for(reg = 0; reg < SBS_REGS; reg++)
+            Host_Put16(Sbs_Value(arg[0], reg));
+        Host_End();
+    }
+    return HOST_OK;
+}
+
+// Outputs come back with the Power_Select() after Host_Process()
+static unsigned char Host_CmdShutdown(const unsigned char *arg)
+{
+    unsigned char ok = Shutdown_Test();
+    const Shutdown_Record *rec = Shutdown_Stats();
+
+    if(Host_Begin(HOST_SHUTDOWN, HOST_SHUTDOWN_LEN))
+    {
+        Host_Put16(rec->lastUs);
+        Host_Put16(rec->worstUs);
+        Host_Put16(SHUTDOWN_BUDGET_US);
+        Host_Put16(rec->count);
+        Host_Put16(rec->overruns);
+        Host_End();
+    }
+    return ok ? HOST_OK : HOST_ERR_TIME;
+}
+
+static unsigned char Host_CmdSeq(const unsigned char *arg)
+{
+    unsigned int dead = arg[0] | ((unsigned int)arg[1] << 8);
+    unsigned int overlap = arg[2] | ((unsigned int)arg[3] << 8);
+
+    if(dead > SEQ_MAX_US || overlap > SEQ_MAX_US)
+        return HOST_ERR_ARG;
+    Seq_SetTiming(dead, overlap);
+    return HOST_OK;
+}
+
+// The records go out after the ACK, as fast as the TX ring drains
+static unsigned char Host_CmdLogRead(const unsigned char *arg)
+{
+    Host_LogSeq = arg[0] | ((unsigned int)arg[1] << 8);
+    Host_LogDump = 1;
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdRtcSet(const unsigned char *arg)
+{
+    Rtc_Set(arg[0] | ((unsigned long)arg[1] << 8) | ((unsigned long)arg[2] << 16) | ((unsigned long)arg[3] << 24));
+    Log_Append(LOG_RTC_SET, 0);
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdEnergy(const unsigned char *arg)
+{
+    unsigned char i;
+
+    if(Host_Begin(HOST_ENERGY, HOST_ENERGY_LEN))
+    {
+        for(i = 0; i < ENERGY_MODES; i++)
+            Host_Put32(Energy_Ms(i));
+        for(i = 0; i < ENERGY_HOLDERS; i++)
+            Host_Put32(Energy_HeldMs(i));
+        Host_Put32(Energy_Wakes());
+        for(i = 0; i < ENERGY_MODES; i++)
+            Host_Put32(Energy_uWh(i));
+        Host_Put32(Energy_WakeuWh());
+        Host_End();
+    }
+    if(Host_Begin(HOST_IRQS, HOST_IRQS_LEN))
+    {
+        Host_Put32(Energy_IrqCount(ENERGY_IRQ_LPM3));
+        for(i = 0; i < ENERGY_IRQS; i++)
+            Host_Put32(Energy_IrqCount(i));
+        Host_End();
+    }
+    if(arg[0])
+        Energy_Clear();
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdDischg(const unsigned char *arg)
+{
+    if(!Dischg_Set(arg[0], arg[1], arg[2] | ((unsigned int)arg[3] << 8), arg[4], arg[5]))
+        return HOST_ERR_ARG;
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdDischgRead(const unsigned char *arg)
+{
+    unsigned int settle;
+
+    if(arg[0] >= BATT_CHANNELS)
+        return HOST_ERR_ARG;
+    settle = Dischg_SettleLoops(arg[0]);
+    if(Host_Begin(HOST_DISCHG, HOST_DISCHG_LEN))
+    {
+        Host_Put8(arg[0]);
+        Host_Put8(Dischg_Mode(arg[0]));
+        Host_Put8(Dischg_Engaged(arg[0]));
+        Host_Put16(Dischg_Setpoint(arg[0]));
+        Host_Put16(Dischg_Target(arg[0]));
+        Host_Put16(Dischg_Measured(arg[0]));
+        Host_Put16(Dischg_Duty(arg[0]));
+        Host_Put16(Dischg_LoopHz());
+        Host_Put16(Dischg_PeriodUs());
+        Host_Put16(settle);
+        Host_Put32(settle == DISCHG_UNSETTLED ? 0xFFFFFFFFUL : (unsigned long)settle * Dischg_PeriodUs());
+        Host_End();
+    }
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdIr(const unsigned char *arg)
+{
+    unsigned int pulseMs = arg[1] | ((unsigned int)arg[2] << 8);
+
+    if(pulseMs == 0)
+        pulseMs = IR_PULSE_MS;
+    if(arg[0] >= BATT_CHANNELS || pulseMs < IR_MIN_PULSE_MS || pulseMs > IR_MAX_PULSE_MS)
+        return HOST_ERR_ARG;
+    if(!Ir_Start(arg[0], pulseMs))
+        return HOST_ERR_STATE;
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdIrRead(const unsigned char *arg)
+{
+    const Ir_Result *r;
+
+    if(arg[0] >= BATT_CHANNELS)
+        return HOST_ERR_ARG;
+    r = Ir_Get(arg[0]);
+    if(Host_Begin(HOST_IR, HOST_IR_LEN))
+    {
+        Host_Put8(arg[0]);
+        Host_Put8(r->status);
+        Host_Put16(r->pulseMs);
+        Host_Put16(r->before);
+        Host_Put16(r->after);
+        Host_Put16(r->stepMa);
+        Host_Put16(r->restMv);
+        Host_Put16(r->loadMv);
+        Host_Put16(r->milliohm);
+        Host_Put16(r->beforeUs);
+        Host_Put16(r->afterUs);
+        Host_End();
+    }
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdPost(const unsigned char *arg)
+{
+    const Post_Stage *stage;
+    unsigned char i;
+
+    if(Host_Begin(HOST_POST, HOST_POST_LEN))
+    {
+        Host_Put8(Post_Result());
+        Host_Put16(Post_TotalUs());
+        Host_Put16(POST_BUDGET_US);
+        for(i = 0; i < POST_STAGES; i++)
+        {
+            stage = Post_Get(i);
+            Host_Put8(stage->status);
+            Host_Put16(stage->us);
+            Host_Put16(stage->value);
+        }
+        Host_End();
+    }
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdOversample(const unsigned char *arg)
+{
+    unsigned char shift = arg[0];
+    unsigned int outputs;
+    unsigned char ch;
+
+    if(shift != 0 && (shift < DECIM_MIN_SHIFT || shift > DECIM_MAX_SHIFT))
+        return HOST_ERR_ARG;
+    if(shift != 0)
+        Iout_SetOversample(shift);
+    shift = Iout_OversampleShift();
+    if(Host_Begin(HOST_OVERSAMPLE, HOST_OVERSAMPLE_LEN))
+    {
+        Host_Put8(shift);
+        Host_Put8(DECIM_BITS(shift));
+        Host_Put16(Iout_Rate() >> shift);
+        for(ch = 0; ch < BATT_CHANNELS; ch++)
+        {
+            Host_Put16(Iout_Oversampled(ch, &outputs));
+            Host_Put16(outputs);
+        }
+        Host_End();
+    }
+    return HOST_OK;
+}
+
+static void Host_Capture(void)
+{
+    const Capture_Record *rec = Capture_Get();
+    unsigned int pre;
+    unsigned int post;
+
+    Capture_Window(&pre, &post);
+    if(Host_Begin(HOST_CAPTURE, HOST_CAPTURE_LEN))
+    {
+        Host_Put8(Capture_State());
+        Host_Put16(pre);
+        Host_Put16(post);
+        Host_Put8(rec->source);
+        Host_Put8(rec->flags);
+        Host_Put16(rec->pre);
+        Host_Put16(rec->post);
+        Host_Put16(rec->rate);
+        Host_Put32(rec->time);
+        Host_End();
+    }
+}
+
+static unsigned char Host_CmdCapture(const unsigned char *arg)
+{
+    unsigned int pre = arg[0] | ((unsigned int)arg[1] << 8);
+    unsigned int post = arg[2] | ((unsigned int)arg[3] << 8);
+
+    if(!Capture_Arm(pre, post))
+        return HOST_ERR_ARG;
+    Host_CaptureDump = 0;                           // The record it was sending is gone
+    Host_Capture();
+    return HOST_OK;
+}
+
+// The entries go out after the ACK, as fast as the TX ring drains
+static unsigned char Host_CmdCaptureRead(const unsigned char *arg)
+{
+    Host_Capture();
+    if(Capture_Get()->source == CAPTURE_SRC_NONE)
+        return HOST_ERR_STATE;
+    Host_CapturePos = 0;
+    Host_CaptureDump = 1;
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdSched(const unsigned char *arg)
+{
+    const Sched_Channel *ch;
+    unsigned char n = Sched_Count();
+    unsigned char i;
+
+    if(Host_Begin(HOST_SCHED, HOST_SCHED_LEN(n)))
+    {
+        Host_Put8(n);
+        Host_Put16(SCHED_LATE_MAX_US);
+        Host_Put16(Sched_DvccMv());
+        Host_Put16((unsigned int)Sched_DieC10());
+        for(i = 0; i < n; i++)
+        {
+            ch = Sched_Get(i);
+            Host_Put8(ch->req.mctl0 & ADCINCH);
+            Host_Put16((unsigned int)((unsigned long)ch->period * 1000 / SUPERVISOR_TICK_HZ));
+            Host_Put16(ch->conversions);
+            Host_Put16(ch->misses);
+            Host_Put16(ch->late);
+            Host_Put16(ch->conversions ? Sched_Us(ch->minLat) : 0);
+            Host_Put16(Sched_Us(ch->maxLat));
+        }
+        Host_End();
+    }
+    if(arg[0])
+        Sched_Clear();
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdTripHyst(const unsigned char *arg)
+{
+    unsigned int ms = arg[0] | ((unsigned int)arg[1] << 8);
+
+    if(ms == 0)
+        return HOST_ERR_ARG;
+    Trip_SetHysteresis(ms);
+    return HOST_OK;
+}
+
+static unsigned char Host_CmdTripMeasure(const unsigned char *arg)
+{
+    if(arg[0] > 1)
+        return HOST_ERR_ARG;
+    Trip_SetMeasure(arg[0]);
+    return HOST_OK;
+}
+
+// Records first.. of the ones still in the log, up to HOST_TRIP_RECORDS
+static unsigned char Host_CmdTripRead(const unsigned char *arg)
+{
+    unsigned int first = arg[0] | ((unsigned int)arg[1] << 8);
+    unsigned int logged = Trip_LogCount();
+    unsigned int n;
+    Trip_Record rec;
+
+    if(logged > TRIP_LOG_SIZE && (unsigned int)(logged - first) > TRIP_LOG_SIZE)
+        first = logged - TRIP_LOG_SIZE;             // Older ones are overwritten
+    n = first < logged ? logged - first : 0;
+    if(n > HOST_TRIP_RECORDS)
+        n = HOST_TRIP_RECORDS;
+    if(!Host_Begin(HOST_TRIP, HOST_TRIP_LEN(n)))
+        return HOST_OK;
+    Host_Put8(Trip_Measuring());
+    Host_Put8(Trip_RailGood());
+    Host_Put16(Trip_Hysteresis());
+    Host_Put16(Trip_Count());
+    Host_Put16(logged);
+    Host_Put16(first);
+    Host_Put8(n);
+    for(; n; n--, first++)
+    {
+        __disable_interrupt();                      // The Timer3_B1 ISR writes them
+        rec = *Trip_GetRecord(first);
+        __enable_interrupt();
+        Host_Put16(rec.edge);
+        Host_Put16(rec.entry);
+        Host_Put16(rec.switched);
+        Host_Put8(rec.level);
+    }
+    Host_End();
+    return HOST_OK;
+}
+
+// USCI_A1 interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=USCI_A1_VECTOR
+__interrupt void USCI_A1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(USCI_A1_VECTOR))) USCI_A1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    unsigned int tail;
+    unsigned int level;
+    unsigned char value;
+
+    ENERGY_IRQ(ENERGY_IRQ_HOST);
+    switch(__even_in_range(UCA1IV,USCI_UART_UCTXCPTIFG))
+    {
+        case USCI_NONE: break;
+        case USCI_UART_UCRXIFG:
+            value = UCA1RXBUF;                          // Clears UCRXIFG
+            Host_RxSeen = 1;
+            switch(Host_RxState)
+            {
+                case HOST_RX_SYNC:
+                    if(value != HOST_SYNC)
+                        break;                          // HOST_WAKE preamble, or noise
+                    if(Host_RxFull)
+                        Host_RxDrops++;                 // Main loop still has the last one
+                    else
+                        Host_RxState = HOST_RX_TYPE;
+                    break;
+                case HOST_RX_TYPE:
+                    Host_Rx.type = value;
+                    Host_RxState = HOST_RX_LEN;
+                    break;
+                case HOST_RX_LEN:
+                    Host_Rx.len = value;
+                    Host_RxCount = 0;
+                    if(value > HOST_MAX_PAYLOAD)
+                        Host_RxState = HOST_RX_SYNC;    // Not a frame, resync
+                    else
+                        Host_RxState = value ? HOST_RX_PAYLOAD : HOST_RX_CRC_LO;
+                    break;
+                case HOST_RX_PAYLOAD:
+                    Host_Rx.payload[Host_RxCount++] = value;
+                    if(Host_RxCount == Host_Rx.len)
+                        Host_RxState = HOST_RX_CRC_LO;
+                    break;
+                case HOST_RX_CRC_LO:
+                    Host_Rx.crc = value;
+                    Host_RxState = HOST_RX_CRC_HI;
+                    break;
+                default:
+                    Host_Rx.crc |= (unsigned int)value << 8;
+                    Host_RxState = HOST_RX_SYNC;
+                    Host_RxFull = 1;
+                    Pending_Events |= EVT_HOST_RX;
+                    __bic_SR_register_on_exit(LPM3_bits);   // Wake main loop
+                    break;
+            }
+            break;
+        case USCI_UART_UCTXIFG:
+            tail = Host_TxTail;
+            level = (unsigned int)(Host_TxHead - tail);
+            if(level == 0)
+            {
+                UCA1IE &= ~UCTXIE;                      // Ring empty
+                UCA1IFG |= UCTXIFG;                     // Cleared by the UCA1IV read, re-armed for Host_End
+                Pending_Events |= EVT_HOST_TX;          // Refill, or let the clock go
+                __bic_SR_register_on_exit(LPM3_bits);
+                break;
+            }
+            UCA1TXBUF = Host_TxRing[tail & (HOST_TX_SIZE - 1)];
+            Host_TxTail = tail + 1;
+            if((Host_Stream || Host_LogDump || Host_CaptureDump) && level == HOST_TX_SIZE / 2 + 1)
+            {
+                Pending_Events |= EVT_HOST_TX;          // Half empty, refill
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            break;
+        case USCI_UART_UCSTTIFG:                        // Start bit on an idle link
+            Host_Hold();                                // LPM0 for the rest of the session
+            __bic_SR_register_on_exit(LPM3_bits);
+            break;
+        case USCI_UART_UCTXCPTIFG: break;
+        default: break;
+    }
+}
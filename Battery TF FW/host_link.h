@@ -0,0 +1,194 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Host link: framed binary protocol to the Raspberry Pi on eUSCI_A1
+//  (P4.3 UCA1TXD -> Pi RXD0, P4.2 UCA1RXD <- Pi TXD0), 8N1, SMCLK.
+//
+//  Frame:  [HOST_WAKE x HOST_WAKE_LEN], HOST_SYNC, type, len, payload[len],
+//          crc_lo, crc_hi
+//  The host starts every frame with the wake preamble, the fixture's
+//  frames have none. The RX ISR discards it like any byte outside a frame.
+//  The CRC16 (CRC-CCITT, seed 0xFFFF) comes from the CRC module, over
+//  type, len and payload; on the Pi that is binascii.crc_hqx(data, 0xFFFF).
+//  Multi-byte fields are little endian.
+//
+//  TX: frames are written straight into a HOST_TX_SIZE byte ring by the main
+//  loop (Host_Begin / Host_Put* / Host_End), CRC fed as each byte goes in,
+//  and drained by the UCTXIFG interrupt. A frame that does not fit is
+//  dropped and counted, the main loop never waits for the UART.
+//  RX: the ISR assembles one frame into a single slot and posts EVT_HOST_RX;
+//  the main loop checks the CRC and runs the command from Host_Commands.
+//  Bytes that arrive while the slot is full are dropped; the host retries
+//  on a missing HOST_RSP_ACK.
+//
+//  Telemetry: every HOST_TELEM_MS (supervisor TB0CCR1) one HOST_TELEM frame
+//  carries every channel reading:
+//      u16 seq, u8 status inputs, u8 rail good, u16 trips, u16 IOUT drops,
+//      u16 TX frames dropped, u16 RX frames dropped, u16 RX CRC errors,
+//      u32 TX bytes in the last second, then per battery:
+//      u8 state, u8 hot, u16 IOUT mean (codes), i16 temp (0.1 degC),
+//      u32 uAh in, u32 uAh out, u32 uWh in, u32 uWh out
+//  62 bytes of payload, 67 on the wire.
+//
+//  Throughput: the TX rate is measured by the firmware and reported in every
+//  telemetry frame. HOST_CMD_STREAM keeps the ring topped up with telemetry
+//  (refilled from EVT_HOST_TX at half empty), which is the sustained
+//  throughput test. Line limits, 10 bits per byte, and the rate the stream
+//  reached in the simulator (Simulator/scripts/host_link.sim):
+//      115200 baud   11520 B/s   171 frames/s
+//      1 Mbaud      100000 B/s  1492 frames/s   measured 99791 B/s, 1489/s
+//  The TX ISR costs ~30 MCLK cycles per byte, so streaming at 1 Mbaud takes
+//  about 19% of the CPU, plus ~900 cycles to build each frame.
+//
+//  Event log: HOST_CMD_LOG_READ dumps the log from the given seq on (a seq
+//  that is not in the log gets all of it) as HOST_LOG frames, refilled
+//  from EVT_HOST_TX like the telemetry stream, up to a frame with n = 0.
+//  The whole log (LOG_SIZE records) is ~1.2 KB on the wire, ~12 ms at
+//  1 Mbaud; the host then asks from the newest seq + 1 for what is new.
+//
+//  Energy: HOST_CMD_ENERGY answers with the residency and energy estimate
+//  (HOST_ENERGY) and the interrupt counts (HOST_IRQS) of energy.h, counted
+//  from boot or the last clear.
+//
+//  Discharge: HOST_CMD_DISCHG sets a channel's discharge mode, setpoint and
+//  PI gains (discharge.h); it applies to the next discharge, or to the
+//  running one straight away. HOST_CMD_DISCHG_READ answers with HOST_DISCHG,
+//  the loop state and the measured loop rate and settling time.
+//
+//  Internal resistance: HOST_CMD_IR starts the pulse test of an idle
+//  battery (ir_test.h), HOST_ERR_STATE when it can not run now. It takes a
+//  few seconds; HOST_CMD_IR_READ answers with HOST_IR, the status and, once
+//  IR_DONE, the result.
+//
+//  Self test: HOST_CMD_POST answers with HOST_POST, the power-on self test
+//  result of this boot (post.h), each stage's status, run time and value.
+//
+//  Oversampling: HOST_CMD_OVERSAMPLE sets the IOUT decimation ratio
+//  (decim.h, iout_sampler.h) and answers with HOST_OVERSAMPLE, the last
+//  oversampled IOUT1 and IOUT2 values.
+//
+//  Transient capture: HOST_CMD_CAPTURE sets the pre- and post-trigger
+//  window and arms the capture (capture.h), dropping a held record;
+//  HOST_CMD_CAPTURE_READ uploads the record: HOST_CAPTURE before the ACK,
+//  then HOST_CAPTURE_DATA frames refilled from EVT_HOST_TX, up to a frame
+//  with n = 0. A full window is 13 frames, ~0.9 KB on the wire.
+//
+//  ADC scheduler: HOST_CMD_SCHED answers with HOST_SCHED, the last DVCC and
+//  die temperature and, per scheduled channel, its period, counts and the
+//  min and max latency from its release tick to its result, the sample
+//  time jitter (adc_sched.h).
+//
+//  Clock: the UART runs from SMCLK, which is off in LPM3. An idle link
+//  holds no request; the eUSCI's automatic clock activation turns SMCLK on
+//  for a character that starts in LPM3, and its start bit (UCSTTIFG) takes
+//  a CLKREQ_HOST request and wakes the main loop into LPM0. The DCO restart
+//  takes about the LPM3 wake-up (supervisor.h), ~10 us: longer than half a
+//  bit at either baud rate, so that first character comes in corrupt. It
+//  is a HOST_WAKE byte of the preamble: all ones after the start bit, read
+//  late it is still no HOST_SYNC, and is dropped. HOST_WAKE_LEN bytes are
+//  40 us at 1 Mbaud, four times the restart, so the sync byte is always
+//  sampled on a running clock. Each queued frame (Host_End) takes the
+//  request too. It is dropped, and the start bit wake-up enabled again,
+//  when the TX ring is empty with no stream, dump or baud change pending
+//  and no byte came in since the last Host_Second(): one to two seconds
+//  after the host's last byte. Telemetry every HOST_TELEM_MS holds it for
+//  the frame's ~6 ms on the wire.
+//  __________________________________________________________________________________*/
+#ifndef HOST_LINK_H_
+#define HOST_LINK_H_
+
+#define HOST_SYNC           0xA5
+#define HOST_WAKE           0xFF            // Preamble byte, host to fixture
+#define HOST_WAKE_LEN       4               // Preamble bytes before each host frame
+#define HOST_MAX_PAYLOAD    64
+#define HOST_TX_SIZE        256             // Bytes, power of 2
+#define HOST_TELEM_MS       1000            // Default telemetry period
+#define HOST_TELEM_MIN_MS   10
+#define HOST_LOG_RECORDS    7               // Event log records per HOST_LOG frame
+#define HOST_CAPTURE_PAIRS  15              // Capture entries per HOST_CAPTURE_DATA frame
+#define HOST_TRIP_RECORDS   7               // Trip log records per HOST_TRIP frame
+
+#define HOST_BAUD_115200    0
+#define HOST_BAUD_1M        1
+
+// Frame types, host to fixture
+#define HOST_CMD_PING       0x01            // No payload
+#define HOST_CMD_BATT       0x02            // u8 channel, u8 BEV_CHARGE/BEV_DISCHARGE/BEV_STOP/BEV_DONE
+#define HOST_CMD_TELEM      0x03            // u16 period in ms, 0 = off, clamped to
+                                            // HOST_TELEM_MIN_MS..SUPERVISOR_TIMER_MAX_MS
+#define HOST_CMD_BAUD       0x04            // u8 HOST_BAUD_*, switched after the ACK is sent
+#define HOST_CMD_CLEAR      0x05            // u8 channel, clears its coulomb counts
+#define HOST_CMD_STREAM     0x06            // u8 1 = stream telemetry back to back, 0 = stop
+#define HOST_CMD_SBS_PERIOD 0x07            // u8 bus, u8 SBS_* register, u16 period in ms, 0 = not polled
+#define HOST_CMD_SBS_READ   0x08            // u8 bus, answered with HOST_SBS before the ACK
+#define HOST_CMD_SHUTDOWN   0x09            // No payload, timed shutdown dry run, HOST_SHUTDOWN before the ACK
+#define HOST_CMD_SEQ        0x0A            // u16 dead time in us, u16 overlap in us (power_seq.h)
+#define HOST_CMD_LOG_READ   0x0B            // u16 first seq, HOST_LOG frames after the ACK (event_log.h)
+#define HOST_CMD_RTC_SET    0x0C            // u32 seconds, RTC time for the event log (rtc.h)
+#define HOST_CMD_ENERGY     0x0D            // u8 1 = clear after reading, HOST_ENERGY and HOST_IRQS before the ACK
+#define HOST_CMD_DISCHG     0x0E            // u8 channel, u8 DISCHG_MODE_*, u16 mA (CC) or mW (CP), u8 kp, u8 ki (Q8)
+#define HOST_CMD_DISCHG_READ 0x0F           // u8 channel, answered with HOST_DISCHG before the ACK
+#define HOST_CMD_IR         0x10            // u8 channel, u16 pulse in ms, 0 = IR_PULSE_MS (ir_test.h)
+#define HOST_CMD_IR_READ    0x11            // u8 channel, answered with HOST_IR before the ACK
+#define HOST_CMD_POST       0x12            // No payload, answered with HOST_POST before the ACK
+#define HOST_CMD_OVERSAMPLE 0x13            // u8 log2 ratio DECIM_MIN_SHIFT..DECIM_MAX_SHIFT, 0 = unchanged,
+                                            // answered with HOST_OVERSAMPLE before the ACK
+#define HOST_CMD_CAPTURE    0x14            // u16 pre, u16 post pairs, 0 and 0 = off, HOST_CAPTURE before the ACK
+#define HOST_CMD_CAPTURE_READ 0x15          // No payload, HOST_CAPTURE before the ACK, HOST_CAPTURE_DATA
+                                            // frames after it, HOST_ERR_STATE when no record is held
+#define HOST_CMD_SCHED      0x16            // u8 1 = clear the counts after reading, HOST_SCHED before the ACK
+#define HOST_CMD_TRIP_HYST  0x17            // u16 restore delay in ms, 1.. (power_trip.h)
+#define HOST_CMD_TRIP_MEASURE 0x18          // u8 1 = trip measurement mode on, 0 = off, clears the trip log
+#define HOST_CMD_TRIP_READ  0x19            // u16 first record, HOST_TRIP before the ACK
+
+// Frame types, fixture to host
+#define HOST_TELEM          0x80
+#define HOST_RSP_ACK        0x81            // u8 command type, u8 HOST_OK/HOST_ERR_*
+#define HOST_SBS            0x82            // u8 bus, u16 valid mask, u16 errors, u16 skipped,
+                                            // u16 value per SBS_* register
+#define HOST_SHUTDOWN       0x83            // u16 last us, u16 worst us, u16 budget us,
+                                            // u16 shutdowns, u16 overruns
+#define HOST_LOG            0x84            // u16 newest seq, u8 n, n event log records
+#define HOST_ENERGY         0x85            // u32 ms active, LPM0, LPM3, u32 LPM0 ms per CLKREQ_* bit,
+                                            // u32 wakes, u32 uWh active, LPM0, LPM3, LPM3 wake-ups (energy.h)
+#define HOST_IRQS           0x86            // u32 LPM3 wakes, u32 entries per ENERGY_IRQ_* source
+#define HOST_DISCHG         0x87            // u8 channel, u8 mode, u8 engaged, u16 setpoint, u16 target,
+                                            // u16 measured (1/16 codes), u16 duty (Q15), u16 loops/s,
+                                            // u16 period us, u16 settle loops, u32 settle us, all ones while unsettled
+#define HOST_IR             0x88            // u8 channel, u8 IR_* status, u16 pulse ms, u16 IOUT before,
+                                            // u16 IOUT after (1/16 codes), u16 step mA, u16 rest mV,
+                                            // u16 loaded mV, u16 mOhm, u16 us before the edge, u16 us after
+#define HOST_POST           0x89            // u8 failed stage bits | POST_OVER_BUDGET, u16 total us, u16 budget us,
+                                            // per POST_* stage: u8 status, u16 us, u16 value (post.h)
+#define HOST_OVERSAMPLE     0x8A            // u8 log2 ratio, u8 bits, u16 outputs/s, per channel:
+                                            // u16 value, u16 outputs since the ratio was set or IOUT started
+#define HOST_CAPTURE        0x8B            // u8 CAPTURE_* state, u16 pre, u16 post armed, record: u8 CAPTURE_SRC_*
+                                            // (0 = none), u8 flags, u16 pre, u16 post, u16 pair rate Hz, u32 time
+#define HOST_CAPTURE_DATA   0x8C            // u16 first entry, u8 n, n entries of u16 IOUT1, u16 IOUT2 (codes)
+#define HOST_SCHED          0x8D            // u8 n, u16 latency bound us, u16 DVCC mV, i16 die 0.1 degC, per channel:
+                                            // u8 ADCINCH, u16 period ms, u16 conversions, u16 missed, u16 late,
+                                            // u16 min us, u16 max us latency
+#define HOST_TRIP           0x8E            // u8 measuring, u8 rail good, u16 restore ms, u16 trips, u16 logged,
+                                            // u16 first, u8 n, n records of u16 edge, u16 entry, u16 switched
+                                            // (SMCLK counts), u8 level
+
+#define HOST_OK             0
+#define HOST_ERR_CMD        1               // Unknown command
+#define HOST_ERR_LEN        2               // Wrong payload length
+#define HOST_ERR_ARG        3               // Argument out of range
+#define HOST_ERR_TIME       4               // Ran over its time budget
+#define HOST_ERR_STATE      5               // Not possible in the current state
+
+void Host_Init(void);
+void Host_SetBaud(unsigned char baud);
+unsigned char Host_Begin(unsigned char type, unsigned char len);
+void Host_Put8(unsigned char value);
+void Host_Put16(unsigned int value);
+void Host_Put32(unsigned long value);
+void Host_End(void);
+void Host_Process(void);
+void Host_TxReady(void);
+void Host_Telemetry(void);
+void Host_Second(void);
+
+#endif /* HOST_LINK_H_ */
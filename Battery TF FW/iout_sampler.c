@@ -0,0 +1,256 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  IOUT sampler: TB1.1 triggered A1/A0 sequence into a lock-free ring.
+//  See iout_sampler.h for the ring layout and the wake-up policy.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "iout_sampler.h"
+#include "coulomb.h"
+#include "discharge.h"
+#include "ir_test.h"
+#include "adc.h"
+#include "decim.h"
+#include "capture.h"
+
+static unsigned int Iout_Ring[IOUT_RING_SIZE];
+static volatile unsigned int Iout_Head;         // Free running write count, ISR only
+static volatile unsigned int Iout_Tail;         // Free running read count, main loop only
+static volatile unsigned int Iout_Conv;         // Conversions since start, pair phase
+static volatile unsigned int Iout_Drops;        // Pairs dropped on overrun
+static unsigned long Iout_Sum[2];               // Code sum per ring slot for the coulomb counter
+static unsigned int Iout_Pair[2];               // Last pair, per ring slot, for the discharge loop
+static unsigned int Iout_PairRate;              // 0 when stopped
+static unsigned int Iout_Means[2];              // Last block mean per channel, ADC codes
+static Decim_Filter Iout_Decim[2];              // Oversampled, per ring slot
+static unsigned char Iout_Shift;                // Oversampling, log2 of the ratio
+
+static unsigned int Iout_Sample(unsigned int sample);
+
+// A1..A0 repeat sequence on TB1.1, sampling timer, MODOSC; Vref=AVCC
+static Adc_Request Iout_Req =
+{
+    ADCSHT_2,                                           // 16ADCclks
+    ADCSHS_2 | ADCCONSEQ_3 | ADCSSEL_0,
+    ADCRES_2,                                           // 12-bit conversion results
+    ADCINCH_1 | ADCSREF_0,
+    0, 0, 0, Iout_Sample
+};
+
+void Iout_Init(void)
+{
+    // Configure ADC A0/A1 pins
+    P1SEL0 |= IOUT1 + IOUT2;
+    P1SEL1 |= IOUT1 + IOUT2;
+
+    Iout_PairRate = 0;
+    Iout_Means[0] = 0;
+    Iout_Means[1] = 0;
+    Iout_SetOversample(IOUT_OVERSAMPLE_SHIFT);
+}
+
+void Iout_Start(unsigned int rateHz)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long period;
+
+    if(rateHz == 0)
+        return;
+    if(rateHz > IOUT_MAX_RATE_HZ)
+        rateHz = IOUT_MAX_RATE_HZ;
+    if(Iout_PairRate == rateHz)
+        return;
+    Iout_Stop();
+
+    Iout_Head = 0;
+    Iout_Tail = 0;
+    Iout_Conv = 0;
+    Iout_Sum[0] = 0;
+    Iout_Sum[1] = 0;
+    Decim_Init(&Iout_Decim[0], Iout_Shift);             // No output across a gap
+    Decim_Init(&Iout_Decim[1], Iout_Shift);
+    Capture_Restart();                                  // No history across a gap
+    Iout_PairRate = rateHz;
+    Coulomb_SetRate(rateHz);
+    __disable_interrupt();                              // The trip ISR changes CLKREQ_TRIP
+    SMCLK_Requests |= CLKREQ_IOUT;
+    if(sr & GIE)
+        __enable_interrupt();
+
+    Adc_StreamStart(&Iout_Req);                         // Queued conversions wait for a pair slot
+
+    // ADC conversion trigger signal - TimerB1.1, one rising edge per conversion
+    period = SMCLK_HZ / (2UL * rateHz);
+    TB1CCR0 = (unsigned int)period - 1;                 // Trigger period
+    TB1CCR1 = (unsigned int)(period / 2);               // TB1.1 high half of the period
+    TB1CCTL1 = OUTMOD_7;                                // Reset/set
+    TB1CTL = TBSSEL__SMCLK | MC__UP | TBCLR;            // SMCLK, up mode
+}
+
+void Iout_Stop(void)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(Iout_PairRate == 0)
+        return;
+    TB1CTL = MC__STOP;
+    TB1CCTL1 = OUTMOD_0;
+    Iout_PairRate = 0;
+    __disable_interrupt();
+    SMCLK_Requests &= ~CLKREQ_IOUT;
+    if(sr & GIE)
+        __enable_interrupt();
+    Adc_StreamStop();                                   // Queued conversions on the software trigger
+}
+
+// Oversampling ratio 1 << shift for both channels (decim.h), restarts the
+// filters
+void Iout_SetOversample(unsigned char shift)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(shift < DECIM_MIN_SHIFT)
+        shift = DECIM_MIN_SHIFT;
+    if(shift > DECIM_MAX_SHIFT)
+        shift = DECIM_MAX_SHIFT;
+    __disable_interrupt();
+    Iout_Shift = shift;
+    Decim_Init(&Iout_Decim[0], shift);
+    Decim_Init(&Iout_Decim[1], shift);
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+unsigned char Iout_OversampleShift(void)
+{
+    return Iout_Shift;
+}
+
+// Last oversampled value of a channel, DECIM_BITS() bits, and the count of
+// outputs so far
+unsigned int Iout_Oversampled(unsigned char ch, unsigned int *outputs)
+{
+    const Decim_Filter *f = &Iout_Decim[IOUT_SLOT(ch & 1)];
+    unsigned int sr = __get_SR_register();
+    unsigned int out;
+
+    __disable_interrupt();
+    out = f->out;
+    *outputs = f->outputs;
+    if(sr & GIE)
+        __enable_interrupt();
+    return out;
+}
+
+unsigned char Iout_Running(void)
+{
+    return Iout_PairRate != 0;
+}
+
+unsigned int Iout_Rate(void)
+{
+    return Iout_PairRate;
+}
+
+// Next full half of the ring, or 0 when none is ready
+const unsigned int *Iout_Block(void)
+{
+    if((unsigned int)(Iout_Head - Iout_Tail) < IOUT_BLOCK_SIZE)
+        return 0;
+    return &Iout_Ring[Iout_Tail & (IOUT_RING_SIZE - 1)];
+}
+
+// Hand the half returned by Iout_Block() back to the ISR
+void Iout_Release(void)
+{
+    Iout_Tail += IOUT_BLOCK_SIZE;
+}
+
+void Iout_Process(void)
+{
+    const unsigned int *block;
+    unsigned long sum1;
+    unsigned long sum2;
+    unsigned int i;
+
+    while((block = Iout_Block()) != 0)
+    {
+        sum1 = 0;
+        sum2 = 0;
+        for(i = 0; i < IOUT_BLOCK_SIZE; i += 2)
+        {
+            sum2 += block[i + IOUT_SLOT(1)];
+            sum1 += block[i + IOUT_SLOT(0)];
+        }
+        Iout_Means[0] = (unsigned int)(sum1 / IOUT_BLOCK_PAIRS);
+        Iout_Means[1] = (unsigned int)(sum2 / IOUT_BLOCK_PAIRS);
+        Iout_Release();
+    }
+}
+
+unsigned int Iout_Mean(unsigned char ch)
+{
+    return Iout_Means[ch & 1];
+}
+
+unsigned int Iout_Dropped(void)
+{
+    return Iout_Drops;
+}
+
+// Integrate the partial block summed so far, interrupts off. The rest of
+// the block is integrated as usual when it completes.
+void Iout_Flush(void)
+{
+    Coulomb_Integrate(Iout_Sum[IOUT_SLOT(0)], Iout_Sum[IOUT_SLOT(1)]);
+    Iout_Sum[0] = 0;
+    Iout_Sum[1] = 0;
+}
+
+// ADC ISR, every IOUT conversion (adc.h). Returns EVT_IOUT_BLOCK when
+// half the ring is full, EVT_CAPTURE when a capture window is complete,
+// and ADC_SLOT at the end of a pair unless the internal resistance bursts
+// need the trigger grid.
+static unsigned int Iout_Sample(unsigned int sample)
+{
+    unsigned int events = 0;
+    unsigned int head;
+    unsigned int conv;
+
+    conv = Iout_Conv;
+    Iout_Sum[conv & 1] += sample;                       // Counted even when the ring is full
+    Iout_Pair[conv & 1] = sample;
+    Decim_Add(&Iout_Decim[conv & 1], sample);
+
+    head = Iout_Head;
+    // Write only in pair phase and with room left, otherwise drop
+    if(((head ^ conv) & 1) == 0 && (unsigned int)(head - Iout_Tail) < IOUT_RING_SIZE)
+    {
+        Iout_Ring[head & (IOUT_RING_SIZE - 1)] = sample;
+        Iout_Head = ++head;
+        if((head & (IOUT_BLOCK_SIZE - 1)) == 0)
+            events = EVT_IOUT_BLOCK;                    // Half full, wake main loop
+    }
+    else if(conv & 1)
+    {
+        Iout_Drops++;
+    }
+
+    Iout_Conv = ++conv;
+    if((conv & (IOUT_BLOCK_SIZE - 1)) == 0)             // Every IOUT_BLOCK_PAIRS pairs
+    {
+        Coulomb_Integrate(Iout_Sum[IOUT_SLOT(0)], Iout_Sum[IOUT_SLOT(1)]);
+        Iout_Sum[0] = 0;
+        Iout_Sum[1] = 0;
+    }
+    if(conv & 1)
+        return events;
+    events |= Capture_Pair(Iout_Pair[IOUT_SLOT(0)], Iout_Pair[IOUT_SLOT(1)]);
+    if(Dischg_Running)                                  // Pair done, regulated discharge loop
+        Dischg_Pair(Iout_Pair[IOUT_SLOT(0)], Iout_Pair[IOUT_SLOT(1)]);
+    if(Ir_Sync)                                         // Pair done, internal resistance bursts
+        Ir_Pair(Iout_Pair[IOUT_SLOT(0)], Iout_Pair[IOUT_SLOT(1)]);
+    else
+        events |= ADC_SLOT;                             // Sequence done, a queued conversion may go
+    return events;
+}
@@ -0,0 +1,79 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  IOUT sampler: continuous, timer triggered sampling of IOUT1 (P1.0/A0)
+//  and IOUT2 (P1.1/A1) into a lock-free ring buffer.
+//
+//  The ADC runs repeat-sequence-of-channels from A1 down to A0, with TB1.1
+//  as the sample trigger (ADCSHS_2). ADCMSC is off, so every conversion
+//  needs its own TB1.1 rising edge: Timer1_B runs up mode at twice the pair
+//  rate and OUTMOD_7 gives one rising edge per period. Pair rate is set with
+//  Iout_Start(), IOUT_MAX_RATE_HZ at most.
+//
+//  There is no DMA on this part, so the ADC ISR (adc.h, the sampler is its
+//  stream) still runs once per conversion, but it never wakes the CPU for
+//  a single sample. It stores ADCMEM0 and only clears the LPM bits when it
+//  completes half of the ring (EVT_IOUT_BLOCK). The CPU sleeps in LPM0
+//  between blocks (TB1 needs SMCLK).
+//
+//  Ring layout: IOUT_RING_SIZE words, consumed in halves. Each pair is
+//  stored in conversion order, IOUT2 (A1) then IOUT1 (A0); use IOUT_SLOT().
+//  Single producer (ADC ISR writes Iout_Head), single consumer (main loop
+//  writes Iout_Tail), both free running, so no locking is needed. When the
+//  consumer falls behind, whole pairs are dropped and counted, never half a
+//  pair, so channel alignment survives an overrun.
+//
+//  Independently of the ring, the ISR keeps a code sum per channel and hands
+//  it to the coulomb counter every IOUT_BLOCK_PAIRS pairs (coulomb.h), so
+//  charge is counted even while the main loop is behind. Iout_Flush() hands
+//  over the part of a block summed so far, for a checkpoint (shutdown.h).
+//  While a discharge is regulated, every pair also goes to the discharge
+//  loop (discharge.h), which runs its PI from here, and during an internal
+//  resistance test to its edge synchronized bursts (ir_test.h), and always
+//  to the transient capture ring (capture.h).
+//
+//  Every sample also goes through an oversampling decimator per channel
+//  (decim.h), 1 << IOUT_OVERSAMPLE_SHIFT by default, for IOUT with more
+//  resolution at a lower rate (Iout_Oversampled()); at 64x and 10 kHz,
+//  15 bits at 156 Hz.
+//
+//  Other ADC channels are converted as queued requests of the ADC service
+//  (Adc_Queue(), adc.h), released by the ADC scheduler (adc_sched.h). While
+//  IOUT runs, they are slotted in after a complete pair: the sequence is
+//  finished, so the request takes the next TB1.1 edge and the pair
+//  sequence the one after it. Each conversion
+//  delays the pairs by one trigger period and stretches that coulomb block
+//  by the same, 2 in 20000 slots a second for the thermistors and 3 every
+//  10 s for DVCC and the die temperature (its sample takes two). They wait
+//  while the internal resistance bursts run, which need the pairs on an
+//  unbroken trigger grid. With IOUT stopped they run straight away on the
+//  software trigger.
+//  __________________________________________________________________________________*/
+#ifndef IOUT_SAMPLER_H_
+#define IOUT_SAMPLER_H_
+
+#define IOUT_RATE_HZ        10000           // Default pair rate
+#define IOUT_MAX_RATE_HZ    25000           // ~12% CPU at 16 MHz for the per-conversion ISR
+#define IOUT_RING_SIZE      256             // Words, power of 2
+#define IOUT_BLOCK_SIZE     (IOUT_RING_SIZE / 2)
+#define IOUT_BLOCK_PAIRS    (IOUT_BLOCK_SIZE / 2)
+
+#define IOUT_SLOT(ch)       (1 - (ch))      // ch 0 = IOUT1 (A0), ch 1 = IOUT2 (A1)
+#define IOUT_OVERSAMPLE_SHIFT 6             // 64x, 15 bits
+
+void Iout_Init(void);
+void Iout_Start(unsigned int rateHz);
+void Iout_Stop(void);
+unsigned char Iout_Running(void);
+unsigned int Iout_Rate(void);
+const unsigned int *Iout_Block(void);
+void Iout_Release(void);
+void Iout_Process(void);
+unsigned int Iout_Mean(unsigned char ch);
+unsigned int Iout_Dropped(void);
+void Iout_Flush(void);
+void Iout_SetOversample(unsigned char shift);
+unsigned char Iout_OversampleShift(void);
+unsigned int Iout_Oversampled(unsigned char ch, unsigned int *outputs);
+
+#endif /* IOUT_SAMPLER_H_ */
@@ -0,0 +1,272 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Internal resistance: TB3 edge on the TB1.1 trigger grid, IOUT bursts
+//  from the ADC ISR, dV from the gauge. See ir_test.h for the timing and
+//  the formats.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "ir_test.h"
+#include "battery_sm.h"
+#include "power_seq.h"
+#include "power_trip.h"
+#include "iout_sampler.h"
+#include "coulomb.h"
+#include "sbs.h"
+
+// Main loop side
+#define IR_STATE_IDLE       0
+#define IR_STATE_REST       1               // Waiting for the rest voltage
+#define IR_STATE_BURST      2               // ADC ISR placing the edge and taking the bursts
+#define IR_STATE_PULSE      3               // Waiting for the loaded voltage
+
+// ADC ISR side, Ir_Sync
+#define IR_SYNC_ARM         1               // Place the edge on the next pair
+#define IR_SYNC_RUN         2               // Edge set, bursts running
+
+static const unsigned char Ir_Pin[BATT_CHANNELS] = { DisChg1, DisChg2 };
+static volatile unsigned int * const Ir_Cctl[BATT_CHANNELS] = { &TB3CCTL1, &TB3CCTL2 };
+static volatile unsigned int * const Ir_Ccr[BATT_CHANNELS] = { &TB3CCR1, &TB3CCR2 };
+
+volatile unsigned char Ir_Sync;
+
+static Ir_Result Ir_Results[BATT_CHANNELS];
+static unsigned char Ir_Ch;                     // Channel under test
+static unsigned char Ir_State;                  // IR_STATE_*
+static unsigned int Ir_Ms;                      // Time in the state, SBS_TICK_MS steps
+static unsigned int Ir_CountsPerUs;             // TB3 counts per us (power_trip.h)
+static unsigned char Ir_Pairs;                  // Pairs since the edge was set, ISR only
+static unsigned int Ir_Before;                  // IOUT sum of the burst before the edge
+static unsigned int Ir_After;                   // IOUT sum of the burst after the edge
+static unsigned int Ir_Trig;                    // TB1 trigger period, SMCLK counts
+
+// Give the pin back to P6OUT, low, unless the sequencer already took it
+static void Ir_End(unsigned char status)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned char pin = Ir_Pin[Ir_Ch];
+
+    __disable_interrupt();
+    Ir_Sync = 0;
+    if(P6SEL0 & ~P6OUT & pin)                   // P6OUT high is a discharge, not ours
+    {
+        P6SEL0 &= ~pin;
+        *Ir_Cctl[Ir_Ch] = OUTMOD_0;
+    }
+    Trip_ClockRelease(TRIP_HOLD_IR);
+    if(sr & GIE)
+        __enable_interrupt();
+    Ir_State = IR_STATE_IDLE;
+    Ir_Results[Ir_Ch].status = status;
+}
+
+void Ir_Init(void)
+{
+    unsigned char ch;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+        Ir_Results[ch].status = IR_NONE;
+    Ir_State = IR_STATE_IDLE;
+    Ir_Sync = 0;
+    Ir_Ch = 0;
+    Ir_CountsPerUs = 1;
+}
+
+// From Trip_SetMeasure(), interrupts off, TB3 on a new clock: a pending
+// edge is off its time, the test ends.
+void Ir_SetClock(unsigned int countsPerUs)
+{
+    Ir_CountsPerUs = countsPerUs;
+    if(Ir_State != IR_STATE_IDLE)
+        Ir_End(IR_ABORTED);
+}
+
+// Returns 0 when the channel can not be tested now, see ir_test.h
+unsigned char Ir_Start(unsigned char ch, unsigned int pulseMs)
+{
+    Ir_Result *r;
+
+    if(ch >= BATT_CHANNELS || pulseMs < IR_MIN_PULSE_MS || pulseMs > IR_MAX_PULSE_MS)
+        return 0;
+    if(Ir_State != IR_STATE_IDLE || Batt_State(ch) != BATT_IDLE || !Trip_RailGood() || Seq_Busy())
+        return 0;
+    if((P6OUT | P6SEL0) & Ir_Pin[ch])
+        return 0;
+
+    r = &Ir_Results[ch];
+    r->status = IR_RUNNING;
+    r->pulseMs = pulseMs;
+    r->before = 0;
+    r->after = 0;
+    r->stepMa = 0;
+    r->restMv = 0;
+    r->loadMv = 0;
+    r->milliohm = 0;
+    r->beforeUs = 0;
+    r->afterUs = 0;
+    Sbs_Fresh(ch, SBS_VOLTAGE);                 // Rest voltage read from now on
+    Ir_Ch = ch;
+    Ir_Ms = 0;
+    Ir_State = IR_STATE_REST;
+    return 1;
+}
+
+// IOUT has to run for the test, Power_Select() keeps it on
+unsigned char Ir_Busy(void)
+{
+    return Ir_State != IR_STATE_IDLE;
+}
+
+// Current step from the bursts, and where the samples were against the
+// edge. The pulsed channel's conversion is IOUT_SLOT(ch) of each pair, so
+// its samples are (3 - 2 slot) / 2 trigger periods ahead of the edge and
+// (4 IR_SETTLE_PAIRS + 1 + 2 slot) / 2 behind it.
+static unsigned char Ir_Step(Ir_Result *r)
+{
+    unsigned int slot = IOUT_SLOT(Ir_Ch);
+    unsigned int perUs = (unsigned int)(SMCLK_HZ / 1000000UL);
+    unsigned long ua;
+
+    r->before = Ir_Before;
+    r->after = Ir_After;
+    r->beforeUs = (unsigned int)((3UL - 2 * slot) * Ir_Trig / 2 / perUs);
+    r->afterUs = (unsigned int)((4UL * IR_SETTLE_PAIRS + 1 + 2 * slot) * Ir_Trig / 2 / perUs);
+    if(r->after <= r->before)
+        return 0;
+    ua = (unsigned long)(unsigned int)(r->after - r->before) * COULOMB_UA_PER_CODE / 16;
+    r->stepMa = (unsigned int)(ua / 1000);
+    return r->stepMa >= IR_MIN_MA;
+}
+
+// R from the gauge voltages and the current step
+static void Ir_Resistance(Ir_Result *r)
+{
+    unsigned long ua = (unsigned long)(unsigned int)(r->after - r->before) * COULOMB_UA_PER_CODE / 16;
+    unsigned long mohm;
+    unsigned int dv;
+
+    dv = r->restMv > r->loadMv ? r->restMv - r->loadMv : 0;
+    if(dv > 4294)                               // dv * 1000000 past 32 bits
+    {
+        r->milliohm = 0xFFFF;
+        return;
+    }
+    mohm = (unsigned long)dv * 1000000UL / ua;
+    r->milliohm = mohm > 0xFFFF ? 0xFFFF : (unsigned int)mohm;
+}
+
+// EVT_SBS_TICK, after Sbs_Tick()
+void Ir_Tick(void)
+{
+    Ir_Result *r = &Ir_Results[Ir_Ch];
+    unsigned char pin = Ir_Pin[Ir_Ch];
+
+    if(Ir_State == IR_STATE_IDLE)
+        return;
+    Ir_Ms += SBS_TICK_MS;
+    if(Batt_State(Ir_Ch) != BATT_IDLE || !Trip_RailGood())
+    {
+        Ir_End(IR_ABORTED);
+        return;
+    }
+
+    switch(Ir_State)
+    {
+        case IR_STATE_REST:
+            if(Sbs_Fresh(Ir_Ch, SBS_VOLTAGE) && Iout_Running())
+            {
+                r->restMv = Sbs_Value(Ir_Ch, SBS_VOLTAGE);
+                Ir_Ms = 0;
+                Ir_State = IR_STATE_BURST;
+                Ir_Sync = IR_SYNC_ARM;          // The ADC ISR takes it from here
+            }
+            else if(Ir_Ms >= IR_GAUGE_MS)
+                Ir_End(IR_NO_VOLTAGE);
+            break;
+        case IR_STATE_BURST:
+            if(Ir_Sync == IR_SYNC_RUN && (!(P6SEL0 & pin) || (P6OUT & pin)))
+                Ir_End(IR_ABORTED);
+            else if(Ir_Sync)
+            {
+                if(Ir_Ms >= IR_GAUGE_MS)        // IOUT stopped under the test
+                    Ir_End(IR_ABORTED);
+            }
+            else if(!Ir_Step(r))
+                Ir_End(IR_NO_CURRENT);
+            else
+            {
+                Sbs_Fresh(Ir_Ch, SBS_VOLTAGE);  // Loaded voltage read from now on
+                Ir_Ms = 0;
+                Ir_State = IR_STATE_PULSE;
+            }
+            break;
+        case IR_STATE_PULSE:
+            if(!(P6SEL0 & pin) || (P6OUT & pin))
+                Ir_End(IR_ABORTED);
+            else if(Ir_Ms >= r->pulseMs && Sbs_Fresh(Ir_Ch, SBS_VOLTAGE))
+            {
+                r->loadMv = Sbs_Value(Ir_Ch, SBS_VOLTAGE);
+                Ir_Resistance(r);
+                Ir_End(IR_DONE);
+            }
+            else if(Ir_Ms >= r->pulseMs + IR_GAUGE_MS)
+                Ir_End(IR_NO_VOLTAGE);
+            break;
+        default:
+            break;
+    }
+}
+
+// First pair after arming: the next TB1.1 rising edge (OUTMOD_7 sets the
+// output at TB1CCR0) starts the burst before the edge. The edge goes half a
+// trigger period after its last conversion, the 2 * IR_BURST_PAIRS th.
+static void Ir_Arm(void)
+{
+    unsigned int trig = TB1CCR0 + 1;
+    unsigned int now1;
+    unsigned int now3;
+    unsigned long lead;
+
+    Trip_ClockHold(TRIP_HOLD_IR);               // TB3 in us before it is read
+    now1 = TB1R;
+    now3 = TB3R;
+
+    lead = (unsigned long)(unsigned int)(trig - 1 - now1) + (2UL * IR_BURST_PAIRS - 1) * trig + trig / 2;
+    *Ir_Cctl[Ir_Ch] = OUTMOD_0;                 // Timer output low, as P6OUT
+    P6SEL0 |= Ir_Pin[Ir_Ch];
+    *Ir_Ccr[Ir_Ch] = now3 + (unsigned int)((lead * Ir_CountsPerUs + SMCLK_HZ / 2000000UL)
+                                           / (SMCLK_HZ / 1000000UL));   // Rounded to a TB3 count
+    *Ir_Cctl[Ir_Ch] = OUTMOD_1;                 // Set on the compare, no interrupt
+    Ir_Trig = trig;
+    Ir_Pairs = 0;
+    Ir_Before = 0;
+    Ir_After = 0;
+    Ir_Sync = IR_SYNC_RUN;
+}
+
+// ADC ISR, once per IOUT pair while Ir_Sync
+void Ir_Pair(unsigned int iout1, unsigned int iout2)
+{
+    unsigned int sample = Ir_Ch ? iout2 : iout1;
+    unsigned char n;
+
+    if(Ir_Sync == IR_SYNC_ARM)
+    {
+        Ir_Arm();
+        return;
+    }
+    n = ++Ir_Pairs;
+    if(n <= IR_BURST_PAIRS)
+        Ir_Before += sample;
+    else if(n > IR_BURST_PAIRS + IR_SETTLE_PAIRS)
+    {
+        Ir_After += sample;
+        if(n == 2 * IR_BURST_PAIRS + IR_SETTLE_PAIRS)
+            Ir_Sync = 0;                        // Both bursts in, back to the main loop
+    }
+}
+
+const Ir_Result *Ir_Get(unsigned char ch)
+{
+    return &Ir_Results[ch & 1];
+}
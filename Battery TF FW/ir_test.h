@@ -0,0 +1,89 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Internal resistance: on demand DC resistance test of one battery, a
+//  load pulse on its DisChg pin, R = dV / dI, computed here so the host only
+//  reads the result (HOST_CMD_IR, HOST_CMD_IR_READ, host_link.h).
+//
+//  The channel has to be in BATT_IDLE, stopped, with the 12 V rail good and
+//  the sequencer idle. The pulse is not a state machine discharge: the
+//  DisChg pin is handed to its Timer3_B output (P6.0 TB3.1, P6.1 TB3.2)
+//  with P6OUT left low, and the compare makes the edge. A transition that
+//  switches a path on cuts the pulse in its break step (power_seq.h), as
+//  do the trip and the shutdown; the test then ends IR_ABORTED.
+//
+//  Current, edge synchronized: IOUT keeps running on its TB1.1 trigger
+//  (iout_sampler.h) and the edge is placed on that trigger grid. On the
+//  first IOUT pair after the test is armed, the ADC ISR reads TB1R and TB3R
+//  together and sets the TB3 compare half a trigger period after the last
+//  conversion of the IR_BURST_PAIRS pairs to come. Those pairs are the
+//  burst before the edge; IR_SETTLE_PAIRS pairs later the next
+//  IR_BURST_PAIRS pairs are the burst after it. Auxiliary conversions are
+//  held off meanwhile, so every trigger sits a whole number of trigger
+//  periods plus one half from the edge, to one TB3 count (1 us, or 1/16 us
+//  in measurement mode, power_trip.h), and the sample and hold closes the
+//  same 16 ADC clocks (~3 us) after each trigger. At the default 10 kHz
+//  pair rate the IOUT1 triggers end 25 us before the edge and start 275 us
+//  after it; IOUT2 is triggered one trigger period, 50 us, earlier. The
+//  burst sums of 16 pairs are the means in 1/16 codes, as in charge.h and
+//  discharge.h.
+//
+//  Voltage: the board has no battery voltage input on the ADC (DM_VBATx_En
+//  routes it to the bench meter), so dV comes from the gauge (SBS_VOLTAGE,
+//  sbs.h): the rest voltage is the first fresh reading after the start,
+//  the loaded voltage the first fresh reading once the pulse has lasted
+//  pulseMs, after which the pin is let go. The gauge voltage of an idle
+//  channel is not read by anyone else (charge.c reads it while charging).
+//  This is the DC resistance of a 1 s pulse (IEC 61960 style) rather than
+//  the ohmic step at the edge; the edge bursts make dI exact.
+//
+//  Fixed point, in the main loop on the SBS tick:
+//      dI  = (after - before) * COULOMB_UA_PER_CODE / 16     uA
+//      R   = (Vrest - Vload) * 1000000 / dI                   mOhm
+//  A step under IR_MIN_MA ends IR_NO_CURRENT. A voltage that did not drop
+//  gives R = 0.
+//  __________________________________________________________________________________*/
+#ifndef IR_TEST_H_
+#define IR_TEST_H_
+
+#define IR_BURST_PAIRS      16              // Pairs per burst, the sum is the mean in 1/16 codes
+#define IR_SETTLE_PAIRS     2               // Pairs skipped after the edge
+#define IR_PULSE_MS         1000            // Default pulse before the loaded voltage
+#define IR_MIN_PULSE_MS     100
+#define IR_MAX_PULSE_MS     10000
+#define IR_GAUGE_MS         3000            // Longest wait for a fresh gauge voltage
+#define IR_MIN_MA           100             // Smallest current step
+
+// Result status
+#define IR_NONE             0               // Never run on this channel
+#define IR_RUNNING          1
+#define IR_DONE             2
+#define IR_ABORTED          3               // Pin taken back, battery left IDLE, IOUT or TB3 clock changed
+#define IR_NO_VOLTAGE       4               // No fresh gauge voltage within IR_GAUGE_MS
+#define IR_NO_CURRENT       5               // Current step under IR_MIN_MA
+
+typedef struct
+{
+    unsigned char status;                   // IR_*
+    unsigned int pulseMs;
+    unsigned int before;                    // IOUT before the edge, 1/16 codes
+    unsigned int after;                     // IOUT after the edge, 1/16 codes
+    unsigned int stepMa;                    // dI
+    unsigned int restMv;                    // Gauge voltage before the pulse
+    unsigned int loadMv;                    // Gauge voltage at the end of the pulse
+    unsigned int milliohm;                  // R, 0xFFFF when over range
+    unsigned int beforeUs;                  // Last sample of the burst before the edge, us ahead of it
+    unsigned int afterUs;                   // First sample of the burst after the edge, us behind it
+} Ir_Result;
+
+extern volatile unsigned char Ir_Sync;      // ADC ISR owns the edge and the bursts
+
+void Ir_Init(void);
+void Ir_SetClock(unsigned int countsPerUs);
+unsigned char Ir_Start(unsigned char ch, unsigned int pulseMs);
+unsigned char Ir_Busy(void);
+void Ir_Tick(void);
+void Ir_Pair(unsigned int iout1, unsigned int iout2);
+const Ir_Result *Ir_Get(unsigned char ch);
+
+#endif /* IR_TEST_H_ */
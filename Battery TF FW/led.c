@@ -0,0 +1,156 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  LED status engine: bit plane PWM on TB2CCR0, patterns in the main loop.
+//  See led.h for the slot layout and the per-tick cost.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "led.h"
+#include "energy.h"
+
+#define LED_BREATHE_STEPS   64              // 2 s at LED_TICK_HZ, power of 2
+
+static const unsigned int Led_Span[LED_SLOTS] =
+{
+    1 * LED_UNIT, 2 * LED_UNIT, 4 * LED_UNIT, 8 * LED_UNIT, 1 * LED_UNIT
+};
+
+static const unsigned char Led_Breathe[LED_BREATHE_STEPS] =
+{
+     0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  2,  2,  2,  3,  3,  4,
+     4,  5,  5,  6,  6,  7,  8,  8,  9, 10, 11, 11, 12, 13, 14, 15,
+    15, 14, 13, 12, 11, 11, 10,  9,  8,  8,  7,  6,  6,  5,  5,  4,
+     4,  3,  3,  2,  2,  2,  1,  1,  1,  1,  0,  0,  0,  0,  0,  0
+};
+
+static unsigned char Led_Planes[2][LED_SLOTS];  // Double buffered, blank plane stays 0
+static const unsigned char *Led_Show;           // Planes the ISR shows, ISR only after init
+static volatile unsigned char Led_Swap;         // Spare planes are ready for the next frame
+static volatile unsigned char Led_Spare;        // Buffer the main loop writes, flipped by the ISR
+static unsigned char Led_Slot;
+static unsigned char Led_Frames;
+static volatile unsigned char Led_Animated;     // Some LED needs EVT_LED
+static unsigned char Led_Pattern[LED_COUNT];
+static unsigned int Led_Phase;                  // Pattern ticks, shared by every LED
+
+static unsigned char Led_Level(unsigned char pattern)
+{
+    switch(pattern)
+    {
+        case LED_DIM:           return 3;
+        case LED_ON:            return LED_MAX_LEVEL;
+        case LED_BLINK:         return (Led_Phase & (LED_TICK_HZ / 2)) ? LED_MAX_LEVEL : 0;
+        case LED_BLINK_FAST:    return (Led_Phase & (LED_TICK_HZ / 8)) ? LED_MAX_LEVEL : 0;
+        case LED_BREATHE:       return Led_Breathe[Led_Phase & (LED_BREATHE_STEPS - 1)];
+        default:                return 0;
+    }
+}
+
+// Build the spare planes from the patterns and hand them to the ISR
+static void Led_Update(void)
+{
+    unsigned char *planes;
+    unsigned char led;
+    unsigned char level;
+    unsigned char animated = 0;
+    unsigned char b;
+
+    Led_Swap = 0;                                   // Take back a spare the ISR has not shown yet
+    planes = Led_Planes[Led_Spare];
+    for(b = 0; b < 4; b++)
+        planes[b] = 0;
+    for(led = 0; led < LED_COUNT; led++)
+    {
+        level = Led_Level(Led_Pattern[led]);
+        for(b = 0; b < 4; b++)
+        {
+            if(level & (1 << b))
+                planes[b] |= 1 << led;              // LED_1..LED_6 are P3.0..P3.5
+        }
+        if(Led_Pattern[led] >= LED_BLINK)
+            animated = 1;
+    }
+    Led_Animated = animated;
+    Led_Swap = 1;
+}
+
+void Led_Init(void)
+{
+    unsigned char led;
+    unsigned char b;
+
+    P3OUT &= ~LED_ALL;                              // Set all LEDs off at start up
+    P3DIR |= LED_ALL;                               // Set P3.0 - P3.5 LEDs as outputs
+
+    for(led = 0; led < LED_COUNT; led++)
+        Led_Pattern[led] = LED_OFF;
+    for(b = 0; b < LED_SLOTS; b++)
+    {
+        Led_Planes[0][b] = 0;
+        Led_Planes[1][b] = 0;
+    }
+    Led_Show = Led_Planes[0];
+    Led_Spare = 1;
+    Led_Swap = 0;
+    Led_Slot = 0;
+    Led_Frames = 0;
+    Led_Animated = 0;
+    Led_Phase = 0;
+
+    TB2CCR0 = Led_Span[0];
+    TB2CCTL0 = CCIE;                                // TBCCR0 interrupt enabled
+    TB2CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR; // ACLK, continuous mode
+}
+
+// Only a pattern change rebuilds the planes
+void Led_Set(unsigned char led, unsigned char pattern)
+{
+    if(led >= LED_COUNT || pattern >= LED_PATTERNS || Led_Pattern[led] == pattern)
+        return;
+    Led_Pattern[led] = pattern;
+    Led_Update();
+}
+
+// EVT_LED: advance the animated patterns
+void Led_Tick(void)
+{
+    Led_Phase++;
+    Led_Update();
+}
+
+// Timer2_B0 interrupt service routine, one bit plane per slot
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER2_B0_VECTOR
+__interrupt void Timer2_B0_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER2_B0_VECTOR))) Timer2_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    unsigned char slot = Led_Slot;
+
+    P3OUT = Led_Show[slot];
+    TB2CCR0 += Led_Span[slot];
+    ENERGY_IRQ(ENERGY_IRQ_LED);                     // After the output, no added jitter
+    if(++slot == LED_SLOTS)
+    {
+        slot = 0;
+        if(Led_Swap)
+        {
+            Led_Show = Led_Planes[Led_Spare];
+            Led_Spare ^= 1;
+            Led_Swap = 0;
+        }
+        if(++Led_Frames == LED_FRAMES_PER_TICK)
+        {
+            Led_Frames = 0;
+            if(Led_Animated)
+            {
+                Pending_Events |= EVT_LED;
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+        }
+    }
+    Led_Slot = slot;
+}
@@ -0,0 +1,64 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  LED status engine: the six LEDs on P3.0 - P3.5, dimmed and animated from
+//  one Timer2_B ISR.
+//
+//  Dimming is bit-parallel software PWM in binary code modulation: the
+//  brightness of each LED is a 4-bit level, and the frame is cut into one
+//  slot per level bit, 1, 2, 4 and 8 units long, plus a blank unit:
+//      slot    0    1    2    3    blank
+//      units   1    2    4    8    1       (unit = LED_UNIT ACLK counts)
+//  Slot b shows bit plane b, the P3 byte with the LEDs whose level has bit b
+//  set. An LED at level n is then on for n of the 16 units of the frame.
+//  The planes are built by the main loop; the TB2CCR0 ISR writes one plane
+//  to P3OUT, adds the slot length to TB2CCR0 and moves on. That is one port
+//  write and no per-LED work, ~30 MCLK cycles per slot whatever the
+//  LEDs show. P3.6/P3.7 are not connected and are written low.
+//
+//  Timing (ACLK, works in LPM3):
+//      LED_UNIT 16 counts, frame 256 counts = 128 Hz, 5 ISRs per frame
+//      ~640 ISRs/s, ~20k MCLK cycles/s, ~0.1% of the CPU
+//
+//  Patterns: each LED is given one of the LED_* patterns below. Patterns
+//  are evaluated in the main loop on EVT_LED, which the ISR posts every
+//  LED_FRAMES_PER_TICK frames (LED_TICK_HZ) while at least one LED is
+//  animated; static levels never wake the CPU. The new planes are written to
+//  the spare buffer and the ISR swaps buffers at the start of a frame, so
+//  a frame is never shown half old, half new. All LEDs share one phase
+//  counter, so LEDs in the same pattern stay in step.
+//
+//      LED_OFF          0
+//      LED_DIM          level 3
+//      LED_ON           level 15
+//      LED_BLINK        1 Hz, 50%
+//      LED_BLINK_FAST   4 Hz, 50%
+//      LED_BREATHE      2 s, triangle with a squared ramp
+//  __________________________________________________________________________________*/
+#ifndef LED_H_
+#define LED_H_
+
+#define LED_COUNT           6
+#define LED_ALL             (LED_1 + LED_2 + LED_3 + LED_4 + LED_5 + LED_6)
+
+#define LED_UNIT            16              // ACLK counts per PWM unit
+#define LED_SLOTS           5               // 4 bit planes and a blank unit
+#define LED_FRAME_HZ        (ACLK_HZ / (16 * LED_UNIT))
+#define LED_FRAMES_PER_TICK 4
+#define LED_TICK_HZ         (LED_FRAME_HZ / LED_FRAMES_PER_TICK)    // 32 Hz
+#define LED_MAX_LEVEL       15
+
+// Patterns
+#define LED_OFF             0
+#define LED_DIM             1
+#define LED_ON              2
+#define LED_BLINK           3
+#define LED_BLINK_FAST      4
+#define LED_BREATHE         5
+#define LED_PATTERNS        6
+
+void Led_Init(void);
+void Led_Set(unsigned char led, unsigned char pattern);
+void Led_Tick(void);
+
+#endif /* LED_H_ */
@@ -143,15 +143,17 @@ SECTIONS
             .mspabi.exidx : {}                 /* C++ constructor tables            */
             .mspabi.extab : {}                 /* C++ constructor tables            */
             .const      : {}                   /* Constant data                     */
-        }
+        } crc_table(Post_ImageCrc, algorithm=CRC_CCITT)   /* Power-on self test, post.h */
 
         GROUP(EXECUTABLE_MEMORY)
         {
             .text       : {}                   /* Code                              */
             .text:_isr  : {}                   /* Code ISRs                         */
-        }
+        } crc_table(Post_ImageCrc, algorithm=CRC_CCITT)
     } > FRAM
 
+    .TI.crctab  : {}               > FRAM    /* Image CRC records, not covered  */
+
     #ifdef __TI_COMPILER_VERSION__
         #if __TI_COMPILER_VERSION__ >= 15009000
             .TI.ramfunc : {} load=FRAM, run=RAM, table(BINIT)
@@ -230,6 +232,10 @@ SECTIONS
 /* FRAM WRITE PROTECTION SEGMENT DEFINITONS                                 */
 /****************************************************************************/
 
+/* PFWP covers the program FRAM from fram_rx_start (FRWPOA) up. The         */
+/* PERSISTENT variables (event log, capture record, coulomb and shutdown    */
+/* records) are linked below it, in fram_rw, so they are written without    */
+/* toggling PFWP.                                                           */
 #ifdef _FRWP_ENABLE
     __mpu_enable=1;
     start_protection_offset_address = (fram_rx_start - fram_rw_start) >> 10;
@@ -0,0 +1,280 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power-on self test: FRAM image CRC, ADC reference and rails, clock
+//  configuration and SMCLK against REFO, die temperature. See post.h for
+//  the checks and the startup time budget.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "post.h"
+#include "event_log.h"
+#include "cal.h"
+
+#ifdef __TI_COMPILER_VERSION__
+#include <crc_tbl.h>
+extern CRC_TABLE Post_ImageCrc;                 // crc_table(), lnk_msp430fr2355.cmd
+#endif
+
+#define POST_REF_US         1000            // Longest wait for the reference or a conversion
+#define POST_CLOCK_US       (2000000UL * POST_CLOCK_ACLK / ACLK_HZ)    // Twice the SMCLK count window
+#define POST_FLLN           (SMCLK_HZ / ACLK_HZ - 1)   // Init_Clock(), 487
+
+static Post_Stage Post_Stages[POST_STAGES];
+static unsigned char Post_Flags;                // Bit per failed stage, POST_OVER_BUDGET
+static unsigned int Post_Total;                 // us
+
+// Poll until (*reg & mask), Timer2_B counting us; 0 after us without it.
+// The no-op is a sync point for the simulator (sim.h).
+static unsigned char Post_Wait(volatile unsigned int *reg, unsigned int mask, unsigned int us)
+{
+    unsigned int start = TB2R;
+
+    while(!(*reg & mask))
+    {
+        if((unsigned int)(TB2R - start) > us)
+            return 0;
+        __no_operation();
+    }
+    return 1;
+}
+
+#ifdef __TI_COMPILER_VERSION__
+// CRC-CCITT of one record with the CRC16 module, seed 0xFFFF. CRCDIRB
+// takes the low byte first, so word writes follow the bytes in memory.
+static unsigned int Post_Crc(const unsigned char *p, unsigned long size)
+{
+    const unsigned int *w;
+    unsigned int n;
+
+    CRCINIRES = 0xFFFF;
+    if(((unsigned int)p & 1) && size)       // Word writes need an even address
+    {
+        CRCDIRB_L = *p++;
+        size--;
+    }
+    w = (const unsigned int *)p;
+    for(n = (unsigned int)(size >> 3); n; n--)  // Four words a pass
+    {
+        CRCDIRB = *w++;
+        CRCDIRB = *w++;
+        CRCDIRB = *w++;
+        CRCDIRB = *w++;
+    }
+    for(n = (unsigned int)(size >> 1) & 3; n; n--)
+        CRCDIRB = *w++;
+    if(size & 1)
+        CRCDIRB_L = *(const unsigned char *)w;
+    return CRCINIRES;
+}
+#endif
+
+// Each linker CRC record against the image, stops at the first bad one
+static unsigned char Post_Image(unsigned int *bytes)
+{
+#ifdef __TI_COMPILER_VERSION__
+    const CRC_RECORD *rec;
+    unsigned int i;
+
+    *bytes = 0;
+    for(i = 0; i < Post_ImageCrc.num_recs; i++)
+    {
+        rec = &Post_ImageCrc.recs[i];
+        *bytes += (unsigned int)rec->size;
+        if(rec->crc_alg_ID != CRC_CCITT)
+            return POST_FAIL;
+        if(Post_Crc((const unsigned char *)(unsigned int)rec->addr, rec->size)
+           != (unsigned int)rec->crc_value)
+            return POST_FAIL;
+    }
+    return i ? POST_PASS : POST_SKIPPED;
+#else
+    *bytes = 0;
+    return POST_SKIPPED;                    // No linker CRC table
+#endif
+}
+
+// ADC for single conversions by ADCSC, MODOSC, and the reference on with
+// the PMMCTL2 bits given; 0 when the reference did not come up
+static unsigned char Post_AdcOn(unsigned int sht, unsigned int pmm)
+{
+    ADCCTL0 = sht | ADCON;                      // Sample time, ADC ON
+    ADCCTL1 = ADCSHP | ADCCONSEQ_0 | ADCSSEL_0; // ADCSC trig, single channel, MODOSC
+    ADCCTL2 = ADCRES_2;                         // 12-bit conversion results
+    ADCIE = 0;
+
+    PMMCTL0_H = PMMPW_H;                        // Unlock the PMM registers
+    PMMCTL2 = INTREFEN | REFVSEL_0 | pmm;       // Internal 1.5 V reference
+    return Post_Wait(&PMMCTL2, REFGENRDY, POST_REF_US);
+}
+
+// Reference off, ADC as after a reset for Iout_Init()
+static void Post_AdcOff(void)
+{
+    PMMCTL2 = 0;                                // Reference off
+    PMMCTL0_H = 0;                              // Lock the PMM registers
+
+    ADCCTL0 &= ~ADCENC;
+    ADCCTL0 = 0;
+    ADCCTL1 = 0;
+    ADCCTL2 = ADCRES_1;
+    ADCMCTL0 = 0;
+    ADCIFG = 0;
+}
+
+// One single conversion, channel and reference, 0xFFFF when it does not finish
+static unsigned int Post_Convert(unsigned int mctl)
+{
+    ADCCTL0 &= ~ADCENC;
+    ADCMCTL0 = mctl;
+    ADCIFG &= ~ADCIFG0;
+    ADCCTL0 |= ADCENC | ADCSC;
+    if(!Post_Wait(&ADCIFG, ADCIFG0, POST_REF_US))
+        return 0xFFFF;
+    return ADCMEM0;
+}
+
+static unsigned char Post_Adc(unsigned int *mv)
+{
+    unsigned int ref = 0;
+    unsigned int vss = 0xFFFF;
+    unsigned int vcc = 0;
+
+    *mv = 0;
+    if(Post_AdcOn(ADCSHT_2, 0))                 // 16ADCclks
+    {
+        ref = Post_Convert(ADCINCH_13 | ADCSREF_0);
+        vss = Post_Convert(ADCINCH_14 | ADCSREF_0);
+        vcc = Post_Convert(ADCINCH_15 | ADCSREF_0);
+    }
+    Post_AdcOff();
+
+    if(ref == 0 || ref > 4095)
+        return POST_FAIL;
+    *mv = Cal_DvccMv(ref);                      // TLV gain, offset and reference (cal.h)
+    if(*mv < POST_DVCC_MIN_MV || *mv > POST_DVCC_MAX_MV)
+        return POST_FAIL;
+    if(vss > POST_ADC_LOW || vcc > 4095 || vcc < 4095 - POST_ADC_LOW)
+        return POST_FAIL;
+    return POST_PASS;
+}
+
+// Die temperature, A12 against the 1.5 V reference with the sensor on
+static unsigned char Post_Temp(unsigned int *dc)
+{
+    unsigned int code = 0xFFFF;
+    int t;
+
+    *dc = 0;
+    if(Post_AdcOn(ADCSHT_8, TSENSOREN))         // 256ADCclks, over the sensor's 30 us
+        code = Post_Convert(ADCINCH_12 | ADCSREF_1);
+    Post_AdcOff();
+
+    if(code > 4095)
+        return POST_FAIL;
+    t = Cal_TempC10(code);
+    *dc = (unsigned int)t;
+    return t >= POST_DIE_MIN_DC && t <= POST_DIE_MAX_DC ? POST_PASS : POST_FAIL;
+}
+
+// Init_Clock() settings, then SMCLK counted on Timer1_B between two
+// Timer0_B compare flags POST_CLOCK_ACLK REFO ticks apart
+static unsigned char Post_Clock(unsigned int *count)
+{
+    unsigned int expect = (unsigned int)(SMCLK_HZ * POST_CLOCK_ACLK / ACLK_HZ);
+    unsigned int start;
+    unsigned int diff;
+    unsigned char ok;
+
+    *count = 0;
+    if((CSCTL1 & DCORSEL) != DCORSEL_5 || (CSCTL2 & (FLLD | FLLN)) != (FLLD_0 | POST_FLLN))
+        return POST_FAIL;
+    if((CSCTL3 & SELREF) != SELREF__REFOCLK || (CSCTL4 & (SELA | SELMS)) != (SELA__REFOCLK | SELMS__DCOCLKDIV))
+        return POST_FAIL;
+    if(CSCTL5 & (DIVM | DIVS | SMCLKOFF))       // MCLK = SMCLK = DCOCLKDIV
+        return POST_FAIL;
+    if(CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1 | DCOFFG))
+        return POST_FAIL;
+
+    TB0CCTL1 = 0;
+    TB0CCR1 = 2;                                // A whole ACLK tick after the clear
+    TB0CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR;
+    TB1CTL = TBSSEL__SMCLK | MC__CONTINUOUS | TBCLR;
+    ok = Post_Wait(&TB0CCTL1, CCIFG, POST_CLOCK_US);
+    start = TB1R;
+    TB0CCTL1 &= ~CCIFG;
+    TB0CCR1 += POST_CLOCK_ACLK;
+    if(ok)
+        ok = Post_Wait(&TB0CCTL1, CCIFG, POST_CLOCK_US);
+    *count = TB1R - start;
+    TB0CTL = MC__STOP | TBCLR;
+    TB1CTL = MC__STOP | TBCLR;
+    TB0CCTL1 = 0;
+    TB0CCR1 = 0;
+    if(!ok)
+    {
+        *count = 0;
+        return POST_FAIL;
+    }
+
+    diff = *count > expect ? *count - expect : expect - *count;
+    return diff <= expect / POST_CLOCK_TOL ? POST_PASS : POST_FAIL;
+}
+
+// From main(), after Init_Clock(), interrupts off
+void Post_Run(void)
+{
+    unsigned char stage;
+    unsigned int mark;
+    unsigned int now;
+    Post_Stage *s;
+
+    TB2EX0 = TBIDEX__2;
+    TB2CTL = TBSSEL__SMCLK | ID__8 | MC__CONTINUOUS | TBCLR;    // SMCLK / 16, 1 us
+
+    Post_Flags = 0;
+    mark = TB2R;
+    for(stage = 0; stage < POST_STAGES; stage++)
+    {
+        s = &Post_Stages[stage];
+        switch(stage)
+        {
+            case POST_IMAGE: s->status = Post_Image(&s->value); break;
+            case POST_ADC:   s->status = Post_Adc(&s->value); break;
+            case POST_CLOCK: s->status = Post_Clock(&s->value); break;
+            default:         s->status = Post_Temp(&s->value); break;
+        }
+        now = TB2R;
+        s->us = now - mark;
+        mark = now;
+        if(s->status == POST_FAIL)
+            Post_Flags |= 1 << stage;
+    }
+    Post_Total = TB2R;
+
+    TB2CTL = MC__STOP | TBCLR;                  // For the LED engine
+    TB2EX0 = 0;
+    if(Post_Total > POST_BUDGET_US)
+        Post_Flags |= POST_OVER_BUDGET;
+}
+
+// After Log_Init(): a LOG_POST record when something failed
+void Post_Log(void)
+{
+    if(Post_Flags)
+        Log_Append(LOG_POST, Post_Flags);
+}
+
+unsigned char Post_Result(void)
+{
+    return Post_Flags;
+}
+
+unsigned int Post_TotalUs(void)
+{
+    return Post_Total;
+}
+
+const Post_Stage *Post_Get(unsigned char stage)
+{
+    return &Post_Stages[stage < POST_STAGES ? stage : POST_STAGES - 1];
+}
@@ -0,0 +1,90 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power-on self test: run once from main() right after Init_Clock() and
+//  Cal_Init() (cal.h), before any other module is set up, with interrupts
+//  off. Four stages, each timed; a failed stage does not stop the boot, it
+//  is logged (LOG_POST, event_log.h) and reported to the host
+//  (HOST_CMD_POST, host_link.h).
+//
+//  POST_IMAGE: the application image in FRAM against the CRCs the linker
+//  computed (crc_table() on the read only and executable groups,
+//  lnk_msp430fr2355.cmd). Each record is run through the CRC16 module
+//  (CRC-CCITT, seed 0xFFFF, the linker's CRC_CCITT) with word writes to
+//  CRCDIRB, four per loop pass; an odd byte at either end goes in through
+//  CRCDIRB_L. Value: bytes checked, up to and including a bad record.
+//  Skipped with no linker table (msp430-gcc, the simulator).
+//
+//  POST_ADC: the internal 1.5 V reference switched on, then three single
+//  conversions against AVCC (12 bit, MODOSC):
+//      A13  1.5 V reference    DVCC, Cal_DvccMv(), POST_DVCC_MIN_MV..MAX
+//      A14  DVSS               under POST_ADC_LOW
+//      A15  DVCC               over 4095 - POST_ADC_LOW
+//  Value: DVCC in mV. The reference is switched off and the ADC left as
+//  after a reset for Iout_Init().
+//
+//  POST_CLOCK: CSCTL1..4 as Init_Clock() left them (DCO range, FLLN,
+//  REFO reference, MCLK/SMCLK from DCOCLKDIV, ACLK from REFO), no FLL
+//  unlock or DCO fault in CSCTL7, then SMCLK measured against REFO: Timer1_B
+//  counts SMCLK over POST_CLOCK_ACLK ticks of Timer0_B, between two
+//  compare flags, which has to be within 1/POST_CLOCK_TOL of SMCLK_HZ.
+//  Value: SMCLK counts, 15616 at FLLN 487.
+//
+//  POST_TEMP: the temperature sensor switched on with the reference, one
+//  conversion of A12 against the 1.5 V reference, ADCSHT_8 (256 MODOSC
+//  cycles, over the sensor's 30 us sample time), converted with the TLV
+//  calibration, Cal_TempC10(): the die within POST_DIE_MIN_DC..MAX_DC.
+//  Value: die temperature in 0.1 degC, signed.
+//
+//  Timing: Timer2_B from SMCLK / 16 (1 us, it belongs to the LED engine,
+//  led.h, which is set up after), run time per stage and in total. Under
+//  POST_BUDGET_US at MCLK 16 MHz:
+//      image   ~6 MCLK cycles per word, ~3 ms for a 16 KB image, 6 ms
+//              at most for the whole 32 KB of program FRAM
+//      ADC     reference settling plus 3 conversions, ~100 us
+//      clock   POST_CLOCK_ACLK REFO ticks, ~1 ms
+//      temp    reference settling plus one long conversion, ~100 us
+//  A run over budget is flagged with POST_OVER_BUDGET like a failed stage.
+//  Timer0_B, Timer1_B and Timer2_B are stopped and cleared afterwards.
+//  __________________________________________________________________________________*/
+#ifndef POST_H_
+#define POST_H_
+
+#define POST_BUDGET_US      8000            // All stages, Post_Run()
+#define POST_CLOCK_ACLK     32              // REFO ticks the SMCLK count runs over
+#define POST_CLOCK_TOL      100             // SMCLK within 1/100
+#define POST_DVCC_MIN_MV    3000            // 3.3 V supply
+#define POST_DVCC_MAX_MV    3600
+#define POST_ADC_LOW        64              // Codes off the rails for DVSS and DVCC
+#define POST_DIE_MIN_DC     (-400)          // Die temperature, 0.1 degC, the part's -40..105 degC
+#define POST_DIE_MAX_DC     1050
+
+// Stages
+#define POST_IMAGE          0
+#define POST_ADC            1
+#define POST_CLOCK          2
+#define POST_TEMP           3
+#define POST_STAGES         4
+
+// Stage status
+#define POST_PASS           0
+#define POST_FAIL           1
+#define POST_SKIPPED        2               // Nothing to check against
+
+// Post_Result(), also the LOG_POST arg: a bit per failed stage
+#define POST_OVER_BUDGET    0x80
+
+typedef struct
+{
+    unsigned char status;                   // POST_PASS/FAIL/SKIPPED
+    unsigned int us;                        // Run time
+    unsigned int value;                     // Stage measurement, see above
+} Post_Stage;
+
+void Post_Run(void);
+void Post_Log(void);
+unsigned char Post_Result(void);
+unsigned int Post_TotalUs(void);
+const Post_Stage *Post_Get(unsigned char stage);
+
+#endif /* POST_H_ */
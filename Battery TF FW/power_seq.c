@@ -0,0 +1,234 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power path sequencer: prebuilt step tables, TB3CCR5 timed port writes.
+//  See power_seq.h for the step order and the busy rule.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "power_seq.h"
+#include "power_trip.h"
+
+#define SEQ_MIN_US          2               // Compare must land after the TB3CCR5 write
+
+static Seq_Transition Seq_Main;                 // Built by Seq_Apply()
+static Seq_Transition Seq_TripT;                // Built by Seq_SetTrip(), run by the trip ISR
+static const Seq_Transition *Seq_Run;           // Transition the ISR steps through
+static unsigned char Seq_Pos;                   // Next step of Seq_Run
+static volatile unsigned char Seq_Active;       // Steps or the settle time left
+static unsigned int Seq_PerUs;                  // TB3 counts per us
+static unsigned int Seq_DeadUs;
+static unsigned int Seq_OverlapUs;
+static unsigned int Seq_Dead;                   // TB3 counts
+static unsigned int Seq_Overlap;                // TB3 counts
+static unsigned char Seq_TripP4;
+static unsigned char Seq_TripP5;
+static unsigned char Seq_TripP6;
+
+// Append a step, or merge it into the last one when it needs no wait
+static void Seq_Add(Seq_Transition *t, unsigned int counts,
+                    unsigned char p4set, unsigned char p4clr,
+                    unsigned char p5set, unsigned char p5clr,
+                    unsigned char p6set, unsigned char p6clr)
+{
+    Seq_Step *s;
+
+    if(!(p4set | p4clr | p5set | p5clr | p6set | p6clr))
+        return;
+    if(t->count != 0 && counts == 0)
+    {
+        s = &t->step[t->count - 1];
+    }
+    else
+    {
+        s = &t->step[t->count++];
+        s->counts = counts;
+        s->p4set = 0;
+        s->p4clr = 0;
+        s->p5set = 0;
+        s->p5clr = 0;
+        s->p6set = 0;
+        s->p6clr = 0;
+    }
+    s->p4set |= p4set;
+    s->p4clr |= p4clr;
+    s->p5set |= p5set;
+    s->p5clr |= p5clr;
+    s->p6set |= p6set;
+    s->p6clr |= p6clr;
+}
+
+// held6: DisChg pins on their timer output with P6OUT low (ir_test.h),
+// cut in the break step when a path is made, left alone otherwise
+static void Seq_Build(Seq_Transition *t,
+                      unsigned char old4, unsigned char old5, unsigned char old6,
+                      unsigned char new4, unsigned char new5, unsigned char new6,
+                      unsigned char held6)
+{
+    unsigned char brk5 = old5 & ~new5;
+    unsigned char brk6 = old6 & ~new6;
+    unsigned char mk5 = new5 & ~old5;
+    unsigned char mk6 = new6 & ~old6;
+
+    if(mk5 | mk6)
+        brk6 |= held6;
+    t->count = 0;
+    Seq_Add(t, 0, new4 & ~old4, 0, 0, 0, 0, 0);                             // 1. VBAT on
+    Seq_Add(t, t->count ? Seq_Overlap : 0, 0, 0, 0, brk5, 0, brk6);         // 2. paths off
+    Seq_Add(t, (brk5 | brk6) ? Seq_Dead : 0, 0, 0, mk5, 0, mk6, 0);         // 3. paths on
+    Seq_Add(t, (mk5 | mk6) ? Seq_Overlap : 0, 0, old4 & ~new4, 0, 0, 0, 0); // 4. VBAT off
+}
+
+static void Seq_Write(const Seq_Step *s)
+{
+    P4OUT = (P4OUT | s->p4set) & ~s->p4clr;
+    P5OUT = (P5OUT | s->p5set) & ~s->p5clr;
+    P6OUT = (P6OUT | s->p6set) & ~s->p6clr;
+    P6SEL0 &= ~s->p6clr;                        // A regulated DisChg back to P6OUT, low (discharge.h)
+}
+
+// Interrupts off. The first step runs now when idle (or when forced), one
+// dead time from now otherwise.
+static void Seq_Start(const Seq_Transition *t, unsigned char now)
+{
+    if(t->count == 0 && !Seq_Active)
+        return;
+    Seq_Run = t;
+    Seq_Pos = 0;
+    if(t->count != 0 && (now || !Seq_Active))
+    {
+        Seq_Write(&t->step[0]);                     // Before the clock switch, on the trip path too
+        Seq_Pos = 1;
+    }
+    Trip_ClockHold(TRIP_HOLD_SEQ);                  // TB3 in us before it is read
+    if(Seq_Pos)
+        TB3CCR5 = TB3R + (t->count > 1 ? t->step[1].counts : Seq_Dead);
+    else
+        TB3CCR5 = TB3R + Seq_Dead;
+    Seq_Active = 1;
+    TB3CCTL5 = CCIE;                                // Compare mode, flag cleared
+}
+
+static void Seq_Rebuild(void)
+{
+    unsigned int us;
+
+    us = Seq_DeadUs < SEQ_MIN_US ? SEQ_MIN_US : Seq_DeadUs;
+    Seq_Dead = us * Seq_PerUs;
+    us = Seq_OverlapUs < SEQ_MIN_US ? SEQ_MIN_US : Seq_OverlapUs;
+    Seq_Overlap = us * Seq_PerUs;
+    Seq_Build(&Seq_TripT, 0, Seq_TripP5, Seq_TripP6, Seq_TripP4, 0, 0, 0);
+}
+
+void Seq_Init(void)
+{
+    TB3CCTL5 = 0;
+    Seq_Active = 0;
+    Seq_Main.count = 0;
+    Seq_Run = &Seq_Main;
+    Seq_Pos = 0;
+    Seq_PerUs = 1;
+    Seq_DeadUs = SEQ_DEAD_US;
+    Seq_OverlapUs = SEQ_OVERLAP_US;
+    Seq_TripP4 = SEQ_P4;                            // Enable VBat on fault
+    Seq_TripP5 = SEQ_P5;                            // Disable charge on fault
+    Seq_TripP6 = SEQ_P6;                            // Disable discharge on fault
+    Seq_Rebuild();
+}
+
+// Timer3_B clock changed. A step already waiting gets one dead time on the
+// new clock; the rest of its transition keeps the counts it was built with.
+void Seq_SetClock(unsigned int countsPerUs)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    Seq_PerUs = countsPerUs;
+    Seq_Rebuild();
+    if(TB3CCTL5 & CCIE)
+        TB3CCR5 = TB3R + Seq_Dead;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Used by the transitions built from now on
+void Seq_SetTiming(unsigned int deadUs, unsigned int overlapUs)
+{
+    unsigned int sr = __get_SR_register();
+
+    if(deadUs > SEQ_MAX_US)
+        deadUs = SEQ_MAX_US;
+    if(overlapUs > SEQ_MAX_US)
+        overlapUs = SEQ_MAX_US;
+    __disable_interrupt();
+    Seq_DeadUs = deadUs;
+    Seq_OverlapUs = overlapUs;
+    Seq_Rebuild();
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Pins the trip transition drives: VBAT on, then charge and discharge off
+void Seq_SetTrip(unsigned char p4set, unsigned char p5clr, unsigned char p6clr)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    Seq_TripP4 = p4set & SEQ_P4;
+    Seq_TripP5 = p5clr & SEQ_P5;
+    Seq_TripP6 = p6clr & SEQ_P6;
+    Seq_Build(&Seq_TripT, 0, Seq_TripP5, Seq_TripP6, Seq_TripP4, 0, 0, 0);
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Move the outputs to the given port images (SEQ_P4/P5/P6 bits)
+void Seq_Apply(unsigned char p4, unsigned char p5, unsigned char p6)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    Seq_Build(&Seq_Main, P4OUT & SEQ_P4, P5OUT & SEQ_P5, P6OUT & SEQ_P6,
+              p4 & SEQ_P4, p5 & SEQ_P5, p6 & SEQ_P6, P6SEL0 & ~P6OUT & SEQ_P6);
+    Seq_Start(&Seq_Main, 0);
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Trip ISR: first step of the trip transition now
+void Seq_Trip(void)
+{
+    Seq_Start(&Seq_TripT, 1);
+}
+
+// TB3CCR5 compare, from the Timer3_B1 ISR
+void Seq_Next(void)
+{
+    const Seq_Transition *t = Seq_Run;
+    unsigned char pos = Seq_Pos;
+
+    if(pos < t->count)
+    {
+        Seq_Write(&t->step[pos++]);
+        TB3CCR5 += pos < t->count ? t->step[pos].counts : Seq_Dead;
+        Seq_Pos = pos;
+    }
+    else
+    {
+        TB3CCTL5 = 0;                               // Settled
+        Seq_Active = 0;
+        Trip_ClockRelease(TRIP_HOLD_SEQ);
+    }
+}
+
+// Drop the steps left, the pins stay as they are
+void Seq_Abort(void)
+{
+    TB3CCTL5 = 0;
+    Seq_Active = 0;
+    Trip_ClockRelease(TRIP_HOLD_SEQ);
+}
+
+unsigned char Seq_Busy(void)
+{
+    return Seq_Active;
+}
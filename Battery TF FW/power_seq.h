@@ -0,0 +1,80 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power path sequencer: ordered, timed switching of the battery outputs
+//  VBAT1_OFF/VBAT2_OFF (P4), ChrgEn1/ChrgEn2 (P5) and DisChg1/DisChg2 (P6).
+//
+//  Every change of those outputs is one transition of up to four steps,
+//  make-before-break on the load path and break-before-make between the
+//  charge and discharge paths:
+//      1. VBAT on              the battery picks up the load first
+//         overlap
+//      2. ChrgEn/DisChg off
+//         dead time
+//      3. ChrgEn/DisChg on     never together with the other path
+//         overlap
+//      4. VBAT off             the load is let go of last
+//  Steps with nothing to switch are dropped, and a step that needs no
+//  wait before it is merged into the one before. Both channels share the
+//  steps, so one transition covers every pin that changes. A DisChg pin
+//  the discharge regulator runs from its TB3 output (discharge.h) goes
+//  back to P6OUT in the step that clears it. One pulsed from its TB3
+//  output with P6OUT low (ir_test.h) counts as on when a transition
+//  switches a path on, and is cut in its break step.
+//
+//  Transitions are built in the main loop (Seq_Apply()) as a table of
+//  steps, each step set/clear masks for the three ports and the compare
+//  counts to wait before it. The first step is written straight away, the
+//  rest from the TB3CCR5 compare ISR, which only writes ports and adds the
+//  next count to TB3CCR5. Timer3_B counts 1 us (power_trip.h), so dead
+//  time and overlap are set in us, SEQ_MAX_US at most (Seq_SetTiming()).
+//
+//  The 12 V trip transition is prebuilt as well (Seq_SetTrip(), from the
+//  state machine's rail-lost outputs). The trip ISR runs its first step
+//  itself, VBAT on, so the switchover latency is unchanged, and the charge
+//  and discharge paths are cut one overlap later.
+//
+//  A new transition replaces one that is still running and starts from
+//  the pins as they are. While a transition runs, and for one dead time
+//  after its last step, the sequencer is busy; a transition that starts
+//  while it is busy waits one dead time before its first step, so a path
+//  that was just cut is never followed by the other one within the dead
+//  time. Only the trip transition starts at once.
+//  __________________________________________________________________________________*/
+#ifndef POWER_SEQ_H_
+#define POWER_SEQ_H_
+
+#define SEQ_STEPS           4
+#define SEQ_DEAD_US         200             // Default charge/discharge break-before-make
+#define SEQ_OVERLAP_US      100             // Default VBAT make-before-break
+#define SEQ_MAX_US          4000            // Fits TB3CCR5 at 16 counts per us
+
+#define SEQ_P4              (VBAT1_OFF + VBAT2_OFF)
+#define SEQ_P5              (ChrgEn1 + ChrgEn2)
+#define SEQ_P6              (DisChg1 + DisChg2)
+
+typedef struct
+{
+    unsigned char p4set, p4clr;
+    unsigned char p5set, p5clr;
+    unsigned char p6set, p6clr;
+    unsigned int counts;                    // Wait before this step, TB3 counts
+} Seq_Step;
+
+typedef struct
+{
+    Seq_Step step[SEQ_STEPS];
+    unsigned char count;
+} Seq_Transition;
+
+void Seq_Init(void);
+void Seq_SetClock(unsigned int countsPerUs);
+void Seq_SetTiming(unsigned int deadUs, unsigned int overlapUs);
+void Seq_SetTrip(unsigned char p4set, unsigned char p5clr, unsigned char p6clr);
+void Seq_Apply(unsigned char p4, unsigned char p5, unsigned char p6);
+void Seq_Trip(void);
+void Seq_Next(void);
+void Seq_Abort(void);
+unsigned char Seq_Busy(void);
+
+#endif /* POWER_SEQ_H_ */
@@ -0,0 +1,235 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power trip: n12VFlt capture on TB3.3 and ISR-only switchover.
+//  See power_trip.h for the latency budget and the hysteresis scheme.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "power_trip.h"
+#include "power_seq.h"
+#include "discharge.h"
+#include "ir_test.h"
+#include "capture.h"
+#include "energy.h"
+
+static volatile unsigned char Trip_Good;        // Rail state after hysteresis
+static volatile unsigned char Trip_Measure;     // Measurement mode on
+static unsigned int Trip_RestoreMs;             // Time a rising edge must hold
+static volatile unsigned int Trip_RestoreLeft;  // ms left in the current restore window
+static unsigned int Trip_MsCounts;              // TB3 counts per ms on the current clock
+static volatile unsigned char Trip_Holders;     // TRIP_HOLD_* users with a TB3 edge pending
+static volatile unsigned int Trip_Trips;        // Total fault edges seen
+static volatile unsigned int Trip_Logged;       // Records written in measurement mode
+static volatile Trip_Record Trip_Log[TRIP_LOG_SIZE];
+
+// TB3 clock for the mode and the holders, interrupts off. The counter is
+// only stopped for the switch, not cleared: TB3CCR3 keeps capturing and a
+// pending restore step is re-timed on the new clock.
+static void Trip_Clock(void)
+{
+    unsigned int ctl;
+    unsigned int ex0;
+
+    if(Trip_Measure)
+    {
+        ctl = TBSSEL__SMCLK | MC__CONTINUOUS;
+        ex0 = TBIDEX__1;
+        Trip_MsCounts = (unsigned int)(SMCLK_HZ / 1000);
+    }
+    else if(Trip_Holders)
+    {
+        ctl = TBSSEL__SMCLK | ID__8 | MC__CONTINUOUS;   // SMCLK / 16 = 1 MHz
+        ex0 = TBIDEX__2;
+        Trip_MsCounts = 1000 * TRIP_US_COUNTS;
+    }
+    else
+    {
+        ctl = TBSSEL__ACLK | MC__CONTINUOUS;
+        ex0 = TBIDEX__1;
+        Trip_MsCounts = TRIP_ACLK_MS_COUNTS;
+    }
+    if(Trip_Measure || Trip_Holders)
+        SMCLK_Requests |= CLKREQ_TRIP;
+    else
+        SMCLK_Requests &= ~CLKREQ_TRIP;
+    if((TB3CTL & (TBSSEL | ID | MC)) == ctl && (TB3EX0 & TBIDEX) == ex0)
+        return;                                     // Clock bits only, TBIFG sets on every overflow
+    TB3CTL = ctl & ~MC;
+    TB3EX0 = ex0;
+    TB3CTL = ctl;
+    if(TB3CCTL4 & CCIE)                             // Pending restore step
+        TB3CCR4 = TB3R + Trip_MsCounts;
+}
+
+void Trip_Init(void)
+{
+    P6DIR &= ~n12VFlt;                              // P6.2 input
+    P6SEL0 |= n12VFlt;                              // P6.2 -> TB3.3 (CCI3A)
+
+    Trip_SetHysteresis(TRIP_RESTORE_DELAY_MS);
+    Trip_Good = (P6IN & n12VFlt) ? 1 : 0;
+    Trip_Measure = 0;
+    Trip_Holders = 0;
+    Trip_MsCounts = TRIP_ACLK_MS_COUNTS;
+
+    TB3CCTL3 = CM_3 | CCIS_0 | CAP | CCIE;          // Both edges, CCI3A, async capture
+    TB3EX0 = TBIDEX__1;
+    TB3CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR; // ACLK until an edge is scheduled
+    Seq_SetClock(TRIP_US_COUNTS);
+    Dischg_SetClock(TRIP_US_COUNTS);
+    Ir_SetClock(TRIP_US_COUNTS);
+}
+
+// A module is about to schedule a TB3CCR1/CCR2/CCR5 edge, interrupts off:
+// TB3 goes to SMCLK first, so the counts it reads and adds are in us
+void Trip_ClockHold(unsigned char user)
+{
+    Trip_Holders |= user;
+    Trip_Clock();
+}
+
+// Its edges are done, interrupts off: back to ACLK with the last holder
+void Trip_ClockRelease(unsigned char user)
+{
+    Trip_Holders &= ~user;
+    Trip_Clock();
+}
+
+unsigned char Trip_RailGood(void)
+{
+    return Trip_Good;
+}
+
+void Trip_SetHysteresis(unsigned int restoreDelayMs)
+{
+    if(restoreDelayMs == 0)
+        restoreDelayMs = 1;
+    Trip_RestoreMs = restoreDelayMs;                // Picked up by the next rising edge
+}
+
+unsigned int Trip_Hysteresis(void)
+{
+    return Trip_RestoreMs;
+}
+
+void Trip_SetMeasure(unsigned char enable)
+{
+    __disable_interrupt();
+    Trip_Measure = enable;
+    Trip_Logged = 0;
+    Trip_Clock();
+    if(enable)
+    {
+        Seq_SetClock(TRIP_MEASURE_US_COUNTS);
+        Dischg_SetClock(TRIP_MEASURE_US_COUNTS);
+        Ir_SetClock(TRIP_MEASURE_US_COUNTS);
+    }
+    else
+    {
+        Seq_SetClock(TRIP_US_COUNTS);
+        Dischg_SetClock(TRIP_US_COUNTS);
+        Ir_SetClock(TRIP_US_COUNTS);
+    }
+    __enable_interrupt();
+}
+
+unsigned char Trip_Measuring(void)
+{
+    return Trip_Measure;
+}
+
+unsigned int Trip_Count(void)
+{
+    return Trip_Trips;
+}
+
+unsigned int Trip_LogCount(void)
+{
+    return Trip_Logged;
+}
+
+const volatile Trip_Record *Trip_GetRecord(unsigned int index)
+{
+    return &Trip_Log[index & (TRIP_LOG_SIZE - 1)];
+}
+
+// Timer3_B1 interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER3_B1_VECTOR
+__interrupt void Timer3_B1_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER3_B1_VECTOR))) Timer3_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    unsigned int entry = TB3R;
+    unsigned int held = SMCLK_Requests & CLKREQ_TRIP;
+    unsigned int switched;
+    volatile Trip_Record *rec;
+
+    ENERGY_IRQ(ENERGY_IRQ_TRIP);
+    switch(__even_in_range(TB3IV, TBIV__TBIFG))
+    {
+        case TBIV__TBCCR3:                          // n12VFlt edge
+            if(!(TB3CCTL3 & CCI))                   // Low: 12 V fault, switch now
+            {
+                Seq_Trip();                         // Enable VBat, charge/discharge off after the overlap
+                switched = TB3R;
+                Capture_Trigger(CAPTURE_SRC_RAIL);  // Freeze the IOUT history
+                TB3CCTL4 &= ~CCIE;                  // Cancel a pending restore
+                Trip_Good = 0;
+                Trip_Trips++;
+                Pending_Events |= EVT_TRIP;
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            else
+            {
+                switched = TB3R;
+                if(Trip_Good == 0)                  // High: start the restore hysteresis
+                {
+                    Trip_RestoreLeft = Trip_RestoreMs;
+                    TB3CCR4 = TB3CCR3 + Trip_MsCounts;
+                    TB3CCTL4 = CCIE;
+                }
+            }
+            if(Trip_Measure)
+            {
+                rec = &Trip_Log[Trip_Logged & (TRIP_LOG_SIZE - 1)];
+                rec->switched = switched;
+                rec->entry = entry;
+                rec->edge = TB3CCR3;
+                rec->level = (TB3CCTL3 & CCI) ? 1 : 0;
+                Trip_Logged++;
+            }
+            TB3CCTL3 &= ~COV;                       // Edges closer than the ISR are merged
+            break;
+        case TBIV__TBCCR1:                          // DisChg1 PWM edge
+            Dischg_Edge(0);
+            break;
+        case TBIV__TBCCR2:                          // DisChg2 PWM edge
+            Dischg_Edge(1);
+            break;
+        case TBIV__TBCCR5:                          // Power path sequencer step
+            Seq_Next();
+            break;
+        case TBIV__TBCCR4:                          // 1 ms step of the restore hysteresis
+            if(--Trip_RestoreLeft != 0)
+            {
+                TB3CCR4 += Trip_MsCounts;
+                break;
+            }
+            TB3CCTL4 &= ~CCIE;
+            if(P6IN & n12VFlt)                      // Held high for the whole window
+            {
+                Trip_Good = 1;
+                Pending_Events |= EVT_TRIP;
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            break;
+        default:
+            break;
+    }
+    if((SMCLK_Requests & CLKREQ_TRIP) != held)      // Sleep mode to pick again
+        __bic_SR_register_on_exit(LPM3_bits);
+}
@@ -0,0 +1,85 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Power trip: hardware edge detection on n12VFlt (P6.2) and an ISR-only
+//  switchover from the 12 V rail to the batteries.
+//
+//  P6.2 has no port interrupt and is not routed to eCOMP or the ADC on this
+//  package, but it is the TB3.3 pin. TB3CCR3 runs in capture mode on both
+//  edges of CCI3A. The falling edge (12 V fault) runs the switchover
+//  straight from the Timer3_B1 ISR: the first step of the prebuilt trip
+//  transition of the power path sequencer (power_seq.h), VBAT on, with
+//  charge and discharge cut one overlap later from TB3CCR5. No main loop
+//  involvement.
+//
+//  Timer3_B clock: the capture needs no particular clock, only the timed
+//  edges do. With none pending TB3 counts ACLK, which runs in LPM3, and the
+//  main loop sleeps there. A module that schedules an edge takes a hold
+//  first, Trip_ClockHold(): the sequencer (TB3CCR5, power_seq.h) while it
+//  has steps or settle time left, the regulated discharge (TB3CCR1/CCR2,
+//  discharge.h) while a channel's PWM is engaged, the internal resistance
+//  test (ir_test.h) while its pulse edge is placed. Held, TB3 counts 1 us
+//  (SMCLK / 16), so they time in us, and the trip module holds a
+//  CLKREQ_TRIP request for LPM0. The last Trip_ClockRelease() goes back
+//  to ACLK and drops the request. The switch stops the counter without
+//  clearing it, so the capture runs on across it. Holds from the ADC ISR
+//  come with IOUT running, under its CLKREQ_IOUT; a hold or release from
+//  the Timer3_B1 ISR wakes the main loop to pick its sleep mode again.
+//
+//  Fault to switchover latency:
+//      LPM3 wake-up            ~10 us (0 from LPM0), as the supervisor tick
+//    + interrupt entry         6 MCLK cycles
+//    + TB3IV dispatch, step 1  ~40 MCLK cycles
+//  ~3 us with MCLK at 16 MHz, plus the wake-up when idle. The first step is
+//  written before TB3 switches to SMCLK; the steps after it are timed on
+//  the held clock.
+//
+//  Hysteresis is in time: the trip is immediate, the restore is not. A rising
+//  edge arms TB3CCR4 to step through the restore delay in 1 ms compares; any
+//  falling edge in that window cancels it. The rail is only reported good
+//  again when the line stayed high for the whole delay. On ACLK a step is
+//  TRIP_ACLK_MS_COUNTS, 1.007 ms; a clock switch restarts the step it is in.
+//
+//  Measurement mode clocks Timer3_B from SMCLK undivided, held or not,
+//  under CLKREQ_TRIP. Every trip then records the captured edge time, the
+//  ISR entry time and the time the first step was written, all in SMCLK
+//  counts. Both edges are logged; switched - edge is the switchover latency
+//  of a fault record (level 0). The log wraps after TRIP_LOG_SIZE records.
+//  The host sets the restore delay and the mode and reads the log
+//  (HOST_CMD_TRIP_*, host_link.h).
+//  __________________________________________________________________________________*/
+#ifndef POWER_TRIP_H_
+#define POWER_TRIP_H_
+
+#define TRIP_RESTORE_DELAY_MS   100         // Default restore hysteresis
+#define TRIP_LOG_SIZE           16          // Trip records kept in measurement mode, power of 2
+#define TRIP_US_COUNTS          1           // TB3 counts per us, SMCLK / 16
+#define TRIP_MEASURE_US_COUNTS  (SMCLK_HZ / 1000000UL)  // TB3 counts per us in measurement mode
+#define TRIP_ACLK_MS_COUNTS     ((unsigned int)((ACLK_HZ + 500) / 1000))  // TB3 counts per ms, idle on ACLK
+
+// Trip_ClockHold() users
+#define TRIP_HOLD_SEQ           0x01        // Power path sequencer
+#define TRIP_HOLD_DISCHG        0x02        // Regulated discharge, << channel
+#define TRIP_HOLD_IR            0x08        // Internal resistance pulse edge
+
+typedef struct
+{
+    unsigned int edge;                      // TB3CCR3 capture of the n12VFlt edge
+    unsigned int entry;                     // TB3R at ISR entry
+    unsigned int switched;                  // TB3R after the port writes
+    unsigned char level;                    // n12VFlt level after the edge (0 = fault)
+} Trip_Record;
+
+void Trip_Init(void);
+unsigned char Trip_RailGood(void);
+void Trip_SetHysteresis(unsigned int restoreDelayMs);
+unsigned int Trip_Hysteresis(void);
+void Trip_SetMeasure(unsigned char enable);
+unsigned char Trip_Measuring(void);
+void Trip_ClockHold(unsigned char user);
+void Trip_ClockRelease(unsigned char user);
+unsigned int Trip_Count(void);
+unsigned int Trip_LogCount(void);
+const volatile Trip_Record *Trip_GetRecord(unsigned int index);
+
+#endif /* POWER_TRIP_H_ */
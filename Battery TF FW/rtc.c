@@ -0,0 +1,67 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  RTC: 1 s overflow from ACLK, seconds count for timestamps.
+//  See rtc.h for the clock source.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "rtc.h"
+#include "energy.h"
+
+static volatile unsigned long Rtc_Seconds;
+
+void Rtc_Init(void)
+{
+    Rtc_Seconds = 0;
+
+    // RTC count re-load compare value at 32.
+    // 1024/32768 * 32 = 1 sec.
+    RTCMOD = RTC_TICKS_PER_S - 1;
+    SYSCFG2 |= RTCCKSEL;                            // Select ACLK as RTC clock
+    RTCCTL = RTCSS_1 | RTCSR | RTCPS__1024 | RTCIE; // Source = ACLK = REFO, divided by 1024
+}
+
+unsigned long Rtc_Now(void)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned long s;
+
+    __disable_interrupt();
+    s = Rtc_Seconds;
+    if(sr & GIE)
+        __enable_interrupt();
+    return s;
+}
+
+void Rtc_Set(unsigned long seconds)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    RTCCTL |= RTCSR;                                // Counter back to 0, a full second to the next tick
+    RTCIV;                                          // Drop a tick already pending
+    Rtc_Seconds = seconds;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// RTC interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=RTC_VECTOR
+__interrupt void RTC_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(RTC_VECTOR))) RTC_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    ENERGY_IRQ(ENERGY_IRQ_RTC);
+    switch(__even_in_range(RTCIV,RTCIV_RTCIF))
+    {
+        case  RTCIV_NONE:   break;          // No interrupt
+        case  RTCIV_RTCIF:                  // RTC Overflow
+            Rtc_Seconds++;
+            break;
+        default: break;
+    }
+}
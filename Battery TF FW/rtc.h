@@ -0,0 +1,26 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  RTC: seconds count for the event log timestamps.
+//
+//  The RTC counter runs from ACLK (REFO) / 1024 and overflows at RTCMOD
+//  every second, as in msp430fr235x_RTC_01.c; there is no XT1 crystal on
+//  this board (P2.6/P2.7 are In2/In3), so RTCCKSEL routes ACLK to the RTC
+//  instead (msp430fr235x_RTC_03.c). It keeps counting in LPM3. The ISR
+//  only adds one to the seconds, it never wakes the main loop.
+//
+//  The count starts at 0 on reset; the host sets it to its own clock
+//  (HOST_CMD_RTC_SET, Unix seconds) so log records can be put on a
+//  calendar. A set restarts the second in progress.
+//  __________________________________________________________________________________*/
+#ifndef RTC_H_
+#define RTC_H_
+
+#define RTC_PRESCALE        1024
+#define RTC_TICKS_PER_S     (ACLK_HZ / RTC_PRESCALE)   // 32
+
+void Rtc_Init(void);
+unsigned long Rtc_Now(void);
+void Rtc_Set(unsigned long seconds);
+
+#endif /* RTC_H_ */
@@ -0,0 +1,334 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Smart battery poller: one interrupt driven I2C master per battery on
+//  eUSCI_B0/eUSCI_B1, each with its own read queue.
+//  See sbs.h for the transaction, the schedule and the timeout handling.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "sbs.h"
+#include "supervisor.h"
+#include "energy.h"
+
+// Transaction phase of a bus
+#define SBS_IDLE            0
+#define SBS_COMMAND         1               // addr+W sent, command byte next
+#define SBS_RESTART         2               // Command byte shifting, repeated START next
+#define SBS_READ_LO         3
+#define SBS_READ_HI         4
+#define SBS_DONE            5               // Value stored, waiting for the STOP
+#define SBS_FAIL            6               // NACK, waiting for the STOP
+
+#define SBS_IE              (UCTXIE0 | UCRXIE0 | UCNACKIE | UCSTPIE | UCCLTOIE)
+
+typedef struct
+{
+    volatile unsigned int *ctlw0;
+    volatile unsigned int *txbuf;
+    volatile unsigned int *rxbuf;
+    volatile unsigned int *ie;
+} Sbs_Port;
+
+typedef struct
+{
+    unsigned char queue[SBS_QUEUE_SIZE];    // Register indexes
+    volatile unsigned char head;            // Free running, main loop only
+    volatile unsigned char tail;            // Free running, ISR only once the bus runs
+    volatile unsigned char phase;
+    unsigned char reg;                      // Register being read
+    unsigned char lo;
+    volatile unsigned int queued;           // Mask of registers in the queue
+    volatile unsigned int valid;            // Mask of registers read at least once
+    volatile unsigned int fresh;            // Mask of registers read since Sbs_Fresh()
+    volatile unsigned int errors;           // NACKs and clock low timeouts
+    unsigned int skipped;                   // Reads dropped on a full queue
+    unsigned int value[SBS_REGS];
+    unsigned int period[SBS_REGS];          // Ticks, 0 = not polled
+    unsigned int count[SBS_REGS];           // Ticks left to the next read
+} Sbs_Bus;
+
+static const Sbs_Port Sbs_Ports[SBS_BUSES] =
+{
+    { &UCB0CTLW0, &UCB0TXBUF, &UCB0RXBUF, &UCB0IE },
+    { &UCB1CTLW0, &UCB1TXBUF, &UCB1RXBUF, &UCB1IE }
+};
+
+static const unsigned char Sbs_Command[SBS_REGS] =
+{
+    0x08, 0x09, 0x0A, 0x0B, 0x0D, 0x0F, 0x10, 0x16, 0x17
+};
+
+// Default schedule in SBS_TICK_MS ticks
+static const unsigned int Sbs_DefaultPeriod[SBS_REGS] =
+{
+    10,     // Temperature
+    5,      // Voltage
+    5,      // Current
+    10,     // Average current
+    50,     // Relative state of charge
+    50,     // Remaining capacity
+    600,    // Full charge capacity
+    10,     // Battery status
+    600     // Cycle count
+};
+
+static Sbs_Bus Sbs_Buses[SBS_BUSES];
+
+// Put a bus in reset and back, the eUSCI releases SCL/SDA. Clears UCBxIE.
+static void Sbs_Reset(unsigned char bus)
+{
+    const Sbs_Port *port = &Sbs_Ports[bus];
+
+    *port->ctlw0 |= UCSWRST;
+    *port->ctlw0 &= ~UCSWRST;
+    *port->ie = SBS_IE;
+}
+
+// Start the next queued read on a bus, or leave it idle. Interrupts off or
+// from the bus ISR. Returns 1 when both buses are idle now and the
+// CLKREQ_SBS request was dropped.
+static unsigned char Sbs_Next(unsigned char bus)
+{
+    Sbs_Bus *b = &Sbs_Buses[bus];
+
+    if(b->head == b->tail)
+    {
+        b->phase = SBS_IDLE;
+        if(Sbs_Buses[bus ^ 1].phase != SBS_IDLE)
+            return 0;
+        SMCLK_Requests &= ~CLKREQ_SBS;              // SCL stopped on both buses
+        return 1;
+    }
+    b->reg = b->queue[b->tail & (SBS_QUEUE_SIZE - 1)];
+    b->tail++;
+    b->queued &= ~(1 << b->reg);
+    b->phase = SBS_COMMAND;
+    SMCLK_Requests |= CLKREQ_SBS;                   // SCL from SMCLK
+    *Sbs_Ports[bus].ctlw0 |= UCTR | UCTXSTT;       // START, addr+W
+    return 0;
+}
+
+// Queue a read, start the bus when it is idle
+static void Sbs_Queue(unsigned char bus, unsigned char reg)
+{
+    Sbs_Bus *b = &Sbs_Buses[bus];
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    if(b->queued & (1 << reg))
+    {
+        // Still waiting from an earlier tick
+    }
+    else if((unsigned char)(b->head - b->tail) >= SBS_QUEUE_SIZE)
+    {
+        b->skipped++;
+    }
+    else
+    {
+        b->queue[b->head & (SBS_QUEUE_SIZE - 1)] = reg;
+        b->head++;
+        b->queued |= 1 << reg;
+        if(b->phase == SBS_IDLE)
+            Sbs_Next(bus);
+    }
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Bus ISR body, iv = UCBxIV. Returns 1 when the main loop has to pick its
+// sleep mode again.
+static unsigned char Sbs_Service(unsigned char bus, unsigned int iv)
+{
+    Sbs_Bus *b = &Sbs_Buses[bus];
+    const Sbs_Port *port = &Sbs_Ports[bus];
+
+    switch(iv)
+    {
+        case USCI_I2C_UCNACKIFG:                    // No gauge or command refused
+            *port->ctlw0 |= UCTXSTP;
+            b->errors++;
+            b->phase = SBS_FAIL;
+            break;
+        case USCI_I2C_UCSTPIFG:
+            return Sbs_Next(bus);
+        case USCI_I2C_UCRXIFG0:
+            if(b->phase == SBS_READ_LO)
+            {
+                *port->ctlw0 |= UCTXSTP;            // NACK + STOP after the last byte
+                b->lo = (unsigned char)*port->rxbuf;
+                b->phase = SBS_READ_HI;
+            }
+            else
+            {
+                b->value[b->reg] = b->lo | (*port->rxbuf << 8);
+                b->valid |= 1 << b->reg;
+                b->fresh |= 1 << b->reg;
+                b->phase = SBS_DONE;
+            }
+            break;
+        case USCI_I2C_UCTXIFG0:
+            if(b->phase == SBS_COMMAND)
+            {
+                *port->txbuf = Sbs_Command[b->reg];
+                b->phase = SBS_RESTART;
+            }
+            else if(b->phase == SBS_RESTART)
+            {
+                *port->ctlw0 &= ~UCTR;
+                *port->ctlw0 |= UCTXSTT;            // Repeated START, addr+R
+                b->phase = SBS_READ_LO;
+            }
+            break;
+        case USCI_I2C_UCCLTOIFG:                    // SCL held low past the timeout
+            Sbs_Reset(bus);
+            b->errors++;
+            return Sbs_Next(bus);
+        default:
+            break;
+    }
+    return 0;
+}
+
+void Sbs_Init(void)
+{
+    unsigned char bus;
+    unsigned char reg;
+
+    // Configure I2C pins
+    P1SEL0 |= i2cData1 + i2cClk1;                   // UCB0SDA/UCB0SCL
+    P4SEL0 |= i2cData2 + i2cClk2;                   // UCB1SDA/UCB1SCL
+
+    UCB0CTLW0 = UCSWRST;                            // Put eUSCI in reset
+    UCB0CTLW0 |= UCMODE_3 | UCMST | UCSYNC | UCSSEL__SMCLK;    // I2C master, SMCLK
+    UCB0CTLW1 = UCCLTO_1;                           // ~28 ms clock low timeout
+    UCB0BRW = SBS_BRW;
+    UCB0I2CSA = SBS_ADDRESS;
+
+    UCB1CTLW0 = UCSWRST;
+    UCB1CTLW0 |= UCMODE_3 | UCMST | UCSYNC | UCSSEL__SMCLK;
+    UCB1CTLW1 = UCCLTO_1;
+    UCB1BRW = SBS_BRW;
+    UCB1I2CSA = SBS_ADDRESS;
+
+    for(bus = 0; bus < SBS_BUSES; bus++)
+    {
+        Sbs_Buses[bus].head = 0;
+        Sbs_Buses[bus].tail = 0;
+        Sbs_Buses[bus].phase = SBS_IDLE;
+        Sbs_Buses[bus].queued = 0;
+        Sbs_Buses[bus].valid = 0;
+        Sbs_Buses[bus].fresh = 0;
+        Sbs_Buses[bus].errors = 0;
+        Sbs_Buses[bus].skipped = 0;
+        for(reg = 0; reg < SBS_REGS; reg++)
+        {
+            Sbs_Buses[bus].period[reg] = Sbs_DefaultPeriod[reg];
+            Sbs_Buses[bus].count[reg] = 1;          // Everything on the first tick
+        }
+        Sbs_Reset(bus);                             // Initialize eUSCI
+    }
+
+    Supervisor_SetTimer(SUPERVISOR_TIMER_SBS, SBS_TICK_MS, EVT_SBS_TICK);
+}
+
+// EVT_SBS_TICK: queue the reads that are due on both buses
+void Sbs_Tick(void)
+{
+    unsigned char bus;
+    unsigned char reg;
+    Sbs_Bus *b;
+
+    for(bus = 0; bus < SBS_BUSES; bus++)
+    {
+        b = &Sbs_Buses[bus];
+        for(reg = 0; reg < SBS_REGS; reg++)
+        {
+            if(b->period[reg] == 0)
+                continue;
+            if(--b->count[reg] == 0)
+            {
+                b->count[reg] = b->period[reg];
+                Sbs_Queue(bus, reg);
+            }
+        }
+    }
+}
+
+// Poll a register every ticks * SBS_TICK_MS, 0 = stop polling it
+void Sbs_SetPeriod(unsigned char bus, unsigned char reg, unsigned int ticks)
+{
+    if(bus >= SBS_BUSES || reg >= SBS_REGS)
+        return;
+    Sbs_Buses[bus].period[reg] = ticks;
+    Sbs_Buses[bus].count[reg] = 1;                  // First read on the next tick
+}
+
+// Last value read, meaningful once the register is in Sbs_Valid()
+unsigned int Sbs_Value(unsigned char bus, unsigned char reg)
+{
+    if(reg >= SBS_REGS)
+        return 0;
+    return Sbs_Buses[bus & 1].value[reg];
+}
+
+// 1 when the register was read again since the last call
+unsigned char Sbs_Fresh(unsigned char bus, unsigned char reg)
+{
+    Sbs_Bus *b = &Sbs_Buses[bus & 1];
+    unsigned int mask = 1 << reg;
+    unsigned int sr = __get_SR_register();
+
+    if(!(b->fresh & mask))
+        return 0;
+    __disable_interrupt();
+    b->fresh &= ~mask;
+    if(sr & GIE)
+        __enable_interrupt();
+    return 1;
+}
+
+// Mask of the registers read at least once, bit n = register index n
+unsigned int Sbs_Valid(unsigned char bus)
+{
+    return Sbs_Buses[bus & 1].valid;
+}
+
+unsigned int Sbs_Errors(unsigned char bus)
+{
+    return Sbs_Buses[bus & 1].errors;
+}
+
+unsigned int Sbs_Skipped(unsigned char bus)
+{
+    return Sbs_Buses[bus & 1].skipped;
+}
+
+// USCI_B0 interrupt service routine, battery 1 gauge
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = USCI_B0_VECTOR
+__interrupt void USCI_B0_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(USCI_B0_VECTOR))) USCI_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    ENERGY_IRQ(ENERGY_IRQ_SBS0);
+    if(Sbs_Service(0, __even_in_range(UCB0IV, USCI_I2C_UCBIT9IFG)))
+        __bic_SR_register_on_exit(LPM3_bits);       // LPM3 from here on
+}
+
+// USCI_B1 interrupt service routine, battery 2 gauge
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = USCI_B1_VECTOR
+__interrupt void USCI_B1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(USCI_B1_VECTOR))) USCI_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    ENERGY_IRQ(ENERGY_IRQ_SBS1);
+    if(Sbs_Service(1, __even_in_range(UCB1IV, USCI_I2C_UCBIT9IFG)))
+        __bic_SR_register_on_exit(LPM3_bits);
+}
@@ -0,0 +1,57 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Smart battery poller: SBS word reads from the gauge of each battery,
+//  battery 1 on UCB0 (P1.2/P1.3), battery 2 on UCB1 (P4.6/P4.7).
+//
+//  Each bus is its own I2C master with its own transaction queue and its
+//  own ISR. A transaction (START, addr+W, command, repeated START, addr+R,
+//  two bytes, NACK + STOP) runs entirely in the ISR, and the STOP
+//  interrupt starts the next queued read, so both buses run at the same
+//  time and the main loop never waits on either. A gauge that stretches
+//  the clock only holds up its own bus; past the eUSCI clock low timeout
+//  (~28 ms, UCCLTO_1, the SMBus 25-35 ms window) that bus is reset and
+//  the read is counted as an error.
+//
+//  Schedule: every SBS_TICK_MS (supervisor TB0CCR2) the main loop counts
+//  down a period per battery and register and queues the reads that are
+//  due. Periods are in ticks, set per register with Sbs_SetPeriod(), 0 =
+//  not polled. A register still queued is not queued again, and a read
+//  that finds its queue full is skipped and counted.
+//
+//  100 kHz SCL from SMCLK: a bus takes a CLKREQ_SBS request when it starts
+//  a queued read, and the STOP (or the timeout reset) that leaves both
+//  buses idle drops it and wakes the main loop back into LPM3. With the
+//  default schedule that is a few ms of LPM0 per tick that has reads due.
+//  __________________________________________________________________________________*/
+#ifndef SBS_H_
+#define SBS_H_
+
+#define SBS_ADDRESS         0x0B            // Smart battery, 7-bit
+#define SBS_TICK_MS         100             // Schedule resolution
+#define SBS_QUEUE_SIZE      8               // Reads per bus, power of 2
+#define SBS_BRW             160             // SMCLK / 160 = 100 kHz
+#define SBS_BUSES           2               // Bus n polls battery n + 1
+
+// Polled registers, index into the schedule and the value table
+#define SBS_TEMPERATURE     0               // 0x08, 0.1 K
+#define SBS_VOLTAGE         1               // 0x09, mV
+#define SBS_CURRENT         2               // 0x0A, mA, signed
+#define SBS_AVG_CURRENT     3               // 0x0B, mA, signed
+#define SBS_RSOC            4               // 0x0D, %
+#define SBS_REMAINING       5               // 0x0F, mAh
+#define SBS_FULL_CHARGE     6               // 0x10, mAh
+#define SBS_STATUS          7               // 0x16, BatteryStatus flags
+#define SBS_CYCLES          8               // 0x17
+#define SBS_REGS            9
+
+void Sbs_Init(void);
+void Sbs_Tick(void);
+void Sbs_SetPeriod(unsigned char bus, unsigned char reg, unsigned int ticks);
+unsigned int Sbs_Value(unsigned char bus, unsigned char reg);
+unsigned char Sbs_Fresh(unsigned char bus, unsigned char reg);
+unsigned int Sbs_Valid(unsigned char bus);
+unsigned int Sbs_Errors(unsigned char bus);
+unsigned int Sbs_Skipped(unsigned char bus);
+
+#endif /* SBS_H_ */
@@ -0,0 +1,116 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Shutdown: nPWR_OFF_Int port 2 ISR, FRAM checkpoint, nSWTurnOFFPower.
+//  See shutdown.h for the sequence and the worst-case latency budget.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "shutdown.h"
+#include "iout_sampler.h"
+#include "coulomb.h"
+#include "power_seq.h"
+#include "event_log.h"
+
+#define SHUTDOWN_TICKS_PER_US   (SMCLK_HZ / 8000000UL)
+
+// Statically-initialized variable
+#ifdef __TI_COMPILER_VERSION__
+#pragma PERSISTENT(Shutdown_Saved)
+Shutdown_Record Shutdown_Saved = {0};
+#elif __IAR_SYSTEMS_ICC__
+__persistent Shutdown_Record Shutdown_Saved = {0};
+#elif defined(__GNUC__)
+Shutdown_Record Shutdown_Saved __attribute__((persistent)) = {0};
+#else
+// Port the following variable to an equivalent persistent functionality for the specific compiler being used
+Shutdown_Record Shutdown_Saved = {0};
+#endif
+
+void Shutdown_Init(void)
+{
+    P2OUT |= nSWTurnOFFPower;                       // Released, high
+    P2DIR |= nSWTurnOFFPower;                       // Set P2.3(nSWTurnOFFPower) as output
+
+    P2DIR &= ~nPWR_OFF_Int;                         // P2.4 input
+    P2REN |= nPWR_OFF_Int;                          // Enable Pullup/down resistor
+    P2OUT |= nPWR_OFF_Int;                          // Select Pullup
+    P2IES |= nPWR_OFF_Int;                          // High to low edge
+    P2IFG &= ~nPWR_OFF_Int;                         // IES change may have set the flag
+    P2IE |= nPWR_OFF_Int;                           // P2.4 interrupt enabled
+}
+
+// Safe outputs and FRAM checkpoint, interrupts off. Returns 0 when the
+// sequence ran over SHUTDOWN_BUDGET_US.
+static unsigned char Shutdown_Sequence(unsigned char real)
+{
+    unsigned int ctl = TB2CTL;                      // Borrowed from the LED engine
+    unsigned int r = TB2R;
+    unsigned int us;
+
+    TB2CTL = TBSSEL__SMCLK | ID__8 | MC__CONTINUOUS | TBCLR;    // SMCLK / 8, 0.5 us
+
+    Seq_Abort();                                    // No step may turn a path back on
+    P5OUT &= ~(ChrgEn1 + ChrgEn2);                  // Disable Battery Charge
+    P6OUT &= ~(DisChg1 + DisChg2);                  // Disable test discharge
+    P6SEL0 &= ~(DisChg1 + DisChg2);                 // and its regulating PWM (discharge.h)
+    Iout_Flush();
+    Coulomb_Commit();
+    if(real)
+        Log_Append(LOG_SHUTDOWN, 0);
+
+    us = TB2R / SHUTDOWN_TICKS_PER_US;
+    TB2CTL = MC__STOP;
+    TB2R = r;                                       // LED PWM carries on where it stopped
+    TB2CTL = ctl;
+
+    Shutdown_Saved.lastUs = us;
+    if(us > Shutdown_Saved.worstUs)
+        Shutdown_Saved.worstUs = us;
+    if(real)
+        Shutdown_Saved.count++;
+    if(us > SHUTDOWN_BUDGET_US)
+    {
+        Shutdown_Saved.overruns++;
+        return 0;
+    }
+    return 1;
+}
+
+// Time the sequence without powering off; the caller restores the outputs
+unsigned char Shutdown_Test(void)
+{
+    unsigned int sr = __get_SR_register();
+    unsigned char ok;
+
+    __disable_interrupt();
+    ok = Shutdown_Sequence(0);
+    if(sr & GIE)
+        __enable_interrupt();
+    return ok;
+}
+
+const Shutdown_Record *Shutdown_Stats(void)
+{
+    return &Shutdown_Saved;
+}
+
+// Port 2 interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=PORT2_VECTOR
+__interrupt void Port_2(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(PORT2_VECTOR))) Port_2 (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if(!(P2IFG & nPWR_OFF_Int))
+        return;
+    P2IFG &= ~nPWR_OFF_Int;
+
+    Shutdown_Sequence(1);
+    P2OUT &= ~nSWTurnOFFPower;                      // Request power off
+
+    while(1)
+        __bis_SR_register(LPM4_bits);               // GIE stays clear, wait for the supply to drop
+}
@@ -0,0 +1,56 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Shutdown: graceful power off on nPWR_OFF_Int (P2.4, active low).
+//
+//  The falling edge raises the port 2 interrupt, which wakes the CPU from
+//  LPM0/LPM3 and runs the whole sequence in the ISR, with interrupts off:
+//      1. ChrgEn1/2 and DisChg1/2 low, nothing charges or discharges
+//      2. the IOUT partial block folded into the coulomb counts
+//         (Iout_Flush()), the counts committed to FRAM (Coulomb_Commit())
+//      3. a LOG_SHUTDOWN record in the event log (event_log.h), ~3 us, and
+//         the sequence time recorded in PERSISTENT FRAM
+//      4. nSWTurnOFFPower (P2.3) low, the power controller cuts the supply
+//  and then sleeps in LPM4 with interrupts off until the power is gone.
+//  VBAT1_OFF/VBAT2_OFF are left as they are, the load keeps its battery
+//  until the supply drops.
+//
+//  Worst case from the nPWR_OFF_Int edge to nSWTurnOFFPower low:
+//      LPM3 wake-up                        ~10 us (0 from LPM0)
+//    + longest interrupts off section      ~15 us (coulomb commit copy,
+//                                                  ADC ISR with an integrate)
+//    + interrupt entry                     6 MCLK cycles
+//    + sequence                            measured, SHUTDOWN_BUDGET_US max
+//  SHUTDOWN_LATENCY_US at MCLK 16 MHz, which the supply hold-up has to cover.
+//
+//  The sequence is timed on Timer2_B from SMCLK / 8 (0.5 us resolution),
+//  started on ISR entry. Timer2_B belongs to the LED engine (led.h); its
+//  count is put back afterwards, so a dry run only stalls the LED PWM for
+//  the length of the sequence. Last and worst times are kept in FRAM with the
+//  number of real shutdowns, and every run over SHUTDOWN_BUDGET_US is
+//  counted as an overrun.
+//
+//  Shutdown_Test() runs the same sequence from the main loop with
+//  interrupts off but leaves nSWTurnOFFPower high and returns; the main loop
+//  then puts the outputs back with Power_Select(). It returns 0 when the
+//  run was over budget, which the host reports as HOST_ERR_TIME.
+//  __________________________________________________________________________________*/
+#ifndef SHUTDOWN_H_
+#define SHUTDOWN_H_
+
+#define SHUTDOWN_BUDGET_US      200         // Sequence time, ISR entry to nSWTurnOFFPower
+#define SHUTDOWN_LATENCY_US     (SHUTDOWN_BUDGET_US + 30)   // Edge to nSWTurnOFFPower
+
+typedef struct
+{
+    unsigned int lastUs;                    // Last sequence, real or test
+    unsigned int worstUs;                   // Worst sequence seen
+    unsigned int count;                     // Real shutdowns
+    unsigned int overruns;                  // Sequences over SHUTDOWN_BUDGET_US
+} Shutdown_Record;
+
+void Shutdown_Init(void);
+unsigned char Shutdown_Test(void);
+const Shutdown_Record *Shutdown_Stats(void);
+
+#endif /* SHUTDOWN_H_ */
@@ -0,0 +1,188 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Supervisor: timer paced sampling of the port 6 status inputs.
+//  See supervisor.h for the detection latency budget.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "supervisor.h"
+#include "energy.h"
+#include "capture.h"
+#include "adc.h"
+#include "adc_sched.h"
+
+static volatile unsigned int Supervisor_Stable; // Debounced P6IN | P2IN << 8
+static unsigned int Supervisor_Ct0;             // Vertical counter, bit 0 per input
+static unsigned int Supervisor_Ct1;             // Vertical counter, bit 1 per input
+static volatile unsigned int Supervisor_Fell;   // Edges since Supervisor_Edges()
+static volatile unsigned int Supervisor_Rose;
+static unsigned int Supervisor_Ticks;           // Ticks left in the current second
+static unsigned int Supervisor_TimerCounts[2];  // TB0CCR1/TB0CCR2 increment, ACLK counts
+static unsigned int Supervisor_TimerEvent[2];   // Event posted on each period
+
+void Supervisor_Init(void)
+{
+    // Status inputs: fault lines are active low open drain, pull them up
+    P6DIR &= ~SUPERVISOR_INPUTS;                    // Set status inputs as inputs
+    P6REN |= n12VFlt + nBat1Flt + nBat2Flt;         // Enable Pullup/down resistor
+    P6OUT |= n12VFlt + nBat1Flt + nBat2Flt;         // Select Pullup
+
+    Supervisor_Ticks = SUPERVISOR_TICK_HZ;
+    Supervisor_Stable = P6IN | ((unsigned int)P2IN << 8);
+    Supervisor_Ct0 = 0xFFFF;                        // Every counter at rest
+    Supervisor_Ct1 = 0xFFFF;
+    Supervisor_Fell = 0;
+    Supervisor_Rose = 0;
+
+    TB0CCR0 = SUPERVISOR_PERIOD;
+    TB0CCTL0 = CCIE;                                // TBCCR0 interrupt enabled
+    TB0CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR; // ACLK, continuous mode
+}
+
+// TB0R, free running ACLK counts. It counts asynchronous to MCLK: read
+// until two reads agree
+unsigned int Supervisor_Now(void)
+{
+    unsigned int t;
+
+    do
+        t = TB0R;
+    while(t != TB0R);
+    return t;
+}
+
+// Debounced port 6 status inputs
+unsigned char Supervisor_Inputs(void)
+{
+    return (unsigned char)Supervisor_Stable & SUPERVISOR_INPUTS;
+}
+
+// Debounced SUPERVISOR_MASK inputs, SUPERVISOR_P6()/SUPERVISOR_P2() bits
+unsigned int Supervisor_State(void)
+{
+    return Supervisor_Stable & SUPERVISOR_MASK;
+}
+
+// Edges of the SUPERVISOR_MASK inputs since the last call
+void Supervisor_Edges(unsigned int *fell, unsigned int *rose)
+{
+    unsigned int sr = __get_SR_register();
+
+    __disable_interrupt();
+    *fell = Supervisor_Fell;
+    *rose = Supervisor_Rose;
+    Supervisor_Fell = 0;
+    Supervisor_Rose = 0;
+    if(sr & GIE)
+        __enable_interrupt();
+}
+
+// Periodic event from TB0CCR1 (timer 0) or TB0CCR2 (timer 1), 0 ms = off
+void Supervisor_SetTimer(unsigned char timer, unsigned int ms, unsigned int event)
+{
+    unsigned long period;
+    unsigned int counts;
+    unsigned int ctl = 0;
+
+    if(ms > SUPERVISOR_TIMER_MAX_MS)
+        ms = SUPERVISOR_TIMER_MAX_MS;
+    period = (ACLK_HZ * ms) / 1000;
+    counts = period > 0xFFFF ? 0xFFFF : (unsigned int)period;  // 2000 ms is 65536 counts
+    if(counts != 0)
+        ctl = CCIE;                                 // TBCCRx interrupt enabled
+
+    timer &= 1;
+    Supervisor_TimerCounts[timer] = counts;
+    Supervisor_TimerEvent[timer] = event;
+    if(timer == SUPERVISOR_TIMER_TELEM)
+    {
+        TB0CCR1 = TB0R + counts;
+        TB0CCTL1 = ctl;
+    }
+    else
+    {
+        TB0CCR2 = TB0R + counts;
+        TB0CCTL2 = ctl;
+    }
+}
+
+// Timer0_B0 interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER0_B0_VECTOR
+__interrupt void Timer0_B0_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER0_B0_VECTOR))) Timer0_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    unsigned int sample;
+    unsigned int flip;
+    unsigned int tick = TB0CCR0;
+
+    ENERGY_IRQ(ENERGY_IRQ_TICK);
+    TB0CCR0 = tick + SUPERVISOR_PERIOD;             // Schedule next tick
+
+    // Battery fault, first raw sample low: transient capture trigger
+    sample = P6IN | ((unsigned int)P2IN << 8);
+    flip = Supervisor_Stable & ~sample;
+    if(flip & nBat1Flt)
+        Capture_Trigger(CAPTURE_SRC_BATT1);
+    else if(flip & nBat2Flt)
+        Capture_Trigger(CAPTURE_SRC_BATT2);
+
+    // 2-bit vertical counter: count samples that differ, flip on the 4th
+    flip = Supervisor_Stable ^ sample;
+    Supervisor_Ct0 = ~(Supervisor_Ct0 & flip);
+    Supervisor_Ct1 = Supervisor_Ct0 ^ (Supervisor_Ct1 & flip);
+    flip &= Supervisor_Ct0 & Supervisor_Ct1;
+    if(flip)
+    {
+        Supervisor_Stable ^= flip;
+        flip &= SUPERVISOR_MASK;
+        Supervisor_Fell |= flip & ~Supervisor_Stable;
+        Supervisor_Rose |= flip & Supervisor_Stable;
+        if(flip)
+        {
+            Pending_Events |= EVT_SUPERVISOR;
+            __bic_SR_register_on_exit(LPM3_bits);   // Wake main loop
+        }
+    }
+
+    Sched_Tick(tick);                               // Slow ADC channel releases
+
+    if(--Supervisor_Ticks == 0)                     // One second housekeeping
+    {
+        Supervisor_Ticks = SUPERVISOR_TICK_HZ;
+        Pending_Events |= EVT_SECOND;
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+}
+
+// Timer0_B1 interrupt service routine, TB0CCR1/TB0CCR2 module timers
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER0_B1_VECTOR
+__interrupt void Timer0_B1_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER0_B1_VECTOR))) Timer0_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    ENERGY_IRQ(ENERGY_IRQ_TIMERS);
+    switch(__even_in_range(TB0IV,TBIV__TBIFG))
+    {
+        case TBIV__TBCCR1:
+            TB0CCR1 += Supervisor_TimerCounts[0];
+            Pending_Events |= Supervisor_TimerEvent[0];
+            __bic_SR_register_on_exit(LPM3_bits);
+            break;
+        case TBIV__TBCCR2:
+            TB0CCR2 += Supervisor_TimerCounts[1];
+            Pending_Events |= Supervisor_TimerEvent[1];
+            __bic_SR_register_on_exit(LPM3_bits);
+            break;
+        default:
+            break;
+    }
+}
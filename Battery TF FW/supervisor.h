@@ -0,0 +1,73 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Supervisor: timer paced sampling of the port 6 status inputs.
+//
+//  Timer0_B runs from ACLK in continuous mode and TB0CCR0 fires every
+//  ACLK_HZ / SUPERVISOR_TICK_HZ counts. The ISR samples P6IN and P2IN as
+//  one 16-bit word (P6 in the low byte, P2 in the high byte) and debounces
+//  every bit of it at once with a 2-bit vertical counter: two counter
+//  words hold bit 0 and bit 1 of a per-input counter, an input's debounced
+//  state only flips after SUPERVISOR_DEBOUNCE consecutive samples that
+//  disagree with it, and any agreeing sample resets its counter. That is
+//  ~10 word instructions per tick for all 16 inputs, so adding an input
+//  costs nothing but a mask bit.
+//
+//  Bits that flip are accumulated as falling and rising edges. The main
+//  loop is only woken (EVT_SUPERVISOR) when one of SUPERVISOR_MASK flips,
+//  and collects the edges with Supervisor_Edges(), so a fault that comes
+//  and goes between two main loop passes is still seen as two events.
+//  Watched inputs: n12VFlt, nBat1Flt, nBat2Flt, ACOK1, ACOK2 on port 6 and
+//  nPWR_OFF_Int on P2.4. The 12 V trip (power_trip.h) and the shutdown
+//  (shutdown.h) keep their own edge interrupts; the debounced view of those
+//  pins is for the control logic and the host. The first raw sample of a
+//  battery fault, before the debounce, triggers the transient capture
+//  (capture.h). Between ticks the CPU
+//  sleeps in LPM3 (ACLK only).
+//
+//  Worst-case detection latency for a change on any status input:
+//      debounce                 SUPERVISOR_DEBOUNCE ticks   (40 ms at 100 Hz)
+//    + LPM3 wake-up             ~10 us (DCO/FLL restart, datasheet t_WAKE-UP LPM3)
+//    + ISR and main loop        < 150 MCLK cycles           (~10 us at 16 MHz)
+//  i.e. ~40.02 ms. A pulse shorter than the debounce
+//  time is filtered out.
+//
+//  The same tick also posts EVT_SECOND once a second for the slow
+//  housekeeping in the main loop (timeouts, counters), and releases the
+//  slow ADC channels (Sched_Tick(), adc_sched.h).
+//
+//  TB0R is a free running ACLK time base, Supervisor_Now() reads it for
+//  the ADC scheduler's latencies and the sleep mode residency (energy.h).
+//
+//  Timer0_B is continuous mode so TB0CCR1/TB0CCR2 serve as two more
+//  periodic ACLK timers for other modules (Supervisor_SetTimer()), each
+//  posting its own event:
+//      SUPERVISOR_TIMER_TELEM    TB0CCR1, host link telemetry
+//      SUPERVISOR_TIMER_SBS      TB0CCR2, smart battery poll schedule
+//  __________________________________________________________________________________*/
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#define SUPERVISOR_TICK_HZ  100             // Status input sample rate, fixed: adc_sched.c and
+                                            // host_link.c scale their periods by it at build time
+#define SUPERVISOR_PERIOD   ((unsigned int)(ACLK_HZ / SUPERVISOR_TICK_HZ))   // TB0CCR0 increment
+#define SUPERVISOR_INPUTS   (n12VFlt + nBat1Flt + nBat2Flt + ACOK1 + ACOK2)
+#define SUPERVISOR_DEBOUNCE 4               // Samples, fixed by the 2-bit vertical counter
+
+// Bits of the debounced word
+#define SUPERVISOR_P6(bits) ((unsigned int)(bits))
+#define SUPERVISOR_P2(bits) ((unsigned int)(bits) << 8)
+#define SUPERVISOR_MASK     (SUPERVISOR_P6(SUPERVISOR_INPUTS) + SUPERVISOR_P2(nPWR_OFF_Int))
+
+#define SUPERVISOR_TIMER_TELEM  0           // TB0CCR1
+#define SUPERVISOR_TIMER_SBS    1           // TB0CCR2
+#define SUPERVISOR_TIMER_MAX_MS 2000        // 16 bits of ACLK, the longest period is 65535 counts
+
+void Supervisor_Init(void);
+unsigned int Supervisor_Now(void);
+unsigned char Supervisor_Inputs(void);
+unsigned int Supervisor_State(void);
+void Supervisor_Edges(unsigned int *fell, unsigned int *rose);
+void Supervisor_SetTimer(unsigned char timer, unsigned int ms, unsigned int event);
+
+#endif /* SUPERVISOR_H_ */
@@ -0,0 +1,96 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Thermistors: table driven code to temperature, over-temperature events.
+//  See therm.h for the table format and the sampling path.
+//  __________________________________________________________________________________*/
+#include "BatteryFW_msp430fr2355.h"
+#include "therm.h"
+#include "adc.h"
+#include "adc_sched.h"
+#include "battery_sm.h"
+#include "cal.h"
+
+static int Therm_DC[BATT_CHANNELS];             // Last temperature, 0.1 degC
+static unsigned char Therm_HotFlag[BATT_CHANNELS];
+static unsigned int Therm_Code[BATT_CHANNELS];
+static unsigned int Therm_Done(Sched_Channel *sch);
+
+// One conversion per thermistor, ADCSC trig (IOUT's TB1.1 while it runs)
+static Sched_Channel Therm_Sched[BATT_CHANNELS] =
+{
+    { { ADCSHT_2, ADCSHS_0 | ADCCONSEQ_0 | ADCSSEL_0, ADCRES_2, THERM_INCH1 | ADCSREF_0,
+        1, &Therm_Code[0], 0, 0 }, 0 },
+    { { ADCSHT_2, ADCSHS_0 | ADCCONSEQ_0 | ADCSSEL_0, ADCRES_2, THERM_INCH2 | ADCSREF_0,
+        1, &Therm_Code[1], 0, 0 }, Therm_Done }
+};
+
+void Therm_Init(void)
+{
+    unsigned char ch;
+
+    // Configure ADC A10/A11 pins
+    P5SEL0 |= TH1 + TH2;
+    P5SEL1 |= TH1 + TH2;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        Therm_DC[ch] = 0;
+        Therm_HotFlag[ch] = 0;
+    }
+    Sched_Add(&Therm_Sched[0], SCHED_THERM_MS, SCHED_PHASE_TH1);
+    Sched_Add(&Therm_Sched[1], SCHED_THERM_MS, SCHED_PHASE_TH2);
+}
+
+// ADC ISR, TH2 is converted a tick after TH1
+static unsigned int Therm_Done(Sched_Channel *sch)
+{
+    return EVT_ADC_AUX;
+}
+
+int Therm_Convert(unsigned int code)
+{
+    const int *t = &Therm_Table[(code & 0x0FFF) >> THERM_SHIFT];
+    unsigned int frac = code & (THERM_STEP - 1);
+
+    return t[0] - (int)(((unsigned int)(t[0] - t[1]) * frac + THERM_STEP / 2) >> THERM_SHIFT);
+}
+
+void Therm_Process(void)
+{
+    unsigned char ch;
+    unsigned int code;
+    unsigned char hot;
+
+    for(ch = 0; ch < BATT_CHANNELS; ch++)
+    {
+        code = Therm_Code[ch];
+        Therm_DC[ch] = Therm_Convert(Cal_Code(code));
+
+        if(code < THERM_SHORT_CODE || code > THERM_OPEN_CODE)
+            hot = 1;                                // Fail safe, no charging on a bad sensor
+        else if(Therm_DC[ch] >= THERM_HOT_DC)
+            hot = 1;
+        else if(Therm_DC[ch] < THERM_HOT_CLEAR_DC)
+            hot = 0;
+        else
+            hot = Therm_HotFlag[ch];                // Hysteresis band
+
+        if(hot != Therm_HotFlag[ch])
+        {
+            Therm_HotFlag[ch] = hot;
+            Batt_Request(ch, hot ? BEV_OVERTEMP : BEV_TEMP_OK);
+        }
+    }
+}
+
+// Last temperature of a channel in 0.1 degC
+int Therm_Temp(unsigned char ch)
+{
+    return Therm_DC[ch & 1];
+}
+
+unsigned char Therm_Hot(unsigned char ch)
+{
+    return Therm_HotFlag[ch & 1];
+}
@@ -0,0 +1,49 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Thermistors: TH1 (P5.2/A10) and TH2 (P5.3/A11), one per battery channel.
+//
+//  Both are converted once a second, a tick apart, as channels of the ADC
+//  scheduler (adc_sched.h), which slots them in between IOUT pairs, or
+//  runs them on the software trigger when IOUT sampling is stopped.
+//  EVT_ADC_AUX follows TH2.
+//
+//  ADC code to temperature goes through Therm_Table, a const table in FRAM
+//  generated by therm_table.py (CCS pre-build step) from the Steinhart-Hart
+//  equation. Entry i is the temperature at code i << THERM_SHIFT in 0.1 degC;
+//  the table falls with the code, so
+//      T = t[i] - ((t[i] - t[i+1]) * frac + THERM_STEP / 2) >> THERM_SHIFT
+//  is one 16x16 multiply with a 16-bit result, ~40 MCLK cycles (~2.5 us at
+//  16 MHz) per conversion. No float, no log. Interpolation error is listed
+//  in therm_table.c. The code goes in gain and offset corrected with the
+//  TLV calibration, Cal_Code() (cal.h); the open and short checks are on
+//  the raw code.
+//
+//  A channel above THERM_HOT_DC, or with an open or shorted thermistor, is
+//  reported to its state machine as BEV_OVERTEMP, which stops charging;
+//  BEV_TEMP_OK follows once it is back under THERM_HOT_CLEAR_DC.
+//  __________________________________________________________________________________*/
+#ifndef THERM_H_
+#define THERM_H_
+
+#define THERM_SHIFT         5               // Codes per table step = 1 << THERM_SHIFT, match therm_table.py
+#define THERM_STEP          (1 << THERM_SHIFT)
+#define THERM_TABLE_SIZE    ((4096 >> THERM_SHIFT) + 1)
+
+#define THERM_INCH1         10              // TH1, P5.2 = A10
+#define THERM_INCH2         11              // TH2, P5.3 = A11
+
+#define THERM_HOT_DC        450             // 45.0 degC, stop charging
+#define THERM_HOT_CLEAR_DC  400             // 40.0 degC, charging allowed again
+#define THERM_SHORT_CODE    16              // Below: thermistor shorted
+#define THERM_OPEN_CODE     4080            // Above: thermistor open or missing
+
+extern const int Therm_Table[THERM_TABLE_SIZE];
+
+void Therm_Init(void);
+void Therm_Process(void);
+int Therm_Convert(unsigned int code);
+int Therm_Temp(unsigned char ch);
+unsigned char Therm_Hot(unsigned char ch);
+
+#endif /* THERM_H_ */
@@ -0,0 +1,31 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  GENERATED by therm_table.py, do not edit.
+//
+//  Pull-up 10000 ohm, Steinhart-Hart A=1.009249522e-03 B=2.378405444e-04 C=2.019202697e-07
+//  129 entries, one every 32 codes, 0.1 degC
+//  Worst interpolation error 1.69 degC, 0.09 degC from -20 to 80 degC
+//  __________________________________________________________________________________*/
+#include "therm.h"
+
+const int Therm_Table[THERM_TABLE_SIZE] =
+{
+     1250,  1250,  1250,  1250,  1250,  1250,  1219,  1154,
+     1098,  1050,  1007,   969,   934,   903,   874,   847,
+      822,   798,   776,   755,   735,   716,   698,   681,
+      664,   648,   633,   618,   604,   590,   577,   564,
+      551,   539,   527,   515,   504,   493,   482,   471,
+      460,   450,   440,   430,   420,   411,   401,   392,
+      383,   373,   364,   356,   347,   338,   329,   321,
+      312,   304,   296,   287,   279,   271,   263,   255,
+      247,   239,   231,   223,   215,   207,   199,   191,
+      183,   176,   168,   160,   152,   144,   136,   128,
+      120,   112,   104,    96,    88,    80,    71,    63,
+       55,    46,    38,    29,    20,    11,     2,    -7,
+      -16,   -25,   -35,   -44,   -54,   -64,   -75,   -85,
+      -96,  -107,  -118,  -130,  -142,  -155,  -168,  -181,
+     -195,  -210,  -226,  -242,  -259,  -278,  -298,  -319,
+     -342,  -368,  -398,  -400,  -400,  -400,  -400,  -400,
+     -400
+};
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# Battery Test Fixure MSP430FR2355 Firmware
+# __________________________________________________________________________________
+#
+#  Generates therm_table.c, the ADC code to temperature table used by therm.c.
+#  Run as a CCS pre-build step; the output is only rewritten when it changes.
+#
+#  Divider: THERM_PULLUP_OHM from AVCC to THx, NTC from THx to GND, ADC
+#  referenced to AVCC, so code = 4096 * Rntc / (Rntc + Rpullup).
+#  Entry i holds the Steinhart-Hart temperature at code i << THERM_SHIFT in
+#  0.1 degC, clamped to THERM_MIN_DC..THERM_MAX_DC. The table falls with the
+#  code, and therm.c relies on every step fitting its 16-bit interpolation.
+# __________________________________________________________________________________
+import math
+import os
+import sys
+
+THERM_PULLUP_OHM = 10000.0
+# Steinhart-Hart coefficients, 10k NTC (B25/85 ~ 3950)
+SH_A = 1.009249522e-03
+SH_B = 2.378405444e-04
+SH_C = 2.019202697e-07
+
+ADC_BITS = 12
+THERM_SHIFT = 5                             # Must match therm.h
+THERM_MIN_DC = -400
+THERM_MAX_DC = 1250
+
+FULL = 1 << ADC_BITS
+
+
+def temp_dc(code):
+    if code <= 0:
+        return THERM_MAX_DC
+    if code >= FULL:
+        return THERM_MIN_DC
+    r = THERM_PULLUP_OHM * code / (FULL - code)
+    ln = math.log(r)
+    t = 1.0 / (SH_A + SH_B * ln + SH_C * ln ** 3) - 273.15
+    return max(THERM_MIN_DC, min(THERM_MAX_DC, t * 10.0))
+
+
+def main():
+    entries = (FULL >> THERM_SHIFT) + 1
+    table = [int(round(temp_dc(i << THERM_SHIFT))) for i in range(entries)]
+
+    step = 1 << THERM_SHIFT
+    for i in range(entries - 1):
+        drop = table[i] - table[i + 1]
+        if drop < 0 or drop * (step - 1) + step // 2 > 0xFFFF:
+            sys.exit('therm_table.py: step %d does not fit the interpolation' % i)
+
+    # Worst interpolation error, same arithmetic as Therm_Convert()
+    worst = 0.0
+    worst_band = 0.0
+    for code in range(1, FULL):
+        exact = temp_dc(code)
+        if exact <= THERM_MIN_DC or exact >= THERM_MAX_DC:
+            continue
+        i = code >> THERM_SHIFT
+        frac = code & (step - 1)
+        approx = table[i] - (((table[i] - table[i + 1]) * frac + step // 2) >> THERM_SHIFT)
+        worst = max(worst, abs(approx - exact))
+        if -200 <= exact <= 800:
+            worst_band = max(worst_band, abs(approx - exact))
+
+    lines = []
+    lines.append('/* Battery Test Fixure MSP430FR2355 Firmware')
+    lines.append('// __________________________________________________________________________________')
+    lines.append('//')
+    lines.append('//  GENERATED by therm_table.py, do not edit.')
+    lines.append('//')
+    lines.append('//  Pull-up %d ohm, Steinhart-Hart A=%.9e B=%.9e C=%.9e' % (THERM_PULLUP_OHM, SH_A, SH_B, SH_C))
+    lines.append('//  %d entries, one every %d codes, 0.1 degC' % (entries, step))
+    lines.append('//  Worst interpolation error %.2f degC, %.2f degC from -20 to 80 degC' % (worst / 10.0, worst_band / 10.0))
+    lines.append('//  __________________________________________________________________________________*/')
+    lines.append('#include "therm.h"')
+    lines.append('')
+    lines.append('const int Therm_Table[THERM_TABLE_SIZE] =')
+    lines.append('{')
+    for i in range(0, entries, 8):
+        row = ', '.join('%5d' % t for t in table[i:i + 8])
+        lines.append('    %s%s' % (row, ',' if i + 8 < entries else ''))
+    lines.append('};')
+    text = '\n'.join(lines) + '\n'
+
+    out = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'therm_table.c')
+    try:
+        with open(out) as f:
+            if f.read() == text:
+                return 0
+    except IOError:
+        pass
+    with open(out, 'w') as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,54 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Cycle count benchmark harness, see bench.h.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+volatile Bench_Totals Bench_Result;
+
+static unsigned int Bench_Begin;            // Counter at Bench_Start()
+static unsigned int Bench_Cost;             // Cycles of an empty Bench_Start()/Bench_Stop()
+
+void Bench_Start(void)
+{
+    Bench_Begin = BENCH_TIMER_R;
+}
+
+void Bench_Stop(void)
+{
+    unsigned int end = BENCH_TIMER_R;
+
+    Bench_Result.cycles += (unsigned int)(end - Bench_Begin - Bench_Cost);
+}
+
+void Bench_Units(unsigned int units, unsigned int kind)
+{
+    Bench_Result.units += units;
+    Bench_Result.kind = kind;
+}
+
+// mspdebug stops here (setbreak Bench_Done) and reads Bench_Result
+void __attribute__((noinline)) Bench_Done(void)
+{
+    while(1)
+        __no_operation();
+}
+
+int main(void)
+{
+    WDTCTL = WDTPW | WDTHOLD;                       // Stop WDT
+
+    BENCH_TIMER_CTL = TBSSEL__SMCLK | MC__CONTINOUS | TBCLR;
+
+    Bench_Cost = 0;
+    Bench_Start();
+    Bench_Stop();
+    Bench_Cost = (unsigned int)Bench_Result.cycles;
+
+    Bench_Result.cycles = 0;
+    Bench_Result.units = 0;
+    Bench_Case();
+    Bench_Done();
+    return 0;
+}
@@ -0,0 +1,72 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Cycle count benchmarks: msp430-elf-gcc builds of the hot paths, run in
+//  the mspdebug simulator (make bench, bench.py).
+//
+//  One ELF per case: bench.c plus a case_*.c that defines Bench_Case() and
+//  either includes the TI example under test or links the firmware with
+//  its main() renamed (BENCH_FW in the Makefile). The case calls the code BENCH_CALLS
+//  times between Bench_Start() and Bench_Stop(), and reports the total
+//  cycles and the units (calls, bytes or samples) in Bench_Result, then
+//  bench.c halts at Bench_Done where mspdebug reads the result back.
+//
+//  Cycles come from an MCLK counter: mspdebug's simulated Timer_A at
+//  BENCH_TIMER_BASE, SMCLK (= MCLK in the simulator), continuous mode.
+//  mspdebug only routes the addresses below 0x200 to its simulated
+//  peripherals; everything above, the FR2355 peripherals included, is
+//  plain memory. So a case sets up an ISR's IV, RXBUF or ADCMEM0 value
+//  with an ordinary write before each call, and Bench_Isr() enters the ISR
+//  the way the interrupt does (PC and SR pushed, returns with RETI).
+//  Each call is timed on its own, so it has to take less than 65536
+//  cycles; the cost of timing an empty call is taken off.
+//
+//  The cases are built for the MSP430 CPU (-mcpu=msp430), which is what
+//  the mspdebug simulator executes, not the FR2355's MSP430X: the counts
+//  compare builds with each other, they are not the firmware's exact
+//  cycles on the part.
+//  __________________________________________________________________________________*/
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <msp430.h>
+
+#ifndef BENCH_TIMER_BASE
+#define BENCH_TIMER_BASE    0x01E0          // Free on the FR2355, below mspdebug's 0x200
+#endif
+#define BENCH_TIMER_CTL     (*(volatile unsigned int *)(BENCH_TIMER_BASE + 0x00))
+#define BENCH_TIMER_R       (*(volatile unsigned int *)(BENCH_TIMER_BASE + 0x10))
+
+#define BENCH_CALLS         64
+
+// Units of a result, as bench.py prints them
+#define BENCH_PER_CALL      0
+#define BENCH_PER_BYTE      1
+#define BENCH_PER_SAMPLE    2
+
+typedef struct
+{
+    unsigned long cycles;                   // Total, timing cost taken off
+    unsigned int units;                     // Calls, bytes or samples
+    unsigned int kind;                      // BENCH_PER_*
+} Bench_Totals;
+
+extern volatile Bench_Totals Bench_Result;
+
+void Bench_Case(void);                      // case_*.c
+void Bench_Start(void);
+void Bench_Stop(void);
+void Bench_Units(unsigned int units, unsigned int kind);
+
+// Enter an ISR as the CPU does: return address and SR on the stack, GIE
+// clear, and RETI at the end of the ISR comes back here
+#define Bench_Isr(isr)                                      \
+    __asm__ __volatile__("push #1f\n\t"                     \
+                         "push r2\n\t"                      \
+                         "dint\n\t"                         \
+                         "nop\n\t"                          \
+                         "br #%0\n"                         \
+                         "1:"                               \
+                         : : "i"(isr) : "memory")
+
+#endif /* BENCH_H_ */
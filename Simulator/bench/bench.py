@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# Battery Test Fixure MSP430FR2355 Firmware
+# __________________________________________________________________________________
+#
+#  Runs the cycle count benchmarks (bench.h) in the mspdebug simulator and
+#  compares them with baseline.txt. Called by make bench with the ELF
+#  files; exits 1 when a case is slower than its baseline by more than
+#  --threshold percent, when a case did not run to Bench_Done, or when
+#  baseline.txt or a case's line in it is missing (a case with nothing to
+#  compare against is not a pass).
+#  The decimator cases are also listed per ratio at the end (decim.h),
+#  and --update keeps that table in baseline.txt as comments.
+#
+#      bench.py [--update] [--threshold PCT] build/bench/case_*.elf
+#
+#  --update writes the results as the new baseline, the only run that
+#  passes without one. baseline.txt has one "case cycles unit" line per
+#  case, cycles per unit with one decimal.
+# __________________________________________________________________________________
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+BENCH_TIMER_BASE = 0x01E0                   # Must match bench.h
+UNITS = ("call", "byte", "sample")          # BENCH_PER_*
+MCLK_HZ = 16000000                          # SMCLK_HZ, BatteryFW_msp430fr2355.h
+DECIM_CODES_HZ = 2 * 10000                  # Two channels at IOUT_RATE_HZ (iout_sampler.h)
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.txt")
+
+MD_LINE = re.compile(r"^\s*(?:0x)?[0-9a-fA-F]+:\s+((?:[0-9a-fA-F]{2}\s+)+)")
+
+
+def run_case(mspdebug, elf):
+    cmds = [
+        "prog %s" % elf,
+        "simio add timer bench",
+        "simio config bench base 0x%04x" % BENCH_TIMER_BASE,
+        "setbreak Bench_Done",
+        "run",
+        "md Bench_Result 8",
+    ]
+    out = subprocess.run([mspdebug, "-q", "sim"] + cmds, stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT, universal_newlines=True, timeout=120).stdout
+    data = []
+    for line in out.splitlines():
+        m = MD_LINE.match(line)
+        if m:
+            data += [int(b, 16) for b in m.group(1).split()]
+    if len(data) < 8:
+        sys.stderr.write(out)
+        raise RuntimeError("%s: no Bench_Result" % elf)
+    cycles = data[0] | data[1] << 8 | data[2] << 16 | data[3] << 24
+    units = data[4] | data[5] << 8
+    kind = data[6] | data[7] << 8
+    if units == 0 or kind >= len(UNITS):
+        raise RuntimeError("%s: case did not reach Bench_Done" % elf)
+    return cycles / units, UNITS[kind]
+
+
+def load_baseline():
+    base = {}
+    with open(BASELINE) as f:
+        for line in f:
+            fields = line.split("#")[0].split()
+            if len(fields) == 3:
+                base[fields[0]] = (float(fields[1]), fields[2])
+    return base
+
+
+# The decimator cases, one per ratio (case_decim4 .. case_decim256): cycles
+# per input code, per output and the MCLK share of both IOUT channels at
+# the default pair rate (decim.h). Printed, and kept in baseline.txt as
+# comment lines by --update.
+def decim_table(base):
+    ratios = sorted(int(name[5:]) for name in base
+                    if name.startswith("decim") and name[5:].isdigit())
+    if not ratios:
+        return []
+    lines = ["%-8s %5s %10s %10s %8s" % ("ratio", "bits", "cyc/code", "cyc/out", "MCLK")]
+    for r in ratios:
+        cpu = base["decim%d" % r][0]
+        shift = r.bit_length() - 1
+        lines.append("%-8s %5d %10.1f %10.1f %7.2f%%" % ("%dx" % r, 12 + shift // 2, cpu, cpu * r,
+                                                         100.0 * cpu * DECIM_CODES_HZ / MCLK_HZ))
+    return lines
+
+
+def main():
+    ap = argparse.ArgumentParser(description="mspdebug cycle count benchmarks")
+    ap.add_argument("elf", nargs="+")
+    ap.add_argument("--update", action="store_true", help="write the results to baseline.txt")
+    ap.add_argument("--threshold", type=float, default=5.0, help="allowed slowdown, percent")
+    ap.add_argument("--mspdebug", default=os.environ.get("MSPDEBUG", "mspdebug"))
+    args = ap.parse_args()
+
+    if os.path.exists(BASELINE):
+        base = load_baseline()
+    elif args.update:
+        base = {}
+    else:
+        sys.stderr.write("%s: missing, make bench-update writes it\n" % BASELINE)
+        return 1
+    results = {}
+    failed = 0
+    print("%-16s %10s %10s %8s" % ("case", "cycles", "baseline", "change"))
+    for elf in args.elf:
+        name = os.path.splitext(os.path.basename(elf))[0]
+        name = name[5:] if name.startswith("case_") else name
+        try:
+            cpu, unit = run_case(args.mspdebug, elf)
+        except (RuntimeError, subprocess.TimeoutExpired) as e:
+            print("%-16s %s" % (name, e))
+            failed += 1
+            continue
+        results[name] = (cpu, unit)
+        line = "%-16s %10.1f" % (name, cpu)
+        if name in base and base[name][1] == unit and base[name][0] > 0:
+            change = 100.0 * (cpu - base[name][0]) / base[name][0]
+            line += " %10.1f %+7.1f%%  /%s" % (base[name][0], change, unit)
+            if change > args.threshold:
+                line += "  REGRESSION"
+                failed += 1
+        else:
+            line += " %10s %8s  /%s" % ("-", "", unit)
+            if not args.update:
+                line += "  NO BASELINE"
+                failed += 1
+        print(line)
+    table = decim_table(results)
+    if table:
+        print()
+        print("\n".join(table))
+
+    if args.update:
+        base.update(results)
+        with open(BASELINE, "w") as f:
+            f.write("# Cycles per unit, written by bench.py --update\n")
+            for name in sorted(base):
+                f.write("%-16s %8.1f %s\n" % (name, base[name][0], base[name][1]))
+            table = decim_table(base)
+            if table:
+                f.write("#\n# Decimator per ratio (decim.h)\n")
+                f.writelines("# %s\n" % line for line in table)
+        return 1 if len(results) < len(args.elf) else 0
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,28 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: ADC ISR of msp430fr235x_adc12_10.c, one ADCIFG0 per sample
+//  of the A2..A0 sequence, cycles per sample.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_adc12_10.c"
+#undef main
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        if(i == 0xFF || n % 3 == 0)
+            i = 2;                                  // Start of a sequence, as main() does
+        ADCMEM0 = 0x0800 + n;
+        ADCIV = ADCIV_ADCIFG;
+        Bench_Start();
+        Bench_Isr(ADC_ISR);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_SAMPLE);
+}
@@ -0,0 +1,26 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: ADC ISR of msp430fr235x_adc12_11.c, the threshold compare
+//  on every TB1.1 triggered sample, both sides of it, cycles per sample.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_adc12_11.c"
+#undef main
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        ADCMEM0 = (n & 1) ? 0x0200 : 0x0A00;        // Below and above 0x555
+        ADCIV = ADCIV_ADCIFG;
+        Bench_Start();
+        Bench_Isr(ADC_ISR);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_SAMPLE);
+}
@@ -0,0 +1,31 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: ADC ISR of msp430fr235x_adc12_16.c, the temperature sensor
+//  code to degC and degF in float against the TLV points, cycles per
+//  sample. The TLV is plain memory here, so the case writes the two
+//  calibration words first. Against case_cal.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_adc12_16.c"
+#undef main
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    *(volatile unsigned int *)0x1A1A = 2185;        // CALADC_15V_30C
+    *(volatile unsigned int *)0x1A1C = 2715;        // CALADC_15V_85C, the 105 degC point here
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        ADCMEM0 = 2000 + 8 * n;                     // -1 to 66 degC
+        ADCIV = ADCIV_ADCIFG;
+        Bench_Start();
+        Bench_Isr(ADC_ISR);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_SAMPLE);
+}
@@ -0,0 +1,26 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: ADC ISR of msp430fr235x_adc12_21.c, the window comparator
+//  HI, LO and IN interrupts in turn, cycles per sample.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_adc12_21.c"
+#undef main
+
+void Bench_Case(void)
+{
+    static const unsigned int iv[3] = { ADCIV_ADCHIIFG, ADCIV_ADCLOIFG, ADCIV_ADCINIFG };
+    unsigned int n;
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        ADCIV = iv[n % 3];
+        Bench_Start();
+        Bench_Isr(ADC_ISR);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_SAMPLE);
+}
@@ -0,0 +1,33 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: Cal_TempC10(), the temperature sensor code to 0.1 degC on
+//  MPY32 with the Q16 slope Cal_Init() worked out from the TLV, linked
+//  against the whole firmware (main renamed). The same codes and TLV
+//  points as case_adc12_16, cycles per call.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+#include "cal.h"
+
+volatile int Bench_Temp;
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    // The TLV is plain memory here: ADC gain, offset and reference nominal
+    *(volatile unsigned int *)CAL_TLV_GAIN = 0x8000;
+    *(volatile unsigned int *)CAL_TLV_OFFSET = 0;
+    *(volatile unsigned int *)CAL_TLV_T30 = 2185;
+    *(volatile unsigned int *)CAL_TLV_THOT = 2715;
+    *(volatile unsigned int *)CAL_TLV_REF15 = 0x8000;
+    Cal_Init();
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        Bench_Start();
+        Bench_Temp = Cal_TempC10(2000 + 8 * n);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_CALL);
+}
@@ -0,0 +1,41 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: Charge_Second(), the once a second charge termination pass
+//  over both channels, linked against the whole firmware (main renamed).
+//  Both batteries charge from a good rail with their ACOK high, the IOUT
+//  means and the temperatures stay put, so no charge ends and every call
+//  runs every check: cycles per call, both channels.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+#include "BatteryFW_msp430fr2355.h"
+#include "charge.h"
+#include "supervisor.h"
+#include "power_trip.h"
+#include "battery_sm.h"
+#include "iout_sampler.h"
+#include "therm.h"
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    // Port inputs are plain memory in the simulator: faults released, rail good, both ACOK
+    P6IN = n12VFlt + nBat1Flt + nBat2Flt + ACOK1 + ACOK2;
+    P2IN = nPWR_OFF_Int;
+
+    Supervisor_Init();
+    Trip_Init();
+    Batt_Init(Supervisor_Inputs(), Trip_RailGood());
+    Iout_Init();
+    Therm_Init();
+    Charge_Init();
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        Bench_Start();
+        Charge_Second();
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_CALL);
+}
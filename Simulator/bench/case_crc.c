@@ -0,0 +1,26 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: CCITT_Update() of msp430fr235x_CRC.c, the software CRC the
+//  example checks the CRC module against, cycles per byte.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_CRC.c"
+#undef main
+
+void Bench_Case(void)
+{
+    unsigned int crc = CRC_Init;
+    unsigned int n;
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        Bench_Start();
+        crc = CCITT_Update(crc, CRC_Input[n & 15] & 0x00FF);
+        Bench_Stop();
+    }
+    SW_Results = crc;                               // Keeps the calls
+    Bench_Units(BENCH_CALLS, BENCH_PER_BYTE);
+}
@@ -0,0 +1,52 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: Decim_Add(), the oversampling decimator the IOUT sampler runs
+//  on every conversion (decim.h). Built once per ratio, BENCH_RATIO from
+//  the Makefile (case_decim4 .. case_decim256). Each timed call feeds one
+//  whole output, R codes with the dump at the end; the codes vary so the
+//  carry into the upper word of the sum is taken: cycles per input code,
+//  the dump included.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+#include "decim.h"
+
+#ifndef BENCH_RATIO
+#define BENCH_RATIO         64
+#endif
+
+static Decim_Filter Bench_Filter;
+volatile unsigned int Bench_Out;
+
+static unsigned char Bench_Shift(unsigned int ratio)
+{
+    unsigned char shift = 0;
+
+    while(ratio > 1)
+    {
+        ratio >>= 1;
+        shift++;
+    }
+    return shift;
+}
+
+void Bench_Case(void)
+{
+    unsigned int n;
+    unsigned int i;
+    unsigned int code = 0x0FF0;
+
+    Decim_Init(&Bench_Filter, Bench_Shift(BENCH_RATIO));
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        Bench_Start();
+        for(i = 0; i < BENCH_RATIO; i++)
+        {
+            Decim_Add(&Bench_Filter, code);
+            code ^= 0x0A5A;
+        }
+        Bench_Stop();
+        Bench_Out = Bench_Filter.out;               // Keeps the calls
+    }
+    Bench_Units(BENCH_CALLS * BENCH_RATIO, BENCH_PER_SAMPLE);
+}
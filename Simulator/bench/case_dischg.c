@@ -0,0 +1,48 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: the regulated discharge loop pass, the Dischg_Pair() call of
+//  every DISCHG_LOOP_PAIRS-th IOUT pair that runs the PI of both channels,
+//  linked against the whole firmware (main renamed). Both channels are in
+//  constant current with their DisChg pin on, taken over on the first
+//  pass; the other pairs of each window only add up and are not timed.
+//  The IOUT codes swing from pass to pass so the duty moves and every
+//  clamp and the settling test run: cycles per loop pass, both channels,
+//  on top of the ADC ISR.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+#include "BatteryFW_msp430fr2355.h"
+#include "discharge.h"
+#include "power_seq.h"
+#include "power_trip.h"
+#include "iout_sampler.h"
+
+void Bench_Case(void)
+{
+    unsigned int n;
+    unsigned char pair;
+    unsigned int code;
+
+    Seq_Init();
+    Dischg_Init();
+    Trip_Init();
+    Iout_Init();
+    Iout_Start(IOUT_RATE_HZ);
+    P6OUT |= DisChg1 + DisChg2;                     // Paths on, as the sequencer leaves them
+    Dischg_Set(0, DISCHG_MODE_CC, 1000, DISCHG_KP, DISCHG_KI);
+    Dischg_Set(1, DISCHG_MODE_CC, 2000, DISCHG_KP, DISCHG_KI);
+
+    for(pair = 0; pair < DISCHG_LOOP_PAIRS; pair++)
+        Dischg_Pair(0, 0);                          // Take both pins over
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        code = (n & 1) ? 0x300 : 0x900;
+        for(pair = 1; pair < DISCHG_LOOP_PAIRS; pair++)
+            Dischg_Pair(code, code);
+        Bench_Start();
+        Dischg_Pair(code, code);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_CALL);
+}
@@ -0,0 +1,43 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: Power_Select(), the main loop body after a supervisor or
+//  trip event, linked against the whole firmware (main renamed). The
+//  modules it reads are brought up by their _Init() functions, without
+//  Init_Clock(), which polls the FLL; the inputs do not change between
+//  calls, so this is the steady state cost, cycles per call.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+#include "event_log.h"
+#include "supervisor.h"
+#include "power_seq.h"
+#include "power_trip.h"
+#include "battery_sm.h"
+#include "coulomb.h"
+#include "iout_sampler.h"
+#include "led.h"
+
+void Power_Select(void);                    // BatteryFW_msp430fr2355.c
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    Led_Init();
+    Log_Init();
+    Supervisor_Init();
+    Seq_Init();
+    Trip_Init();
+    Batt_Init(Supervisor_Inputs(), Trip_RailGood());
+    Iout_Init();
+    Coulomb_Init();
+    Power_Select();                         // First call logs the power-on state
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        Bench_Start();
+        Power_Select();
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_CALL);
+}
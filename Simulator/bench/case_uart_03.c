@@ -0,0 +1,26 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Benchmark: USCI_A0 ISR of msp430fr235x_euscia0_uart_03.c, the RX of the
+//  expected byte (a wrong one traps), cycles per byte.
+//  __________________________________________________________________________________*/
+#include "bench.h"
+
+#define main Bench_ExampleMain
+#include "../../Example Code/C/msp430fr235x_euscia0_uart_03.c"
+#undef main
+
+void Bench_Case(void)
+{
+    unsigned int n;
+
+    for(n = 0; n < BENCH_CALLS; n++)
+    {
+        UCA0RXBUF = TXData;
+        UCA0IV = USCI_UART_UCRXIFG;
+        Bench_Start();
+        Bench_Isr(USCI_A0_ISR);
+        Bench_Stop();
+    }
+    Bench_Units(BENCH_CALLS, BENCH_PER_BYTE);
+}
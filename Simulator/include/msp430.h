@@ -0,0 +1,854 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: msp430.h for the Linux build (see ../sim.h).
+//
+//  Same register, bit and vector names as the TI header for the modeled
+//  peripherals. Registers are plain volatile globals, so they can be read,
+//  written and have their address taken like the real ones; the simulator
+//  picks the writes up at the next sync point (sim.h). A few registers are
+//  accessors instead:
+//      xxIV, SYSRSTIV          the read clears the flag it returns
+//      CRCDI/CRCDIRB, CRCINIRES every write feeds the CRC, the read returns it
+//      RESx, RESLO/RESHI       computed from the operands when read
+//      SYSCFG0                 the FRAM write protection changes on the write
+//      TLV_WORD(addr)          a word of the device descriptor (TLVMEM), which
+//                              has no address here; the firmware's fallback
+//                              reads it through a pointer (cal.h)
+//
+//  With SIM_FIRMWARE (firmware and example builds) int is 16 bits, as on
+//  the MSP430, so unsigned int counters wrap at 0xFFFF and structs keep
+//  their layout. long has no such shim (unsigned long can not be a macro),
+//  so it has to be 32 bits from the compiler: the Makefile builds with
+//  -m32, and the build fails here without it unless SIM_LONG64 says a
+//  64-bit long is accepted. main() is renamed, the simulator owns the host
+//  main().
+//  __________________________________________________________________________________*/
+#ifndef SIM_MSP430_H_
+#define SIM_MSP430_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define __MSP430FR2355__    1
+
+// Bits
+#define BIT0                (0x0001)
+#define BIT1                (0x0002)
+#define BIT2                (0x0004)
+#define BIT3                (0x0008)
+#define BIT4                (0x0010)
+#define BIT5                (0x0020)
+#define BIT6                (0x0040)
+#define BIT7                (0x0080)
+#define BIT8                (0x0100)
+#define BIT9                (0x0200)
+#define BITA                (0x0400)
+#define BITB                (0x0800)
+#define BITC                (0x1000)
+#define BITD                (0x2000)
+#define BITE                (0x4000)
+#define BITF                (0x8000)
+
+// Status register
+#define C                   (0x0001)
+#define Z                   (0x0002)
+#define N                   (0x0004)
+#define V                   (0x0100)
+#define GIE                 (0x0008)
+#define CPUOFF              (0x0010)
+#define OSCOFF              (0x0020)
+#define SCG0                (0x0040)
+#define SCG1                (0x0080)
+
+#define LPM0_bits           (CPUOFF)
+#define LPM1_bits           (SCG0 + CPUOFF)
+#define LPM2_bits           (SCG1 + CPUOFF)
+#define LPM3_bits           (SCG1 + SCG0 + CPUOFF)
+#define LPM4_bits           (SCG1 + SCG0 + OSCOFF + CPUOFF)
+
+// Intrinsics, each one a sync point
+void __bis_SR_register(uint16_t bits);
+void __bic_SR_register(uint16_t bits);
+void __bis_SR_register_on_exit(uint16_t bits);
+void __bic_SR_register_on_exit(uint16_t bits);
+uint16_t __get_SR_register(void);
+void __enable_interrupt(void);
+void __disable_interrupt(void);
+void __no_operation(void);
+void __delay_cycles(uint32_t cycles);
+#define __even_in_range(x, y)   (x)
+#define _BIS_SR(x)              __bis_SR_register(x)
+#define _BIC_SR(x)              __bic_SR_register(x)
+#define __low_power_mode_0()    __bis_SR_register(LPM0_bits | GIE)
+#define __low_power_mode_3()    __bis_SR_register(LPM3_bits | GIE)
+#define __low_power_mode_4()    __bis_SR_register(LPM4_bits | GIE)
+#define __low_power_mode_off_on_exit()  __bic_SR_register_on_exit(LPM4_bits)
+#define _NOP()                  __no_operation()
+
+// ISRs: __attribute__((interrupt(VEC))) puts the ISR in section sim_isr_VEC,
+// where the simulator finds it by the linker's __start_ symbol.
+// PERSISTENT data (__attribute__((persistent))) goes in section sim_fram.
+#define interrupt(vec)          section("sim_isr_" #vec), used, noinline
+#define persistent              section("sim_fram"), used, aligned(2)
+
+// Interrupt vectors, highest priority first
+#define SIM_VECTORS(X) \
+    X(SYSNMI_VECTOR) X(UNMI_VECTOR) \
+    X(TIMER0_B0_VECTOR) X(TIMER0_B1_VECTOR) X(TIMER1_B0_VECTOR) X(TIMER1_B1_VECTOR) \
+    X(TIMER2_B0_VECTOR) X(TIMER2_B1_VECTOR) X(TIMER3_B0_VECTOR) X(TIMER3_B1_VECTOR) \
+    X(RTC_VECTOR) X(WDT_VECTOR) X(USCI_A0_VECTOR) X(USCI_A1_VECTOR) \
+    X(USCI_B0_VECTOR) X(USCI_B1_VECTOR) X(ADC_VECTOR) \
+    X(PORT1_VECTOR) X(PORT2_VECTOR) X(PORT3_VECTOR) X(PORT4_VECTOR)
+
+#define SYSNMI_VECTOR       (62)
+#define UNMI_VECTOR         (61)
+#define TIMER0_B0_VECTOR    (60)
+#define TIMER0_B1_VECTOR    (59)
+#define TIMER1_B0_VECTOR    (58)
+#define TIMER1_B1_VECTOR    (57)
+#define TIMER2_B0_VECTOR    (56)
+#define TIMER2_B1_VECTOR    (55)
+#define TIMER3_B0_VECTOR    (54)
+#define TIMER3_B1_VECTOR    (53)
+#define RTC_VECTOR          (52)
+#define WDT_VECTOR          (51)
+#define USCI_A0_VECTOR      (50)
+#define USCI_A1_VECTOR      (49)
+#define USCI_B0_VECTOR      (48)
+#define USCI_B1_VECTOR      (47)
+#define ADC_VECTOR          (46)
+#define PORT1_VECTOR        (45)
+#define PORT2_VECTOR        (44)
+#define PORT3_VECTOR        (43)
+#define PORT4_VECTOR        (42)
+
+// Register storage, plain globals in sim_regs.c
+#define SIM_REG8(name)      extern volatile uint8_t name;
+#define SIM_REG16(name)     extern volatile uint16_t name;
+#define SIM_REGS(R8, R16) \
+    R16(PAIN) R16(PAOUT) R16(PADIR) R16(PAREN) R16(PASEL0) R16(PASEL1) R16(PAIES) R16(PAIE) R16(PAIFG) \
+    R16(PBIN) R16(PBOUT) R16(PBDIR) R16(PBREN) R16(PBSEL0) R16(PBSEL1) R16(PBIES) R16(PBIE) R16(PBIFG) \
+    R16(PCIN) R16(PCOUT) R16(PCDIR) R16(PCREN) R16(PCSEL0) R16(PCSEL1) R16(PCIES) R16(PCIE) R16(PCIFG) \
+    R16(TB0CTL) R16(TB0R) R16(TB0EX0) R16(TB0CCTL0) R16(TB0CCTL1) R16(TB0CCTL2) \
+    R16(TB0CCR0) R16(TB0CCR1) R16(TB0CCR2) \
+    R16(TB1CTL) R16(TB1R) R16(TB1EX0) R16(TB1CCTL0) R16(TB1CCTL1) R16(TB1CCTL2) \
+    R16(TB1CCR0) R16(TB1CCR1) R16(TB1CCR2) \
+    R16(TB2CTL) R16(TB2R) R16(TB2EX0) R16(TB2CCTL0) R16(TB2CCTL1) R16(TB2CCTL2) \
+    R16(TB2CCR0) R16(TB2CCR1) R16(TB2CCR2) \
+    R16(TB3CTL) R16(TB3R) R16(TB3EX0) R16(TB3CCTL0) R16(TB3CCTL1) R16(TB3CCTL2) R16(TB3CCTL3) \
+    R16(TB3CCTL4) R16(TB3CCTL5) R16(TB3CCTL6) R16(TB3CCR0) R16(TB3CCR1) R16(TB3CCR2) R16(TB3CCR3) \
+    R16(TB3CCR4) R16(TB3CCR5) R16(TB3CCR6) \
+    R16(ADCCTL0) R16(ADCCTL1) R16(ADCCTL2) R16(ADCLO) R16(ADCHI) R16(ADCMCTL0) R16(ADCMEM0) \
+    R16(ADCIE) R16(ADCIFG) \
+    R16(UCA0CTLW0) R16(UCA0CTLW1) R16(UCA0BRW) R16(UCA0MCTLW) R16(UCA0STATW) R16(UCA0RXBUF) \
+    R16(UCA0TXBUF) R16(UCA0ABCTL) R16(UCA0IRCTL) R16(UCA0IE) R16(UCA0IFG) \
+    R16(UCA1CTLW0) R16(UCA1CTLW1) R16(UCA1BRW) R16(UCA1MCTLW) R16(UCA1STATW) R16(UCA1RXBUF) \
+    R16(UCA1TXBUF) R16(UCA1ABCTL) R16(UCA1IRCTL) R16(UCA1IE) R16(UCA1IFG) \
+    R16(UCB0CTLW0) R16(UCB0CTLW1) R16(UCB0BRW) R16(UCB0STATW) R16(UCB0TBCNT) R16(UCB0RXBUF) \
+    R16(UCB0TXBUF) R16(UCB0I2COA0) R16(UCB0I2COA1) R16(UCB0I2COA2) R16(UCB0I2COA3) R16(UCB0ADDRX) \
+    R16(UCB0ADDMASK) R16(UCB0I2CSA) R16(UCB0IE) R16(UCB0IFG) \
+    R16(UCB1CTLW0) R16(UCB1CTLW1) R16(UCB1BRW) R16(UCB1STATW) R16(UCB1TBCNT) R16(UCB1RXBUF) \
+    R16(UCB1TXBUF) R16(UCB1I2COA0) R16(UCB1I2COA1) R16(UCB1I2COA2) R16(UCB1I2COA3) R16(UCB1ADDRX) \
+    R16(UCB1ADDMASK) R16(UCB1I2CSA) R16(UCB1IE) R16(UCB1IFG) \
+    R16(MPY) R16(MPYS) R16(OP2) R16(MPY32L) R16(MPY32H) R16(OP2L) R16(OP2H) R16(MPY32CTL0) \
+    R16(RTCCTL) R16(RTCMOD) R16(RTCCNT) \
+    R16(WDTCTL) R16(SFRIE1) R16(SFRIFG1) R16(SFRRPCR) \
+    R16(SYSCTL) R16(SYSCFG1) R16(SYSCFG2) \
+    R16(CSCTL0) R16(CSCTL1) R16(CSCTL2) R16(CSCTL3) R16(CSCTL4) R16(CSCTL5) R16(CSCTL6) \
+    R16(CSCTL7) R16(CSCTL8) \
+    R16(PMMCTL0) R16(PMMCTL1) R16(PMMCTL2) R16(PMMIFG) R16(PM5CTL0) \
+    R16(FRCTL0) R16(GCCTL0) R16(GCCTL1)
+SIM_REGS(SIM_REG8, SIM_REG16)
+
+// Byte views of the word registers (little endian host)
+#define SIM_LO(reg)         (((volatile uint8_t *)&(reg))[0])
+#define SIM_HI(reg)         (((volatile uint8_t *)&(reg))[1])
+
+// Accessors, see the header comment
+uint16_t Sim_ReadIV(unsigned char which);
+volatile uint16_t *Sim_CrcIn(unsigned char kind);
+volatile uint16_t *Sim_CrcResult(unsigned char reversed);
+uint16_t Sim_MpyResult(unsigned char word);
+volatile uint16_t *Sim_SysCfg0(void);
+uint16_t Sim_TlvWord(uint16_t addr);
+
+#define SIM_IV_TB0          0
+#define SIM_IV_TB1          1
+#define SIM_IV_TB2          2
+#define SIM_IV_TB3          3
+#define SIM_IV_ADC          4
+#define SIM_IV_UCA0         5
+#define SIM_IV_UCA1         6
+#define SIM_IV_UCB0         7
+#define SIM_IV_UCB1         8
+#define SIM_IV_RTC          9
+#define SIM_IV_P1           10
+#define SIM_IV_P2           11
+#define SIM_IV_P3           12
+#define SIM_IV_P4           13
+#define SIM_IV_SYSRST       14
+
+#define SIM_CRC_DI          0
+#define SIM_CRC_DI_L        1
+#define SIM_CRC_DIRB        2
+#define SIM_CRC_DIRB_L      3
+
+/************************************************************
+* Digital I/O
+************************************************************/
+#define P1IN                SIM_LO(PAIN)
+#define P1OUT               SIM_LO(PAOUT)
+#define P1DIR               SIM_LO(PADIR)
+#define P1REN               SIM_LO(PAREN)
+#define P1SEL0              SIM_LO(PASEL0)
+#define P1SEL1              SIM_LO(PASEL1)
+#define P1IES               SIM_LO(PAIES)
+#define P1IE                SIM_LO(PAIE)
+#define P1IFG               SIM_LO(PAIFG)
+#define P2IN                SIM_HI(PAIN)
+#define P2OUT               SIM_HI(PAOUT)
+#define P2DIR               SIM_HI(PADIR)
+#define P2REN               SIM_HI(PAREN)
+#define P2SEL0              SIM_HI(PASEL0)
+#define P2SEL1              SIM_HI(PASEL1)
+#define P2IES               SIM_HI(PAIES)
+#define P2IE                SIM_HI(PAIE)
+#define P2IFG               SIM_HI(PAIFG)
+#define P3IN                SIM_LO(PBIN)
+#define P3OUT               SIM_LO(PBOUT)
+#define P3DIR               SIM_LO(PBDIR)
+#define P3REN               SIM_LO(PBREN)
+#define P3SEL0              SIM_LO(PBSEL0)
+#define P3SEL1              SIM_LO(PBSEL1)
+#define P3IES               SIM_LO(PBIES)
+#define P3IE                SIM_LO(PBIE)
+#define P3IFG               SIM_LO(PBIFG)
+#define P4IN                SIM_HI(PBIN)
+#define P4OUT               SIM_HI(PBOUT)
+#define P4DIR               SIM_HI(PBDIR)
+#define P4REN               SIM_HI(PBREN)
+#define P4SEL0              SIM_HI(PBSEL0)
+#define P4SEL1              SIM_HI(PBSEL1)
+#define P4IES               SIM_HI(PBIES)
+#define P4IE                SIM_HI(PBIE)
+#define P4IFG               SIM_HI(PBIFG)
+#define P5IN                SIM_LO(PCIN)
+#define P5OUT               SIM_LO(PCOUT)
+#define P5DIR               SIM_LO(PCDIR)
+#define P5REN               SIM_LO(PCREN)
+#define P5SEL0              SIM_LO(PCSEL0)
+#define P5SEL1              SIM_LO(PCSEL1)
+#define P6IN                SIM_HI(PCIN)
+#define P6OUT               SIM_HI(PCOUT)
+#define P6DIR               SIM_HI(PCDIR)
+#define P6REN               SIM_HI(PCREN)
+#define P6SEL0              SIM_HI(PCSEL0)
+#define P6SEL1              SIM_HI(PCSEL1)
+#define P1IV                Sim_ReadIV(SIM_IV_P1)
+#define P2IV                Sim_ReadIV(SIM_IV_P2)
+#define P3IV                Sim_ReadIV(SIM_IV_P3)
+#define P4IV                Sim_ReadIV(SIM_IV_P4)
+
+#define P1IV_NONE           (0x0000)
+#define P1IV__P1IFG0        (0x0002)
+#define P1IV__P1IFG1        (0x0004)
+#define P1IV__P1IFG2        (0x0006)
+#define P1IV__P1IFG3        (0x0008)
+#define P1IV__P1IFG4        (0x000A)
+#define P1IV__P1IFG5        (0x000C)
+#define P1IV__P1IFG6        (0x000E)
+#define P1IV__P1IFG7        (0x0010)
+#define P2IV_NONE           P1IV_NONE
+#define P2IV__P2IFG0        P1IV__P1IFG0
+#define P2IV__P2IFG1        P1IV__P1IFG1
+#define P2IV__P2IFG2        P1IV__P1IFG2
+#define P2IV__P2IFG3        P1IV__P1IFG3
+#define P2IV__P2IFG4        P1IV__P1IFG4
+#define P2IV__P2IFG5        P1IV__P1IFG5
+#define P2IV__P2IFG6        P1IV__P1IFG6
+#define P2IV__P2IFG7        P1IV__P1IFG7
+
+/************************************************************
+* Timer_B
+************************************************************/
+#define TB0CTL_             TB0CTL
+#define TBSSEL              (0x0300)
+#define TBSSEL0             (0x0100)
+#define TBSSEL1             (0x0200)
+#define TBSSEL_0            (0x0000)        // TBCLK
+#define TBSSEL_1            (0x0100)        // ACLK
+#define TBSSEL_2            (0x0200)        // SMCLK
+#define TBSSEL_3            (0x0300)        // INCLK
+#define TBSSEL__TBCLK       TBSSEL_0
+#define TBSSEL__ACLK        TBSSEL_1
+#define TBSSEL__SMCLK       TBSSEL_2
+#define TBSSEL__INCLK       TBSSEL_3
+#define ID                  (0x00C0)
+#define ID_0                (0x0000)
+#define ID_1                (0x0040)
+#define ID_2                (0x0080)
+#define ID_3                (0x00C0)
+#define ID__1               ID_0
+#define ID__2               ID_1
+#define ID__4               ID_2
+#define ID__8               ID_3
+#define MC                  (0x0030)
+#define MC_0                (0x0000)
+#define MC_1                (0x0010)
+#define MC_2                (0x0020)
+#define MC_3                (0x0030)
+#define MC__STOP            MC_0
+#define MC__UP              MC_1
+#define MC__CONTINUOUS      MC_2
+#define MC__CONTINOUS       MC_2
+#define MC__UPDOWN          MC_3
+#define TBCLGRP_1           (0x2000)
+#define CNTL                (0x1800)
+#define TBCLR               (0x0004)
+#define TBIE                (0x0002)
+#define TBIFG               (0x0001)
+
+#define CM                  (0xC000)
+#define CM_0                (0x0000)
+#define CM_1                (0x4000)
+#define CM_2                (0x8000)
+#define CM_3                (0xC000)
+#define CM__NONE            CM_0
+#define CM__RISING          CM_1
+#define CM__FALLING         CM_2
+#define CM__BOTH            CM_3
+#define CCIS                (0x3000)
+#define CCIS_0              (0x0000)
+#define CCIS_1              (0x1000)
+#define CCIS_2              (0x2000)
+#define CCIS_3              (0x3000)
+#define CCIS__CCIA          CCIS_0
+#define CCIS__CCIB          CCIS_1
+#define CCIS__GND           CCIS_2
+#define CCIS__VCC           CCIS_3
+#define SCS                 (0x0800)
+#define CLLD                (0x0600)
+#define CLLD_0              (0x0000)
+#define CLLD_1              (0x0200)
+#define CLLD_2              (0x0400)
+#define CLLD_3              (0x0600)
+#define CAP                 (0x0100)
+#define OUTMOD              (0x00E0)
+#define OUTMOD_0            (0x0000)
+#define OUTMOD_1            (0x0020)
+#define OUTMOD_2            (0x0040)
+#define OUTMOD_3            (0x0060)
+#define OUTMOD_4            (0x0080)
+#define OUTMOD_5            (0x00A0)
+#define OUTMOD_6            (0x00C0)
+#define OUTMOD_7            (0x00E0)
+#define CCIE                (0x0010)
+#define CCI                 (0x0008)
+#define OUT                 (0x0004)
+#define COV                 (0x0002)
+#define CCIFG               (0x0001)
+
+#define TBIDEX              (0x0007)
+#define TBIDEX_0            (0x0000)
+#define TBIDEX_1            (0x0001)
+#define TBIDEX_2            (0x0002)
+#define TBIDEX_3            (0x0003)
+#define TBIDEX_4            (0x0004)
+#define TBIDEX_5            (0x0005)
+#define TBIDEX_6            (0x0006)
+#define TBIDEX_7            (0x0007)
+#define TBIDEX__1           TBIDEX_0
+#define TBIDEX__2           TBIDEX_1
+#define TBIDEX__3           TBIDEX_2
+#define TBIDEX__4           TBIDEX_3
+#define TBIDEX__5           TBIDEX_4
+#define TBIDEX__6           TBIDEX_5
+#define TBIDEX__7           TBIDEX_6
+#define TBIDEX__8           TBIDEX_7
+
+#define TB0IV               Sim_ReadIV(SIM_IV_TB0)
+#define TB1IV               Sim_ReadIV(SIM_IV_TB1)
+#define TB2IV               Sim_ReadIV(SIM_IV_TB2)
+#define TB3IV               Sim_ReadIV(SIM_IV_TB3)
+#define TBIV__NONE          (0x0000)
+#define TBIV__TBCCR1        (0x0002)
+#define TBIV__TBCCR2        (0x0004)
+#define TBIV__TBCCR3        (0x0006)
+#define TBIV__TBCCR4        (0x0008)
+#define TBIV__TBCCR5        (0x000A)
+#define TBIV__TBCCR6        (0x000C)
+#define TBIV__TBIFG         (0x000E)
+#define TB0IV_NONE          TBIV__NONE
+#define TB0IV_TBCCR1        TBIV__TBCCR1
+#define TB0IV_TBCCR2        TBIV__TBCCR2
+#define TB0IV_TBIFG         TBIV__TBIFG
+
+/************************************************************
+* ADC
+************************************************************/
+#define ADCSHT              (0x0F00)
+#define ADCSHT_0            (0x0000)
+#define ADCSHT_1            (0x0100)
+#define ADCSHT_2            (0x0200)
+#define ADCSHT_3            (0x0300)
+#define ADCSHT_4            (0x0400)
+#define ADCSHT_5            (0x0500)
+#define ADCSHT_6            (0x0600)
+#define ADCSHT_7            (0x0700)
+#define ADCSHT_8            (0x0800)
+#define ADCSHT_9            (0x0900)
+#define ADCSHT_10           (0x0A00)
+#define ADCSHT_11           (0x0B00)
+#define ADCSHT_12           (0x0C00)
+#define ADCSHT_13           (0x0D00)
+#define ADCSHT_14           (0x0E00)
+#define ADCSHT_15           (0x0F00)
+#define ADCMSC              (0x0080)
+#define ADCON               (0x0010)
+#define ADCENC              (0x0002)
+#define ADCSC               (0x0001)
+
+#define ADCSHS              (0x0C00)
+#define ADCSHS_0            (0x0000)        // ADCSC
+#define ADCSHS_1            (0x0400)        // TB0.1
+#define ADCSHS_2            (0x0800)        // TB1.1
+#define ADCSHS_3            (0x0C00)        // TB2.1
+#define ADCSHP              (0x0200)
+#define ADCISSH             (0x0100)
+#define ADCDIV              (0x00E0)
+#define ADCSSEL             (0x0018)
+#define ADCSSEL_0           (0x0000)        // MODCLK
+#define ADCSSEL_1           (0x0008)        // ACLK
+#define ADCSSEL_2           (0x0010)        // SMCLK
+#define ADCSSEL_3           (0x0018)        // SMCLK
+#define ADCCONSEQ           (0x0006)
+#define ADCCONSEQ_0         (0x0000)
+#define ADCCONSEQ_1         (0x0002)
+#define ADCCONSEQ_2         (0x0004)
+#define ADCCONSEQ_3         (0x0006)
+#define ADCBUSY             (0x0001)
+
+#define ADCRES              (0x0030)
+#define ADCRES_0            (0x0000)        // 8 bit
+#define ADCRES_1            (0x0010)        // 10 bit
+#define ADCRES_2            (0x0020)        // 12 bit
+#define ADCDF               (0x0008)
+#define ADCSR               (0x0004)
+
+#define ADCSREF             (0x0070)
+#define ADCSREF_0           (0x0000)
+#define ADCSREF_1           (0x0010)
+#define ADCSREF_2           (0x0020)
+#define ADCSREF_3           (0x0030)
+#define ADCSREF_4           (0x0040)
+#define ADCSREF_5           (0x0050)
+#define ADCSREF_6           (0x0060)
+#define ADCSREF_7           (0x0070)
+#define ADCINCH             (0x000F)
+#define ADCINCH_0           (0x0000)
+#define ADCINCH_1           (0x0001)
+#define ADCINCH_2           (0x0002)
+#define ADCINCH_3           (0x0003)
+#define ADCINCH_4           (0x0004)
+#define ADCINCH_5           (0x0005)
+#define ADCINCH_6           (0x0006)
+#define ADCINCH_7           (0x0007)
+#define ADCINCH_8           (0x0008)
+#define ADCINCH_9           (0x0009)
+#define ADCINCH_10          (0x000A)
+#define ADCINCH_11          (0x000B)
+#define ADCINCH_12          (0x000C)
+#define ADCINCH_13          (0x000D)
+#define ADCINCH_14          (0x000E)
+#define ADCINCH_15          (0x000F)
+
+#define ADCIE0              (0x0001)
+#define ADCINIE             (0x0002)
+#define ADCLOIE             (0x0004)
+#define ADCHIIE             (0x0008)
+#define ADCOVIE             (0x0010)
+#define ADCTOVIE            (0x0020)
+#define ADCIFG0             (0x0001)
+#define ADCINIFG            (0x0002)
+#define ADCLOIFG            (0x0004)
+#define ADCHIIFG            (0x0008)
+#define ADCOVIFG            (0x0010)
+#define ADCTOVIFG           (0x0020)
+
+#define ADCIV               Sim_ReadIV(SIM_IV_ADC)
+#define ADCIV_NONE          (0x0000)
+#define ADCIV_ADCOVIFG      (0x0002)
+#define ADCIV_ADCTOVIFG     (0x0004)
+#define ADCIV_ADCHIIFG      (0x0006)
+#define ADCIV_ADCLOIFG      (0x0008)
+#define ADCIV_ADCINIFG      (0x000A)
+#define ADCIV_ADCIFG        (0x000C)
+
+/************************************************************
+* eUSCI_A UART, eUSCI_B I2C master
+************************************************************/
+#define UCA0CTL1            SIM_LO(UCA0CTLW0)
+#define UCA0CTL0            SIM_HI(UCA0CTLW0)
+#define UCA0BR0             SIM_LO(UCA0BRW)
+#define UCA0BR1             SIM_HI(UCA0BRW)
+#define UCA1CTL1            SIM_LO(UCA1CTLW0)
+#define UCA1CTL0            SIM_HI(UCA1CTLW0)
+#define UCA1BR0             SIM_LO(UCA1BRW)
+#define UCA1BR1             SIM_HI(UCA1BRW)
+#define UCB0CTL1            SIM_LO(UCB0CTLW0)
+#define UCB0CTL0            SIM_HI(UCB0CTLW0)
+#define UCB0BR0             SIM_LO(UCB0BRW)
+#define UCB0BR1             SIM_HI(UCB0BRW)
+#define UCB1CTL1            SIM_LO(UCB1CTLW0)
+#define UCB1CTL0            SIM_HI(UCB1CTLW0)
+#define UCB1BR0             SIM_LO(UCB1BRW)
+#define UCB1BR1             SIM_HI(UCB1BRW)
+#define UCA0IV              Sim_ReadIV(SIM_IV_UCA0)
+#define UCA1IV              Sim_ReadIV(SIM_IV_UCA1)
+#define UCB0IV              Sim_ReadIV(SIM_IV_UCB0)
+#define UCB1IV              Sim_ReadIV(SIM_IV_UCB1)
+
+// UCxCTLW0
+#define UCPEN               (0x8000)
+#define UCPAR               (0x4000)
+#define UCMSB               (0x2000)
+#define UC7BIT              (0x1000)
+#define UCSPB               (0x0800)
+#define UCMST               (0x0800)
+#define UCMODE              (0x0600)
+#define UCMODE_0            (0x0000)
+#define UCMODE_1            (0x0200)
+#define UCMODE_2            (0x0400)
+#define UCMODE_3            (0x0600)
+#define UCSYNC              (0x0100)
+#define UCSSEL              (0x00C0)
+#define UCSSEL_0            (0x0000)
+#define UCSSEL_1            (0x0040)
+#define UCSSEL_2            (0x0080)
+#define UCSSEL_3            (0x00C0)
+#define UCSSEL__UCLK        UCSSEL_0
+#define UCSSEL__ACLK        UCSSEL_1
+#define UCSSEL__SMCLK       UCSSEL_2
+#define UCRXEIE             (0x0020)
+#define UCBRKIE             (0x0010)
+#define UCTR                (0x0010)
+#define UCDORM              (0x0008)
+#define UCTXNACK            (0x0008)
+#define UCTXADDR            (0x0004)
+#define UCTXSTP             (0x0004)
+#define UCTXBRK             (0x0002)
+#define UCTXSTT             (0x0002)
+#define UCSWRST             (0x0001)
+
+// UCBxCTLW1
+#define UCCLTO              (0x00C0)
+#define UCCLTO_0            (0x0000)
+#define UCCLTO_1            (0x0040)        // ~28 ms
+#define UCCLTO_2            (0x0080)        // ~31 ms
+#define UCCLTO_3            (0x00C0)        // ~34 ms
+#define UCASTP              (0x000C)
+#define UCASTP_0            (0x0000)
+#define UCASTP_1            (0x0004)
+#define UCASTP_2            (0x0008)
+
+// UCAxMCTLW
+#define UCOS16              (0x0001)
+#define UCBRF               (0x00F0)
+#define UCBRF_0             (0x0000)
+#define UCBRF_1             (0x0010)
+#define UCBRF_2             (0x0020)
+#define UCBRF_3             (0x0030)
+#define UCBRF_4             (0x0040)
+#define UCBRF_5             (0x0050)
+#define UCBRF_6             (0x0060)
+#define UCBRF_7             (0x0070)
+#define UCBRF_8             (0x0080)
+#define UCBRF_9             (0x0090)
+#define UCBRF_10            (0x00A0)
+#define UCBRF_11            (0x00B0)
+#define UCBRF_12            (0x00C0)
+#define UCBRF_13            (0x00D0)
+#define UCBRF_14            (0x00E0)
+#define UCBRF_15            (0x00F0)
+
+// UCxSTATW
+#define UCBBUSY             (0x0010)
+#define UCBUSY              (0x0001)
+
+// UCAxIE/UCAxIFG
+#define UCTXCPTIE           (0x0008)
+#define UCSTTIE             (0x0004)
+#define UCTXIE              (0x0002)
+#define UCRXIE              (0x0001)
+#define UCTXCPTIFG          (0x0008)
+#define UCSTTIFG            (0x0004)
+#define UCTXIFG             (0x0002)
+#define UCRXIFG             (0x0001)
+
+// UCBxIE/UCBxIFG, I2C
+#define UCBIT9IE            (0x4000)
+#define UCTXIE3             (0x2000)
+#define UCRXIE3             (0x1000)
+#define UCTXIE2             (0x0800)
+#define UCRXIE2             (0x0400)
+#define UCTXIE1             (0x0200)
+#define UCRXIE1             (0x0100)
+#define UCCLTOIE            (0x0080)
+#define UCBCNTIE            (0x0040)
+#define UCNACKIE            (0x0020)
+#define UCALIE              (0x0010)
+#define UCSTPIE             (0x0008)
+#define UCTXIE0             (0x0002)
+#define UCRXIE0             (0x0001)
+#define UCBIT9IFG           (0x4000)
+#define UCCLTOIFG           (0x0080)
+#define UCBCNTIFG           (0x0040)
+#define UCNACKIFG           (0x0020)
+#define UCALIFG             (0x0010)
+#define UCSTPIFG            (0x0008)
+#define UCTXIFG0            (0x0002)
+#define UCRXIFG0            (0x0001)
+
+#define USCI_NONE                   (0x0000)
+#define USCI_UART_UCRXIFG           (0x0002)
+#define USCI_UART_UCTXIFG           (0x0004)
+#define USCI_UART_UCSTTIFG          (0x0006)
+#define USCI_UART_UCTXCPTIFG        (0x0008)
+#define USCI_I2C_UCALIFG            (0x0002)
+#define USCI_I2C_UCNACKIFG          (0x0004)
+#define USCI_I2C_UCSTTIFG           (0x0006)
+#define USCI_I2C_UCSTPIFG           (0x0008)
+#define USCI_I2C_UCRXIFG3           (0x000A)
+#define USCI_I2C_UCTXIFG3           (0x000C)
+#define USCI_I2C_UCRXIFG2           (0x000E)
+#define USCI_I2C_UCTXIFG2           (0x0010)
+#define USCI_I2C_UCRXIFG1           (0x0012)
+#define USCI_I2C_UCTXIFG1           (0x0014)
+#define USCI_I2C_UCRXIFG0           (0x0016)
+#define USCI_I2C_UCTXIFG0           (0x0018)
+#define USCI_I2C_UCBCNTIFG          (0x001A)
+#define USCI_I2C_UCCLTOIFG          (0x001C)
+#define USCI_I2C_UCBIT9IFG          (0x001E)
+
+/************************************************************
+* CRC16, MPY32
+************************************************************/
+#define CRCDI               (*Sim_CrcIn(SIM_CRC_DI))
+#define CRCDI_L             (*(volatile uint8_t *)Sim_CrcIn(SIM_CRC_DI_L))
+#define CRCDIRB             (*Sim_CrcIn(SIM_CRC_DIRB))
+#define CRCDIRB_L           (*(volatile uint8_t *)Sim_CrcIn(SIM_CRC_DIRB_L))
+#define CRCINIRES           (*Sim_CrcResult(0))
+#define CRCRESR             (*Sim_CrcResult(1))
+
+#define RESLO               Sim_MpyResult(4)
+#define RESHI               Sim_MpyResult(5)
+#define RES0                Sim_MpyResult(0)
+#define RES1                Sim_MpyResult(1)
+#define RES2                Sim_MpyResult(2)
+#define RES3                Sim_MpyResult(3)
+
+/************************************************************
+* TLV
+************************************************************/
+#define TLV_WORD(addr)      Sim_TlvWord(addr)
+
+/************************************************************
+* RTC
+************************************************************/
+#define RTCIV               Sim_ReadIV(SIM_IV_RTC)
+#define RTCSS               (0x3000)
+#define RTCSS_0             (0x0000)        // Off
+#define RTCSS_1             (0x1000)        // SMCLK, ACLK with RTCCKSEL
+#define RTCSS_2             (0x2000)        // XT1CLK
+#define RTCSS_3             (0x3000)        // VLOCLK
+#define RTCSS__DISABLED     RTCSS_0
+#define RTCSS__SMCLK        RTCSS_1
+#define RTCSS__XT1CLK       RTCSS_2
+#define RTCSS__VLOCLK       RTCSS_3
+#define RTCPS               (0x0700)
+#define RTCPS_0             (0x0000)
+#define RTCPS_1             (0x0100)
+#define RTCPS_2             (0x0200)
+#define RTCPS_3             (0x0300)
+#define RTCPS_4             (0x0400)
+#define RTCPS_5             (0x0500)
+#define RTCPS_6             (0x0600)
+#define RTCPS_7             (0x0700)
+#define RTCPS__1            RTCPS_0
+#define RTCPS__10           RTCPS_1
+#define RTCPS__100          RTCPS_2
+#define RTCPS__1000         RTCPS_3
+#define RTCPS__16           RTCPS_4
+#define RTCPS__64           RTCPS_5
+#define RTCPS__256          RTCPS_6
+#define RTCPS__1024         RTCPS_7
+#define RTCSR               (0x0040)
+#define RTCIE               (0x0002)
+#define RTCIFG              (0x0001)
+#define RTCIV_NONE          (0x0000)
+#define RTCIV_RTCIF         (0x0002)
+#define RTCIV_RTCIFG        RTCIV_RTCIF
+
+/************************************************************
+* WDT, SFR, SYS
+************************************************************/
+#define WDTPW               (0x5A00)
+#define WDTHOLD             (0x0080)
+#define WDTSSEL             (0x0060)
+#define WDTSSEL_0           (0x0000)
+#define WDTSSEL_1           (0x0020)
+#define WDTSSEL_2           (0x0040)
+#define WDTSSEL__SMCLK      WDTSSEL_0
+#define WDTSSEL__ACLK       WDTSSEL_1
+#define WDTSSEL__VLO        WDTSSEL_2
+#define WDTTMSEL            (0x0010)
+#define WDTCNTCL            (0x0008)
+#define WDTIS               (0x0007)
+#define WDTIS0              (0x0001)
+#define WDTIS1              (0x0002)
+#define WDTIS2              (0x0004)
+#define WDTIS_0             (0x0000)        // 2^31
+#define WDTIS_1             (0x0001)        // 2^27
+#define WDTIS_2             (0x0002)        // 2^23
+#define WDTIS_3             (0x0003)        // 2^19
+#define WDTIS_4             (0x0004)        // 2^15
+#define WDTIS_5             (0x0005)        // 2^13
+#define WDTIS_6             (0x0006)        // 2^9
+#define WDTIS_7             (0x0007)        // 2^6
+#define WDTIS__32K          WDTIS_4
+#define WDTIS__8192         WDTIS_5
+#define WDTIS__512          WDTIS_6
+#define WDTIS__64           WDTIS_7
+#define WDT_MDLY_32         (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2)
+#define WDT_MDLY_8          (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTIS0)
+#define WDT_MDLY_0_5        (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTIS1)
+#define WDT_MDLY_0_064      (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTIS1 + WDTIS0)
+#define WDT_ADLY_1000       (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTSSEL0)
+#define WDT_ADLY_250        (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTSSEL0 + WDTIS0)
+#define WDT_ADLY_16         (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTSSEL0 + WDTIS1)
+#define WDT_ADLY_1_9        (WDTPW + WDTTMSEL + WDTCNTCL + WDTIS2 + WDTSSEL0 + WDTIS1 + WDTIS0)
+#define WDT_ARST_1000       (WDTPW + WDTCNTCL + WDTIS2 + WDTSSEL0)
+#define WDTSSEL0            (0x0020)
+
+#define WDTIE               (0x0001)
+#define OFIE                (0x0002)
+#define WDTIFG              (0x0001)
+#define OFIFG               (0x0002)
+
+#define SYSCFG0             (*Sim_SysCfg0())
+#define FRWPPW              (0xA500)
+#define FRWPOA              (0x00FC)
+#define FRWPOA0             (0x0004)
+#define DFWP                (0x0002)
+#define PFWP                (0x0001)
+#define RTCCKSEL            (0x0400)        // SYSCFG2
+
+#define SYSRSTIV            Sim_ReadIV(SIM_IV_SYSRST)
+#define SYSRSTIV_NONE       (0x0000)
+#define SYSRSTIV_BOR        (0x0002)
+#define SYSRSTIV_RSTNMI     (0x0004)
+#define SYSRSTIV_DOBOR      (0x0006)
+#define SYSRSTIV_LPM5WU     (0x0008)
+#define SYSRSTIV_SECYV      (0x000A)
+#define SYSRSTIV_DOPOR      (0x0012)
+#define SYSRSTIV_WDTTO      (0x0016)
+#define SYSRSTIV_WDTPW      (0x0018)
+#define SYSRSTIV_FRCTLPW    (0x001A)
+#define SYSRSTIV_PMMPW      (0x0020)
+
+/************************************************************
+* CS, PMM, FRAM controller
+************************************************************/
+#define DCOTAP              (0x01FF)
+#define DCOFTRIMEN          (0x0080)
+#define DCOFTRIMEN_1        (0x0080)
+#define DCOFTRIM            (0x0070)
+#define DCOFTRIM0           (0x0010)
+#define DCOFTRIM1           (0x0020)
+#define DCOFTRIM2           (0x0040)
+#define DCORSEL             (0x000E)
+#define DCORSEL_0           (0x0000)
+#define DCORSEL_1           (0x0002)
+#define DCORSEL_2           (0x0004)
+#define DCORSEL_3           (0x0006)
+#define DCORSEL_4           (0x0008)
+#define DCORSEL_5           (0x000A)
+#define DCORSEL_6           (0x000C)
+#define DCORSEL_7           (0x000E)
+#define FLLD                (0x7000)
+#define FLLD_0              (0x0000)
+#define FLLD_1              (0x1000)
+#define FLLN                (0x03FF)
+#define SELREF              (0x0030)
+#define SELREF__XT1CLK      (0x0000)
+#define SELREF__REFOCLK     (0x0010)
+#define SELMS               (0x0007)
+#define SELMS__DCOCLKDIV    (0x0000)
+#define SELMS__REFOCLK      (0x0001)
+#define SELMS__XT1CLK       (0x0002)
+#define SELMS__VLOCLK       (0x0003)
+#define SELA                (0x0300)
+#define SELA__XT1CLK        (0x0000)
+#define SELA__REFOCLK       (0x0100)
+#define SELA__VLOCLK        (0x0200)
+#define DIVM                (0x0007)
+#define DIVM_0              (0x0000)
+#define DIVM_1              (0x0001)
+#define DIVM_2              (0x0002)
+#define DIVM_3              (0x0003)
+#define DIVM__1             DIVM_0
+#define DIVM__2             DIVM_1
+#define DIVM__4             DIVM_2
+#define DIVM__8             DIVM_3
+#define DIVS                (0x0030)
+#define DIVS_0              (0x0000)
+#define DIVS_1              (0x0010)
+#define DIVS_2              (0x0020)
+#define DIVS_3              (0x0030)
+#define DIVS__1             DIVS_0
+#define DIVS__2             DIVS_1
+#define DIVS__4             DIVS_2
+#define DIVS__8             DIVS_3
+#define SMCLKOFF            (0x0100)
+#define XTS                 (0x0002)
+#define FLLUNLOCKHIS1       (0x0800)
+#define FLLUNLOCKHIS0       (0x0400)
+#define FLLUNLOCK1          (0x0200)
+#define FLLUNLOCK0          (0x0100)
+#define FLLULIFG            (0x0010)
+#define XT1OFFG             (0x0002)
+#define DCOFFG              (0x0001)
+
+#define PMMPW               (0xA500)
+#define PMMPW_H             (0xA5)
+#define PMMREGOFF           (0x0010)
+#define PMMSWPOR            (0x0008)
+#define PMMSWBOR            (0x0004)
+#define PMMCTL0_L           SIM_LO(PMMCTL0)
+#define PMMCTL0_H           SIM_HI(PMMCTL0)
+#define REFGENRDY           (0x1000)
+#define REFVSEL             (0x0030)
+#define REFVSEL_0           (0x0000)
+#define REFVSEL_1           (0x0010)
+#define REFVSEL_2           (0x0020)
+#define TSENSOREN           (0x0008)
+#define INTREFEN            (0x0001)
+#define LOCKLPM5            (0x0001)
+
+#define FRCTLPW             (0xA500)
+#define NWAITS              (0x0070)
+#define NWAITS_0            (0x0000)
+#define NWAITS_1            (0x0010)
+#define NWAITS_2            (0x0020)
+
+#ifdef SIM_FIRMWARE
+#define int                 short
+#define main                Sim_FirmwareMain
+#ifndef SIM_LONG64
+_Static_assert(sizeof(long) == 4, "long is not 32 bits as on the MSP430: build with -m32, or make SIM_LONG64=1");
+#endif
+#endif
+
+#endif /* SIM_MSP430_H_ */
@@ -0,0 +1,217 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: runs the firmware, or one of the TI examples, on Linux against
+//  a register-level model of the MSP430FR2355 peripherals it uses.
+//
+//      make                                    firmware, ./sim_fw
+//      make example EX=msp430fr235x_tb0_01     TI example, ./sim_ex
+//      ./sim_fw -t 10 -s scripts/boot.sim -o trace.txt
+//
+//  The firmware sources are compiled unchanged against include/msp430.h,
+//  which declares the registers as plain variables. There is no CPU
+//  model: the C code runs natively, and the peripherals catch up at sync
+//  points, the intrinsics (__bis_SR_register, __disable_interrupt,
+//  __delay_cycles, ...), the accessor registers (msp430.h) and ISR entry
+//  and exit. At a sync point the simulator:
+//      picks up the register writes since the last one (it keeps a shadow
+//      of every register it has to watch, and strobes like TBCLR, ADCSC,
+//      UCTXSTT or a TXBUF write are seen as changes against it),
+//      charges SIM_SYNC_CYCLES of MCLK (or the __delay_cycles count),
+//      runs the peripherals up to the new time,
+//      and calls the highest priority pending ISR if GIE is set.
+//  With CPUOFF set the CPU is asleep: time jumps straight to the next
+//  peripheral or script event, so a firmware that sleeps most of the time
+//  runs many times faster than real time.
+//
+//  Time is kept in 1/512 us (SIM_UNITS_PER_US): one 16 MHz MCLK cycle is 32,
+//  one ACLK tick 15625. LPM0 stops MCLK, LPM3 SMCLK too (timers and I2C on
+//  SMCLK stop), LPM4 ACLK too. The ADC on MODOSC and the RTC keep running.
+//  A UART on SMCLK keeps its bit clock in LPM3, the eUSCI_A automatic clock
+//  activation: the characters are not lost, but the current of the DCO it
+//  keeps running is not counted, and the character that started it has
+//  its bits sampled SIM_DCO_WAKE_US late, the DCO restart. Sleeping with GIE clear ends the run
+//  (nothing can wake the CPU).
+//
+//  Modeled: ports P1..P6 (P1..P4 edge interrupts), Timer_B0..B3 (compare,
+//  capture from the TB3 pins P6.0..P6.5 and CCIS GND/VCC, output modes
+//  for the ADC trigger and on the P6 pins selected to TB3), ADC (single, sequence, repeat, SC/TB0.1/TB1.1/
+//  TB2.1 triggers), eUSCI_A0/A1 UART, eUSCI_B0/B1 I2C master with a smart
+//  battery gauge at 0x0B on each bus, RTC, WDT, CRC16, MPY32, CS (FLL
+//  frequency, DCOTAP for the software trim), PMM reference ready flag,
+//  SYSCFG0 FRAM write protection over the PERSISTENT variables, the TLV
+//  words (nominal ADC calibration until the script sets them).
+//  Not modeled: SAC, eCOMP, SPI, I2C slave, XT1 (it is always "running"
+//  at 32768 Hz), absolute FRAM addresses, LPMx.5, clock requests.
+//
+//  Limits of the sync point model:
+//      A polling loop with no sync point in it sees the registers as they
+//      were at the last one, so busy and "not ready" flags that code polls
+//      (UCBUSY, ADCBUSY, FLLUNLOCK, DCOFFG, XT1OFFG) always read clear.
+//      Reading RXBUF or ADCMEM0 does not clear the flag, reading the IV
+//      register does.
+//      int is 16 bits (SIM_FIRMWARE) and long 32 with -m32, which the
+//      build uses where the compiler can link 32-bit code; without it the
+//      firmware does not compile unless make SIM_LONG64=1, and then code
+//      that relies on unsigned long wrapping at 32 bits is not run
+//      faithfully. Arithmetic on unsigned int still promotes to the host's
+//      32-bit int, not to unsigned: a difference that is not stored back
+//      into an unsigned int needs its (unsigned int) cast, as it would for
+//      any 16-bit target.
+//      A loop with no sync point in it at all (while(1);) never returns
+//      to the simulator, Ctrl-C stops the run with the trace and summary.
+//      Cycle counts are approximate, 1 sync point = SIM_SYNC_CYCLES.
+//      A reset (WDT, password violation, PMMSWBOR) ends the run.
+//
+//  Script (-s), one event per line, '#' comments, times with s/ms/us:
+//      <time> pin P6.2 0|1|z         drive an input, z = release
+//      <time> adc A1 <code>          ADC result for a channel, 12 bit code
+//      <time> load A0 P6.0|off       the channel reads its code only while
+//                                    the pin is high, a load on that pin
+//      <time> uart <hex bytes>       bytes into UCA1 RX (uart0 for UCA0)
+//      <time> frame <type> <payload> host link frame into UCA1 RX, with
+//                                    the wake preamble, sync, length and
+//                                    CRC (host_link.h); the preamble goes
+//                                    before <time>, so at 115200 baud the
+//                                    sync byte starts at <time>
+//      <time> i2c <bus> reg <cmd> <value>   gauge register value
+//      <time> i2c <bus> on|off|stuck        gauge present, absent (NACK),
+//                                           holding SCL low
+//      <time> tlv <addr> <value>     a TLV word, 0x1A00..0x1AFE; the
+//                                    firmware reads the calibration once at
+//                                    boot (cal.h), so at 0 for it to count
+//      <time> mark                   start of the window for expect high
+//      <time> end                    stop the run
+//
+//  Checks, in the same script (make test runs every script in scripts/):
+//      <time> expect frame <type>[:<key>] <offset> u8|u16|i16|u32 <min> [<max>]
+//                                    a payload field of the newest host
+//                                    link frame of that type out of UCA1
+//                                    TX since the last frame/uart line into
+//                                    UCA1 RX; key picks the frame by the u16
+//                                    at payload offset 0 (an upload's first
+//                                    entry)
+//      <time> expect frame <type>[:<key>] none   no such frame since
+//                                    the last frame/uart line into UCA1 RX
+//      <time> expect pin P2.3 0|1    pin level
+//      <time> expect high P6.0 <min> [<max>]   percent of the time the pin
+//                                    was high since the last mark
+//      <time> expect active|lpm0|lpm3|lpm4 <min> [<max>]   percent of the
+//                                    run so far in that mode (lpm3 is
+//                                    LPM1..3, as in the summary)
+//  max defaults to min for frame fields and to 100 for percentages. A
+//  failed check is an error, so the run exits 1; one still to come when
+//  the run stops fails too, unless the CPU halted, when it is checked
+//  against the state it halted in (nothing can change after that).
+//
+//  Trace (-o): one line per event, time in us:
+//      port outputs (OUT & DIR, DIR) once LOCKLPM5 is cleared, UART bytes
+//      sent and received, I2C transactions, resets, FRAM writes blocked
+//      by SYSCFG0, checks and their values. A summary goes to stderr at
+//      the end.
+//  __________________________________________________________________________________*/
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "msp430.h"
+
+typedef uint64_t Sim_Time;
+
+#define SIM_UNITS_PER_US    512ULL
+#define SIM_UNITS_PER_S     (SIM_UNITS_PER_US * 1000000ULL)
+#define SIM_NEVER           UINT64_MAX
+#define SIM_SYNC_CYCLES     20              // MCLK cycles charged per sync point
+#define SIM_ISR_CYCLES      11              // Interrupt entry + RETI
+#define SIM_DCO_WAKE_US     10              // DCO restart from LPM3 (supervisor.h)
+
+// Clocks
+#define SIM_CLK_MCLK        0
+#define SIM_CLK_SMCLK       1
+#define SIM_CLK_ACLK        2
+#define SIM_CLK_MODCLK      3
+#define SIM_CLK_VLO         4
+#define SIM_CLK_REFO        5
+#define SIM_CLK_SMCLK_REQ   6               // SMCLK as a module clock request sees it, SCG1 ignored
+#define SIM_CLKS            7
+
+// Peripheral model. sync() picks up register writes at Sim_Now, next()
+// is the time of its next event, SIM_NEVER if none, run() runs the events
+// due at Sim_Now. The core asks each model for its pending interrupts by
+// vector (Sim_xxPending).
+typedef struct
+{
+    const char *name;
+    void (*reset)(void);
+    void (*sync)(void);
+    Sim_Time (*next)(void);
+    void (*run)(void);
+} Sim_Module;
+
+extern Sim_Time Sim_Now;
+extern Sim_Time Sim_End;
+extern uint16_t Sim_SR;
+extern FILE *Sim_Trace;
+
+// sim_core.c
+void Sim_Error(const char *fmt, ...);
+void Sim_Log(const char *fmt, ...);
+void Sim_Reset(const char *why);
+void Sim_Stop(const char *why);
+uint32_t Sim_ClockHz(unsigned char clk);
+Sim_Time Sim_ClockPeriod(unsigned char clk);
+void Sim_SyncPoint(void);
+double Sim_ModePercent(unsigned char mode);
+
+// sim_port.c
+extern const Sim_Module Sim_Port;
+void Sim_PinDrive(unsigned char port, unsigned char bit, int level);
+unsigned char Sim_PinLevel(unsigned char port, unsigned char bit);
+Sim_Time Sim_PinHigh(unsigned char port, unsigned char bit);
+uint8_t Sim_PortIV(unsigned char port);
+uint8_t Sim_PortPending(unsigned char port);
+
+// sim_timer.c
+extern const Sim_Module Sim_Timer;
+void Sim_TimerInputs(void);
+uint16_t Sim_TimerIV(unsigned char t);
+uint8_t Sim_TimerOutputs(unsigned char t);
+uint8_t Sim_TimerPending(unsigned char t, unsigned char vector);
+
+// sim_adc.c
+extern const Sim_Module Sim_Adc;
+void Sim_AdcTrigger(unsigned char source);
+void Sim_AdcSet(unsigned char ch, uint16_t code);
+void Sim_AdcLoad(unsigned char ch, unsigned char port, int bit);
+uint16_t Sim_AdcIV(void);
+uint8_t Sim_AdcPending(void);
+
+// sim_eusci.c
+extern const Sim_Module Sim_Eusci;
+void Sim_UartInject(unsigned char a, const uint8_t *data, unsigned int n);
+void Sim_GaugeSet(unsigned char bus, uint8_t cmd, uint16_t value);
+void Sim_GaugeMode(unsigned char bus, char mode);
+uint16_t Sim_EusciIV(unsigned char which);
+uint8_t Sim_EusciPending(unsigned char which);
+void Sim_EusciStats(void);
+
+// sim_misc.c
+extern const Sim_Module Sim_Misc;
+uint16_t Sim_RtcIV(void);
+uint8_t Sim_RtcPending(void);
+uint8_t Sim_WdtPending(void);
+void Sim_TlvSet(uint16_t addr, uint16_t value);
+void Sim_FramLoad(const char *path, int protect);
+void Sim_FramSave(const char *path);
+void Sim_FramCheck(void);
+uint16_t Sim_Crc16(uint16_t crc, const uint8_t *data, unsigned int n);
+uint32_t Sim_FramBlocked(void);
+
+// sim_script.c
+extern const Sim_Module Sim_Script;
+int Sim_ScriptLoad(const char *path);
+void Sim_ScriptHostByte(uint8_t byte);
+void Sim_ScriptFinish(int halted);
+
+#endif /* SIM_H_ */
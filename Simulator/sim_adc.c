@@ -0,0 +1,199 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: ADC. Channel results come from the script (12 bit codes,
+//  scaled to ADCRES), mid scale until set; the internal channels start at
+//  their codes against a 3.3 V AVCC (A13 1.5 V reference 1862, A14 DVSS 0,
+//  A15 DVCC 4095), A12 at the temperature sensor's code for 25 degC against
+//  the 1.5 V reference with the nominal TLV (2150). Single channel, sequence
+//  (ADCINCH down to A0), repeat single and repeat sequence, one
+//  conversion per trigger unless ADCMSC; triggered by ADCSC or, with
+//  ADCSHS_1..3, by the rising TB0.1/TB1.1/TB2.1 output. A channel may be
+//  gated by a pin (Sim_AdcLoad()): it then reads its code while the pin is
+//  high and 0 while it is low, a load switched by that pin. A conversion takes
+//  the sample time plus the resolution in ADCCLK cycles. Clearing ADCENC
+//  ends the sequence after the conversion in progress. The window
+//  comparator, reference and temperature sensor are not modeled.
+//  __________________________________________________________________________________*/
+#include "sim.h"
+
+#define SIM_ADC_CHANNELS    16
+#define SIM_ADC_UNGATED     0xFF
+
+static uint16_t Sim_AdcCodes[SIM_ADC_CHANNELS];
+static unsigned char Sim_AdcGate[SIM_ADC_CHANNELS];     // Port << 3 | bit, SIM_ADC_UNGATED
+static unsigned char Sim_AdcCh;                 // Channel of the conversion in progress or next
+static unsigned char Sim_AdcSeq;                // A sequence is under way
+static unsigned char Sim_AdcBusy;
+static Sim_Time Sim_AdcDone;
+static uint16_t Sim_AdcCfg[2];                  // ADCCTL1, ADCMCTL0 at the last sync
+
+static const uint16_t Sim_AdcSample[16] =
+{
+    4, 8, 16, 32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1024, 1024, 1024
+};
+
+static unsigned char Sim_AdcBits(void)
+{
+    return 8 + ((ADCCTL2 & ADCRES) >> 4) * 2;
+}
+
+static void Sim_AdcStart(void)
+{
+    Sim_Time clk;
+    static const uint8_t pdiv[4] = { 1, 4, 64, 1 };
+
+    switch(ADCCTL1 & ADCSSEL)
+    {
+        case ADCSSEL_1: clk = Sim_ClockPeriod(SIM_CLK_ACLK); break;
+        case ADCSSEL_2:
+        case ADCSSEL_3: clk = Sim_ClockPeriod(SIM_CLK_SMCLK); break;
+        default:        clk = 0; break;
+    }
+    if(clk == 0)
+        clk = Sim_ClockPeriod(SIM_CLK_MODCLK);  // MODOSC, or the source's clock request
+    clk *= (((ADCCTL1 & ADCDIV) >> 5) + 1) * pdiv[(ADCCTL2 >> 8) & 3];
+
+    if(!Sim_AdcSeq || !(ADCCTL1 & ADCCONSEQ_1))
+    {
+        Sim_AdcCh = ADCMCTL0 & ADCINCH;
+        Sim_AdcSeq = 1;
+    }
+    Sim_AdcBusy = 1;
+    Sim_AdcDone = Sim_Now + clk * (Sim_AdcSample[(ADCCTL0 & ADCSHT) >> 8] + Sim_AdcBits() + 2);
+}
+
+void Sim_AdcTrigger(unsigned char source)
+{
+    if((ADCCTL0 & (ADCON | ADCENC)) != (ADCON | ADCENC))
+        return;
+    if(((ADCCTL1 & ADCSHS) >> 10) != source || Sim_AdcBusy)
+        return;
+    Sim_AdcStart();
+}
+
+void Sim_AdcSet(unsigned char ch, uint16_t code)
+{
+    if(ch < SIM_ADC_CHANNELS)
+        Sim_AdcCodes[ch] = code & 0x0FFF;
+}
+
+// Channel ch reads 0 while the pin is low, bit < 0 removes the gate
+void Sim_AdcLoad(unsigned char ch, unsigned char port, int bit)
+{
+    if(ch < SIM_ADC_CHANNELS)
+        Sim_AdcGate[ch] = bit < 0 ? SIM_ADC_UNGATED : (unsigned char)((port << 3) | bit);
+}
+
+static void Sim_AdcReset(void)
+{
+    unsigned char ch;
+
+    ADCCTL0 = 0;
+    ADCCTL1 = 0;
+    ADCCTL2 = ADCRES_1;
+    ADCMCTL0 = 0;
+    ADCMEM0 = 0;
+    ADCIE = 0;
+    ADCIFG = 0;
+    ADCLO = 0;
+    ADCHI = 0x03FF;
+    for(ch = 0; ch < SIM_ADC_CHANNELS; ch++)
+    {
+        Sim_AdcCodes[ch] = 0x0800;
+        Sim_AdcGate[ch] = SIM_ADC_UNGATED;
+    }
+    Sim_AdcCodes[12] = 2150;
+    Sim_AdcCodes[13] = 1862;
+    Sim_AdcCodes[14] = 0;
+    Sim_AdcCodes[15] = 0x0FFF;
+    Sim_AdcSeq = 0;
+    Sim_AdcBusy = 0;
+    Sim_AdcCfg[0] = Sim_AdcCfg[1] = 0;
+}
+
+static void Sim_AdcSync(void)
+{
+    if(!Sim_AdcBusy && (ADCCTL1 != Sim_AdcCfg[0] || ADCMCTL0 != Sim_AdcCfg[1]))
+        Sim_AdcSeq = 0;                         // Reconfigured, ENC toggled in between
+    Sim_AdcCfg[0] = ADCCTL1;
+    Sim_AdcCfg[1] = ADCMCTL0;
+    if(!(ADCCTL0 & ADCON))
+    {
+        Sim_AdcBusy = 0;                        // Off: conversion lost
+        Sim_AdcSeq = 0;
+    }
+    else if(!(ADCCTL0 & ADCENC))
+        Sim_AdcSeq = Sim_AdcBusy;               // Ends with the conversion in progress
+    if(ADCCTL0 & ADCSC)
+    {
+        if((ADCCTL0 & (ADCON | ADCENC)) == (ADCON | ADCENC))
+        {
+            ADCCTL0 &= ~ADCSC;
+            if((ADCCTL1 & ADCSHS) == ADCSHS_0 && !Sim_AdcBusy)
+                Sim_AdcStart();
+        }
+    }
+    ADCCTL1 &= ~ADCBUSY;                        // Polled, see sim.h
+}
+
+static Sim_Time Sim_AdcNext(void)
+{
+    return Sim_AdcBusy ? Sim_AdcDone : SIM_NEVER;
+}
+
+static void Sim_AdcRun(void)
+{
+    unsigned char last;
+    unsigned char gate;
+    uint16_t conseq;
+    uint16_t code;
+
+    if(!Sim_AdcBusy || Sim_Now < Sim_AdcDone)
+        return;
+    Sim_AdcBusy = 0;
+    if(ADCIFG & ADCIFG0)
+        ADCIFG |= ADCOVIFG;
+    code = Sim_AdcCodes[Sim_AdcCh];
+    gate = Sim_AdcGate[Sim_AdcCh];
+    if(gate != SIM_ADC_UNGATED && !Sim_PinLevel(gate >> 3, gate & 7))
+        code = 0;
+    ADCMEM0 = code >> (12 - Sim_AdcBits());
+    ADCIFG |= ADCIFG0;
+
+    conseq = ADCCTL1 & ADCCONSEQ;
+    last = Sim_AdcCh == 0;
+    if(conseq == ADCCONSEQ_1 || conseq == ADCCONSEQ_3)
+        Sim_AdcCh = last ? (ADCMCTL0 & ADCINCH) : Sim_AdcCh - 1;
+    if(conseq == ADCCONSEQ_0 || (conseq == ADCCONSEQ_1 && last) || !(ADCCTL0 & ADCENC))
+    {
+        Sim_AdcSeq = 0;
+        return;
+    }
+    if(ADCCTL0 & ADCMSC)
+        Sim_AdcStart();                         // Next conversion without a trigger
+}
+
+// ADCIV: OV, TOV, HI, LO, IN, IFG0, enabled flags only
+uint16_t Sim_AdcIV(void)
+{
+    static const uint16_t order[6] = { ADCOVIFG, ADCTOVIFG, ADCHIIFG, ADCLOIFG, ADCINIFG, ADCIFG0 };
+    unsigned char i;
+
+    for(i = 0; i < 6; i++)
+    {
+        if(ADCIFG & ADCIE & order[i])
+        {
+            ADCIFG &= ~order[i];
+            return 2 * (i + 1);
+        }
+    }
+    return 0;
+}
+
+uint8_t Sim_AdcPending(void)
+{
+    return (ADCIFG & ADCIE) != 0;
+}
+
+const Sim_Module Sim_Adc = { "adc", Sim_AdcReset, Sim_AdcSync, Sim_AdcNext, Sim_AdcRun };
@@ -0,0 +1,522 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator core: time, sync points, SR and low power modes, interrupt
+//  dispatch, the intrinsics and the command line driver. See sim.h.
+//  __________________________________________________________________________________*/
+#include <getopt.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim.h"
+
+Sim_Time Sim_Now;
+Sim_Time Sim_End;
+uint16_t Sim_SR;
+FILE *Sim_Trace;
+
+void Sim_FirmwareMain(void);
+
+static const Sim_Module *const Sim_Modules[] =
+{
+    &Sim_Script, &Sim_Port, &Sim_Timer, &Sim_Adc, &Sim_Eusci, &Sim_Misc
+};
+#define SIM_MODULES         (sizeof(Sim_Modules) / sizeof(Sim_Modules[0]))
+
+// ISRs by vector section (msp430.h), highest priority first
+#define SIM_ISR_START(v)    extern const char __start_sim_isr_##v[] __attribute__((weak));
+SIM_VECTORS(SIM_ISR_START)
+
+typedef struct
+{
+    const char *name;
+    const char *isr;
+    unsigned char vector;
+} Sim_Vector;
+
+#define SIM_VECTOR_ENTRY(v) { #v, __start_sim_isr_##v, v },
+static const Sim_Vector Sim_Vectors[] = { SIM_VECTORS(SIM_VECTOR_ENTRY) };
+#define SIM_VECTOR_COUNT    (sizeof(Sim_Vectors) / sizeof(Sim_Vectors[0]))
+
+#define SIM_MAX_NESTING     16
+
+static uint16_t Sim_Frames[SIM_MAX_NESTING];    // SR saved on ISR entry
+static unsigned char Sim_Depth;
+static uint32_t Sim_IsrCount[SIM_VECTOR_COUNT];
+static uint8_t Sim_Unhandled[SIM_VECTOR_COUNT];
+static Sim_Time Sim_ModeTime[4];                // Active, LPM0, LPM3 (LPM1..3), LPM4
+static uint32_t Sim_Wakeups;
+static uint32_t Sim_Errors;
+static sigjmp_buf Sim_Exit;
+static const char *Sim_Why = "time limit";
+
+void Sim_Log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if(Sim_Trace == NULL)
+        return;
+    fprintf(Sim_Trace, "%12.3f ", (double)Sim_Now / SIM_UNITS_PER_US);
+    va_start(ap, fmt);
+    vfprintf(Sim_Trace, fmt, ap);
+    va_end(ap);
+    fputc('\n', Sim_Trace);
+}
+
+void Sim_Error(const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "sim: %.3f us: ", (double)Sim_Now / SIM_UNITS_PER_US);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    Sim_Errors++;
+}
+
+void Sim_Stop(const char *why)
+{
+    Sim_Why = why;
+    siglongjmp(Sim_Exit, 1);
+}
+
+// Ctrl-C: a loop with no sync point in it (while(1);) never gets back to
+// the simulator, so it is stopped from the signal
+static void Sim_Interrupted(int sig)
+{
+    (void)sig;
+    Sim_Stop("interrupted");
+}
+
+void Sim_Reset(const char *why)
+{
+    Sim_Log("reset %s", why);
+    Sim_Stop(why);
+}
+
+// Clock frequencies from CS and the SR oscillator bits, 0 = stopped
+uint32_t Sim_ClockHz(unsigned char clk)
+{
+    uint32_t hz;
+
+    switch(clk)
+    {
+        case SIM_CLK_MCLK:
+        case SIM_CLK_SMCLK:
+        case SIM_CLK_SMCLK_REQ:
+            switch(CSCTL4 & SELMS)
+            {
+                case SELMS__DCOCLKDIV:  hz = 32768UL * ((CSCTL2 & FLLN) + 1); break;
+                case SELMS__VLOCLK:     hz = 10000; break;
+                default:                hz = 32768; break;
+            }
+            hz >>= (CSCTL5 & DIVM);
+            if(clk == SIM_CLK_MCLK)
+                return (Sim_SR & CPUOFF) ? 0 : hz;
+            if(((Sim_SR & SCG1) && clk == SIM_CLK_SMCLK) || (CSCTL5 & SMCLKOFF))
+                return 0;
+            return hz >> ((CSCTL5 & DIVS) >> 4);
+        case SIM_CLK_ACLK:
+            if(Sim_SR & OSCOFF)
+                return 0;
+            return (CSCTL4 & SELA) == SELA__VLOCLK ? 10000 : 32768;
+        case SIM_CLK_MODCLK:
+            return 5120000;
+        case SIM_CLK_VLO:
+            return 10000;
+        case SIM_CLK_REFO:
+            return (Sim_SR & OSCOFF) ? 0 : 32768;
+    }
+    return 0;
+}
+
+// One clock period in time units, 0 = stopped
+Sim_Time Sim_ClockPeriod(unsigned char clk)
+{
+    uint32_t hz = Sim_ClockHz(clk);
+
+    if(hz == 0)
+        return 0;
+    return (SIM_UNITS_PER_S + hz / 2) / hz;
+}
+
+static unsigned char Sim_Mode(void)
+{
+    if(!(Sim_SR & CPUOFF))
+        return 0;
+    if(Sim_SR & OSCOFF)
+        return 3;
+    if(Sim_SR & (SCG0 | SCG1))
+        return 2;
+    return 1;
+}
+
+// Register writes since the last sync point
+static void Sim_Pickup(void)
+{
+    unsigned char i;
+
+    for(i = 0; i < SIM_MODULES; i++)
+        if(Sim_Modules[i]->sync)
+            Sim_Modules[i]->sync();
+}
+
+static Sim_Time Sim_NextEvent(void)
+{
+    Sim_Time next = SIM_NEVER;
+    Sim_Time t;
+    unsigned char i;
+
+    for(i = 0; i < SIM_MODULES; i++)
+    {
+        t = Sim_Modules[i]->next();
+        if(t < next)
+            next = t;
+    }
+    return next;
+}
+
+// Run the peripherals up to target
+static void Sim_Advance(Sim_Time target)
+{
+    Sim_Time t;
+    unsigned char i;
+
+    if(target > Sim_End)
+        target = Sim_End;
+    while((t = Sim_NextEvent()) <= target)
+    {
+        if(t > Sim_Now)
+        {
+            Sim_ModeTime[Sim_Mode()] += t - Sim_Now;
+            Sim_Now = t;
+        }
+        for(i = 0; i < SIM_MODULES; i++)
+            Sim_Modules[i]->run();
+    }
+    Sim_ModeTime[Sim_Mode()] += target - Sim_Now;
+    Sim_Now = target;
+    if(Sim_Now >= Sim_End)
+        Sim_Stop("time limit");
+}
+
+static void Sim_Charge(uint32_t cycles)
+{
+    Sim_Advance(Sim_Now + cycles * Sim_ClockPeriod(SIM_CLK_MCLK));
+}
+
+// SR change: the peripherals run to now on the old clocks, then pick up the new ones
+static void Sim_SetSR(uint16_t sr)
+{
+    Sim_Pickup();
+    Sim_SR = sr;
+    Sim_Pickup();
+}
+
+static int Sim_Pending(void)
+{
+    unsigned char i;
+    unsigned char v;
+    uint8_t pending;
+
+    for(i = 0; i < SIM_VECTOR_COUNT; i++)
+    {
+        v = Sim_Vectors[i].vector;
+        switch(v)
+        {
+            case TIMER0_B0_VECTOR: case TIMER1_B0_VECTOR: case TIMER2_B0_VECTOR: case TIMER3_B0_VECTOR:
+                pending = Sim_TimerPending((TIMER0_B0_VECTOR - v) / 2, 0);
+                break;
+            case TIMER0_B1_VECTOR: case TIMER1_B1_VECTOR: case TIMER2_B1_VECTOR: case TIMER3_B1_VECTOR:
+                pending = Sim_TimerPending((TIMER0_B1_VECTOR - v) / 2, 1);
+                break;
+            case RTC_VECTOR:        pending = Sim_RtcPending(); break;
+            case WDT_VECTOR:        pending = Sim_WdtPending(); break;
+            case USCI_A0_VECTOR:    pending = Sim_EusciPending(0); break;
+            case USCI_A1_VECTOR:    pending = Sim_EusciPending(1); break;
+            case USCI_B0_VECTOR:    pending = Sim_EusciPending(2); break;
+            case USCI_B1_VECTOR:    pending = Sim_EusciPending(3); break;
+            case ADC_VECTOR:        pending = Sim_AdcPending(); break;
+            case PORT1_VECTOR: case PORT2_VECTOR: case PORT3_VECTOR: case PORT4_VECTOR:
+                pending = Sim_PortPending(PORT1_VECTOR - v);
+                break;
+            default:                pending = 0; break;
+        }
+        if(!pending)
+            continue;
+        if(Sim_Vectors[i].isr != NULL)
+            return i;
+        if(!Sim_Unhandled[i])
+        {
+            Sim_Error("%s pending with no ISR, ignored", Sim_Vectors[i].name);
+            Sim_Unhandled[i] = 1;
+        }
+    }
+    return -1;
+}
+
+// Single source vectors clear their flag on entry
+static void Sim_Acknowledge(unsigned char v)
+{
+    switch(v)
+    {
+        case TIMER0_B0_VECTOR:  TB0CCTL0 &= ~CCIFG; break;
+        case TIMER1_B0_VECTOR:  TB1CCTL0 &= ~CCIFG; break;
+        case TIMER2_B0_VECTOR:  TB2CCTL0 &= ~CCIFG; break;
+        case TIMER3_B0_VECTOR:  TB3CCTL0 &= ~CCIFG; break;
+        case WDT_VECTOR:        SFRIFG1 &= ~WDTIFG; break;
+        default:                break;
+    }
+}
+
+static void Sim_Call(int i)
+{
+    void (*isr)(void) = (void (*)(void))(uintptr_t)Sim_Vectors[i].isr;
+    uint16_t sr;
+
+    if(Sim_Depth == SIM_MAX_NESTING)
+    {
+        Sim_Error("ISR nesting over %d", SIM_MAX_NESTING);
+        Sim_Stop("stack overflow");
+    }
+    Sim_Frames[Sim_Depth++] = Sim_SR;
+    Sim_SetSR(Sim_SR & ~(GIE | LPM4_bits));
+    Sim_IsrCount[i]++;
+    Sim_Acknowledge(Sim_Vectors[i].vector);
+    isr();
+    Sim_Pickup();
+    Sim_Charge(SIM_ISR_CYCLES);
+    sr = Sim_Frames[--Sim_Depth];
+    Sim_SetSR(sr);
+}
+
+static void Sim_Dispatch(void)
+{
+    int i;
+
+    while((Sim_SR & GIE) && (i = Sim_Pending()) >= 0)
+        Sim_Call(i);
+}
+
+// Asleep until an ISR clears CPUOFF on exit
+static void Sim_Sleep(void)
+{
+    Sim_Time next;
+    int i;
+
+    while(Sim_SR & CPUOFF)
+    {
+        if((Sim_SR & GIE) && (i = Sim_Pending()) >= 0)
+        {
+            Sim_Call(i);
+            if(!(Sim_SR & CPUOFF))
+                Sim_Wakeups++;
+            continue;
+        }
+        if(!(Sim_SR & GIE))
+        {
+            Sim_Log("halt, CPU off with GIE clear");
+            Sim_Stop("halted, CPU off with GIE clear");
+        }
+        next = Sim_NextEvent();
+        if(next == SIM_NEVER)
+            next = Sim_End;
+        Sim_Advance(next);
+    }
+}
+
+// Share of the run so far in a mode, as Sim_Mode(), in percent
+double Sim_ModePercent(unsigned char mode)
+{
+    return Sim_Now ? 100.0 * Sim_ModeTime[mode] / Sim_Now : 0.0;
+}
+
+static void Sim_Sync(uint32_t cycles)
+{
+    Sim_Pickup();
+    Sim_Charge(cycles);
+    Sim_Pickup();
+    Sim_Dispatch();
+}
+
+// Accessor registers (msp430.h): the peripherals catch up, no dispatch
+// until the access is done
+void Sim_SyncPoint(void)
+{
+    Sim_Pickup();
+    Sim_Charge(SIM_SYNC_CYCLES);
+    Sim_Pickup();
+}
+
+/************************************************************
+* Intrinsics
+************************************************************/
+void __bis_SR_register(uint16_t bits)
+{
+    Sim_Pickup();
+    Sim_Charge(SIM_SYNC_CYCLES);
+    Sim_SetSR(Sim_SR | bits);
+    Sim_Dispatch();
+    Sim_Sleep();
+}
+
+void __bic_SR_register(uint16_t bits)
+{
+    Sim_Pickup();
+    Sim_Charge(SIM_SYNC_CYCLES);
+    Sim_SetSR(Sim_SR & ~bits);
+    Sim_Dispatch();
+}
+
+void __bis_SR_register_on_exit(uint16_t bits)
+{
+    if(Sim_Depth == 0)
+        Sim_Error("__bis_SR_register_on_exit outside an ISR");
+    else
+        Sim_Frames[Sim_Depth - 1] |= bits;
+}
+
+void __bic_SR_register_on_exit(uint16_t bits)
+{
+    if(Sim_Depth == 0)
+        Sim_Error("__bic_SR_register_on_exit outside an ISR");
+    else
+        Sim_Frames[Sim_Depth - 1] &= ~bits;
+}
+
+uint16_t __get_SR_register(void)
+{
+    Sim_Sync(SIM_SYNC_CYCLES);
+    return Sim_SR;
+}
+
+void __enable_interrupt(void)
+{
+    Sim_Pickup();
+    Sim_SR |= GIE;
+    Sim_Sync(SIM_SYNC_CYCLES);
+}
+
+void __disable_interrupt(void)
+{
+    Sim_Sync(SIM_SYNC_CYCLES);
+    Sim_SR &= ~GIE;
+}
+
+void __no_operation(void)
+{
+    Sim_Sync(1);
+}
+
+void __delay_cycles(uint32_t cycles)
+{
+    Sim_Sync(cycles);
+}
+
+/************************************************************
+* Driver
+************************************************************/
+static void Sim_Usage(void)
+{
+    fprintf(stderr,
+        "usage: sim [-t seconds] [-s script] [-o trace] [--fram file] [--no-frwp]\n"
+        "  -t seconds     simulated time to run, default 10\n"
+        "  -s script      input waveforms and host traffic (sim.h)\n"
+        "  -o trace       event trace, - for stdout\n"
+        "  --fram file    PERSISTENT FRAM contents, loaded and saved back\n"
+        "  --no-frwp      FRAM write protected from reset (no _FRWP_ENABLE)\n");
+    exit(2);
+}
+
+static void Sim_Summary(double wall)
+{
+    double sim = (double)Sim_Now / SIM_UNITS_PER_S;
+    double total = Sim_Now ? (double)Sim_Now : 1.0;
+    unsigned char i;
+
+    fprintf(stderr, "sim: stopped at %.6f s: %s\n", sim, Sim_Why);
+    fprintf(stderr, "sim: %.3f s wall, %.0fx real time\n", wall, wall > 0 ? sim / wall : 0.0);
+    fprintf(stderr, "sim: active %.2f%%, LPM0 %.2f%%, LPM1..3 %.2f%%, LPM4 %.2f%%, %u wakeups\n",
+            100.0 * Sim_ModeTime[0] / total, 100.0 * Sim_ModeTime[1] / total,
+            100.0 * Sim_ModeTime[2] / total, 100.0 * Sim_ModeTime[3] / total, Sim_Wakeups);
+    for(i = 0; i < SIM_VECTOR_COUNT; i++)
+        if(Sim_IsrCount[i])
+            fprintf(stderr, "sim: %-18s %u\n", Sim_Vectors[i].name, Sim_IsrCount[i]);
+    Sim_EusciStats();
+    if(Sim_FramBlocked())
+        fprintf(stderr, "sim: %u FRAM writes blocked\n", Sim_FramBlocked());
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] =
+    {
+        { "fram", required_argument, NULL, 'f' },
+        { "no-frwp", no_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 }
+    };
+    const char *script = NULL;
+    const char *trace = NULL;
+    const char *fram = NULL;
+    double seconds = 10.0;
+    int protect = 1;
+    struct timespec t0, t1;
+    unsigned char i;
+    int c;
+
+    while((c = getopt_long(argc, argv, "t:s:o:", options, NULL)) != -1)
+    {
+        switch(c)
+        {
+            case 't': seconds = atof(optarg); break;
+            case 's': script = optarg; break;
+            case 'o': trace = optarg; break;
+            case 'f': fram = optarg; break;
+            case 'p': protect = 0; break;
+            default: Sim_Usage();
+        }
+    }
+    if(optind != argc || seconds <= 0)
+        Sim_Usage();
+
+    if(trace != NULL)
+    {
+        Sim_Trace = strcmp(trace, "-") == 0 ? stdout : fopen(trace, "w");
+        if(Sim_Trace == NULL)
+        {
+            perror(trace);
+            return 2;
+        }
+    }
+    if(script != NULL && Sim_ScriptLoad(script) != 0)
+        return 2;
+
+    Sim_End = (Sim_Time)(seconds * SIM_UNITS_PER_S);
+    Sim_SR = 0;
+    for(i = 0; i < SIM_MODULES; i++)
+        Sim_Modules[i]->reset();
+    Sim_FramLoad(fram, protect);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    signal(SIGINT, Sim_Interrupted);
+    signal(SIGTERM, Sim_Interrupted);
+    if(sigsetjmp(Sim_Exit, 1) == 0)
+    {
+        Sim_FirmwareMain();
+        Sim_Why = "main returned";
+    }
+    else if(strcmp(Sim_Why, "interrupted") == 0 && sigsetjmp(Sim_Exit, 1) == 0)
+        Sim_Pickup();                   // Writes since the last sync point, for the trace
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    Sim_ScriptFinish(strncmp(Sim_Why, "halted", 6) == 0);
+
+    if(fram != NULL)
+        Sim_FramSave(fram);
+    if(Sim_Trace != NULL && Sim_Trace != stdout)
+        fclose(Sim_Trace);
+    Sim_Summary((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    return Sim_Errors ? 1 : 0;
+}
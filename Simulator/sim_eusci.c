@@ -0,0 +1,577 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: eUSCI_A0/A1 UART and eUSCI_B0/B1 I2C master.
+//
+//  UART: bit time from UCBRW/UCBRF (UCOS16) and the clock, start, data,
+//  parity and stop bits per character. TX has the buffer and the shift
+//  register: UCTXIFG when the buffer is free, UCTXCPTIFG when both are
+//  empty. RX bytes come from the script at the current baud rate, with
+//  UCSTTIFG at the start bit; UCOE is set on an overrun. SMCLK stays on
+//  for the bit clock in LPM3 (automatic clock activation, sim.h), but a
+//  character whose start bit comes in LPM3 is read SIM_DCO_WAKE_US late,
+//  as the DCO restarts. Bytes are traced in lines of up to 32.
+//
+//  I2C: master transactions with 9 SCL periods per byte (UCBRW of the
+//  clock), START/repeated START with UCTXSTT and UCTR, UCTXSTP after the
+//  byte in progress, NACKIFG from an absent slave, UCCLTO from a slave
+//  holding SCL low. Each bus has a smart battery gauge at SBS_ADDRESS that
+//  answers word reads (command, repeated START, low byte, high byte).
+//  __________________________________________________________________________________*/
+#include "sim.h"
+
+#define SIM_TX_EMPTY        0xFFFF          // TXBUF after the byte was taken
+#define SIM_RX_QUEUE        4096
+#define SIM_LINE_BYTES      32
+#define SIM_GAUGE_ADDRESS   0x0B
+
+typedef struct
+{
+    volatile uint16_t *ctlw0;
+    volatile uint16_t *ctlw1;
+    volatile uint16_t *brw;
+    volatile uint16_t *mctlw;
+    volatile uint16_t *statw;
+    volatile uint16_t *rxbuf;
+    volatile uint16_t *txbuf;
+    volatile uint16_t *ie;
+    volatile uint16_t *ifg;
+    volatile uint16_t *i2csa;
+} Sim_EusciRegs;
+
+static const Sim_EusciRegs Sim_EusciRegs_[4] =
+{
+    { &UCA0CTLW0, &UCA0CTLW1, &UCA0BRW, &UCA0MCTLW, &UCA0STATW, &UCA0RXBUF, &UCA0TXBUF, &UCA0IE, &UCA0IFG, NULL },
+    { &UCA1CTLW0, &UCA1CTLW1, &UCA1BRW, &UCA1MCTLW, &UCA1STATW, &UCA1RXBUF, &UCA1TXBUF, &UCA1IE, &UCA1IFG, NULL },
+    { &UCB0CTLW0, &UCB0CTLW1, &UCB0BRW, NULL, &UCB0STATW, &UCB0RXBUF, &UCB0TXBUF, &UCB0IE, &UCB0IFG, &UCB0I2CSA },
+    { &UCB1CTLW0, &UCB1CTLW1, &UCB1BRW, NULL, &UCB1STATW, &UCB1RXBUF, &UCB1TXBUF, &UCB1IE, &UCB1IFG, &UCB1I2CSA }
+};
+
+// I2C master phases
+#define SIM_I2C_IDLE        0
+#define SIM_I2C_START       1               // START + address + ACK
+#define SIM_I2C_TX_WAIT     2               // Waiting for TXBUF, STT or STP
+#define SIM_I2C_TX          3               // Byte + ACK
+#define SIM_I2C_RX          4               // Byte + ACK/NACK
+#define SIM_I2C_STOP        5
+#define SIM_I2C_NACKED      6               // Holding the bus after a NACK
+#define SIM_I2C_STUCK       7               // SCL held low by the slave
+
+typedef struct
+{
+    unsigned char in_reset;
+    // UART
+    unsigned char tx_busy;
+    unsigned char tx_full;
+    uint8_t tx_shift;
+    uint8_t tx_buf;
+    Sim_Time tx_done;
+    uint8_t rx_queue[SIM_RX_QUEUE];
+    unsigned int rx_head;
+    unsigned int rx_tail;
+    unsigned char rx_busy;
+    unsigned char rx_cold;                  // Started with SMCLK off, sampled SIM_DCO_WAKE_US late
+    Sim_Time rx_done;
+    uint8_t line[SIM_LINE_BYTES];
+    unsigned char line_len;
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t rx_lost;
+    unsigned char overwrite_seen;
+    // I2C
+    unsigned char phase;
+    unsigned char bits;                     // Bit times of the phase, to restart on a stopped clock
+    Sim_Time event;
+    unsigned char tr;
+    unsigned char rx_index;
+    uint8_t cmd;
+    uint8_t rx[2];
+    uint32_t reads;
+    uint32_t nacks;
+    uint32_t timeouts;
+} Sim_EusciState;
+
+typedef struct
+{
+    uint16_t regs[256];
+    char mode;                              // 'y' present, 'n' absent (NACK), 's' holding SCL low
+} Sim_GaugeState;
+
+static Sim_EusciState Sim_Eusci_[4];
+static Sim_GaugeState Sim_Gauges[2];
+
+static Sim_Time Sim_EusciBit(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    Sim_Time clk;
+
+    switch(*regs->ctlw0 & UCSSEL)
+    {
+        case UCSSEL__ACLK:  clk = Sim_ClockPeriod(SIM_CLK_ACLK); break;
+        case UCSSEL__SMCLK:
+        case UCSSEL_3:      clk = Sim_ClockPeriod(u < 2 ? SIM_CLK_SMCLK_REQ : SIM_CLK_SMCLK); break;
+        default:            clk = 0; break;
+    }
+    if(regs->mctlw != NULL && (*regs->mctlw & UCOS16))
+        return clk * (16 * (Sim_Time)*regs->brw + ((*regs->mctlw & UCBRF) >> 4));
+    return clk * (*regs->brw ? *regs->brw : 1);
+}
+
+/************************************************************
+* UART
+************************************************************/
+static unsigned char Sim_UartBits(unsigned char u)
+{
+    uint16_t ctl = *Sim_EusciRegs_[u].ctlw0;
+
+    return 1 + ((ctl & UC7BIT) ? 7 : 8) + ((ctl & UCPEN) ? 1 : 0) + ((ctl & UCSPB) ? 2 : 1);
+}
+
+static Sim_Time Sim_UartChar(unsigned char u)
+{
+    Sim_Time bit = Sim_EusciBit(u);
+
+    return bit ? bit * Sim_UartBits(u) : SIM_NEVER;
+}
+
+// A character whose start bit came with SMCLK off (LPM3): the DCO only
+// runs SIM_DCO_WAKE_US later, so its data bits are sampled that many bit
+// times late, the bits past the stop bit read as the idle line (1)
+static uint8_t Sim_UartCold(unsigned char u, uint8_t value)
+{
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    Sim_Time bit = Sim_EusciBit(u);
+    Sim_Time late;
+    uint8_t got;
+
+    if(!s->rx_cold)
+        return value;
+    s->rx_cold = 0;
+    late = bit ? (SIM_DCO_WAKE_US * SIM_UNITS_PER_US + bit / 2) / bit : 0;
+    got = late >= 8 ? 0xFF : (uint8_t)(value >> late | 0xFF << (8 - late));
+    if(got != value)
+        Sim_Log("uart%u rx %02x read as %02x, start bit with SMCLK off", u, value, got);
+    return got;
+}
+
+static void Sim_UartFlush(unsigned char u)
+{
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    char text[3 * SIM_LINE_BYTES + 1];
+    unsigned char i;
+
+    if(s->line_len == 0)
+        return;
+    for(i = 0; i < s->line_len; i++)
+        sprintf(&text[3 * i], " %02x", s->line[i]);
+    Sim_Log("uart%u tx%s", u, text);
+    s->line_len = 0;
+}
+
+static void Sim_UartShift(unsigned char u, uint8_t byte)
+{
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    Sim_Time t = Sim_UartChar(u);
+
+    s->tx_busy = 1;
+    s->tx_shift = byte;
+    s->tx_done = t == SIM_NEVER ? SIM_NEVER : Sim_Now + t;
+}
+
+static void Sim_UartSync(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    uint8_t byte;
+
+    if(s->tx_busy && s->tx_done == SIM_NEVER && Sim_UartChar(u) != SIM_NEVER)
+        s->tx_done = Sim_Now + Sim_UartChar(u); // Clock back
+    if(*regs->txbuf == SIM_TX_EMPTY)
+        return;
+    byte = (uint8_t)*regs->txbuf;
+    *regs->txbuf = SIM_TX_EMPTY;
+    *regs->ifg &= ~UCTXCPTIFG;
+    if(!s->tx_busy)
+    {
+        Sim_UartShift(u, byte);                 // Straight to the shift register, buffer free again
+        *regs->ifg |= UCTXIFG;
+    }
+    else
+    {
+        if(s->tx_full && !s->overwrite_seen)
+        {
+            Sim_Error("UCA%uTXBUF written while full, byte lost", u);
+            s->overwrite_seen = 1;
+        }
+        s->tx_full = 1;
+        s->tx_buf = byte;
+        *regs->ifg &= ~UCTXIFG;
+    }
+}
+
+static void Sim_UartRun(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    Sim_EusciState *s = &Sim_Eusci_[u];
+
+    if(s->tx_busy && Sim_Now >= s->tx_done)
+    {
+        s->line[s->line_len++] = s->tx_shift;
+        s->tx_bytes++;
+        if(u == 1)
+            Sim_ScriptHostByte(s->tx_shift);    // Host link frames, for expect
+        if(s->line_len == SIM_LINE_BYTES)
+            Sim_UartFlush(u);
+        s->tx_busy = 0;
+        if(s->tx_full)
+        {
+            s->tx_full = 0;
+            Sim_UartShift(u, s->tx_buf);
+            *regs->ifg |= UCTXIFG;
+        }
+        else
+        {
+            *regs->ifg |= UCTXCPTIFG;
+            Sim_UartFlush(u);
+        }
+    }
+    if(s->rx_busy && Sim_Now >= s->rx_done)
+    {
+        s->rx_busy = 0;
+        if(*regs->ifg & UCRXIFG)
+            *regs->statw |= 0x0020;             // UCOE
+        *regs->rxbuf = Sim_UartCold(u, s->rx_queue[s->rx_tail++ % SIM_RX_QUEUE]);
+        *regs->ifg |= UCRXIFG;
+        s->rx_bytes++;
+    }
+    if(!s->rx_busy && s->rx_tail != s->rx_head)
+    {
+        if(s->in_reset || Sim_UartChar(u) == SIM_NEVER)
+        {
+            s->rx_lost += s->rx_head - s->rx_tail; // Nobody listening
+            s->rx_tail = s->rx_head;
+        }
+        else
+        {
+            s->rx_busy = 1;
+            s->rx_cold = u < 2 && (*regs->ctlw0 & UCSSEL) >= UCSSEL__SMCLK && Sim_ClockHz(SIM_CLK_SMCLK) == 0;
+            s->rx_done = Sim_Now + Sim_UartChar(u);
+            *regs->ifg |= UCSTTIFG;             // Start bit
+        }
+    }
+}
+
+void Sim_UartInject(unsigned char a, const uint8_t *data, unsigned int n)
+{
+    Sim_EusciState *s = &Sim_Eusci_[a];
+    char text[3 * SIM_LINE_BYTES + 1];
+    unsigned int i;
+    unsigned int k = 0;
+
+    for(i = 0; i < n; i++)
+    {
+        if(s->rx_head - s->rx_tail < SIM_RX_QUEUE)
+            s->rx_queue[s->rx_head++ % SIM_RX_QUEUE] = data[i];
+        sprintf(&text[3 * k++], " %02x", data[i]);
+        if(k == SIM_LINE_BYTES || i == n - 1)
+        {
+            Sim_Log("uart%u rx%s", a, text);
+            k = 0;
+        }
+    }
+    Sim_UartRun(a);
+}
+
+/************************************************************
+* I2C master and gauge
+************************************************************/
+static void Sim_I2cPhase(unsigned char u, unsigned char phase, unsigned char bits)
+{
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    Sim_Time bit = Sim_EusciBit(u);
+
+    s->phase = phase;
+    s->bits = bits;
+    s->event = bit ? Sim_Now + bit * bits : SIM_NEVER;
+}
+
+static void Sim_I2cStuck(unsigned char u)
+{
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    static const uint16_t clto_ms[4] = { 0, 28, 31, 34 };
+    uint16_t ms = clto_ms[(*Sim_EusciRegs_[u].ctlw1 & UCCLTO) >> 6];
+
+    s->phase = SIM_I2C_STUCK;
+    s->event = ms ? Sim_Now + ms * 1000 * SIM_UNITS_PER_US : SIM_NEVER;
+}
+
+static void Sim_I2cSync(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    Sim_GaugeState *g = &Sim_Gauges[u - 2];
+    uint16_t ctl = *regs->ctlw0;
+
+    if((ctl & (UCMODE | UCMST | UCSYNC)) != (UCMODE_3 | UCMST | UCSYNC))
+        return;                                 // Only the I2C master is modeled
+    if(s->event == SIM_NEVER && s->phase != SIM_I2C_IDLE && s->phase != SIM_I2C_TX_WAIT
+       && s->phase != SIM_I2C_NACKED && s->phase != SIM_I2C_STUCK && Sim_EusciBit(u))
+        Sim_I2cPhase(u, s->phase, s->bits);     // Clock back
+
+    if(*regs->txbuf != SIM_TX_EMPTY)
+    {
+        if(s->phase == SIM_I2C_TX_WAIT)
+        {
+            if(s->rx_index == 0)
+                s->cmd = (uint8_t)*regs->txbuf; // Gauge command
+            s->rx_index++;
+            *regs->ifg &= ~UCTXIFG0;
+            Sim_I2cPhase(u, SIM_I2C_TX, 9);
+        }
+        *regs->txbuf = SIM_TX_EMPTY;
+    }
+    if((ctl & UCTXSTT) && (s->phase == SIM_I2C_IDLE || s->phase == SIM_I2C_TX_WAIT || s->phase == SIM_I2C_NACKED))
+    {
+        s->tr = (ctl & UCTR) ? 1 : 0;
+        *regs->ifg &= ~UCTXIFG0;
+        if(s->tr)
+            s->rx_index = 0;
+        if(g->mode == 's')
+            Sim_I2cStuck(u);
+        else
+            Sim_I2cPhase(u, SIM_I2C_START, 10);
+    }
+    else if((ctl & UCTXSTP) && (s->phase == SIM_I2C_IDLE || s->phase == SIM_I2C_TX_WAIT || s->phase == SIM_I2C_NACKED))
+        Sim_I2cPhase(u, SIM_I2C_STOP, 1);
+    *regs->statw &= ~(UCBBUSY | UCBUSY);        // Polled, see sim.h
+}
+
+static void Sim_I2cRun(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    Sim_EusciState *s = &Sim_Eusci_[u];
+    Sim_GaugeState *g = &Sim_Gauges[u - 2];
+    uint16_t value;
+
+    if(s->event == SIM_NEVER || Sim_Now < s->event)
+        return;
+    s->event = SIM_NEVER;
+    switch(s->phase)
+    {
+        case SIM_I2C_START:
+            *regs->ctlw0 &= ~UCTXSTT;
+            if(g->mode == 'n' || (*regs->i2csa & 0x7F) != SIM_GAUGE_ADDRESS)
+            {
+                s->phase = SIM_I2C_NACKED;
+                s->nacks++;
+                *regs->ifg |= UCNACKIFG;
+                Sim_Log("i2c%u nack %02x", u - 2, *regs->i2csa & 0x7F);
+            }
+            else if(s->tr)
+            {
+                s->phase = SIM_I2C_TX_WAIT;
+                *regs->ifg |= UCTXIFG0;
+            }
+            else
+            {
+                s->rx_index = 0;
+                Sim_I2cPhase(u, SIM_I2C_RX, 9);
+            }
+            break;
+        case SIM_I2C_TX:
+            s->phase = SIM_I2C_TX_WAIT;
+            *regs->ifg |= UCTXIFG0;
+            break;
+        case SIM_I2C_RX:
+            value = g->regs[s->cmd];
+            if(s->rx_index < 2)
+                s->rx[s->rx_index] = (uint8_t)(s->rx_index ? value >> 8 : value);
+            *regs->rxbuf = s->rx_index < 2 ? s->rx[s->rx_index] : 0xFF;
+            s->rx_index++;
+            *regs->ifg |= UCRXIFG0;
+            if(*regs->ctlw0 & UCTXSTP)
+                Sim_I2cPhase(u, SIM_I2C_STOP, 1);   // That byte was NACKed
+            else
+                Sim_I2cPhase(u, SIM_I2C_RX, 9);
+            break;
+        case SIM_I2C_STOP:
+            *regs->ctlw0 &= ~UCTXSTP;
+            *regs->ifg |= UCSTPIFG;
+            if(!s->tr && s->rx_index >= 2)
+            {
+                s->reads++;
+                Sim_Log("i2c%u read %02x = %02x%02x", u - 2, s->cmd, s->rx[1], s->rx[0]);
+            }
+            s->phase = SIM_I2C_IDLE;
+            break;
+        case SIM_I2C_STUCK:
+            *regs->ctlw0 &= ~(UCTXSTT | UCTXSTP);
+            *regs->ifg |= UCCLTOIFG;
+            s->timeouts++;
+            s->phase = SIM_I2C_IDLE;
+            Sim_Log("i2c%u clock low timeout", u - 2);
+            break;
+    }
+}
+
+void Sim_GaugeSet(unsigned char bus, uint8_t cmd, uint16_t value)
+{
+    Sim_Gauges[bus & 1].regs[cmd] = value;
+}
+
+void Sim_GaugeMode(unsigned char bus, char mode)
+{
+    Sim_Gauges[bus & 1].mode = mode;
+}
+
+/************************************************************
+* Module
+************************************************************/
+static void Sim_EusciReset(void)
+{
+    const Sim_EusciRegs *regs;
+    unsigned char u;
+
+    for(u = 0; u < 4; u++)
+    {
+        regs = &Sim_EusciRegs_[u];
+        memset(&Sim_Eusci_[u], 0, sizeof(Sim_EusciState));
+        Sim_Eusci_[u].in_reset = 1;
+        Sim_Eusci_[u].event = SIM_NEVER;
+        *regs->ctlw0 = u < 2 ? UCSWRST : (UCMST | UCSYNC | UCSSEL_3 | UCSWRST);
+        *regs->ctlw1 = u < 2 ? 0 : 0x0003;
+        *regs->brw = 0;
+        if(regs->mctlw)
+            *regs->mctlw = 0;
+        *regs->statw = 0;
+        *regs->rxbuf = 0;
+        *regs->txbuf = SIM_TX_EMPTY;
+        *regs->ie = 0;
+        *regs->ifg = u < 2 ? UCTXIFG : 0;
+        if(regs->i2csa)
+            *regs->i2csa = 0;
+    }
+    Sim_Gauges[0].mode = Sim_Gauges[1].mode = 'y';
+}
+
+static void Sim_EusciSync(void)
+{
+    const Sim_EusciRegs *regs;
+    Sim_EusciState *s;
+    unsigned char u;
+
+    for(u = 0; u < 4; u++)
+    {
+        regs = &Sim_EusciRegs_[u];
+        s = &Sim_Eusci_[u];
+        if(*regs->ctlw0 & UCSWRST)
+        {
+            if(!s->in_reset)
+            {
+                s->in_reset = 1;                // Transfers stop, flags back to reset
+                s->tx_busy = s->tx_full = s->rx_busy = 0;
+                s->phase = SIM_I2C_IDLE;
+                s->event = SIM_NEVER;
+                *regs->ifg = u < 2 ? UCTXIFG : 0;
+                if(u >= 2)
+                    *regs->ie = 0;
+                *regs->ctlw0 &= ~(UCTXSTT | UCTXSTP);
+                if(u < 2)
+                    Sim_UartFlush(u);
+            }
+            *regs->txbuf = SIM_TX_EMPTY;
+            continue;
+        }
+        s->in_reset = 0;
+        if(u < 2)
+            Sim_UartSync(u);
+        else
+            Sim_I2cSync(u);
+    }
+}
+
+static Sim_Time Sim_EusciNext(void)
+{
+    Sim_Time next = SIM_NEVER;
+    const Sim_EusciState *s;
+    unsigned char u;
+
+    for(u = 0; u < 4; u++)
+    {
+        s = &Sim_Eusci_[u];
+        if(u < 2)
+        {
+            if(s->tx_busy && s->tx_done < next)
+                next = s->tx_done;
+            if(s->rx_busy && s->rx_done < next)
+                next = s->rx_done;
+            if(!s->rx_busy && s->rx_tail != s->rx_head && Sim_Now < next)
+                next = Sim_Now;
+        }
+        else if(s->event < next)
+            next = s->event;
+    }
+    return next;
+}
+
+static void Sim_EusciRun(void)
+{
+    unsigned char u;
+
+    for(u = 0; u < 4; u++)
+    {
+        if(u < 2)
+            Sim_UartRun(u);
+        else
+            Sim_I2cRun(u);
+    }
+}
+
+// UCAxIV: RX, TX, STT, TXCPT. UCBxIV (I2C): AL, NACK, STT, STP, RX3..TX0, BCNT, CLTO, BIT9
+uint16_t Sim_EusciIV(unsigned char u)
+{
+    static const uint16_t uart[4] = { UCRXIFG, UCTXIFG, UCSTTIFG, UCTXCPTIFG };
+    static const uint16_t i2c[15] =
+    {
+        UCALIFG, UCNACKIFG, UCSTTIFG, UCSTPIFG, 0x1000, 0x2000, 0x0400, 0x0800,
+        0x0100, 0x0200, UCRXIFG0, UCTXIFG0, UCBCNTIFG, UCCLTOIFG, UCBIT9IFG
+    };
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+    const uint16_t *order = u < 2 ? uart : i2c;
+    unsigned char n = u < 2 ? 4 : 15;
+    unsigned char i;
+
+    for(i = 0; i < n; i++)
+    {
+        if(*regs->ifg & *regs->ie & order[i])
+        {
+            *regs->ifg &= ~order[i];
+            return 2 * (i + 1);
+        }
+    }
+    return 0;
+}
+
+uint8_t Sim_EusciPending(unsigned char u)
+{
+    const Sim_EusciRegs *regs = &Sim_EusciRegs_[u];
+
+    return (*regs->ifg & *regs->ie) != 0;
+}
+
+void Sim_EusciStats(void)
+{
+    const Sim_EusciState *s;
+    unsigned char u;
+
+    for(u = 0; u < 4; u++)
+    {
+        s = &Sim_Eusci_[u];
+        if(u < 2 && (s->tx_bytes || s->rx_bytes || s->rx_lost))
+            fprintf(stderr, "sim: UCA%u %u bytes sent, %u received, %u lost\n", u, s->tx_bytes, s->rx_bytes, s->rx_lost);
+        if(u >= 2 && (s->reads || s->nacks || s->timeouts))
+            fprintf(stderr, "sim: UCB%u %u reads, %u NACKs, %u clock low timeouts\n", u - 2, s->reads, s->nacks, s->timeouts);
+    }
+}
+
+const Sim_Module Sim_Eusci = { "eusci", Sim_EusciReset, Sim_EusciSync, Sim_EusciNext, Sim_EusciRun };
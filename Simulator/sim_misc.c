@@ -0,0 +1,502 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: the small modules. Interrupt vector registers, CRC16, MPY32,
+//  the TLV, RTC counter, watchdog, CS (FLL lock and the DCO tap the
+//  software trim reads), PMM software resets and reference ready flag, and
+//  the SYSCFG0 FRAM write protection over the PERSISTENT variables.
+//
+//  CRCDI, CRCDIRB, CRCINIRES and SYSCFG0 are accessors returning a slot:
+//  the write lands in the slot after the call, and is taken at the next
+//  call or sync point, in order.
+//  __________________________________________________________________________________*/
+#include <stdlib.h>
+#include "sim.h"
+
+#define SIM_WDT_PW_READ     0x6900          // WDTPW reads back as 0x69
+#define SIM_FRWP_PW_READ    0x9600          // FRWPPW reads back as 0x96
+
+// PERSISTENT variables (msp430.h), empty if the program has none
+extern uint8_t __start_sim_fram[] __attribute__((weak));
+extern uint8_t __stop_sim_fram[] __attribute__((weak));
+
+// Down counter on a clock that may stop
+typedef struct
+{
+    Sim_Time due;                           // SIM_NEVER while stopped or unused
+    Sim_Time period;                        // Tick period, 0 = clock stopped
+    uint64_t left;                          // Ticks to go while stopped
+} Sim_Counter;
+
+static void Sim_CounterStart(Sim_Counter *c, uint64_t ticks, Sim_Time period)
+{
+    c->period = period;
+    c->left = ticks;
+    c->due = period ? Sim_Now + ticks * period : SIM_NEVER;
+}
+
+// Clock change: the ticks left run on at the new period
+static void Sim_CounterClock(Sim_Counter *c, Sim_Time period)
+{
+    if(period == c->period)
+        return;
+    if(c->period && c->due != SIM_NEVER)
+        c->left = (c->due - Sim_Now + c->period - 1) / c->period;
+    Sim_CounterStart(c, c->left, period);
+}
+
+static void Sim_CounterStop(Sim_Counter *c)
+{
+    c->due = SIM_NEVER;
+    c->period = 0;
+    c->left = 0;
+}
+
+/************************************************************
+* CRC16, MPY32
+************************************************************/
+static uint16_t Sim_CrcValue;
+static uint16_t Sim_CrcInSlot;
+static signed char Sim_CrcInKind = -1;      // Slot waiting to be taken, -1 none
+static uint16_t Sim_CrcResSlot;
+static uint16_t Sim_CrcResLoaded;
+
+static uint8_t Sim_Reverse8(uint8_t b)
+{
+    b = (uint8_t)((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (uint8_t)((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    return (uint8_t)((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+static uint16_t Sim_Reverse16(uint16_t w)
+{
+    return (uint16_t)(Sim_Reverse8((uint8_t)w) << 8 | Sim_Reverse8((uint8_t)(w >> 8)));
+}
+
+// CRC-CCITT, polynomial 0x1021, MSB first (CRCDIRB and CRCINIRES)
+uint16_t Sim_Crc16(uint16_t crc, const uint8_t *data, unsigned int n)
+{
+    unsigned char i;
+
+    while(n--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for(i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static void Sim_CrcByte(uint8_t b, unsigned char reversed)
+{
+    if(!reversed)
+        b = Sim_Reverse8(b);                // CRCDI takes the data LSB first
+    Sim_CrcValue = Sim_Crc16(Sim_CrcValue, &b, 1);
+}
+
+// Take the slot writes since the last call, input before result
+static void Sim_CrcTake(void)
+{
+    unsigned char reversed;
+
+    if(Sim_CrcResSlot != Sim_CrcResLoaded)
+        Sim_CrcValue = Sim_CrcResSlot;      // CRCINIRES written: seed
+    Sim_CrcResSlot = Sim_CrcResLoaded = Sim_CrcValue;
+    if(Sim_CrcInKind < 0)
+        return;
+    reversed = Sim_CrcInKind == SIM_CRC_DIRB || Sim_CrcInKind == SIM_CRC_DIRB_L;
+    Sim_CrcByte((uint8_t)Sim_CrcInSlot, reversed);
+    if(Sim_CrcInKind == SIM_CRC_DI || Sim_CrcInKind == SIM_CRC_DIRB)
+        Sim_CrcByte((uint8_t)(Sim_CrcInSlot >> 8), reversed);
+    Sim_CrcInKind = -1;
+    Sim_CrcResSlot = Sim_CrcResLoaded = Sim_CrcValue;
+}
+
+volatile uint16_t *Sim_CrcIn(unsigned char kind)
+{
+    Sim_CrcTake();
+    Sim_CrcInSlot = 0;
+    Sim_CrcInKind = (signed char)kind;
+    return &Sim_CrcInSlot;
+}
+
+volatile uint16_t *Sim_CrcResult(unsigned char reversed)
+{
+    static uint16_t reversedSlot;
+
+    Sim_CrcTake();
+    if(!reversed)
+        return &Sim_CrcResSlot;
+    reversedSlot = Sim_Reverse16(Sim_CrcValue);
+    return &reversedSlot;                   // CRCRESR is read only
+}
+
+// RES0..3: MPY32 x OP2 (32 x 32), RESLO/HI: MPY x OP2 (16 x 16)
+uint16_t Sim_MpyResult(unsigned char word)
+{
+    uint64_t res;
+
+    if(word < 4)
+        res = (uint64_t)((uint32_t)MPY32H << 16 | MPY32L) * ((uint32_t)OP2H << 16 | OP2L);
+    else
+    {
+        res = (uint32_t)MPY * OP2;
+        word -= 4;
+    }
+    return (uint16_t)(res >> (16 * word));
+}
+
+/************************************************************
+* TLV
+************************************************************/
+#define SIM_TLV_START       0x1A00
+#define SIM_TLV_WORDS       0x80
+
+static uint16_t Sim_Tlv[SIM_TLV_WORDS];
+
+// A blank TLV but for the ADC calibration, nominal: gain and the 1.5 V
+// reference factor 1, offset 0, the temperature sensor at 30 and 105 degC
+static void Sim_TlvReset(void)
+{
+    memset(Sim_Tlv, 0xFF, sizeof(Sim_Tlv));
+    Sim_Tlv[(0x1A16 - SIM_TLV_START) / 2] = 0x8000;
+    Sim_Tlv[(0x1A18 - SIM_TLV_START) / 2] = 0;
+    Sim_Tlv[(0x1A1A - SIM_TLV_START) / 2] = 2185;
+    Sim_Tlv[(0x1A1C - SIM_TLV_START) / 2] = 2715;
+    Sim_Tlv[(0x1A20 - SIM_TLV_START) / 2] = 0x8000;
+}
+
+uint16_t Sim_TlvWord(uint16_t addr)
+{
+    if(addr < SIM_TLV_START || addr >= SIM_TLV_START + 2 * SIM_TLV_WORDS || (addr & 1))
+    {
+        Sim_Error("TLV read at 0x%04X", addr);
+        return 0xFFFF;
+    }
+    return Sim_Tlv[(addr - SIM_TLV_START) / 2];
+}
+
+// Script, the address checked by the parser
+void Sim_TlvSet(uint16_t addr, uint16_t value)
+{
+    Sim_Tlv[(addr - SIM_TLV_START) / 2] = value;
+}
+
+/************************************************************
+* SYSCFG0 and the PERSISTENT FRAM
+************************************************************/
+static uint8_t *Sim_FramCopy;               // Contents at the last check
+static size_t Sim_FramSize;
+static uint16_t Sim_SysCfg;                 // FRWPOA, DFWP, PFWP
+static uint16_t Sim_SysCfgSlot;
+static uint32_t Sim_FramBlockedCount;
+
+static unsigned char Sim_FramProtected(size_t offset)
+{
+    return (Sim_SysCfg & PFWP) && offset >= (size_t)((Sim_SysCfg & FRWPOA) >> 2) * 1024;
+}
+
+static void Sim_SysCfgTake(void)
+{
+    if(Sim_SysCfgSlot == (SIM_FRWP_PW_READ | Sim_SysCfg))
+        return;
+    if((Sim_SysCfgSlot & 0xFF00) == FRWPPW)
+        Sim_SysCfg = Sim_SysCfgSlot & 0x00FF;
+    else
+        Sim_Error("SYSCFG0 write %04x without FRWPPW, ignored", Sim_SysCfgSlot);
+    Sim_SysCfgSlot = SIM_FRWP_PW_READ | Sim_SysCfg;
+}
+
+// Writes since the last check: kept, or put back if protected
+void Sim_FramCheck(void)
+{
+    size_t i, first = 0;
+    unsigned int blocked = 0;
+
+    if(memcmp(__start_sim_fram, Sim_FramCopy, Sim_FramSize) == 0)
+        return;
+    for(i = 0; i < Sim_FramSize; i++)
+    {
+        if(__start_sim_fram[i] == Sim_FramCopy[i])
+            continue;
+        if(!Sim_FramProtected(i))
+        {
+            Sim_FramCopy[i] = __start_sim_fram[i];
+            continue;
+        }
+        if(blocked++ == 0)
+            first = i;
+        __start_sim_fram[i] = Sim_FramCopy[i];
+    }
+    if(blocked)
+    {
+        Sim_FramBlockedCount += blocked;
+        Sim_Log("FRAM write blocked +0x%04x, %u bytes", (unsigned int)first, blocked);
+    }
+}
+
+volatile uint16_t *Sim_SysCfg0(void)
+{
+    Sim_SysCfgTake();
+    Sim_FramCheck();
+    return &Sim_SysCfgSlot;
+}
+
+uint32_t Sim_FramBlocked(void)
+{
+    return Sim_FramBlockedCount;
+}
+
+// Contents from path if given, and the protection the linker command file
+// sets up with _FRWP_ENABLE: PFWP from the end of the PERSISTENT section
+// on. Without it, the reset state, all program FRAM protected.
+void Sim_FramLoad(const char *path, int protect)
+{
+    FILE *f;
+    size_t n;
+
+    Sim_FramSize = __start_sim_fram ? (size_t)(__stop_sim_fram - __start_sim_fram) : 0;
+    if(path != NULL && (f = fopen(path, "rb")) != NULL)
+    {
+        n = fread(__start_sim_fram, 1, Sim_FramSize, f);
+        if(n != Sim_FramSize || fgetc(f) != EOF)
+            Sim_Error("%s: %u bytes of FRAM for %u, layout changed?", path, (unsigned int)n, (unsigned int)Sim_FramSize);
+        fclose(f);
+    }
+    Sim_FramCopy = malloc(Sim_FramSize ? Sim_FramSize : 1);
+    if(Sim_FramSize)
+        memcpy(Sim_FramCopy, __start_sim_fram, Sim_FramSize);
+    Sim_SysCfg = DFWP | PFWP;
+    if(protect)
+        Sim_SysCfg |= ((Sim_FramSize + 1023) / 1024) << 2 & FRWPOA;
+    Sim_SysCfgSlot = SIM_FRWP_PW_READ | Sim_SysCfg;
+}
+
+void Sim_FramSave(const char *path)
+{
+    FILE *f;
+
+    Sim_SysCfgTake();
+    Sim_FramCheck();
+    if((f = fopen(path, "wb")) == NULL || fwrite(__start_sim_fram, 1, Sim_FramSize, f) != Sim_FramSize)
+        Sim_Error("%s: FRAM not saved", path);
+    if(f != NULL)
+        fclose(f);
+}
+
+/************************************************************
+* RTC
+************************************************************/
+static Sim_Counter Sim_Rtc;
+static uint16_t Sim_RtcCtl;                 // RTCCTL, RTCMOD at the last sync
+static uint16_t Sim_RtcMod;
+
+static Sim_Time Sim_RtcPeriod(void)
+{
+    static const uint16_t prescale[8] = { 1, 10, 100, 1000, 16, 64, 256, 1024 };
+    Sim_Time clk;
+
+    switch(RTCCTL & RTCSS)
+    {
+        case RTCSS_1: clk = Sim_ClockPeriod((SYSCFG2 & RTCCKSEL) ? SIM_CLK_ACLK : SIM_CLK_SMCLK); break;
+        case RTCSS_2: clk = Sim_ClockPeriod(SIM_CLK_REFO); break;   // XT1 stands in
+        case RTCSS_3: clk = Sim_ClockPeriod(SIM_CLK_VLO); break;
+        default:      return 0;
+    }
+    return clk * prescale[(RTCCTL & RTCPS) >> 8];
+}
+
+static void Sim_RtcSync(void)
+{
+    Sim_Time period = Sim_RtcPeriod();
+
+    if((RTCCTL & RTCSR) || ((RTCCTL ^ Sim_RtcCtl) & (RTCSS | RTCPS)) || RTCMOD != Sim_RtcMod)
+    {
+        RTCCTL &= ~RTCSR;
+        if(RTCCTL & RTCSS)
+            Sim_CounterStart(&Sim_Rtc, (uint64_t)RTCMOD + 1, period);
+        else
+            Sim_CounterStop(&Sim_Rtc);
+    }
+    else if(RTCCTL & RTCSS)
+        Sim_CounterClock(&Sim_Rtc, period);
+    Sim_RtcCtl = RTCCTL;
+    Sim_RtcMod = RTCMOD;
+
+    if(Sim_Rtc.period && Sim_Rtc.due != SIM_NEVER)
+        RTCCNT = (uint16_t)(RTCMOD - (Sim_Rtc.due - Sim_Now + Sim_Rtc.period - 1) / Sim_Rtc.period + 1);
+}
+
+static void Sim_RtcRun(void)
+{
+    if(Sim_Now < Sim_Rtc.due)
+        return;
+    RTCCTL |= RTCIFG;
+    Sim_RtcCtl = RTCCTL;
+    Sim_CounterStart(&Sim_Rtc, (uint64_t)RTCMOD + 1, Sim_RtcPeriod());
+}
+
+uint16_t Sim_RtcIV(void)
+{
+    if((RTCCTL & (RTCIFG | RTCIE)) != (RTCIFG | RTCIE))
+        return RTCIV_NONE;
+    RTCCTL &= ~RTCIFG;
+    return RTCIV_RTCIF;
+}
+
+uint8_t Sim_RtcPending(void)
+{
+    return (RTCCTL & (RTCIFG | RTCIE)) == (RTCIFG | RTCIE);
+}
+
+/************************************************************
+* WDT
+************************************************************/
+static Sim_Counter Sim_Wdt;
+static uint16_t Sim_WdtCtl;
+
+static Sim_Time Sim_WdtPeriod(void)
+{
+    if(WDTCTL & WDTHOLD)
+        return 0;
+    switch(WDTCTL & WDTSSEL)
+    {
+        case WDTSSEL_0: return Sim_ClockPeriod(SIM_CLK_SMCLK);
+        case WDTSSEL_1: return Sim_ClockPeriod(SIM_CLK_ACLK);
+        default:        return Sim_ClockPeriod(SIM_CLK_VLO);
+    }
+}
+
+static void Sim_WdtSync(void)
+{
+    static const unsigned char bits[8] = { 31, 27, 23, 19, 15, 13, 9, 6 };
+
+    if((WDTCTL & 0xFF00) != SIM_WDT_PW_READ)
+    {
+        if((WDTCTL & 0xFF00) != WDTPW)
+            Sim_Reset("WDT password");
+        if((WDTCTL & WDTCNTCL) || ((WDTCTL ^ Sim_WdtCtl) & (WDTSSEL | WDTIS | WDTTMSEL)))
+            Sim_CounterStart(&Sim_Wdt, 1ULL << bits[WDTCTL & WDTIS], Sim_WdtPeriod());
+        WDTCTL = SIM_WDT_PW_READ | (WDTCTL & 0x00F7);
+        Sim_WdtCtl = WDTCTL;
+    }
+    Sim_CounterClock(&Sim_Wdt, Sim_WdtPeriod());
+}
+
+static void Sim_WdtRun(void)
+{
+    static const unsigned char bits[8] = { 31, 27, 23, 19, 15, 13, 9, 6 };
+
+    if(Sim_Now < Sim_Wdt.due)
+        return;
+    if(!(WDTCTL & WDTTMSEL))
+        Sim_Reset("watchdog");
+    SFRIFG1 |= WDTIFG;
+    Sim_CounterStart(&Sim_Wdt, 1ULL << bits[WDTCTL & WDTIS], Sim_WdtPeriod());
+}
+
+uint8_t Sim_WdtPending(void)
+{
+    return (SFRIFG1 & SFRIE1 & WDTIFG) && (WDTCTL & WDTTMSEL);
+}
+
+/************************************************************
+* IV registers
+************************************************************/
+uint16_t Sim_ReadIV(unsigned char which)
+{
+    static unsigned char booted;
+
+    Sim_SyncPoint();
+    switch(which)
+    {
+        case SIM_IV_TB0: case SIM_IV_TB1: case SIM_IV_TB2: case SIM_IV_TB3:
+            return Sim_TimerIV(which - SIM_IV_TB0);
+        case SIM_IV_ADC:
+            return Sim_AdcIV();
+        case SIM_IV_UCA0: case SIM_IV_UCA1: case SIM_IV_UCB0: case SIM_IV_UCB1:
+            return Sim_EusciIV(which - SIM_IV_UCA0);
+        case SIM_IV_RTC:
+            return Sim_RtcIV();
+        case SIM_IV_P1: case SIM_IV_P2: case SIM_IV_P3: case SIM_IV_P4:
+            return Sim_PortIV(which - SIM_IV_P1);
+        case SIM_IV_SYSRST:
+            if(booted)
+                return SYSRSTIV_NONE;
+            booted = 1;
+            return SYSRSTIV_BOR;            // Every run starts from power up
+    }
+    return 0;
+}
+
+/************************************************************
+* CS, PMM and the module
+************************************************************/
+static void Sim_CsSync(void)
+{
+    // The FLL locks at once; DCOTAP sits mid range at the best DCOFTRIM
+    // (3), one tap step of 32 per trim step either side
+    CSCTL0 = (CSCTL0 & ~DCOTAP) | (uint16_t)(240 + 32 * (3 - (int)((CSCTL1 & DCOFTRIM) >> 4)));
+    CSCTL7 &= ~(DCOFFG | XT1OFFG | FLLUNLOCK0 | FLLUNLOCK1);
+    SFRIFG1 &= ~OFIFG;
+}
+
+static void Sim_MiscReset(void)
+{
+    CSCTL0 = 0;
+    CSCTL1 = 0x0033;
+    CSCTL2 = 0x101F;
+    CSCTL3 = 0;
+    CSCTL4 = 0;
+    CSCTL5 = 0;
+    CSCTL6 = 0;
+    CSCTL7 = 0;
+    CSCTL8 = 0x0007;
+    PMMCTL0 = 0x9640;
+    PMMCTL2 = 0;
+    Sim_TlvReset();
+    SFRIE1 = 0;
+    SFRIFG1 = 0;
+    SYSCFG2 = 0;
+    RTCCTL = 0;
+    RTCMOD = 0xFFFF;
+    RTCCNT = 0;
+    Sim_RtcCtl = 0;
+    Sim_RtcMod = 0xFFFF;
+    Sim_CounterStop(&Sim_Rtc);
+    WDTCTL = SIM_WDT_PW_READ | WDTIS_4;     // Running from reset, 32 ms on SMCLK
+    Sim_WdtCtl = WDTCTL;
+    Sim_CounterStart(&Sim_Wdt, 1ULL << 15, Sim_WdtPeriod());
+    Sim_CrcValue = Sim_CrcResSlot = Sim_CrcResLoaded = 0xFFFF;
+    Sim_CrcInKind = -1;
+}
+
+static void Sim_MiscSync(void)
+{
+    Sim_CrcTake();
+    Sim_SysCfgTake();
+    if(Sim_FramCopy != NULL)
+        Sim_FramCheck();
+    if(PMMCTL0 & (PMMSWBOR | PMMSWPOR))
+        Sim_Reset((PMMCTL0 & PMMSWBOR) ? "PMMSWBOR" : "PMMSWPOR");
+    if(PMMCTL2 & INTREFEN)                  // The reference settles at once
+        PMMCTL2 |= REFGENRDY;
+    else
+        PMMCTL2 &= ~REFGENRDY;
+    Sim_CsSync();
+    Sim_WdtSync();
+    Sim_RtcSync();
+}
+
+static Sim_Time Sim_MiscNext(void)
+{
+    return Sim_Wdt.due < Sim_Rtc.due ? Sim_Wdt.due : Sim_Rtc.due;
+}
+
+static void Sim_MiscRun(void)
+{
+    Sim_WdtRun();
+    Sim_RtcRun();
+}
+
+const Sim_Module Sim_Misc = { "misc", Sim_MiscReset, Sim_MiscSync, Sim_MiscNext, Sim_MiscRun };
@@ -0,0 +1,176 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: digital I/O P1..P6. A pin is the port output when it is an
+//  output, else what the script drives, else its pull resistor, else low.
+//  The P6 outputs with P6SEL0 set (P6SEL1 clear) are the TB3.1..TB3.6
+//  outputs instead; no other module output is routed to its pin.
+//  P1..P4 set PxIFG on the PxIES edge. Pins are high impedance until
+//  LOCKLPM5 is cleared, and only then are output changes traced. The time
+//  each pin has been high is kept for the script's expect high.
+//  __________________________________________________________________________________*/
+#include "sim.h"
+
+#define SIM_PORTS           6
+
+typedef struct
+{
+    volatile uint16_t *in;
+    volatile uint16_t *out;
+    volatile uint16_t *dir;
+    volatile uint16_t *ren;
+    volatile uint16_t *ies;
+    volatile uint16_t *ie;
+    volatile uint16_t *ifg;
+} Sim_PortRegs;
+
+static const Sim_PortRegs Sim_PortWords[SIM_PORTS / 2] =
+{
+    { &PAIN, &PAOUT, &PADIR, &PAREN, &PAIES, &PAIE, &PAIFG },
+    { &PBIN, &PBOUT, &PBDIR, &PBREN, &PBIES, &PBIE, &PBIFG },
+    { &PCIN, &PCOUT, &PCDIR, &PCREN, &PCIES, &PCIE, &PCIFG }
+};
+
+// Byte of port p (0 = P1) in a word register
+#define SIM_PORT(p, reg)    (((volatile uint8_t *)Sim_PortWords[(p) / 2].reg)[(p) & 1])
+
+static uint8_t Sim_Driven[SIM_PORTS];           // Inputs driven by the script
+static uint8_t Sim_DriveLevel[SIM_PORTS];
+static uint8_t Sim_Pins[SIM_PORTS];             // Pin levels
+static uint8_t Sim_TraceOut[SIM_PORTS];         // Traced OUT & DIR
+static uint8_t Sim_TraceDir[SIM_PORTS];
+static Sim_Time Sim_High[SIM_PORTS][8];         // Time each pin has been high, up to Sim_PinTime
+static Sim_Time Sim_PinTime;
+
+// High time of the pins at their levels since the last update
+static void Sim_PinAccount(void)
+{
+    Sim_Time dt = Sim_Now - Sim_PinTime;
+    unsigned char p, bit;
+
+    for(p = 0; p < SIM_PORTS; p++)
+        for(bit = 0; Sim_Pins[p] >> bit; bit++)
+            if((Sim_Pins[p] >> bit) & 1)
+                Sim_High[p][bit] += dt;
+    Sim_PinTime = Sim_Now;
+}
+
+static void Sim_PortUpdate(void)
+{
+    unsigned char locked = PM5CTL0 & LOCKLPM5;
+    uint8_t dir, out, drive, sel, level, changed;
+    unsigned char p;
+
+    Sim_PinAccount();
+    for(p = 0; p < SIM_PORTS; p++)
+    {
+        dir = locked ? 0 : SIM_PORT(p, dir);
+        out = SIM_PORT(p, out);
+        drive = out;
+        if(p == 5)
+        {
+            sel = P6SEL0 & ~P6SEL1;
+            drive = (out & ~sel) | ((Sim_TimerOutputs(3) >> 1) & sel);
+        }
+        level = (drive & dir)
+              | (Sim_DriveLevel[p] & Sim_Driven[p] & ~dir)
+              | (out & SIM_PORT(p, ren) & ~Sim_Driven[p] & ~dir);
+        changed = level ^ Sim_Pins[p];
+        Sim_Pins[p] = level;
+        SIM_PORT(p, in) = level;
+        if(p < 4 && changed)
+        {
+            // IES 0: rising edge sets PxIFG, 1: falling edge
+            SIM_PORT(p, ifg) |= changed & ((level & ~SIM_PORT(p, ies)) | (~level & SIM_PORT(p, ies)));
+        }
+        if(!locked && ((out & dir) != Sim_TraceOut[p] || dir != Sim_TraceDir[p]))
+        {
+            Sim_TraceOut[p] = out & dir;
+            Sim_TraceDir[p] = dir;
+            Sim_Log("P%u out %02x dir %02x", p + 1, out & dir, dir);
+        }
+    }
+    Sim_TimerInputs();
+}
+
+static void Sim_PortReset(void)
+{
+    unsigned char p;
+
+    for(p = 0; p < SIM_PORTS / 2; p++)
+    {
+        *Sim_PortWords[p].out = 0;
+        *Sim_PortWords[p].dir = 0;
+        *Sim_PortWords[p].ren = 0;
+        *Sim_PortWords[p].ies = 0;
+        *Sim_PortWords[p].ie = 0;
+        *Sim_PortWords[p].ifg = 0;
+    }
+    PASEL0 = PASEL1 = PBSEL0 = PBSEL1 = PCSEL0 = PCSEL1 = 0;
+    PM5CTL0 = LOCKLPM5;
+    memset(Sim_Pins, 0, sizeof(Sim_Pins));
+    memset(Sim_TraceOut, 0, sizeof(Sim_TraceOut));
+    memset(Sim_TraceDir, 0, sizeof(Sim_TraceDir));
+    memset(Sim_High, 0, sizeof(Sim_High));
+    Sim_PinTime = 0;
+}
+
+static Sim_Time Sim_PortNext(void)
+{
+    return SIM_NEVER;
+}
+
+static void Sim_PortRun(void)
+{
+}
+
+void Sim_PinDrive(unsigned char port, unsigned char bit, int level)
+{
+    if(level < 0)
+        Sim_Driven[port] &= ~(1 << bit);
+    else
+    {
+        Sim_Driven[port] |= 1 << bit;
+        if(level)
+            Sim_DriveLevel[port] |= 1 << bit;
+        else
+            Sim_DriveLevel[port] &= ~(1 << bit);
+    }
+    Sim_PortUpdate();
+}
+
+unsigned char Sim_PinLevel(unsigned char port, unsigned char bit)
+{
+    return (Sim_Pins[port] >> bit) & 1;
+}
+
+// Time the pin has been high since the reset
+Sim_Time Sim_PinHigh(unsigned char port, unsigned char bit)
+{
+    Sim_PinAccount();
+    return Sim_High[port][bit];
+}
+
+// PxIV: lowest pending bit first
+uint8_t Sim_PortIV(unsigned char port)
+{
+    uint8_t pending = SIM_PORT(port, ifg) & SIM_PORT(port, ie);
+    unsigned char bit;
+
+    for(bit = 0; bit < 8; bit++)
+    {
+        if(pending & (1 << bit))
+        {
+            SIM_PORT(port, ifg) &= ~(1 << bit);
+            return 2 * (bit + 1);
+        }
+    }
+    return 0;
+}
+
+uint8_t Sim_PortPending(unsigned char port)
+{
+    return (SIM_PORT(port, ifg) & SIM_PORT(port, ie)) != 0;
+}
+
+const Sim_Module Sim_Port = { "port", Sim_PortReset, Sim_PortUpdate, Sim_PortNext, Sim_PortRun };
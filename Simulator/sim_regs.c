@@ -0,0 +1,10 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: register storage. Reset values are set by each model.
+//  __________________________________________________________________________________*/
+#include "sim.h"
+
+#define SIM_DEF8(name)      volatile uint8_t name;
+#define SIM_DEF16(name)     volatile uint16_t name;
+SIM_REGS(SIM_DEF8, SIM_DEF16)
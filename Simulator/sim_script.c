@@ -0,0 +1,628 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: input script (format in sim.h). The events are loaded and
+//  sorted by time before the run, and applied when the clock gets there.
+//  The expect lines are checked the same way, against the host link
+//  frames decoded from UCA1 TX, the pins and the low power mode times; a
+//  failed one is a Sim_Error(), so the run exits 1.
+//  __________________________________________________________________________________*/
+#include <ctype.h>
+#include <stdlib.h>
+#include "sim.h"
+
+#define SIM_SCRIPT_LINE     512
+#define SIM_WAKE_LEN        4               // HOST_WAKE_LEN
+#define SIM_WAKE_TIME       (SIM_WAKE_LEN * 10 * SIM_UNITS_PER_S / 115200)  // Its time on the wire at 115200
+#define SIM_SCRIPT_BYTES    (SIM_WAKE_LEN + 64 + 5) // A host frame, preamble + HOST_MAX_PAYLOAD + overhead
+#define SIM_HOST_SYNC       0xA5
+
+typedef enum
+{
+    SIM_EV_PIN,
+    SIM_EV_ADC,
+    SIM_EV_LOAD,
+    SIM_EV_UART,
+    SIM_EV_GAUGE_REG,
+    SIM_EV_GAUGE_MODE,
+    SIM_EV_TLV,
+    SIM_EV_MARK,
+    SIM_EV_EXPECT,
+    SIM_EV_END
+} Sim_EventKind;
+
+typedef enum
+{
+    SIM_EXPECT_FRAME,
+    SIM_EXPECT_PIN,
+    SIM_EXPECT_HIGH,
+    SIM_EXPECT_MODE
+} Sim_ExpectKind;
+
+typedef struct
+{
+    Sim_Time time;
+    unsigned int line;                      // Ties keep the script order
+    Sim_EventKind kind;
+    unsigned char a, b;                     // Port/bit, channel, UART, bus/cmd
+    uint16_t addr;                          // TLV word
+    int value;                              // Level, code, register value, mode
+    unsigned char n;
+    uint8_t data[SIM_SCRIPT_BYTES];
+    Sim_ExpectKind expect;
+    char field;                             // Frame field: 'b' u8, 'w' u16, 's' i16, 'l' u32
+    long key;                               // Frame: u16 at payload offset 0, -1 = any
+    double min, max;                        // Expected range
+} Sim_Event;
+
+// Host link frames out of UCA1 TX since the last frame into UCA1 RX, the
+// newest SIM_HOST_FRAMES of them
+#define SIM_HOST_FRAMES     256
+
+typedef struct
+{
+    uint8_t type;
+    unsigned char len;
+    uint8_t payload[SIM_SCRIPT_BYTES - 5];
+} Sim_HostFrame;
+
+static Sim_Event *Sim_Events;
+static unsigned int Sim_EventCount;
+static unsigned int Sim_EventNext;
+static Sim_HostFrame Sim_HostFrames[SIM_HOST_FRAMES];
+static unsigned int Sim_HostFrameCount;     // Since the last frame into UCA1 RX
+static uint8_t Sim_HostRx[SIM_SCRIPT_BYTES];
+static unsigned int Sim_HostLen;
+static Sim_Time Sim_MarkTime;
+static Sim_Time Sim_MarkHigh[6][8];
+static unsigned int Sim_Expects;
+static unsigned int Sim_Failed;
+static const char *const Sim_ModeNames[] = { "active", "lpm0", "lpm3", "lpm4" };
+
+static int Sim_ParseTime(const char *s, Sim_Time *t)
+{
+    char *end;
+    double v = strtod(s, &end);
+
+    if(end == s || v < 0)
+        return -1;
+    if(strcmp(end, "s") == 0)
+        v *= 1e6;
+    else if(strcmp(end, "ms") == 0)
+        v *= 1e3;
+    else if(strcmp(end, "us") != 0)
+        return -1;
+    *t = (Sim_Time)(v * SIM_UNITS_PER_US + 0.5);
+    return 0;
+}
+
+static int Sim_ParseReal(const char *s, double *value)
+{
+    char *end;
+
+    if(s == NULL)
+        return -1;
+    *value = strtod(s, &end);
+    return *end == '\0' ? 0 : -1;
+}
+
+// P<port>.<bit>
+static int Sim_ParsePin(const char *s, unsigned char *port, unsigned char *bit)
+{
+    if(s == NULL || toupper((unsigned char)s[0]) != 'P' || s[1] < '1' || s[1] > '6'
+       || s[2] != '.' || s[3] < '0' || s[3] > '7' || s[4] != '\0')
+        return -1;
+    *port = (unsigned char)(s[1] - '1');
+    *bit = (unsigned char)(s[3] - '0');
+    return 0;
+}
+
+static int Sim_ParseNumber(const char *s, long min, long max, int *value)
+{
+    char *end;
+    long v;
+
+    if(s == NULL)
+        return -1;
+    v = strtol(s, &end, 0);
+    if(*end != '\0' || v < min || v > max)
+        return -1;
+    *value = (int)v;
+    return 0;
+}
+
+// Hex bytes, "a5" or "0xa5", from the remaining tokens
+static int Sim_ParseBytes(char *tok, uint8_t *data, unsigned int max)
+{
+    unsigned int n = 0;
+    unsigned long v;
+    char *end;
+
+    for(; tok != NULL; tok = strtok(NULL, " \t"))
+    {
+        v = strtoul(tok, &end, 16);
+        if(*end != '\0' || v > 0xFF || n == max)
+            return -1;
+        data[n++] = (uint8_t)v;
+    }
+    return (int)n;
+}
+
+// expect frame <type>[:<key>] <offset> u8|u16|i16|u32 <min> [<max>]
+// expect frame <type>[:<key>] none
+// expect pin P<port>.<bit> 0|1
+// expect high P<port>.<bit> <min %> [<max %>]
+// expect active|lpm0|lpm3|lpm4 <min %> [<max %>]
+static int Sim_ParseExpect(char *what, Sim_Event *ev)
+{
+    char *tok, *key;
+    int n;
+
+    ev->kind = SIM_EV_EXPECT;
+    if(what == NULL)
+        return -1;
+    if(strcmp(what, "frame") == 0)
+    {
+        ev->expect = SIM_EXPECT_FRAME;
+        if((tok = strtok(NULL, " \t")) == NULL)
+            return -1;
+        ev->key = -1;
+        if((key = strchr(tok, ':')) != NULL)
+        {
+            *key++ = '\0';
+            if(Sim_ParseNumber(key, 0, 0xFFFF, &n) != 0)
+                return -1;
+            ev->key = n;
+        }
+        if(Sim_ParseNumber(tok, 0, 0xFF, &n) != 0)
+            return -1;
+        ev->a = (unsigned char)n;
+        if((tok = strtok(NULL, " \t")) != NULL && strcmp(tok, "none") == 0)
+        {
+            ev->field = 'n';                // Frames of the type, none expected
+            ev->min = ev->max = 0;
+            return 0;
+        }
+        if(Sim_ParseNumber(tok, 0, SIM_SCRIPT_BYTES - 6, &ev->value) != 0)
+            return -1;
+        if((tok = strtok(NULL, " \t")) == NULL)
+            return -1;
+        if(strcmp(tok, "u8") == 0)
+            ev->field = 'b';
+        else if(strcmp(tok, "u16") == 0)
+            ev->field = 'w';
+        else if(strcmp(tok, "i16") == 0)
+            ev->field = 's';
+        else if(strcmp(tok, "u32") == 0)
+            ev->field = 'l';
+        else
+            return -1;
+    }
+    else if(strcmp(what, "pin") == 0 || strcmp(what, "high") == 0)
+    {
+        ev->expect = what[0] == 'p' ? SIM_EXPECT_PIN : SIM_EXPECT_HIGH;
+        if(Sim_ParsePin(strtok(NULL, " \t"), &ev->a, &ev->b) != 0)
+            return -1;
+        if(ev->expect == SIM_EXPECT_PIN)
+        {
+            if(Sim_ParseNumber(strtok(NULL, " \t"), 0, 1, &n) != 0)
+                return -1;
+            ev->min = ev->max = n;
+            return 0;
+        }
+    }
+    else
+    {
+        ev->expect = SIM_EXPECT_MODE;
+        for(n = 0; n < 4 && strcmp(what, Sim_ModeNames[n]) != 0; n++)
+            ;
+        if(n == 4)
+            return -1;
+        ev->a = (unsigned char)n;
+    }
+    if(Sim_ParseReal(strtok(NULL, " \t"), &ev->min) != 0)
+        return -1;
+    if((tok = strtok(NULL, " \t")) == NULL)
+        ev->max = ev->expect == SIM_EXPECT_FRAME ? ev->min : 100.0;
+    else if(Sim_ParseReal(tok, &ev->max) != 0 || ev->max < ev->min)
+        return -1;
+    return 0;
+}
+
+static int Sim_ParseLine(char *text, Sim_Event *ev)
+{
+    char *cmd, *arg, *tok = strtok(text, " \t");
+    uint8_t payload[SIM_SCRIPT_BYTES];
+    uint16_t crc;
+    unsigned char bit;
+    int n, type;
+
+    if(tok == NULL || Sim_ParseTime(tok, &ev->time) != 0)
+        return -1;
+    if((cmd = strtok(NULL, " \t")) == NULL)
+        return -1;
+    arg = strtok(NULL, " \t");
+
+    if(strcmp(cmd, "pin") == 0)
+    {
+        // P<port>.<bit> 0|1|z
+        ev->kind = SIM_EV_PIN;
+        if(Sim_ParsePin(arg, &ev->a, &ev->b) != 0)
+            return -1;
+        if((tok = strtok(NULL, " \t")) == NULL)
+            return -1;
+        if(strcmp(tok, "z") == 0)
+            ev->value = -1;
+        else if(Sim_ParseNumber(tok, 0, 1, &ev->value) != 0)
+            return -1;
+    }
+    else if(strcmp(cmd, "adc") == 0)
+    {
+        ev->kind = SIM_EV_ADC;
+        if(arg == NULL || toupper((unsigned char)arg[0]) != 'A' || Sim_ParseNumber(arg + 1, 0, 15, &n) != 0)
+            return -1;
+        ev->a = (unsigned char)n;
+        if(Sim_ParseNumber(strtok(NULL, " \t"), 0, 0x0FFF, &ev->value) != 0)
+            return -1;
+    }
+    else if(strcmp(cmd, "load") == 0)
+    {
+        // A<n> P<port>.<bit>|off
+        ev->kind = SIM_EV_LOAD;
+        if(arg == NULL || toupper((unsigned char)arg[0]) != 'A' || Sim_ParseNumber(arg + 1, 0, 15, &n) != 0)
+            return -1;
+        ev->a = (unsigned char)n;
+        if((tok = strtok(NULL, " \t")) == NULL)
+            return -1;
+        if(strcmp(tok, "off") == 0)
+            ev->value = -1;
+        else
+        {
+            if(Sim_ParsePin(tok, &ev->b, &bit) != 0)
+                return -1;
+            ev->value = bit;
+        }
+    }
+    else if(strcmp(cmd, "uart") == 0 || strcmp(cmd, "uart0") == 0)
+    {
+        ev->kind = SIM_EV_UART;
+        ev->a = cmd[4] == '0' ? 0 : 1;
+        if((n = Sim_ParseBytes(arg, ev->data, SIM_SCRIPT_BYTES)) <= 0)
+            return -1;
+        ev->n = (unsigned char)n;
+    }
+    else if(strcmp(cmd, "frame") == 0)
+    {
+        // HOST_WAKE_LEN HOST_WAKE, HOST_SYNC, type, len, payload, CRC-CCITT
+        // over type, len and payload
+        uint8_t *f = &ev->data[SIM_WAKE_LEN];
+
+        ev->kind = SIM_EV_UART;
+        ev->a = 1;
+        if(Sim_ParseNumber(arg, 0, 0xFF, &type) != 0)
+            return -1;
+        if((n = Sim_ParseBytes(strtok(NULL, " \t"), payload, SIM_SCRIPT_BYTES - SIM_WAKE_LEN - 5)) < 0)
+            return -1;
+        memset(ev->data, 0xFF, SIM_WAKE_LEN);
+        f[0] = 0xA5;
+        f[1] = (uint8_t)type;
+        f[2] = (uint8_t)n;
+        memcpy(&f[3], payload, n);
+        crc = Sim_Crc16(0xFFFF, &f[1], n + 2);
+        f[3 + n] = (uint8_t)crc;
+        f[4 + n] = (uint8_t)(crc >> 8);
+        ev->n = (unsigned char)(SIM_WAKE_LEN + n + 5);
+        ev->time = ev->time > SIM_WAKE_TIME ? ev->time - SIM_WAKE_TIME : 0;   // Sync byte on time
+    }
+    else if(strcmp(cmd, "i2c") == 0)
+    {
+        if(Sim_ParseNumber(arg, 0, 1, &n) != 0 || (tok = strtok(NULL, " \t")) == NULL)
+            return -1;
+        ev->a = (unsigned char)n;
+        if(strcmp(tok, "reg") == 0)
+        {
+            ev->kind = SIM_EV_GAUGE_REG;
+            if(Sim_ParseNumber(strtok(NULL, " \t"), 0, 0xFF, &n) != 0)
+                return -1;
+            ev->b = (unsigned char)n;
+            if(Sim_ParseNumber(strtok(NULL, " \t"), -32768, 0xFFFF, &ev->value) != 0)
+                return -1;
+        }
+        else
+        {
+            ev->kind = SIM_EV_GAUGE_MODE;
+            if(strcmp(tok, "on") == 0)
+                ev->value = 'y';
+            else if(strcmp(tok, "off") == 0)
+                ev->value = 'n';
+            else if(strcmp(tok, "stuck") == 0)
+                ev->value = 's';
+            else
+                return -1;
+        }
+    }
+    else if(strcmp(cmd, "tlv") == 0)
+    {
+        // <addr> <value>, a word of TLVMEM
+        ev->kind = SIM_EV_TLV;
+        if(Sim_ParseNumber(arg, 0x1A00, 0x1AFE, &n) != 0 || (n & 1))
+            return -1;
+        ev->addr = (uint16_t)n;
+        if(Sim_ParseNumber(strtok(NULL, " \t"), -32768, 0xFFFF, &ev->value) != 0)
+            return -1;
+    }
+    else if(strcmp(cmd, "mark") == 0)
+    {
+        ev->kind = SIM_EV_MARK;
+        if(arg != NULL)
+            return -1;
+    }
+    else if(strcmp(cmd, "expect") == 0)
+    {
+        if(Sim_ParseExpect(arg, ev) != 0)
+            return -1;
+    }
+    else if(strcmp(cmd, "end") == 0)
+        ev->kind = SIM_EV_END;
+    else
+        return -1;
+
+    if(ev->kind != SIM_EV_UART && strtok(NULL, " \t") != NULL)
+        return -1;                          // Trailing junk
+    return 0;
+}
+
+static int Sim_EventOrder(const void *a, const void *b)
+{
+    const Sim_Event *x = a, *y = b;
+
+    if(x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return x->line < y->line ? -1 : (x->line > y->line);
+}
+
+int Sim_ScriptLoad(const char *path)
+{
+    char text[SIM_SCRIPT_LINE];
+    unsigned int line = 0, size = 0;
+    Sim_Event ev;
+    FILE *f;
+    char *p;
+    int errors = 0;
+
+    if((f = fopen(path, "r")) == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    while(fgets(text, sizeof(text), f) != NULL)
+    {
+        line++;
+        if((p = strchr(text, '#')) != NULL)
+            *p = '\0';
+        p = text + strspn(text, " \t\r\n");
+        p[strcspn(p, "\r\n")] = '\0';
+        if(*p == '\0')
+            continue;
+        memset(&ev, 0, sizeof(ev));
+        ev.line = line;
+        if(Sim_ParseLine(p, &ev) != 0)
+        {
+            fprintf(stderr, "%s:%u: bad event\n", path, line);
+            errors++;
+            continue;
+        }
+        if(Sim_EventCount == size)
+        {
+            size = size ? 2 * size : 64;
+            Sim_Events = realloc(Sim_Events, size * sizeof(Sim_Event));
+        }
+        Sim_Events[Sim_EventCount++] = ev;
+    }
+    fclose(f);
+    if(Sim_EventCount)
+        qsort(Sim_Events, Sim_EventCount, sizeof(Sim_Event), Sim_EventOrder);
+    return errors ? -1 : 0;
+}
+
+static void Sim_ScriptReset(void)
+{
+    Sim_EventNext = 0;
+    Sim_HostFrameCount = 0;
+    Sim_HostLen = 0;
+    Sim_MarkTime = 0;
+    memset(Sim_MarkHigh, 0, sizeof(Sim_MarkHigh));
+    Sim_Expects = 0;
+    Sim_Failed = 0;
+}
+
+static Sim_Time Sim_ScriptNext(void)
+{
+    return Sim_EventNext < Sim_EventCount ? Sim_Events[Sim_EventNext].time : SIM_NEVER;
+}
+
+static void Sim_Mark(void)
+{
+    unsigned char port, bit;
+
+    Sim_MarkTime = Sim_Now;
+    for(port = 0; port < 6; port++)
+        for(bit = 0; bit < 8; bit++)
+            Sim_MarkHigh[port][bit] = Sim_PinHigh(port, bit);
+}
+
+// Payload field of the newest frame of the type (and key) since the last
+// frame into UCA1 RX
+static int Sim_FrameField(const Sim_Event *ev, double *value)
+{
+    const Sim_HostFrame *f;
+    const uint8_t *p;
+    unsigned int size = ev->field == 'b' ? 1 : ev->field == 'l' ? 4 : 2;
+    unsigned int i;
+    unsigned int n = 0;
+
+    for(i = Sim_HostFrameCount; i > 0; i--)
+    {
+        f = &Sim_HostFrames[(i - 1) % SIM_HOST_FRAMES];
+        if(Sim_HostFrameCount - i >= SIM_HOST_FRAMES)
+        {
+            if(ev->field != 'n')
+                return -1;                  // Overwritten
+            break;
+        }
+        if(f->type == ev->a && (ev->key < 0 || (f->len >= 2 && (f->payload[0] | f->payload[1] << 8) == ev->key)))
+        {
+            if(ev->field != 'n')
+                break;
+            n++;
+        }
+    }
+    if(ev->field == 'n')
+    {
+        *value = n;
+        return 0;
+    }
+    if(i == 0 || (unsigned int)ev->value + size > f->len)
+        return -1;
+    p = &f->payload[ev->value];
+    switch(ev->field)
+    {
+        case 'b':   *value = p[0]; break;
+        case 'w':   *value = p[0] | p[1] << 8; break;
+        case 's':   *value = (int16_t)(p[0] | p[1] << 8); break;
+        default:    *value = p[0] | p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; break;
+    }
+    return 0;
+}
+
+static void Sim_Expect(const Sim_Event *ev)
+{
+    char what[48];
+    double value = 0;
+    int missing = 0;
+
+    Sim_Expects++;
+    switch(ev->expect)
+    {
+        case SIM_EXPECT_FRAME:
+            if(ev->field == 'n')
+                sprintf(what, "frame 0x%02x count", ev->a);
+            else if(ev->key < 0)
+                sprintf(what, "frame 0x%02x +%d", ev->a, ev->value);
+            else
+                sprintf(what, "frame 0x%02x:%ld +%d", ev->a, ev->key, ev->value);
+            missing = Sim_FrameField(ev, &value);
+            break;
+        case SIM_EXPECT_PIN:
+            sprintf(what, "pin P%u.%u", ev->a + 1, ev->b);
+            value = Sim_PinLevel(ev->a, ev->b);
+            break;
+        case SIM_EXPECT_HIGH:
+            sprintf(what, "high P%u.%u %%", ev->a + 1, ev->b);
+            if(Sim_Now == Sim_MarkTime)
+                missing = -1;
+            else
+                value = 100.0 * (Sim_PinHigh(ev->a, ev->b) - Sim_MarkHigh[ev->a][ev->b])
+                      / (Sim_Now - Sim_MarkTime);
+            break;
+        case SIM_EXPECT_MODE:
+            sprintf(what, "%s %%", Sim_ModeNames[ev->a]);
+            value = Sim_ModePercent(ev->a);
+            break;
+    }
+    if(missing)
+    {
+        Sim_Failed++;
+        Sim_Error("script line %u: expect %s: nothing to check", ev->line, what);
+    }
+    else if(value < ev->min || value > ev->max)
+    {
+        Sim_Failed++;
+        Sim_Error("script line %u: expect %s: %g, not in %g..%g", ev->line, what, value, ev->min, ev->max);
+    }
+    Sim_Log("expect %s: %g %s", what, value, missing || value < ev->min || value > ev->max ? "FAIL" : "ok");
+}
+
+static void Sim_ScriptRun(void)
+{
+    const Sim_Event *ev;
+
+    while(Sim_EventNext < Sim_EventCount && Sim_Events[Sim_EventNext].time <= Sim_Now)
+    {
+        ev = &Sim_Events[Sim_EventNext++];
+        switch(ev->kind)
+        {
+            case SIM_EV_PIN:        Sim_PinDrive(ev->a, ev->b, ev->value); break;
+            case SIM_EV_ADC:        Sim_AdcSet(ev->a, (uint16_t)ev->value); break;
+            case SIM_EV_LOAD:       Sim_AdcLoad(ev->a, ev->b, ev->value); break;
+            case SIM_EV_UART:
+                if(ev->a == 1)
+                    Sim_HostFrameCount = 0; // The frames out so far are stale for expect
+                Sim_UartInject(ev->a, ev->data, ev->n);
+                break;
+            case SIM_EV_GAUGE_REG:  Sim_GaugeSet(ev->a, ev->b, (uint16_t)ev->value); break;
+            case SIM_EV_GAUGE_MODE: Sim_GaugeMode(ev->a, (char)ev->value); break;
+            case SIM_EV_TLV:        Sim_TlvSet(ev->addr, (uint16_t)ev->value); break;
+            case SIM_EV_MARK:       Sim_Mark(); break;
+            case SIM_EV_EXPECT:     Sim_Expect(ev); break;
+            case SIM_EV_END:        Sim_Stop("script end"); break;
+        }
+    }
+}
+
+// A byte out of UCA1 TX: frames with a good CRC are kept for expect
+void Sim_ScriptHostByte(uint8_t byte)
+{
+    Sim_HostFrame *f;
+    unsigned int n;
+    uint16_t crc;
+
+    if(Sim_HostLen == 0 && byte != SIM_HOST_SYNC)
+        return;
+    Sim_HostRx[Sim_HostLen++] = byte;
+    if(Sim_HostLen < 3)
+        return;
+    n = Sim_HostRx[2];
+    if(n > SIM_SCRIPT_BYTES - 5)
+    {
+        Sim_HostLen = 0;                    // Not a frame, look for the next sync
+        return;
+    }
+    if(Sim_HostLen < n + 5)
+        return;
+    Sim_HostLen = 0;
+    crc = Sim_Crc16(0xFFFF, &Sim_HostRx[1], n + 2);
+    if(Sim_HostRx[3 + n] != (uint8_t)crc || Sim_HostRx[4 + n] != (uint8_t)(crc >> 8))
+        return;
+    f = &Sim_HostFrames[Sim_HostFrameCount++ % SIM_HOST_FRAMES];
+    f->type = Sim_HostRx[1];
+    f->len = (unsigned char)n;
+    memcpy(f->payload, &Sim_HostRx[3], n);
+}
+
+// After the run. A halted CPU can not change anything any more, so the
+// expect lines still to come are checked against where it stopped;
+// otherwise they were not reached, and fail.
+void Sim_ScriptFinish(int halted)
+{
+    const Sim_Event *ev;
+
+    for(; Sim_EventNext < Sim_EventCount; Sim_EventNext++)
+    {
+        ev = &Sim_Events[Sim_EventNext];
+        if(ev->kind != SIM_EV_EXPECT)
+            continue;
+        if(halted)
+            Sim_Expect(ev);
+        else
+        {
+            Sim_Expects++;
+            Sim_Failed++;
+            Sim_Error("script line %u: expect not reached", ev->line);
+        }
+    }
+    if(Sim_Expects)
+        fprintf(stderr, "sim: %u expects, %u failed\n", Sim_Expects, Sim_Failed);
+}
+
+const Sim_Module Sim_Script = { "script", Sim_ScriptReset, NULL, Sim_ScriptNext, Sim_ScriptRun };
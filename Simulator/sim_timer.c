@@ -0,0 +1,419 @@
+/* Battery Test Fixure MSP430FR2355 Firmware
+// __________________________________________________________________________________
+//
+//  Simulator: Timer_B0..B3. The counter is not stepped tick by tick: it is
+//  brought up to date from the time of its last tick whenever it is
+//  looked at, and next() is the tick on which it reaches the next compare
+//  value, TBxCL0 or the rollover. Up, continuous and up/down modes, ID and
+//  IDEX dividers, ACLK or SMCLK (TBCLK and INCLK are not modeled, the
+//  timer stands still), CNTL lengths, compare and capture (CCIxA pins,
+//  CCIS GND/VCC; CCIxB reads low), the eight output modes. TBxCLn are
+//  loaded at once whatever CLLD says.
+//  The output of TB0.1, TB1.1 and TB2.1 triggers the ADC on a rising edge;
+//  TB3.1..TB3.6 drive P6.0..P6.5 when P6SEL0 selects them (sim_port.c).
+//  __________________________________________________________________________________*/
+#include "sim.h"
+
+#define SIM_TIMERS          4
+#define SIM_TB_MAX_CH       7
+
+typedef struct
+{
+    volatile uint16_t *ctl;
+    volatile uint16_t *r;
+    volatile uint16_t *ex0;
+    volatile uint16_t *cctl[SIM_TB_MAX_CH];
+    volatile uint16_t *ccr[SIM_TB_MAX_CH];
+    unsigned char channels;
+    unsigned char pin_port[SIM_TB_MAX_CH];      // CCIxA pin, port index (0 = P1)
+    unsigned char pin_bit[SIM_TB_MAX_CH];
+} Sim_TbRegs;
+
+typedef struct
+{
+    uint16_t count;
+    unsigned char down;                         // Up/down mode, counting down
+    Sim_Time last;                              // Time of the last tick
+    Sim_Time period;                            // Tick period, 0 = stopped
+    Sim_Time phase;                             // Time into the tick when stopped
+    uint16_t shadow_r;                          // TBxR as last set here
+    uint8_t cci;                                // Capture inputs, bit per channel
+    uint8_t out;                                // Output units, bit per channel
+} Sim_Tb;
+
+#define SIM_NONE            0xFF
+
+static const Sim_TbRegs Sim_TbRegs_[SIM_TIMERS] =
+{
+    { &TB0CTL, &TB0R, &TB0EX0, { &TB0CCTL0, &TB0CCTL1, &TB0CCTL2 }, { &TB0CCR0, &TB0CCR1, &TB0CCR2 },
+      3, { SIM_NONE, 0, 0 }, { 0, 6, 7 } },             // P1.6, P1.7
+    { &TB1CTL, &TB1R, &TB1EX0, { &TB1CCTL0, &TB1CCTL1, &TB1CCTL2 }, { &TB1CCR0, &TB1CCR1, &TB1CCR2 },
+      3, { SIM_NONE, 1, 1 }, { 0, 0, 1 } },             // P2.0, P2.1
+    { &TB2CTL, &TB2R, &TB2EX0, { &TB2CCTL0, &TB2CCTL1, &TB2CCTL2 }, { &TB2CCR0, &TB2CCR1, &TB2CCR2 },
+      3, { SIM_NONE, 4, 4 }, { 0, 0, 1 } },             // P5.0, P5.1
+    { &TB3CTL, &TB3R, &TB3EX0,
+      { &TB3CCTL0, &TB3CCTL1, &TB3CCTL2, &TB3CCTL3, &TB3CCTL4, &TB3CCTL5, &TB3CCTL6 },
+      { &TB3CCR0, &TB3CCR1, &TB3CCR2, &TB3CCR3, &TB3CCR4, &TB3CCR5, &TB3CCR6 },
+      7, { SIM_NONE, 5, 5, 5, 5, 5, 5 }, { 0, 0, 1, 2, 3, 4, 5 } }     // P6.0..P6.5
+};
+
+static Sim_Tb Sim_Tbs[SIM_TIMERS];
+
+static uint16_t Sim_TbTop(const Sim_TbRegs *regs)
+{
+    uint16_t ctl = *regs->ctl;
+
+    if((ctl & MC) == MC__CONTINUOUS)
+    {
+        switch(ctl & CNTL)
+        {
+            case 0x0800: return 0x0FFF;
+            case 0x1000: return 0x03FF;
+            case 0x1800: return 0x00FF;
+            default:     return 0xFFFF;
+        }
+    }
+    return *regs->ccr[0];
+}
+
+static Sim_Time Sim_TbPeriod(const Sim_TbRegs *regs)
+{
+    uint16_t ctl = *regs->ctl;
+    Sim_Time clk;
+
+    if((ctl & MC) == MC__STOP || ((ctl & MC) != MC__CONTINUOUS && *regs->ccr[0] == 0))
+        return 0;
+    switch(ctl & TBSSEL)
+    {
+        case TBSSEL__ACLK:  clk = Sim_ClockPeriod(SIM_CLK_ACLK); break;
+        case TBSSEL__SMCLK: clk = Sim_ClockPeriod(SIM_CLK_SMCLK); break;
+        default:            clk = 0; break;
+    }
+    return clk * (1 << ((ctl & ID) >> 6)) * ((*regs->ex0 & TBIDEX) + 1);
+}
+
+static void Sim_TbOutput(unsigned char t, unsigned char ch, unsigned char level)
+{
+    Sim_Tb *tb = &Sim_Tbs[t];
+    unsigned char was = (tb->out >> ch) & 1;
+
+    if(level)
+        tb->out |= 1 << ch;
+    else
+        tb->out &= ~(1 << ch);
+    if(ch == 1 && t < 3 && level && !was)
+        Sim_AdcTrigger(t + 1);                      // ADCSHS_1..3
+    if(t == 3 && ch != 0 && level != was)
+        Sim_Port.sync();                            // P6 pin on the TB3 output
+}
+
+uint8_t Sim_TimerOutputs(unsigned char t)
+{
+    return Sim_Tbs[t].out;
+}
+
+// The counter has just reached tb->count
+static void Sim_TbArrive(unsigned char t)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    Sim_Tb *tb = &Sim_Tbs[t];
+    unsigned char equ0 = tb->count == *regs->ccr[0];
+    unsigned char ch;
+    uint16_t cctl;
+    unsigned char out;
+
+    for(ch = 0; ch < regs->channels; ch++)
+    {
+        cctl = *regs->cctl[ch];
+        if(cctl & CAP)
+            continue;
+        out = (tb->out >> ch) & 1;
+        if(tb->count == *regs->ccr[ch])
+        {
+            *regs->cctl[ch] |= CCIFG;
+            switch(cctl & OUTMOD)
+            {
+                case OUTMOD_1: case OUTMOD_3:   out = 1; break;
+                case OUTMOD_2: case OUTMOD_4:
+                case OUTMOD_6:                  out ^= 1; break;
+                case OUTMOD_5: case OUTMOD_7:   out = 0; break;
+                default:                        break;
+            }
+        }
+        if(equ0 && ch != 0)
+        {
+            switch(cctl & OUTMOD)
+            {
+                case OUTMOD_2: case OUTMOD_3:   out = 0; break;
+                case OUTMOD_6: case OUTMOD_7:   out = 1; break;
+                default:                        break;
+            }
+        }
+        if((cctl & OUTMOD) == OUTMOD_0)
+            out = (cctl & OUT) ? 1 : 0;
+        Sim_TbOutput(t, ch, out);
+    }
+}
+
+// Ticks to the next count that sets a flag or flips a direction
+static uint32_t Sim_TbDistance(unsigned char t)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    Sim_Tb *tb = &Sim_Tbs[t];
+    uint16_t top = Sim_TbTop(regs);
+    uint32_t best;
+    uint16_t v;
+    unsigned char ch;
+
+    if(tb->count > top)
+        return 1;                                   // TBxCL0 moved below the count, rolls to 0
+    if(tb->down)
+        best = tb->count;
+    else if((*regs->ctl & MC) == MC__UPDOWN)
+        best = top - tb->count;
+    else
+        best = top - tb->count + 1;                 // Rollover to 0
+    if(best == 0)
+        best = 1;
+    for(ch = 0; ch < regs->channels; ch++)
+    {
+        if(*regs->cctl[ch] & CAP)
+            continue;
+        v = *regs->ccr[ch];
+        if(!tb->down && v > tb->count && v <= top && (uint32_t)(v - tb->count) < best)
+            best = v - tb->count;
+        if(tb->down && v < tb->count && (uint32_t)(tb->count - v) < best)
+            best = tb->count - v;
+    }
+    return best;
+}
+
+static void Sim_TbTicks(unsigned char t, uint64_t n)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    Sim_Tb *tb = &Sim_Tbs[t];
+    uint16_t top;
+    uint32_t d;
+    uint64_t step;
+
+    while(n > 0)
+    {
+        top = Sim_TbTop(regs);
+        if(tb->count > top)
+        {
+            tb->count = 0;                          // Rolls to zero
+            *regs->ctl |= TBIFG;
+            Sim_TbArrive(t);
+            n--;
+            continue;
+        }
+        d = Sim_TbDistance(t);
+        step = n < d ? n : d;
+        n -= step;
+        if(tb->down)
+            tb->count -= step;
+        else if((*regs->ctl & MC) != MC__UPDOWN && tb->count + step > top)
+            tb->count = 0;                          // Rollover
+        else
+            tb->count += step;
+        if(step < d)
+            break;
+        if(tb->count == 0)
+        {
+            *regs->ctl |= TBIFG;
+            tb->down = 0;
+        }
+        if((*regs->ctl & MC) == MC__UPDOWN && tb->count == top && !tb->down)
+            tb->down = 1;
+        Sim_TbArrive(t);
+    }
+}
+
+// Count the ticks since the last update, then pick up the clock
+static void Sim_TbCatchUp(unsigned char t)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    Sim_Tb *tb = &Sim_Tbs[t];
+    Sim_Time period;
+    uint64_t n;
+
+    if(tb->period && Sim_Now >= tb->last + tb->period)
+    {
+        n = (Sim_Now - tb->last) / tb->period;
+        tb->last += n * tb->period;
+        Sim_TbTicks(t, n);
+    }
+
+    period = Sim_TbPeriod(regs);
+    if(period == tb->period)
+        return;
+    if(period == 0)
+        tb->phase = Sim_Now - tb->last;             // Stopped mid tick
+    else if(tb->period == 0)
+        tb->last = Sim_Now - (tb->phase < period ? tb->phase : 0);
+    else
+        tb->last = Sim_Now;                         // New clock, the tick in progress is lost
+    tb->period = period;
+}
+
+static void Sim_TbCapture(unsigned char t, unsigned char ch)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+
+    if(*regs->cctl[ch] & CCIFG)
+        *regs->cctl[ch] |= COV;
+    *regs->ccr[ch] = Sim_Tbs[t].count;
+    *regs->cctl[ch] |= CCIFG;
+}
+
+void Sim_TimerInputs(void)
+{
+    const Sim_TbRegs *regs;
+    Sim_Tb *tb;
+    unsigned char t, ch, level, was;
+    uint16_t cctl;
+
+    for(t = 0; t < SIM_TIMERS; t++)
+    {
+        regs = &Sim_TbRegs_[t];
+        tb = &Sim_Tbs[t];
+        for(ch = 0; ch < regs->channels; ch++)
+        {
+            cctl = *regs->cctl[ch];
+            switch(cctl & CCIS)
+            {
+                case CCIS__CCIA:
+                    level = regs->pin_port[ch] == SIM_NONE ? 0 : Sim_PinLevel(regs->pin_port[ch], regs->pin_bit[ch]);
+                    break;
+                case CCIS__VCC: level = 1; break;
+                default:        level = 0; break;
+            }
+            was = (tb->cci >> ch) & 1;
+            if(level == was)
+                continue;
+            tb->cci ^= 1 << ch;
+            *regs->cctl[ch] = level ? (cctl | CCI) : (cctl & ~CCI);
+            if((cctl & CAP) && (((cctl & CM_1) && level) || ((cctl & CM_2) && !level)))
+            {
+                Sim_TbCatchUp(t);
+                Sim_TbCapture(t, ch);
+            }
+        }
+    }
+}
+
+static void Sim_TimerReset(void)
+{
+    const Sim_TbRegs *regs;
+    unsigned char t, ch;
+
+    for(t = 0; t < SIM_TIMERS; t++)
+    {
+        regs = &Sim_TbRegs_[t];
+        *regs->ctl = 0;
+        *regs->r = 0;
+        *regs->ex0 = 0;
+        for(ch = 0; ch < regs->channels; ch++)
+        {
+            *regs->cctl[ch] = 0;
+            *regs->ccr[ch] = 0;
+        }
+        memset(&Sim_Tbs[t], 0, sizeof(Sim_Tb));
+    }
+}
+
+static void Sim_TimerSync(void)
+{
+    const Sim_TbRegs *regs;
+    Sim_Tb *tb;
+    unsigned char t, ch;
+
+    for(t = 0; t < SIM_TIMERS; t++)
+    {
+        regs = &Sim_TbRegs_[t];
+        tb = &Sim_Tbs[t];
+        Sim_TbCatchUp(t);
+        if(*regs->ctl & TBCLR)
+        {
+            *regs->ctl &= ~TBCLR;                   // Counter, divider and direction
+            tb->count = 0;
+            tb->down = 0;
+            tb->last = Sim_Now;
+            tb->phase = 0;
+        }
+        else if(*regs->r != tb->shadow_r)
+            tb->count = *regs->r;                   // Written by the firmware
+        Sim_TbCatchUp(t);
+        for(ch = 0; ch < regs->channels; ch++)
+            if((*regs->cctl[ch] & (CAP | OUTMOD)) == OUTMOD_0)
+                Sim_TbOutput(t, ch, (*regs->cctl[ch] & OUT) ? 1 : 0);
+        *regs->r = tb->count;
+        tb->shadow_r = tb->count;
+    }
+}
+
+static Sim_Time Sim_TimerNext(void)
+{
+    Sim_Time next = SIM_NEVER;
+    Sim_Time t;
+    unsigned char i;
+
+    for(i = 0; i < SIM_TIMERS; i++)
+    {
+        if(Sim_Tbs[i].period == 0)
+            continue;
+        t = Sim_Tbs[i].last + Sim_TbDistance(i) * Sim_Tbs[i].period;
+        if(t < next)
+            next = t;
+    }
+    return next;
+}
+
+static void Sim_TimerRun(void)
+{
+    unsigned char t;
+
+    for(t = 0; t < SIM_TIMERS; t++)
+    {
+        Sim_TbCatchUp(t);
+        *Sim_TbRegs_[t].r = Sim_Tbs[t].count;
+        Sim_Tbs[t].shadow_r = Sim_Tbs[t].count;
+    }
+}
+
+// TBxIV: CCR1..CCR6, then TBIFG, enabled flags only
+uint16_t Sim_TimerIV(unsigned char t)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    unsigned char ch;
+
+    for(ch = 1; ch < regs->channels; ch++)
+    {
+        if((*regs->cctl[ch] & (CCIE | CCIFG)) == (CCIE | CCIFG))
+        {
+            *regs->cctl[ch] &= ~CCIFG;
+            return 2 * ch;
+        }
+    }
+    if((*regs->ctl & (TBIE | TBIFG)) == (TBIE | TBIFG))
+    {
+        *regs->ctl &= ~TBIFG;
+        return TBIV__TBIFG;
+    }
+    return 0;
+}
+
+uint8_t Sim_TimerPending(unsigned char t, unsigned char vector)
+{
+    const Sim_TbRegs *regs = &Sim_TbRegs_[t];
+    unsigned char ch;
+
+    if(vector == 0)
+        return (*regs->cctl[0] & (CCIE | CCIFG)) == (CCIE | CCIFG);
+    for(ch = 1; ch < regs->channels; ch++)
+        if((*regs->cctl[ch] & (CCIE | CCIFG)) == (CCIE | CCIFG))
+            return 1;
+    return (*regs->ctl & (TBIE | TBIFG)) == (TBIE | TBIFG);
+}
+
+const Sim_Module Sim_Timer = { "timer", Sim_TimerReset, Sim_TimerSync, Sim_TimerNext, Sim_TimerRun };